@@ -1,4 +1,20 @@
 import FWCore.ParameterSet.Config as cms
+from FWCore.ParameterSet.VarParsing import VarParsing
+
+options = VarParsing('python')
+options.register('nThreads', 16, VarParsing.multiplicity.singleton, VarParsing.varType.int,
+                 "number of threads (and streams) of the job")
+options.register('timing', 0, VarParsing.multiplicity.singleton, VarParsing.varType.int,
+                 "0: no stage timing, 1: stage timing summary at the end of the job, 2: also the timing ttree")
+options.register('branchGroups', '', VarParsing.multiplicity.list, VarParsing.varType.string,
+                 "branch groups of the ttree (Event, PV, MET, Jet, Electron, Muon, Track, TrackSim, Gen, GenPacked, GenFromLLP, GenFromBC, GenJet, LLP, Hemi), all if empty")
+options.register('backend', 'ttree', VarParsing.multiplicity.singleton, VarParsing.varType.string,
+                 "ttree, rntuple (CMSSW_14_0 and 14_1, ROOT 6.30) or both, to compare them at the end of the job")
+options.register('selection', 'none', VarParsing.multiplicity.singleton, VarParsing.varType.string,
+                 "Z->mumu + HT selection in front of the ntupling: none, reject (failing events are dropped) or record (only their event record is written)")
+options.register('parquetFile', '', VarParsing.multiplicity.singleton, VarParsing.varType.string,
+                 "if set, also write the tracks (with their sim columns) and hemispheres to <parquetFile>_tracks.parquet and <parquetFile>_hemis.parquet (needs Arrow)")
+options.parseArguments()
 
 from Configuration.Eras.Era_Run2_2018_cff import Run2_2018
 
@@ -19,7 +35,7 @@ process.load("Configuration.Geometry.GeometryRecoDB_cff")
 process.load("Configuration.StandardSequences.MagneticField_cff")
 ##----------------end of paul------------------------##
 
-process.maxEvents = cms.untracked.PSet( input = cms.untracked.int32(-1) )
+process.maxEvents = cms.untracked.PSet( input = cms.untracked.int32(options.maxEvents) ) # maxEvents=N on the command line, all by default
 #$$ process.maxEvents = cms.untracked.PSet( input = cms.untracked.int32(200) )
 
 # Input source
@@ -158,8 +174,17 @@ process.Flag_CSCTightHalo2015Filter = cms.Path(process.CSCTightHalo2015Filter)
 process.Flag_BadPFMuonDzFilter = cms.Path(process.BadPFMuonDzFilter)
 process.MINIAODSIMoutput_step = cms.EndPath(process.MINIAODSIMoutput)
 
-# FlyingTopAnalyzer
-process.FlyingTop = cms.EDAnalyzer("FlyingTopAnalyzer",
+# FlyingTopFilter: Z->mumu (Mmumu > 60 GeV) + HT (> 180 GeV) selection from the muons and jets, before the track stages
+process.FlyingTopFilter = cms.EDFilter("FlyingTopFilter",
+    mode         = cms.untracked.string(options.selection if options.selection != 'none' else 'reject'), # reject or record
+    minMmumu     = cms.untracked.double(60.),
+    minHT        = cms.untracked.double(180.),
+    jets         = cms.InputTag('slimmedJets'),
+    muons        = cms.InputTag("slimmedMuons")
+)
+
+# FlyingTopProducer computes the ntuple content, on all the streams
+process.FlyingTopProducer = cms.EDProducer("FlyingTopProducer",
 #$$
 #    weightFileMVA = cms.untracked.string( "TMVAbgctau50withnhits.xml"), # BDToldreco
 #    weightFileMVA = cms.untracked.string( "TMVAClassification_BDTG50sansalgo.weights.xml"), # BDToldrecosansalgo  
@@ -167,6 +192,10 @@ process.FlyingTop = cms.EDAnalyzer("FlyingTopAnalyzer",
     weightFileMVA = cms.untracked.string( "TMVAClassification_BDTG50cm_HighPurity.weights.xml"), # BDTrecohpsansalgo  
 #    weightFileMVA = cms.untracked.string( "TMVAClassification_BDTG50cm_sansntrk10_avecHP.weights.xml"), # BDTrecohpsansalgosansntrk10  
 #$$
+    firstHitPropagation = cms.untracked.string("cmssw"), # cmssw (PropaHitPattern), helix (HelixPropagator) or validate (run both, store cmssw)
+    timing       = cms.untracked.bool(options.timing > 0), # time the stages of produce() and print them at the end of the job
+    branchGroups = cms.untracked.vstring(options.branchGroups), # groups not listed are not computed when nothing else needs them
+    selection    = cms.untracked.InputTag('FlyingTopFilter' if options.selection == 'record' else ''), # event record only for the events failing it
     genpruned    = cms.InputTag('prunedGenParticles'),
     genpacked    = cms.InputTag('packedGenParticles'),
     genjets      = cms.InputTag("slimmedGenJets"),
@@ -182,11 +211,31 @@ process.FlyingTop = cms.EDAnalyzer("FlyingTopAnalyzer",
     trackLabel   = cms.InputTag('generalTracks')
 )
 
+# FlyingTopAnalyzer writes it to the ttree
+process.FlyingTop = cms.EDAnalyzer("FlyingTopAnalyzer",
+    src          = cms.InputTag('FlyingTopProducer'),
+    timing       = cms.untracked.bool(options.timing > 0), # time smalltree->Fill()
+    timingTree   = cms.untracked.bool(options.timing > 1), # write the stage times and counters to the timing ttree
+    branchGroups = cms.untracked.vstring(options.branchGroups), # groups written to the ttree
+    parquetFile      = cms.untracked.string(options.parquetFile), # flat track and hemisphere tables, none if empty
+    parquetBatchRows = cms.untracked.uint32(100000), # rows per Parquet row group, written in the background
+    parquetMaxPending = cms.untracked.uint32(4), # row groups queued for the writing before the event thread waits for it
+    backend      = cms.untracked.string(options.backend), # ttree, rntuple or both
+    rntupleFile  = cms.untracked.string("FlyingTop_rntuple.root"),
+    rntuplePageSize    = cms.untracked.uint32(1024), # (kB) unzipped page size
+    rntupleClusterSize = cms.untracked.uint32(200),  # (MB) zipped cluster size
+    readBack     = cms.untracked.vstring("tree_track_pt", "tree_track_eta", "tree_track_firstHit_x", "tree_jet_pt", "tree_Hemi_Vtx_x") # read back at the end of the job (backend = both)
+)
+
 process.FlyingTop_step = cms.EndPath(process.FlyingTop)
 
 process.FlyingTopNtuple = cms.Path( 
-    process.FlyingTop
+    process.FlyingTopProducer + process.FlyingTop
 )
+if options.selection not in ['none', 'reject', 'record']:
+    raise ValueError("selection must be none, reject or record, not " + options.selection)
+if options.selection != 'none':
+    process.FlyingTopNtuple.insert(0, process.FlyingTopFilter)
 
 ########## output of ntuple
 #$$
@@ -226,7 +275,9 @@ from PhysicsTools.PatAlgos.slimming.miniAOD_tools import miniAOD_customizeAllMC
 process = miniAOD_customizeAllMC(process)
 
 #$$ 
-process.options.numberOfThreads=cms.untracked.uint32(16)
+# events/s are printed by FlyingTopProducer at the end of the job, run with nThreads=1,4,8,16 for the scaling
+process.options.numberOfThreads=cms.untracked.uint32(options.nThreads)
+process.options.numberOfStreams=cms.untracked.uint32(0)
 #$$ 
 
 # End of customisation functions
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+# Compares the ttree of a job with a reduced branchGroups to the one of a job with all the groups, on the same input:
+# every branch of the reduced ttree must be identical, event by event, to the same branch of the full one.
+#   cmsRun flyingtop.py nThreads=1 ; mv UDD_bgctau50_smu275_snu225_BDTrecohpsansalgo.root full.root
+#   cmsRun flyingtop.py nThreads=1 branchGroups=Event,PV,Jet,Muon,Track,LLP,Hemi ; mv UDD_bgctau50_smu275_snu225_BDTrecohpsansalgo.root reduced.root
+#   python3 flyingtop_compare.py full.root reduced.root
+# The events are matched by run, lumi and event number, so the two jobs may run with several threads.
+# Needs uproot, awkward and numpy.
+
+import argparse
+import sys
+
+import awkward as ak
+import numpy as np
+import uproot
+
+parser = argparse.ArgumentParser(description="compare a reduced branchGroups ttree to the full one")
+parser.add_argument("fullFile", help="TFileService file of the job with all the branch groups")
+parser.add_argument("reducedFile", help="TFileService file of the job with the reduced branchGroups")
+parser.add_argument("--tree", default="FlyingTop/ttree")
+args = parser.parse_args()
+
+keys = ["runNumber", "lumiBlock", "eventNumber"]
+
+
+def order(tree):
+    # entry of each event, sorted by (run, lumi, event)
+    ids = tree.arrays(keys, library="np")
+    return np.lexsort([ids[key] for key in reversed(keys)]), {key: ids[key] for key in keys}
+
+
+full = uproot.open(args.fullFile)[args.tree]
+reduced = uproot.open(args.reducedFile)[args.tree]
+fullOrder, fullIds = order(full)
+reducedOrder, reducedIds = order(reduced)
+if len(fullOrder) != len(reducedOrder) or any(not np.array_equal(fullIds[key][fullOrder], reducedIds[key][reducedOrder]) for key in keys):
+    sys.exit("the two files do not have the same events")
+
+missing = [name for name in reduced.keys() if name not in full.keys()]
+if missing:
+    sys.exit("branches of the reduced file not in the full one: " + " ".join(missing))
+
+
+def identical(a, b):
+    # same number of values in each event, then the same values (NaN == NaN, the values are written by the same code)
+    if a.ndim > 1 and not ak.all(ak.num(a) == ak.num(b)):
+        return False
+    a, b = ak.ravel(a), ak.ravel(b)
+    return bool(ak.all((a == b) | ((a != a) & (b != b))))
+
+
+nDiff = 0
+for name in reduced.keys():
+    if not identical(full[name].array(library="ak")[fullOrder], reduced[name].array(library="ak")[reducedOrder]):
+        nDiff += 1
+        print("%s differs" % name)
+
+print("%d events, %d branches compared, %d differ" % (len(fullOrder), len(reduced.keys()), nDiff))
+sys.exit(1 if nDiff else 0)
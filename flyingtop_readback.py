@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+# Time to read the same track and hemisphere columns from the Parquet tables written by FlyingTopAnalyzer
+# (parquetFile) and from the ttree of the TFileService file, with uproot, as flat numpy arrays in both cases.
+#   python3 flyingtop_readback.py Ntuple_AOD.root FlyingTop
+# reads Ntuple_AOD.root and FlyingTop_tracks.parquet, FlyingTop_hemis.parquet.
+# Needs pyarrow, uproot and awkward.
+
+import argparse
+import time
+
+import awkward as ak
+import numpy as np
+import pyarrow.parquet as pq
+import uproot
+
+parser = argparse.ArgumentParser(description="read back the FlyingTop tracks and hemispheres from Parquet and from the ttree")
+parser.add_argument("rootFile", help="TFileService file with FlyingTop/ttree")
+parser.add_argument("parquetFile", help="parquetFile of FlyingTopAnalyzer, without _tracks.parquet / _hemis.parquet")
+parser.add_argument("--tree", default="FlyingTop/ttree")
+parser.add_argument("--trackColumns", nargs="+", default=["tree_track_pt", "tree_track_eta", "tree_track_phi", "tree_track_firstHit_x", "tree_track_MVAval"])
+parser.add_argument("--hemiColumns", nargs="+", default=["tree_Hemi_eta", "tree_Hemi_phi", "tree_Hemi_Vtx_x", "tree_Hemi_Vtx_NChi2"])
+parser.add_argument("--repeat", type=int, default=3, help="best of repeat reads")
+args = parser.parse_args()
+
+
+def best(read):
+    times = []
+    for i in range(args.repeat):
+        t0 = time.perf_counter()
+        columns = read()
+        times.append(time.perf_counter() - t0)
+    return min(times), columns
+
+
+def parquet(fileName, columns):
+    # one row per track or hemisphere, with the run, lumi and event keys
+    table = pq.read_table(fileName, columns=["run", "lumi", "event"] + columns)
+    return {name: table.column(name).to_numpy() for name in table.column_names}
+
+
+def ttree(tree, columns):
+    # jagged per event, flattened to one value per track or hemisphere, with the event keys repeated
+    arrays = tree.arrays(["runNumber", "lumiBlock", "eventNumber"] + columns, library="ak")
+    counts = ak.num(arrays[columns[0]])
+    flat = {name: ak.to_numpy(ak.flatten(arrays[name])) for name in columns}
+    for key, branch in (("run", "runNumber"), ("lumi", "lumiBlock"), ("event", "eventNumber")):
+        flat[key] = np.repeat(ak.to_numpy(arrays[branch]), counts)
+    return flat
+
+
+tree = uproot.open(args.rootFile)[args.tree]
+for table, columns in (("tracks", args.trackColumns), ("hemis", args.hemiColumns)):
+    fileName = "%s_%s.parquet" % (args.parquetFile, table)
+    parquetTime, fromParquet = best(lambda: parquet(fileName, columns))
+    ttreeTime, fromTree = best(lambda: ttree(tree, columns))
+    nValues = sum(len(fromParquet[name]) for name in columns)
+    print("%s: %d rows, %d values" % (table, len(fromParquet[columns[0]]), nValues))
+    print("   Parquet (pyarrow) %8.3f s, %8.1f M values/s" % (parquetTime, 1.e-6 * nValues / parquetTime))
+    print("   ttree   (uproot)  %8.3f s, %8.1f M values/s" % (ttreeTime, 1.e-6 * nValues / ttreeTime))
+    # the Parquet rows are in the order of the writing, the same as the ttree entries in a single job
+    for name in ["run", "lumi", "event"] + columns:
+        if len(fromParquet[name]) != len(fromTree[name]):
+            print("   %s: %d rows in Parquet, %d in the ttree" % (name, len(fromParquet[name]), len(fromTree[name])))
+        elif not np.array_equal(np.nan_to_num(fromParquet[name]), np.nan_to_num(fromTree[name])):
+            print("   %s: different values" % name)
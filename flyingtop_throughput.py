@@ -0,0 +1,38 @@
+#!/usr/bin/env python3
+# Throughput of the FlyingTop job with 1, 4, 8 and 16 threads: runs flyingtop.py once per thread count on the same
+# events and reads the events/s of the "FlyingTop summary" line that FlyingTopProducer prints at the end of the job
+# (counted from the first event, so the loading of the conditions and of the BDT weights is not included).
+#   python3 flyingtop_throughput.py --maxEvents 2000
+#   python3 flyingtop_throughput.py --threads 1 8 --maxEvents 500 -- branchGroups=Event,Track,Hemi
+# The arguments after -- are passed to flyingtop.py. Needs cmsRun, from a CMSSW environment.
+
+import argparse
+import re
+import subprocess
+import sys
+import time
+
+parser = argparse.ArgumentParser(description="events/s of flyingtop.py as a function of the number of threads")
+parser.add_argument("--config", default="flyingtop.py")
+parser.add_argument("--threads", type=int, nargs="+", default=[1, 4, 8, 16])
+parser.add_argument("--maxEvents", type=int, default=1000, help="events of each job")
+parser.add_argument("extra", nargs="*", help="other options of flyingtop.py")
+args = parser.parse_args()
+
+summary = re.compile(r"FlyingTop summary: (\d+) events, ([0-9.eE+-]+) events/s")
+
+print("%8s %8s %12s %10s %10s" % ("threads", "events", "events/s", "speedup", "job (s)"))
+first = None  # events/s of the first thread count, the speedup is relative to it
+for nThreads in args.threads:
+    command = ["cmsRun", args.config, "nThreads=%d" % nThreads, "maxEvents=%d" % args.maxEvents] + args.extra
+    t0 = time.perf_counter()
+    job = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    jobTime = time.perf_counter() - t0
+    match = summary.search(job.stdout)
+    if job.returncode != 0 or not match:
+        sys.stdout.write(job.stdout[-5000:])
+        sys.exit("%s failed (exit code %d)" % (" ".join(command), job.returncode))
+    rate = float(match.group(2))
+    if first is None:
+        first = rate
+    print("%8d %8s %12.2f %10.2f %10.1f" % (nThreads, match.group(1), rate, rate / first, jobTime))
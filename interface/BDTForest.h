@@ -0,0 +1,221 @@
+#ifndef FlyingTop_BDTForest_h
+#define FlyingTop_BDTForest_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+// user include files
+#include "TXMLEngine.h"
+#include "FWCore/Utilities/interface/Exception.h"
+/*---------------*/
+
+// Flat copy of a TMVA BDTG forest read from its weights XML.
+// Each node is stored as (input index, cut, two child indices) in contiguous arrays, with the
+// cut type of the node already folded into the order of the children: the next node is always
+// child[2*node + (x[var] >= cut)]. Leaves point to themselves, so a tree is walked with a fixed
+// number of steps (its depth) and no branch, allocation or virtual call.
+// Only gradient boosted forests without input transformations are supported (same output as
+// MethodBDT::GetGradBoostMVA), anything else throws at construction.
+
+class BDTForest {
+   public:
+
+      //Constructor
+      //inputs gives the expressions of the variables in the order they are passed to Evaluate()
+      BDTForest(const std::string& weightFile, const std::vector<std::string>& inputs)
+        {
+          TXMLEngine xml;
+          XMLDocPointer_t doc = xml.ParseFile(weightFile.c_str());
+          if ( !doc ) throw cms::Exception("BDTForest") << "cannot parse " << weightFile;
+          DocGuard guard {xml, doc}; // frees the document on every exit, the throws included
+          XMLNodePointer_t setup = xml.DocGetRootElement(doc);
+
+          std::vector<int> inputIndex; // position in inputs for each variable of the xml
+          bool isGrad = false;
+          for (XMLNodePointer_t node = xml.GetChild(setup); node; node = xml.GetNext(node))
+            {
+              std::string name = xml.GetNodeName(node);
+              if ( name == "Options" )
+                {
+                  for (XMLNodePointer_t opt = xml.GetChild(node); opt; opt = xml.GetNext(opt))
+                    {
+                      const char* optName = xml.GetAttr(opt, "name");
+                      const char* content = xml.GetNodeContent(opt);
+                      if ( optName && content && std::string(optName) == "BoostType" ) isGrad = ( std::string(content) == "Grad" );
+                    }
+                }
+              else if ( name == "Transformations" )
+                {
+                  const char* ntr = xml.GetAttr(node, "NTransformations");
+                  if ( ntr && std::atoi(ntr) != 0 )
+                    throw cms::Exception("BDTForest") << "input transformations are not supported in " << weightFile;
+                }
+              else if ( name == "Variables" )
+                {
+                  for (XMLNodePointer_t var = xml.GetChild(node); var; var = xml.GetNext(var))
+                    {
+                      const char* attr = xml.GetAttr(var, "Expression");
+                      if ( !attr ) throw cms::Exception("BDTForest") << "variable without Expression in " << weightFile;
+                      std::string expr = attr;
+                      int idx = -1;
+                      for (unsigned int i=0; i<inputs.size(); i++) if ( inputs[i] == expr ) idx = i;
+                      if ( idx < 0 ) throw cms::Exception("BDTForest") << "variable " << expr << " of " << weightFile << " is not an input";
+                      inputIndex.push_back(idx);
+                    }
+                }
+              else if ( name == "Weights" )
+                {
+                  for (XMLNodePointer_t tree = xml.GetChild(node); tree; tree = xml.GetNext(tree))
+                    {
+                      XMLNodePointer_t top = xml.GetChild(tree);
+                      if ( !top ) continue;
+                      int depth = 0;
+                      Root.push_back(AddNode(xml, top, inputIndex, 0, depth));
+                      Depth.push_back(depth);
+                    }
+                }
+            }
+
+          if ( !isGrad ) throw cms::Exception("BDTForest") << weightFile << " is not a gradient boosted forest";
+          if ( Root.empty() ) throw cms::Exception("BDTForest") << "no tree found in " << weightFile;
+          if ( inputs.size() > kMaxInputs ) throw cms::Exception("BDTForest") << "too many inputs";
+          NInputs = inputs.size();
+        }
+
+      //Destructor
+      ~BDTForest(){}
+
+      //-------Main Method--------//
+      //x holds the NInputs values in the order given at construction
+      double Evaluate(const float* x) const
+        {
+          double sum = 0.;
+          for (unsigned int t=0; t<Root.size(); t++)
+            {
+              int32_t n = Root[t];
+              for (int d=0; d<Depth[t]; d++) n = Child[2*n + (x[Var[n]] >= Cut[n])];
+              sum += Res[n];
+            }
+          return 2./(1.+exp(-2.*sum)) - 1.;
+        }
+
+      //Batch of n events given as columns: x[i][k] is input i of event k, out[k] receives its score.
+      //The trees are walked for kLanes events at a time with independent lanes, so that the inner
+      //loops map onto one SIMD gather/compare per step; each event sums its trees in the same order
+      //as Evaluate(x) and gets a bit-identical result.
+      void Evaluate(const float* const* x, unsigned int n, double* out) const
+        {
+          for (unsigned int k0=0; k0<n; k0+=kLanes)
+            {
+              const unsigned int m = std::min(kLanes, n-k0);
+              if ( m < kLanes ) // remaining events, scalar fallback
+                {
+                  float in[kMaxInputs];
+                  for (unsigned int l=0; l<m; l++)
+                    {
+                      for (unsigned int i=0; i<NInputs; i++) in[i] = x[i][k0+l];
+                      out[k0+l] = Evaluate(in);
+                    }
+                  break;
+                }
+              double  sum[kLanes];
+              int32_t node[kLanes];
+              for (unsigned int l=0; l<kLanes; l++) sum[l] = 0.;
+              for (unsigned int t=0; t<Root.size(); t++)
+                {
+                  for (unsigned int l=0; l<kLanes; l++) node[l] = Root[t];
+                  for (int d=0; d<Depth[t]; d++)
+                    for (unsigned int l=0; l<kLanes; l++)
+                      node[l] = Child[2*node[l] + (x[Var[node[l]]][k0+l] >= Cut[node[l]])];
+                  for (unsigned int l=0; l<kLanes; l++) sum[l] += Res[node[l]];
+                }
+              for (unsigned int l=0; l<kLanes; l++) out[k0+l] = 2./(1.+exp(-2.*sum[l])) - 1.;
+            }
+        }
+
+#if defined(__AVX512F__)
+      static constexpr unsigned int kLanes = 16;
+#else
+      static constexpr unsigned int kLanes = 8;
+#endif
+      static constexpr unsigned int kMaxInputs = 32;
+
+      //-----Access Data Members------//
+      unsigned int NTrees() const {return Root.size();}
+      unsigned int NNodes() const {return Var.size();}
+      unsigned int NVariables() const {return NInputs;}
+
+   private:
+      //-------Loading from xml--------//
+      int32_t AddNode(TXMLEngine& xml, XMLNodePointer_t node, const std::vector<int>& inputIndex, int depth, int& maxDepth)
+        {
+          int32_t n = Var.size();
+          Var.push_back(0);
+          Cut.push_back(std::numeric_limits<float>::infinity());
+          Child.push_back(n);
+          Child.push_back(n);
+          Res.push_back(0.);
+          if ( depth > maxDepth ) maxDepth = depth;
+
+          XMLNodePointer_t left = 0, right = 0;
+          for (XMLNodePointer_t child = xml.GetChild(node); child; child = xml.GetNext(child))
+            {
+              const char* pos = xml.GetAttr(child, "pos");
+              if ( pos && pos[0] == 'l' ) left = child;
+              if ( pos && pos[0] == 'r' ) right = child;
+            }
+          if ( !left || !right ) // leaf
+            {
+              Res[n] = ReadFloat(xml, node, "res");
+              return n;
+            }
+
+          int ivar = std::atoi(ReadAttr(xml, node, "IVar"));
+          if ( ivar < 0 || ivar >= int(inputIndex.size()) ) throw cms::Exception("BDTForest") << "bad IVar " << ivar;
+          if ( xml.HasAttr(node, "NCoef") && std::atoi(xml.GetAttr(node, "NCoef")) != 0 )
+            throw cms::Exception("BDTForest") << "Fisher cuts are not supported";
+          Var[n] = inputIndex[ivar];
+          Cut[n] = ReadFloat(xml, node, "Cut");
+          int32_t l = AddNode(xml, left,  inputIndex, depth+1, maxDepth);
+          int32_t r = AddNode(xml, right, inputIndex, depth+1, maxDepth);
+          bool cutType = std::atoi(ReadAttr(xml, node, "cType")) == 1; // true : goes right if x >= cut
+          Child[2*n]   = cutType ? l : r;
+          Child[2*n+1] = cutType ? r : l;
+          return n;
+        }
+
+      //Attribute of a node, throws if it is missing
+      static const char* ReadAttr(TXMLEngine& xml, XMLNodePointer_t node, const char* name)
+        {
+          const char* val = xml.GetAttr(node, name);
+          if ( !val ) throw cms::Exception("BDTForest") << "node without " << name << " attribute";
+          return val;
+        }
+      static float ReadFloat(TXMLEngine& xml, XMLNodePointer_t node, const char* name)
+        {
+          return std::strtof(ReadAttr(xml, node, name), nullptr);
+        }
+
+      struct DocGuard {
+        TXMLEngine& Xml;
+        XMLDocPointer_t Doc;
+        ~DocGuard() {Xml.FreeDoc(Doc);}
+      };
+
+      // ----------member data ---------------------------
+      unsigned int NInputs = 0;
+      std::vector<int32_t> Root;  // first node of each tree
+      std::vector<int>     Depth; // number of steps to reach any leaf of each tree
+      std::vector<int32_t> Var;   // input index tested by each node
+      std::vector<float>   Cut;   // cut value of each node
+      std::vector<int32_t> Child; // 2 per node, [x < cut, x >= cut]
+      std::vector<float>   Res;   // response of each leaf, 0 for the other nodes
+};
+
+#endif
@@ -1,14 +1,72 @@
-#include <TMath.h>
-double Deltar(double eta1, double phi1, double eta2, double phi2) {
-  double DeltaPhi = TMath::Abs(phi2 - phi1);
-  if (DeltaPhi > 3.141593 ) DeltaPhi = 2.*3.141593 - DeltaPhi;
-  return TMath::Sqrt( (eta2-eta1)*(eta2-eta1) + DeltaPhi*DeltaPhi );
-}
-double Deltaphi(double phi1, double phi2) {
-  double DeltaPhi = phi1 - phi2;
-  if (abs(DeltaPhi) > 3.141593 ) {
-    DeltaPhi = 2.*3.141593 - abs(DeltaPhi);
-    DeltaPhi = -DeltaPhi * (phi1 - phi2) / abs(phi1 - phi2);
-  }
-  return DeltaPhi;
-}
\ No newline at end of file
+#ifndef FlyingTop_DeltaFunc_h
+#define FlyingTop_DeltaFunc_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <cmath>
+/*---------------*/
+
+// DeltaPhi and DeltaR^2 kernels, in float.
+// The phi difference is wrapped into [-pi, pi] by subtracting the nearest multiple of 2 pi, computed with a
+// conversion to int (no branch, no library call), with 2 pi split in two constants so that the wrapped
+// value keeps the float precision of dphi. For dphi = +-pi exactly, the sign of the result is not defined.
+// The scalar forms are for single calls, the array forms (one object against n others, n x m matrix)
+// have no branch in their loops, so that the compiler vectorizes them. DeltaR is left to the caller:
+// compare DeltaR2 to the squared cut, and take the sqrt only when the value is kept.
+
+namespace DeltaFunc {
+  constexpr float kTwoPiHi  = 6.28125f;                 // 2 pi = kTwoPiHi + kTwoPiLo, kTwoPiHi with 8 significant bits
+  constexpr float kTwoPiLo  = 1.9353071795864769e-3f;
+  constexpr float kInvTwoPi = 0.15915494309189535f;
+}
+
+//DeltaPhi wrapped in [-pi, pi]
+inline float DeltaPhi(float phi1, float phi2)
+{
+  const float dphi = phi1 - phi2;
+  const float k = int(dphi * DeltaFunc::kInvTwoPi + std::copysign(0.5f, dphi));
+  return ( dphi - k * DeltaFunc::kTwoPiHi ) - k * DeltaFunc::kTwoPiLo;
+}
+
+//DeltaR^2 (no sqrt)
+inline float DeltaR2(float eta1, float phi1, float eta2, float phi2)
+{
+  const float deta = eta1 - eta2;
+  const float dphi = DeltaPhi(phi1, phi2);
+  return deta * deta + dphi * dphi;
+}
+
+//-------One against n--------//
+//dphi[i] = DeltaPhi(phi, phi2[i])
+inline void DeltaPhi(float phi, unsigned int n, const float* __restrict__ phi2, float* __restrict__ dphi)
+{
+  for (unsigned int i=0; i<n; i++) dphi[i] = DeltaPhi(phi, phi2[i]);
+}
+
+//dr2[i] = DeltaR2(eta, phi, eta2[i], phi2[i])
+inline void DeltaR2(float eta, float phi, unsigned int n, const float* __restrict__ eta2, const float* __restrict__ phi2, float* __restrict__ dr2)
+{
+  for (unsigned int i=0; i<n; i++) dr2[i] = DeltaR2(eta, phi, eta2[i], phi2[i]);
+}
+
+//Smallest i with DeltaR2(eta, phi, eta2[i], phi2[i]) < dr2Cut, -1 if none
+inline int FirstWithin(float eta, float phi, unsigned int n, const float* __restrict__ eta2, const float* __restrict__ phi2, float dr2Cut)
+{
+  int first = n;
+  for (unsigned int i=0; i<n; i++)
+    {
+      const int k = ( DeltaR2(eta, phi, eta2[i], phi2[i]) < dr2Cut ) ? int(i) : int(n);
+      first = ( k < first ) ? k : first;
+    }
+  return ( first < int(n) ) ? first : -1;
+}
+
+//-------n x m--------//
+//dr2[i*m+j] = DeltaR2(eta1[i], phi1[i], eta2[j], phi2[j])
+inline void DeltaR2(unsigned int n, const float* eta1, const float* phi1,
+                    unsigned int m, const float* eta2, const float* phi2, float* __restrict__ dr2)
+{
+  for (unsigned int i=0; i<n; i++) DeltaR2(eta1[i], phi1[i], m, eta2, phi2, dr2 + i*m);
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef FlyingTop_EtaPhiGrid_h
+#define FlyingTop_EtaPhiGrid_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+// user include files
+#include "DeltaFunc.h"
+/*---------------*/
+
+// Uniform eta-phi binning of a set of objects of one event, to find the ones close to a given
+// direction without looping over all of them.
+// Phi is periodic, with a period of 2 pi for a usual eta-phi grid (or pi when phi is only known
+// modulo pi), eta is binned in [-EtaMax, EtaMax] and the objects beyond go in the edge bins.
+// The objects are stored by cell (counting sort), in increasing index inside a cell, with their positions.
+// Visit() gives a superset of the objects in the window, the caller still applies its own cuts.
+// First() applies a DeltaR cut itself, on the positions given to Fill(), for grids with a 2 pi period.
+
+class EtaPhiGrid {
+   public:
+
+      //Constructor
+      EtaPhiGrid(float etaCell, float phiCell, float phiPeriod = 2*M_PI, float etaMax = 5.) :
+        EtaMax (etaMax), PhiPeriod (phiPeriod)
+        {
+          NEta = std::max(1, int(std::ceil(2*etaMax / etaCell)));
+          NPhi = std::max(1, int(std::ceil(phiPeriod / phiCell)));
+          EtaCell = 2*etaMax / NEta;
+          PhiCell = phiPeriod / NPhi;
+          Start.assign(NEta*NPhi+1, 0);
+        }
+
+      //Destructor
+      ~EtaPhiGrid(){}
+
+      //-------Filling--------//
+      //n objects, the index given to Visit() is the position in the arrays; use (if given) selects the objects to fill
+      void Fill(unsigned int n, const float* eta, const float* phi, const char* use = nullptr)
+        {
+          std::fill(Start.begin(), Start.end(), 0);
+          std::vector<int> cell(n, -1);
+          for (unsigned int i=0; i<n; i++)
+            {
+              if ( use && !use[i] ) continue;
+              cell[i] = EtaBin(eta[i]) * NPhi + PhiBin(phi[i]);
+              Start[cell[i]+1]++;
+            }
+          for (unsigned int c=0; c<Start.size()-1; c++) Start[c+1] += Start[c];
+          Items.resize(Start.back());
+          ItemEta.resize(Start.back());
+          ItemPhi.resize(Start.back());
+          std::vector<int> next(Start.begin(), Start.end()-1);
+          for (unsigned int i=0; i<n; i++) if ( cell[i] >= 0 )
+            {
+              const int k = next[cell[i]]++;
+              Items[k] = i;
+              ItemEta[k] = eta[i];
+              ItemPhi[k] = phi[i];
+            }
+        }
+
+      //-------Queries--------//
+      //Calls f(i) for each object in the cells overlapping [eta-dEta, eta+dEta] x [phi-dPhi, phi+dPhi]
+      template <class F> void Visit(float eta, float phi, float dEta, float dPhi, F&& f) const
+        {
+          Ranges(eta, phi, dEta, dPhi, [&](int begin, int end) { for (int k=begin; k<end; k++) f(Items[k]); });
+        }
+
+      //Smallest index of the objects with DeltaR < dR to (eta,phi), -1 if none
+      int First(float eta, float phi, float dR) const
+        {
+          const int none = std::numeric_limits<int>::max();
+          int first = none;
+          const float dR2 = dR * dR;
+          Ranges(eta, phi, dR, dR, [&](int begin, int end) {
+            for (int k=begin; k<end; k++)
+              {
+                const int i = ( DeltaR2(eta, phi, ItemEta[k], ItemPhi[k]) < dR2 ) ? Items[k] : none;
+                first = std::min(first, i);
+              }
+          });
+          return ( first < none ) ? first : -1;
+        }
+
+      unsigned int Size() const {return Items.size();}
+
+   private:
+      //Calls g(begin, end) for the ranges of Items in the cells overlapping the window : the cells of an eta row
+      //are contiguous in phi, so there are one or two ranges (when the window crosses the end of the period) per row
+      template <class G> void Ranges(float eta, float phi, float dEta, float dPhi, G&& g) const
+        {
+          const int eta0 = EtaBin(eta - dEta), eta1 = EtaBin(eta + dEta);
+          int phi0 = Floor((phi - dPhi) / PhiCell);
+          int phi1 = Floor((phi + dPhi) / PhiCell);
+          if ( phi1 - phi0 + 1 >= NPhi ) { phi0 = 0; phi1 = NPhi - 1; }
+          const int shift = ( (phi0 % NPhi) + NPhi ) % NPhi - phi0;
+          phi0 += shift;
+          phi1 += shift;
+          for (int ie=eta0; ie<=eta1; ie++)
+            {
+              const int row = ie * NPhi;
+              if ( phi1 < NPhi ) g(Start[row+phi0], Start[row+phi1+1]);
+              else
+                {
+                  g(Start[row+phi0], Start[row+NPhi]);
+                  g(Start[row], Start[row+phi1-NPhi+1]);
+                }
+            }
+        }
+
+      //floor() by a conversion to int, which does not need a library call
+      static int Floor(float x)
+        {
+          int i = int(x);
+          return i - ( x < i );
+        }
+      int EtaBin(float eta) const
+        {
+          int bin = Floor((eta + EtaMax) / EtaCell);
+          return std::min(std::max(bin, 0), NEta-1);
+        }
+      int PhiBin(float phi) const
+        {
+          int bin = Floor((phi - PhiPeriod * Floor(phi / PhiPeriod)) / PhiCell);
+          return std::min(std::max(bin, 0), NPhi-1);
+        }
+
+      // ----------member data ---------------------------
+      float EtaMax, PhiPeriod, EtaCell, PhiCell;
+      int NEta, NPhi;
+      std::vector<int> Start;  // first item of each cell (NEta*NPhi+1)
+      std::vector<int> Items;  // object indices sorted by cell
+      std::vector<float> ItemEta, ItemPhi;  // positions of the objects, in the order of Items
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef FlyingTop_FirstHitGrid_h
+#define FlyingTop_FirstHitGrid_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+/*---------------*/
+
+// Uniform 3D grid over the first hit positions of the tracks of one event, used to count the
+// neighbours of each track within a few radii (ntrk10/20/30) without looping over all the pairs.
+// The points are sorted by cell, so that a query only looks at the 27 cells around the point.
+// The cell size has to be at least the largest radius asked for.
+
+class FirstHitGrid {
+   public:
+
+      //Constructor
+      FirstHitGrid(float cellSize) : CellSize (cellSize) {}
+
+      //Destructor
+      ~FirstHitGrid(){}
+
+      //-------Filling--------//
+      //n points, the point index used in the queries is the position in the arrays
+      void Fill(unsigned int n, const float* x, const float* y, const float* z)
+        {
+          X.assign(x, x+n);
+          Y.assign(y, y+n);
+          Z.assign(z, z+n);
+          Cells.resize(n);
+          for (unsigned int i=0; i<n; i++) Cells[i] = std::make_pair(Key(Cell(x[i]), Cell(y[i]), Cell(z[i])), i);
+          std::sort(Cells.begin(), Cells.end());
+        }
+
+      //-------Queries--------//
+      //Number of other points with a squared distance to point i below each of the nR values of r2
+      void Count(unsigned int i, unsigned int nR, const float* r2, int* count) const
+        {
+          for (unsigned int r=0; r<nR; r++) count[r] = 0;
+          const float xi = X[i], yi = Y[i], zi = Z[i];
+          const int cx = Cell(xi), cy = Cell(yi), cz = Cell(zi);
+          for (int ix=cx-1; ix<=cx+1; ix++)
+          for (int iy=cy-1; iy<=cy+1; iy++)
+          for (int iz=cz-1; iz<=cz+1; iz++)
+            {
+              auto first = std::lower_bound(Cells.begin(), Cells.end(), std::make_pair(Key(ix, iy, iz), 0u));
+              for (auto it = first; it != Cells.end() && it->first == Key(ix, iy, iz); ++it)
+                {
+                  unsigned int j = it->second;
+                  if ( j == i ) continue;
+                  float d2 = (xi-X[j])*(xi-X[j]) + (yi-Y[j])*(yi-Y[j]) + (zi-Z[j])*(zi-Z[j]);
+                  for (unsigned int r=0; r<nR; r++) count[r] += ( d2 < r2[r] );
+                }
+            }
+        }
+
+      unsigned int Size() const {return X.size();}
+
+   private:
+      int Cell(float v) const {return int(std::floor(v / CellSize));}
+      // 21 bits per coordinate, far more than the tracker needs with cells of a few cm
+      static int64_t Key(int ix, int iy, int iz)
+        {
+          return ( (int64_t(ix) & 0x1FFFFF) << 42 ) | ( (int64_t(iy) & 0x1FFFFF) << 21 ) | ( int64_t(iz) & 0x1FFFFF );
+        }
+
+      // ----------member data ---------------------------
+      float CellSize;
+      std::vector<float> X, Y, Z;
+      std::vector<std::pair<int64_t, unsigned int> > Cells; // (cell key, point index) sorted by cell
+};
+
+#endif
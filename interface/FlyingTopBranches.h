@@ -0,0 +1,272 @@
+#ifndef FlyingTop_FlyingTopBranches_h
+#define FlyingTop_FlyingTopBranches_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <string>
+/*---------------*/
+
+// Registry of the branches of the FlyingTop ntuple: each one is declared once, in FLYINGTOP_BRANCHES, as
+//   X(group, type, name)
+// with the group it belongs to, the type of the FlyingTopEvent member and the name of the member and of the branch,
+// in the order of the ttree. FlyingTopEvent declares its members from it and FlyingTopAnalyzer creates the branches
+// from it, group by group. The groups are:
+//   Event      : run, event, lumi block, Z candidate and HT filter flags
+//   PV         : primary vertices
+//   MET, Jet, Electron, Muon
+//   Track      : per track reco, first hit, BDT and hemisphere association
+//   TrackSim   : per track truth matching
+//   Gen        : gen PV, pruned genparticles, dR between the neutralinos
+//   GenPacked  : packed genparticles
+//   GenFromLLP : final gen particles from the LLP decays
+//   GenFromBC  : gen particles from b and c hadron decays
+//   GenJet     : gen jets
+//   LLP        : generated LLPs and their vertices
+//   Hemi       : hemispheres and their vertices
+// The groups written to the ttree are chosen with the branchGroups parameter of FlyingTopProducer and FlyingTopAnalyzer.
+
+class FlyingTopBranches {
+  public:
+
+    enum Group { Event, PV, MET, Jet, Electron, Muon, Track, TrackSim, Gen, GenPacked, GenFromLLP, GenFromBC, GenJet, LLP, Hemi, NGroups };
+
+    static const char* GroupName(int group)
+      {
+        static const char* names[NGroups] = { "Event", "PV", "MET", "Jet", "Electron", "Muon", "Track", "TrackSim", "Gen", "GenPacked", "GenFromLLP", "GenFromBC", "GenJet", "LLP", "Hemi" };
+        return names[group];
+      }
+    //Group of the given name, -1 if none
+    static int GroupIndex(const std::string& name)
+      {
+        for (int i=0; i<NGroups; i++) if ( name == GroupName(i) ) return i;
+        return -1;
+      }
+};
+
+#define FLYINGTOP_BRANCHES(X) \
+  X(Event,      int,                         runNumber) \
+  X(Event,      int,                         eventNumber) \
+  X(Event,      int,                         lumiBlock) \
+  X(PV,         int,                         tree_nPV) \
+  X(PV,         std::vector<float>,          tree_PV_x) \
+  X(PV,         std::vector<float>,          tree_PV_y) \
+  X(PV,         std::vector<float>,          tree_PV_z) \
+  X(PV,         std::vector<float>,          tree_PV_ez) \
+  X(PV,         std::vector<float>,          tree_PV_NChi2) \
+  X(PV,         std::vector<float>,          tree_PV_ndf) \
+  X(Event,      int,                         tree_NbrOfZCand) \
+  X(Event,      bool,                        tree_passesHTFilter) \
+  X(MET,        float,                       tree_PFMet_et) \
+  X(MET,        float,                       tree_PFMet_phi) \
+  X(MET,        float,                       tree_PFMet_sig) \
+  X(Jet,        int,                         tree_njet) \
+  X(Jet,        std::vector<float>,          tree_jet_E) \
+  X(Jet,        std::vector<float>,          tree_jet_pt) \
+  X(Jet,        std::vector<float>,          tree_jet_eta) \
+  X(Jet,        std::vector<float>,          tree_jet_phi) \
+  X(Electron,   std::vector<float>,          tree_electron_pt) \
+  X(Electron,   std::vector<float>,          tree_electron_eta) \
+  X(Electron,   std::vector<float>,          tree_electron_phi) \
+  X(Electron,   std::vector<float>,          tree_electron_x) \
+  X(Electron,   std::vector<float>,          tree_electron_y) \
+  X(Electron,   std::vector<float>,          tree_electron_z) \
+  X(Electron,   std::vector<float>,          tree_electron_energy) \
+  X(Electron,   std::vector<int>,            tree_electron_charge) \
+  X(Muon,       float,                       tree_Mmumu) \
+  X(Muon,       std::vector<float>,          tree_muon_pt) \
+  X(Muon,       std::vector<float>,          tree_muon_eta) \
+  X(Muon,       std::vector<float>,          tree_muon_phi) \
+  X(Muon,       std::vector<float>,          tree_muon_x) \
+  X(Muon,       std::vector<float>,          tree_muon_y) \
+  X(Muon,       std::vector<float>,          tree_muon_z) \
+  X(Muon,       std::vector<float>,          tree_muon_energy) \
+  X(Muon,       std::vector<float>,          tree_muon_dxy) \
+  X(Muon,       std::vector<float>,          tree_muon_dxyError) \
+  X(Muon,       std::vector<float>,          tree_muon_dz) \
+  X(Muon,       std::vector<float>,          tree_muon_dzError) \
+  X(Muon,       std::vector<int>,            tree_muon_charge) \
+  X(Muon,       std::vector<bool>,           tree_muon_isLoose) \
+  X(Muon,       std::vector<bool>,           tree_muon_isTight) \
+  X(Muon,       std::vector<bool>,           tree_muon_isGlobal) \
+  X(Track,      int,                         tree_nTracks) \
+  X(Track,      std::vector<float>,          tree_track_pt) \
+  X(Track,      std::vector<float>,          tree_track_eta) \
+  X(Track,      std::vector<float>,          tree_track_phi) \
+  X(Track,      std::vector<int>,            tree_track_charge) \
+  X(Track,      std::vector<float>,          tree_track_NChi2) \
+  X(Track,      std::vector<bool>,           tree_track_isLoose) \
+  X(Track,      std::vector<bool>,           tree_track_isTight) \
+  X(Track,      std::vector<bool>,           tree_track_isHighPurity) \
+  X(Track,      std::vector<float>,          tree_track_dxy) /* with respect to PV */ \
+  X(Track,      std::vector<float>,          tree_track_dxyError) \
+  X(Track,      std::vector<float>,          tree_track_drSig) \
+  X(Track,      std::vector<float>,          tree_track_dz) /* with respect to PV */ \
+  X(Track,      std::vector<float>,          tree_track_dzError) \
+  X(Track,      std::vector<int>,            tree_track_numberOfLostHits) \
+  X(Track,      std::vector<unsigned int>,   tree_track_originalAlgo) \
+  X(Track,      std::vector<unsigned int>,   tree_track_algo) \
+  X(Track,      std::vector<unsigned short>, tree_track_stopReason) \
+  X(Track,      std::vector<int>,            tree_track_nHit) \
+  X(Track,      std::vector<int>,            tree_track_nHitPixel) \
+  X(Track,      std::vector<int>,            tree_track_nHitTIB) \
+  X(Track,      std::vector<int>,            tree_track_nHitTID) \
+  X(Track,      std::vector<int>,            tree_track_nHitTOB) \
+  X(Track,      std::vector<int>,            tree_track_nHitTEC) \
+  X(Track,      std::vector<int>,            tree_track_nHitPXB) \
+  X(Track,      std::vector<int>,            tree_track_nHitPXF) \
+  X(Track,      std::vector<int>,            tree_track_isHitPixel) \
+  X(Track,      std::vector<int>,            tree_track_nLayers) \
+  X(Track,      std::vector<int>,            tree_track_nLayersPixel) \
+  X(Track,      std::vector<int>,            tree_track_stripTECLayersWithMeasurement) \
+  X(Track,      std::vector<int>,            tree_track_stripTIBLayersWithMeasurement) \
+  X(Track,      std::vector<int>,            tree_track_stripTIDLayersWithMeasurement) \
+  X(Track,      std::vector<int>,            tree_track_stripTOBLayersWithMeasurement) \
+  X(Track,      std::vector<float>,          tree_track_x) \
+  X(Track,      std::vector<float>,          tree_track_y) \
+  X(Track,      std::vector<float>,          tree_track_z) \
+  X(Track,      std::vector<int>,            tree_track_firstHit) \
+  X(Track,      std::vector<float>,          tree_track_region) \
+  X(Track,      std::vector<float>,          tree_track_firstHit_x) \
+  X(Track,      std::vector<float>,          tree_track_firstHit_y) \
+  X(Track,      std::vector<float>,          tree_track_firstHit_z) \
+  X(Track,      std::vector<int>,            tree_track_iJet) \
+  X(Track,      std::vector<float>,          tree_track_ntrk10) \
+  X(Track,      std::vector<float>,          tree_track_ntrk20) \
+  X(Track,      std::vector<float>,          tree_track_ntrk30) \
+  X(Track,      std::vector<double>,         tree_track_MVAval) \
+  X(Track,      std::vector<int>,            tree_track_Hemi) \
+  X(Track,      std::vector<double>,         tree_track_Hemi_dR) \
+  X(Track,      std::vector<double>,         tree_track_Hemi_mva_NChi2) \
+  X(Track,      std::vector<int>,            tree_track_Hemi_LLP) \
+  X(TrackSim,   std::vector<int>,            tree_track_sim_LLP) \
+  X(TrackSim,   std::vector<bool>,           tree_track_sim_isFromB) \
+  X(TrackSim,   std::vector<bool>,           tree_track_sim_isFromC) \
+  X(TrackSim,   std::vector<float>,          tree_track_sim_pt) \
+  X(TrackSim,   std::vector<float>,          tree_track_sim_eta) \
+  X(TrackSim,   std::vector<float>,          tree_track_sim_phi) \
+  X(TrackSim,   std::vector<int>,            tree_track_sim_charge) \
+  X(TrackSim,   std::vector<int>,            tree_track_sim_pdgId) \
+  X(TrackSim,   std::vector<float>,          tree_track_sim_mass) \
+  X(TrackSim,   std::vector<float>,          tree_track_sim_x) \
+  X(TrackSim,   std::vector<float>,          tree_track_sim_y) \
+  X(TrackSim,   std::vector<float>,          tree_track_sim_z) \
+  X(TrackSim,   std::vector<float>,          tree_track_sim_dFirstGen) \
+  X(Gen,        float,                       tree_GenPVx) \
+  X(Gen,        float,                       tree_GenPVy) \
+  X(Gen,        float,                       tree_GenPVz) \
+  X(Gen,        std::vector<float>,          tree_genParticle_pt) \
+  X(Gen,        std::vector<float>,          tree_genParticle_eta) \
+  X(Gen,        std::vector<float>,          tree_genParticle_phi) \
+  X(Gen,        std::vector<float>,          tree_genParticle_charge) \
+  X(Gen,        std::vector<int>,            tree_genParticle_pdgId) \
+  X(Gen,        std::vector<float>,          tree_genParticle_mass) \
+  X(Gen,        std::vector<float>,          tree_genParticle_x) \
+  X(Gen,        std::vector<float>,          tree_genParticle_y) \
+  X(Gen,        std::vector<float>,          tree_genParticle_z) \
+  X(Gen,        std::vector<int>,            tree_genParticle_statusCode) \
+  X(Gen,        std::vector<int>,            tree_genParticle_mother_pdgId) \
+  X(Gen,        std::vector<int>,            tree_genParticle_LLP) \
+  X(GenPacked,  std::vector<float>,          tree_genPackPart_pt) \
+  X(GenPacked,  std::vector<float>,          tree_genPackPart_eta) \
+  X(GenPacked,  std::vector<float>,          tree_genPackPart_phi) \
+  X(GenPacked,  std::vector<float>,          tree_genPackPart_charge) \
+  X(GenPacked,  std::vector<int>,            tree_genPackPart_pdgId) \
+  X(GenPacked,  std::vector<float>,          tree_genPackPart_mass) \
+  X(GenPacked,  std::vector<int>,            tree_genPackPart_mother_pdgId) \
+  X(GenFromLLP, int,                         tree_ngenFromLLP) \
+  X(GenFromLLP, std::vector<int>,            tree_genFromLLP_LLP) \
+  X(GenFromLLP, std::vector<float>,          tree_genFromLLP_pt) \
+  X(GenFromLLP, std::vector<float>,          tree_genFromLLP_eta) \
+  X(GenFromLLP, std::vector<float>,          tree_genFromLLP_phi) \
+  X(GenFromLLP, std::vector<float>,          tree_genFromLLP_charge) \
+  X(GenFromLLP, std::vector<int>,            tree_genFromLLP_pdgId) \
+  X(GenFromLLP, std::vector<float>,          tree_genFromLLP_mass) \
+  X(GenFromLLP, std::vector<float>,          tree_genFromLLP_x) \
+  X(GenFromLLP, std::vector<float>,          tree_genFromLLP_y) \
+  X(GenFromLLP, std::vector<float>,          tree_genFromLLP_z) \
+  X(GenFromLLP, std::vector<int>,            tree_genFromLLP_mother_pdgId) \
+  X(GenFromLLP, std::vector<bool>,           tree_genFromLLP_isFromB) \
+  X(GenFromLLP, std::vector<bool>,           tree_genFromLLP_isFromC) \
+  X(Gen,        std::vector<float>,          tree_genAxis_dRneuneu) \
+  X(GenFromBC,  int,                         tree_nFromC) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromC_pt) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromC_eta) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromC_phi) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromC_charge) \
+  X(GenFromBC,  std::vector<int>,            tree_genFromC_pdgId) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromC_x) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromC_y) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromC_z) \
+  X(GenFromBC,  std::vector<int>,            tree_genFromC_mother_pdgId) \
+  X(GenFromBC,  std::vector<int>,            tree_genFromC_generation) \
+  X(GenFromBC,  std::vector<int>,            tree_genFromC_LLP) \
+  X(GenFromBC,  int,                         tree_nFromB) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromB_pt) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromB_eta) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromB_phi) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromB_charge) \
+  X(GenFromBC,  std::vector<int>,            tree_genFromB_pdgId) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromB_x) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromB_y) \
+  X(GenFromBC,  std::vector<float>,          tree_genFromB_z) \
+  X(GenFromBC,  std::vector<int>,            tree_genFromB_mother_pdgId) \
+  X(GenFromBC,  std::vector<int>,            tree_genFromB_generation) \
+  X(GenFromBC,  std::vector<int>,            tree_genFromB_LLP) \
+  X(GenJet,     std::vector<float>,          tree_genJet_pt) \
+  X(GenJet,     std::vector<float>,          tree_genJet_eta) \
+  X(GenJet,     std::vector<float>,          tree_genJet_phi) \
+  X(GenJet,     std::vector<float>,          tree_genJet_mass) \
+  X(GenJet,     std::vector<float>,          tree_genJet_energy) \
+  X(LLP,        int,                         tree_nLLP) \
+  X(LLP,        std::vector<int>,            tree_LLP) \
+  X(LLP,        std::vector<float>,          tree_LLP_pt) \
+  X(LLP,        std::vector<float>,          tree_LLP_eta) \
+  X(LLP,        std::vector<float>,          tree_LLP_phi) \
+  X(LLP,        std::vector<float>,          tree_LLP_x) \
+  X(LLP,        std::vector<float>,          tree_LLP_y) \
+  X(LLP,        std::vector<float>,          tree_LLP_z) \
+  X(LLP,        std::vector<float>,          tree_LLP_dist) \
+  X(LLP,        std::vector<int>,            tree_LLP_nTrks) \
+  X(LLP,        std::vector<int>,            tree_LLP_Vtx_nTrks) \
+  X(LLP,        std::vector<float>,          tree_LLP_Vtx_NChi2) \
+  X(LLP,        std::vector<float>,          tree_LLP_Vtx_dx) \
+  X(LLP,        std::vector<float>,          tree_LLP_Vtx_dy) \
+  X(LLP,        std::vector<float>,          tree_LLP_Vtx_dz) \
+  X(LLP,        std::vector<float>,          tree_LLP_Vtx_dist) \
+  X(LLP,        std::vector<float>,          tree_LLP_Vtx_dd) \
+  X(LLP,        std::vector<float>,          tree_LLP_Vtx_trackWeight) \
+  X(Hemi,       std::vector<int>,            tree_Hemi) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_njet) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_eta) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_phi) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_dR) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_nTrks) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_nTrks_sig) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_nTrks_bad) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_nTrks_mva) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_nTrks_mva_sig) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_nTrks_mva_bad) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_LLP) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_LLP_pt) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_LLP_eta) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_LLP_phi) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_LLP_dist) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_LLP_x) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_LLP_y) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_LLP_z) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_NChi2) \
+  X(Hemi,       std::vector<int>,            tree_Hemi_Vtx_nTrks) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_x) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_y) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_z) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_dx) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_dy) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_dz) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_dist) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_dd) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_Vtx_trackWeight) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_dR12) \
+  X(Hemi,       std::vector<float>,          tree_Hemi_LLP_dR12)
+
+#endif
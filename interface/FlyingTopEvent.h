@@ -0,0 +1,66 @@
+#ifndef FlyingTop_FlyingTopEvent_h
+#define FlyingTop_FlyingTopEvent_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+// user include files
+#include "FlyingTopBranches.h"
+/*---------------*/
+
+// Per-event content of the FlyingTop ntuple.
+// Filled by FlyingTopProducer, which does all the computation and can run on several streams,
+// and written to the TTree by FlyingTopAnalyzer. One member per branch, with the branch name,
+// declared from the registry in FlyingTopBranches.h.
+
+class FlyingTopEvent {
+  public:
+
+#define FLYINGTOP_DECLARE_BRANCH(group, type, name) type name {};
+    FLYINGTOP_BRANCHES(FLYINGTOP_DECLARE_BRANCH)
+#undef FLYINGTOP_DECLARE_BRANCH
+
+    //Reserves the per track columns (Track and TrackSim groups) for n tracks, so that the track loop does not reallocate them
+    void ReserveTracks(size_t n)
+      {
+#define FLYINGTOP_RESERVE_BRANCH(group, type, name) \
+        if ( FlyingTopBranches::group == FlyingTopBranches::Track || FlyingTopBranches::group == FlyingTopBranches::TrackSim ) Reserve(name, n);
+        FLYINGTOP_BRANCHES(FLYINGTOP_RESERVE_BRANCH)
+#undef FLYINGTOP_RESERVE_BRANCH
+      }
+
+    //Raises sizes, one per member in the order of the registry, to the sizes of the vector members of this event,
+    //so that over events it holds the largest size of each column
+    void MaxColumnSizes(std::vector<size_t>& sizes) const
+      {
+        size_t i = 0;
+#define FLYINGTOP_SIZE_BRANCH(group, type, name) i++;
+        FLYINGTOP_BRANCHES(FLYINGTOP_SIZE_BRANCH)
+#undef FLYINGTOP_SIZE_BRANCH
+        sizes.resize(i, 0);
+        i = 0;
+#define FLYINGTOP_MAX_BRANCH(group, type, name) sizes[i] = std::max( sizes[i], Size(name) ); i++;
+        FLYINGTOP_BRANCHES(FLYINGTOP_MAX_BRANCH)
+#undef FLYINGTOP_MAX_BRANCH
+      }
+
+    //Reserves each vector member for the size given by MaxColumnSizes(), nothing if sizes is empty
+    void ReserveColumns(const std::vector<size_t>& sizes)
+      {
+        if ( sizes.empty() ) return;
+        size_t i = 0;
+#define FLYINGTOP_RESERVE_COLUMN(group, type, name) Reserve(name, sizes[i++]);
+        FLYINGTOP_BRANCHES(FLYINGTOP_RESERVE_COLUMN)
+#undef FLYINGTOP_RESERVE_COLUMN
+      }
+
+  private:
+    template <class T> static void Reserve(std::vector<T>& column, size_t n) {column.reserve(n);}
+    template <class T> static void Reserve(T&, size_t) {}
+    template <class T> static size_t Size(const std::vector<T>& column) {return column.size();}
+    template <class T> static size_t Size(const T&) {return 0;}
+};
+
+#endif
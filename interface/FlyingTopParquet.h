@@ -0,0 +1,311 @@
+#ifndef FlyingTop_FlyingTopParquet_h
+#define FlyingTop_FlyingTopParquet_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <exception>
+// user include files
+#if __has_include(<parquet/arrow/writer.h>)
+#define FLYINGTOP_PARQUET
+#include <arrow/api.h>
+#include <arrow/io/file.h>
+#include <parquet/arrow/writer.h>
+#include <parquet/properties.h>
+#endif
+#include "tbb/task_group.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "FlyingTopEvent.h"
+/*---------------*/
+
+// Flat Parquet table of branch groups of the FlyingTop ntuple with one value per object, written by
+// FlyingTopAnalyzer (parquetFile): one row per element of the std::vector branches of the groups (per track for Track
+// and TrackSim, per hemisphere for Hemi), with the run, lumiBlock and event keys repeated on each row, and one column
+// per std::vector branch of the groups.
+// The number of rows of an event is the size of the first std::vector branch of the first group; a branch of another
+// size in an event (tree_Hemi_Vtx_trackWeight has one value per vertex track, the TrackSim branches are empty on data)
+// is null on the rows of that event, the number of such events is given by Mismatches().
+// Fill() only appends the values to buffers on the event thread. Every batchRows rows the buffers are queued for a
+// task that builds the Arrow arrays and writes them as one row group, while the next batches are filled. The queue
+// holds at most maxPending batches (besides the one being written): only when it is full does Fill() wait on the
+// event thread, helping the writing task until the queue is empty. This back-pressure, the writing being slower
+// than the event loop, is given by Stalls() and StallSeconds(). The columns are dictionary encoded, which Parquet stores with RLE indices,
+// with ZSTD pages; the keys, repeated on all the rows of an event, cost almost nothing.
+// Needs Arrow >= 10 with Parquet; without them the constructor throws.
+
+#ifdef FLYINGTOP_PARQUET
+// Arrow builder, type and buffer value of each branch element type
+namespace FlyingTopArrow {
+template <class T> struct ArrowOf;
+template <> struct ArrowOf<float>          { typedef arrow::FloatBuilder   Builder; typedef float          Value; static std::shared_ptr<arrow::DataType> Type() {return arrow::float32();} };
+template <> struct ArrowOf<double>         { typedef arrow::DoubleBuilder  Builder; typedef double         Value; static std::shared_ptr<arrow::DataType> Type() {return arrow::float64();} };
+template <> struct ArrowOf<int>            { typedef arrow::Int32Builder   Builder; typedef int            Value; static std::shared_ptr<arrow::DataType> Type() {return arrow::int32();} };
+template <> struct ArrowOf<unsigned int>   { typedef arrow::UInt32Builder  Builder; typedef unsigned int   Value; static std::shared_ptr<arrow::DataType> Type() {return arrow::uint32();} };
+template <> struct ArrowOf<unsigned short> { typedef arrow::UInt16Builder  Builder; typedef unsigned short Value; static std::shared_ptr<arrow::DataType> Type() {return arrow::uint16();} };
+template <> struct ArrowOf<bool>           { typedef arrow::BooleanBuilder Builder; typedef uint8_t        Value; static std::shared_ptr<arrow::DataType> Type() {return arrow::boolean();} };
+}
+#endif
+
+class FlyingTopParquetTable {
+   public:
+
+      //Constructor
+      FlyingTopParquetTable(const std::string& fileName, const std::vector<int>& groups, long batchRows, unsigned int maxPending) :
+        FileName (fileName), BatchRows (batchRows), MaxPending (maxPending)
+        {
+#ifdef FLYINGTOP_PARQUET
+          Columns.push_back( std::make_unique<KeyColumn>("run",   &FlyingTopEvent::runNumber) );
+          Columns.push_back( std::make_unique<KeyColumn>("lumi",  &FlyingTopEvent::lumiBlock) );
+          Columns.push_back( std::make_unique<KeyColumn>("event", &FlyingTopEvent::eventNumber) );
+          // the columns of each group in turn, in the order of the registry
+          for (int group : groups) {
+#define FLYINGTOP_PARQUET_COLUMN(g, type, name) \
+            if ( FlyingTopBranches::g == group ) AddColumn(#name, &FlyingTopEvent::name);
+            FLYINGTOP_BRANCHES(FLYINGTOP_PARQUET_COLUMN)
+#undef FLYINGTOP_PARQUET_COLUMN
+            if ( !RowColumn ) throw cms::Exception("Configuration") << "branch group " << FlyingTopBranches::GroupName(group) << " has no std::vector branch";
+          }
+
+          std::vector<std::shared_ptr<arrow::Field> > fields;
+          for (const auto& column : Columns) fields.push_back( arrow::field(column->Name, column->Type, column->Nullable) );
+          Schema = arrow::schema(fields);
+          parquet::WriterProperties::Builder properties;
+          properties.enable_dictionary()->compression(parquet::Compression::ZSTD);
+          Output = Check( arrow::io::FileOutputStream::Open(FileName) );
+          Writer = Check( parquet::arrow::FileWriter::Open(*Schema, arrow::default_memory_pool(), Output, properties.build()) );
+#else
+          throw cms::Exception("Configuration") << "the Parquet output needs Arrow and Parquet, " << fileName << " cannot be written";
+#endif
+        }
+
+      //Destructor
+      ~FlyingTopParquetTable() {try {Writes.wait();} catch (...) {}}
+
+      //-------Main Method--------//
+      void Fill(const FlyingTopEvent& ev)
+        {
+#ifdef FLYINGTOP_PARQUET
+          auto t0 = std::chrono::steady_clock::now();
+          size_t nRows = RowColumn->Size(ev);
+          for (auto& column : Columns) column->Append(ev, nRows);
+          Rows += nRows;
+          NRows += nRows;
+          NEvents++;
+          if ( Rows >= BatchRows ) Flush();
+          FillTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+#endif
+        }
+      //Writes the last batch and closes the file
+      void Close()
+        {
+#ifdef FLYINGTOP_PARQUET
+          Flush();
+          Writes.wait();
+          Rethrow();
+          Check( Writer->Close() );
+          Check( Output->Close() );
+#endif
+        }
+
+      //-----Access Data Members------//
+      const std::string& File() const {return FileName;}
+      long   Events() const {return NEvents;}
+      long   RowCount() const {return NRows;}
+      long   RowGroups() const {return NRowGroups;}
+      double FillSeconds() const {return FillTime;}   // (s) on the event thread
+      double WriteSeconds() const {return WriteTime;} // (s) in the writing tasks, after Close()
+      long   Stalls() const {return NStalls;}             // times Fill() found the queue full
+      double StallSeconds() const {return StallTime;}     // (s) Fill() waited for the writing
+      //Columns and number of events where they were null
+      std::vector<std::pair<std::string,long> > Mismatches() const
+        {
+          std::vector<std::pair<std::string,long> > mismatches;
+#ifdef FLYINGTOP_PARQUET
+          for (const auto& column : Columns) if ( column->NMismatch > 0 ) mismatches.emplace_back(column->Name, column->NMismatch);
+#endif
+          return mismatches;
+        }
+
+   private:
+#ifdef FLYINGTOP_PARQUET
+      typedef std::function<std::shared_ptr<arrow::Array>()> ArrayBuilder;
+
+      static void Check(const arrow::Status& status)
+        {
+          if ( !status.ok() ) throw cms::Exception("FlyingTopParquet") << status.ToString();
+        }
+      template <class T> static T Check(arrow::Result<T> result)
+        {
+          Check( result.status() );
+          return std::move(result).ValueOrDie();
+        }
+
+      template <class T> using ArrowOf = FlyingTopArrow::ArrowOf<T>;
+
+      // a column of the table: its values and validity bytes for the rows of the current batch
+      struct Column {
+        virtual ~Column() {}
+        virtual size_t Size(const FlyingTopEvent&) const {return 0;}
+        virtual void Append(const FlyingTopEvent& ev, size_t nRows) = 0;
+        virtual ArrayBuilder Take() = 0;  // moves the batch out, to build the Arrow array in the writing task
+        std::string Name;
+        std::shared_ptr<arrow::DataType> Type;
+        bool Nullable = false;
+        long NMismatch = 0;
+      };
+      template <class T> struct BufferColumn : public Column {
+        typedef typename ArrowOf<T>::Value Value;
+        std::vector<Value> Values;
+        std::vector<uint8_t> Valid;
+        ArrayBuilder Take() override
+          {
+            auto values = std::make_shared<std::vector<Value> >(); values->swap(Values);
+            auto valid  = std::make_shared<std::vector<uint8_t> >(); valid->swap(Valid);
+            return [values, valid]() {
+              typename ArrowOf<T>::Builder builder;
+              Check( builder.AppendValues(values->data(), values->size(), valid->empty() ? nullptr : valid->data()) );
+              std::shared_ptr<arrow::Array> array;
+              Check( builder.Finish(&array) );
+              return array;
+            };
+          }
+      };
+      // run, lumiBlock and event, repeated on the rows of the event
+      struct KeyColumn : public BufferColumn<int> {
+        KeyColumn(const char* name, int FlyingTopEvent::* member) : Member (member) {Name = name; Type = ArrowOf<int>::Type();}
+        void Append(const FlyingTopEvent& ev, size_t nRows) override {Values.insert(Values.end(), nRows, ev.*Member);}
+        int FlyingTopEvent::* Member;
+      };
+      template <class T> struct VectorColumn : public BufferColumn<T> {
+        VectorColumn(const char* name, std::vector<T> FlyingTopEvent::* member) : Member (member)
+          {this->Name = name; this->Type = ArrowOf<T>::Type(); this->Nullable = true;}
+        size_t Size(const FlyingTopEvent& ev) const override {return (ev.*Member).size();}
+        void Append(const FlyingTopEvent& ev, size_t nRows) override
+          {
+            const std::vector<T>& column = ev.*Member;
+            if ( column.size() == nRows ) {
+              this->Values.insert(this->Values.end(), column.begin(), column.end());
+              this->Valid.insert(this->Valid.end(), nRows, 1);
+            }
+            else {
+              this->Values.insert(this->Values.end(), nRows, typename BufferColumn<T>::Value());
+              this->Valid.insert(this->Valid.end(), nRows, 0);
+              this->NMismatch++;
+            }
+          }
+        std::vector<T> FlyingTopEvent::* Member;
+      };
+
+      // only the std::vector branches are columns, the first one gives the number of rows
+      template <class T> void AddColumn(const char* name, std::vector<T> FlyingTopEvent::* member)
+        {
+          Columns.push_back( std::make_unique<VectorColumn<T> >(name, member) );
+          if ( !RowColumn ) RowColumn = Columns.back().get();
+        }
+      template <class T> void AddColumn(const char*, T FlyingTopEvent::*) {}
+
+      // a batch waiting to be written
+      struct Batch {
+        std::vector<ArrayBuilder> Builders;
+        long NRows;
+      };
+
+      //Queues the current batch for the writing task, started if it is not running; waits for it if the queue is full
+      void Flush()
+        {
+          if ( Rows == 0 ) return;
+          Rethrow();
+          bool full;
+          {
+            std::lock_guard<std::mutex> lock(PendingMutex);
+            full = ( Pending.size() >= MaxPending );
+          }
+          if ( full ) {
+            // the calling thread runs the writing too, so that this also works with a single thread
+            auto t0 = std::chrono::steady_clock::now();
+            Writes.wait();
+            StallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            NStalls++;
+            Rethrow();
+          }
+          Batch batch;
+          for (auto& column : Columns) batch.Builders.push_back( column->Take() );
+          batch.NRows = Rows;
+          Rows = 0;
+          std::lock_guard<std::mutex> lock(PendingMutex);
+          Pending.push_back( std::move(batch) );
+          if ( Writing ) return;
+          Writing = true;
+          Writes.run([this]() {Write();});
+        }
+
+      //Writing task: writes the queued batches, one row group each, until the queue is empty
+      void Write()
+        {
+          while ( true ) {
+            Batch batch;
+            {
+              std::lock_guard<std::mutex> lock(PendingMutex);
+              if ( Pending.empty() || Error ) {
+                Writing = false;
+                return;
+              }
+              batch = std::move(Pending.front());
+              Pending.pop_front();
+            }
+            try {
+              auto t0 = std::chrono::steady_clock::now();
+              std::vector<std::shared_ptr<arrow::Array> > arrays;
+              for (const auto& builder : batch.Builders) arrays.push_back( builder() );
+              auto table = arrow::Table::Make(Schema, arrays, batch.NRows);
+              Check( Writer->WriteTable(*table, batch.NRows) );
+              NRowGroups++;
+              WriteTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            }
+            catch (...) {
+              std::lock_guard<std::mutex> lock(PendingMutex);
+              Error = std::current_exception();
+            }
+          }
+        }
+
+      //Rethrows on the event thread the error of the writing task, if any
+      void Rethrow()
+        {
+          std::lock_guard<std::mutex> lock(PendingMutex);
+          if ( Error ) std::rethrow_exception(Error);
+        }
+#endif
+
+      // ----------member data ---------------------------
+      std::string FileName;
+      long BatchRows;
+      size_t MaxPending;
+#ifdef FLYINGTOP_PARQUET
+      std::vector<std::unique_ptr<Column> > Columns;
+      Column* RowColumn = nullptr;
+      std::shared_ptr<arrow::Schema> Schema;
+      std::shared_ptr<arrow::io::FileOutputStream> Output;
+      std::unique_ptr<parquet::arrow::FileWriter> Writer;
+#endif
+#ifdef FLYINGTOP_PARQUET
+      std::deque<Batch> Pending;   // batches waiting for the writing task
+#endif
+      std::mutex PendingMutex;     // Pending, Writing and Error
+      bool Writing = false;        // the writing task is running
+      std::exception_ptr Error;    // of the writing task
+      tbb::task_group Writes;      // the writing task
+      long   Rows = 0;             // in the current batch
+      long   NRows = 0, NEvents = 0, NRowGroups = 0, NStalls = 0;
+      double FillTime = 0., WriteTime = 0., StallTime = 0.;
+};
+
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef FlyingTop_FlyingTopRNTuple_h
+#define FlyingTop_FlyingTopRNTuple_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
+// user include files
+#include "RVersion.h"
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,30,0) && ROOT_VERSION_CODE < ROOT_VERSION(6,32,0)
+#define FLYINGTOP_RNTUPLE
+#include <ROOT/RNTuple.hxx>
+#include <ROOT/RNTupleModel.hxx>
+#include <ROOT/RNTupleOptions.hxx>
+#include <ROOT/RNTupleView.hxx>
+#endif
+#include "FWCore/Utilities/interface/Exception.h"
+#include "FlyingTopEvent.h"
+/*---------------*/
+
+// RNTuple copy of the FlyingTop ntuple, written by FlyingTopAnalyzer (backend = rntuple or both) to its own file.
+// The per object std::vector branches are the fields of five collections, one entry per object:
+//   tracks (Track and TrackSim groups), jets (Jet), muons (Muon), Hemi (Hemi) and LLP (LLP)
+// each field having the name and element type of its branch, so all the columns of a collection share one offset
+// column. The number of objects of a collection in an event is the size of its first branch; a branch of another
+// size in an event is written as 0 for that event and counted in Mismatches(). The other branches (the scalars,
+// the other groups and the per vertex track tree_Hemi_Vtx_trackWeight and tree_LLP_Vtx_trackWeight) are top level
+// fields with the name and type of their branch.
+// The page size is the approximate unzipped size of a page, the cluster size the approximate zipped size of a cluster:
+// larger pages and clusters than the ROOT defaults make reading a few columns over many events cheaper.
+// RNTuple is in ROOT::Experimental with an API that changes from one ROOT version to the next: this is written for
+// ROOT 6.30, the one of CMSSW_14_0 and CMSSW_14_1 (RNTupleModel::MakeCollection, removed in 6.32); with other ROOT
+// versions the constructor throws.
+
+class FlyingTopRNTupleWriter {
+   public:
+
+      //Constructor
+      FlyingTopRNTupleWriter(const std::string& fileName, const std::vector<bool>& groups, size_t pageSize, size_t clusterSize) :
+        FileName (fileName)
+        {
+#ifdef FLYINGTOP_RNTUPLE
+          auto model = ROOT::Experimental::RNTupleModel::Create();
+          std::vector<std::unique_ptr<ROOT::Experimental::RNTupleModel> > itemModels;
+          for (int c=0; c<kNCollections; c++) {
+            itemModels.push_back( ROOT::Experimental::RNTupleModel::Create() );
+            Collections.emplace_back();
+            Collections.back().Name = CollectionName(c);
+          }
+#define FLYINGTOP_RNTUPLE_FIELD(group, type, name) \
+          if ( groups[FlyingTopBranches::group] ) AddField(*model, itemModels, FlyingTopBranches::group, #name, &FlyingTopEvent::name);
+          FLYINGTOP_BRANCHES(FLYINGTOP_RNTUPLE_FIELD)
+#undef FLYINGTOP_RNTUPLE_FIELD
+          for (int c=0; c<kNCollections; c++)
+            if ( !Collections[c].Items.empty() ) Collections[c].Writer = model->MakeCollection(Collections[c].Name, std::move(itemModels[c]));
+
+          ROOT::Experimental::RNTupleWriteOptions options;
+          options.SetApproxUnzippedPageSize(pageSize);
+          options.SetApproxZippedClusterSize(clusterSize);
+          Writer = ROOT::Experimental::RNTupleWriter::Recreate(std::move(model), "ntuple", FileName, options);
+#else
+          throw cms::Exception("Configuration") << "the RNTuple backend is written for ROOT 6.30 (CMSSW_14_0 and 14_1), this is ROOT " << ROOT_RELEASE;
+#endif
+        }
+
+      //Destructor
+      ~FlyingTopRNTupleWriter(){}
+
+      //-------Main Method--------//
+      void Fill(const FlyingTopEvent& ev)
+        {
+#ifdef FLYINGTOP_RNTUPLE
+          auto t0 = std::chrono::steady_clock::now();
+          for (auto& field : Fields) field->Set(ev);
+          for (auto& collection : Collections) {
+          if ( !collection.Writer ) continue;
+            size_t n = collection.Items.front()->Size(ev);
+            for (auto& item : collection.Items) item->Begin(ev, n);
+            for (size_t i=0; i<n; i++) {
+              for (auto& item : collection.Items) item->Set(i);
+              collection.Writer->Fill();
+            }
+          }
+          Writer->Fill();
+          FillTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+          NFill++;
+#endif
+        }
+      //Writes the last cluster and closes the file
+      void Close()
+        {
+#ifdef FLYINGTOP_RNTUPLE
+          Writer.reset();
+#endif
+        }
+
+      //Reads back the given std::vector<float> branch of all the entries (after Close()), from its collection or
+      //from its top level field; returns the time it took (s) and the number of values read in nValues, -1 if the
+      //branch is not written
+      double ReadColumn(const std::string& name, long& nValues) const
+        {
+          nValues = -1;
+#ifdef FLYINGTOP_RNTUPLE
+          std::string collectionName;
+          for (const auto& collection : Collections)
+            for (const auto& item : collection.Items) if ( item->Name == name ) collectionName = collection.Name;
+          bool topLevel = false;
+          for (const auto& field : Fields) if ( field->Name == name ) topLevel = true;
+          if ( collectionName.empty() && !topLevel ) return 0.;
+          nValues = 0;
+          double sum = 0.;
+          auto t0 = std::chrono::steady_clock::now();
+          auto reader = ROOT::Experimental::RNTupleReader::Open("ntuple", FileName);
+          if ( topLevel ) {
+            auto view = reader->GetView<std::vector<float> >(name);
+            for (auto i : reader->GetEntryRange())
+              for (float value : view(i)) {
+                sum += value;
+                nValues++;
+              }
+          }
+          else {
+            auto collection = reader->GetViewCollection(collectionName);
+            auto view = collection.GetView<float>(name);
+            for (auto i : reader->GetEntryRange())
+              for (auto j : collection.GetCollectionRange(i)) {
+                sum += view(j);
+                nValues++;
+              }
+          }
+          Checksum = sum;
+          return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+#else
+          return 0.;
+#endif
+        }
+
+      //-----Access Data Members------//
+      const std::string& File() const {return FileName;}
+      long   Entries() const {return NFill;}
+      double FillSeconds() const {return FillTime;}
+      double LastChecksum() const {return Checksum;}  // sum of the values read by the last ReadColumn()
+      //Collection branches and number of events where they did not have one value per object
+      std::vector<std::pair<std::string,long> > Mismatches() const
+        {
+          std::vector<std::pair<std::string,long> > mismatches;
+          for (const auto& collection : Collections)
+            for (const auto& item : collection.Items) if ( item->NMismatch > 0 ) mismatches.emplace_back(item->Name, item->NMismatch);
+          return mismatches;
+        }
+
+   private:
+      enum CollectionIndex { kTracks, kJets, kMuons, kHemi, kLLP, kNCollections };
+      static const char* CollectionName(int c)
+        {
+          static const char* names[kNCollections] = { "tracks", "jets", "muons", "Hemi", "LLP" };
+          return names[c];
+        }
+      //Collection of a std::vector branch of the given group, -1 for a top level field
+      static int CollectionOf(int group, const std::string& name)
+        {
+          if ( name.size() > 12 && name.compare(name.size()-12, 12, "_trackWeight") == 0 ) return -1;  // per vertex track
+          switch ( group ) {
+            case FlyingTopBranches::Track:
+            case FlyingTopBranches::TrackSim: return kTracks;
+            case FlyingTopBranches::Jet:      return kJets;
+            case FlyingTopBranches::Muon:     return kMuons;
+            case FlyingTopBranches::Hemi:     return kHemi;
+            case FlyingTopBranches::LLP:      return kLLP;
+            default: return -1;
+          }
+        }
+
+      // a top level field, set from its FlyingTopEvent member
+      struct Field {
+        virtual ~Field() {}
+        virtual void Set(const FlyingTopEvent& ev) = 0;
+        std::string Name;
+      };
+      // a field of a collection, set from the element of its FlyingTopEvent member for each object
+      struct Item {
+        virtual ~Item() {}
+        virtual size_t Size(const FlyingTopEvent& ev) const = 0;
+        virtual void Begin(const FlyingTopEvent& ev, size_t n) = 0;
+        virtual void Set(size_t i) = 0;
+        std::string Name;
+        long NMismatch = 0;
+      };
+      struct Collection {
+        std::string Name;
+        std::vector<std::unique_ptr<Item> > Items;   // the first one gives the number of objects
+#ifdef FLYINGTOP_RNTUPLE
+        std::shared_ptr<ROOT::Experimental::RCollectionNTupleWriter> Writer;
+#else
+        std::shared_ptr<void> Writer;
+#endif
+      };
+
+#ifdef FLYINGTOP_RNTUPLE
+      template <class T> struct TopField : public Field {
+        TopField(ROOT::Experimental::RNTupleModel& model, const char* name, T FlyingTopEvent::* member) :
+          Value (model.MakeField<T>(name)), Member (member) {Name = name;}
+        void Set(const FlyingTopEvent& ev) override {*Value = ev.*Member;}
+        std::shared_ptr<T> Value;
+        T FlyingTopEvent::* Member;
+      };
+      template <class T> struct CollectionItem : public Item {
+        CollectionItem(ROOT::Experimental::RNTupleModel& model, const char* name, std::vector<T> FlyingTopEvent::* member) :
+          Value (model.MakeField<T>(name)), Member (member) {Name = name;}
+        size_t Size(const FlyingTopEvent& ev) const override {return (ev.*Member).size();}
+        void Begin(const FlyingTopEvent& ev, size_t n) override
+          {
+            Column = &(ev.*Member);
+            if ( Column->size() == n ) return;
+            Column = nullptr;
+            NMismatch++;
+          }
+        void Set(size_t i) override {*Value = Column ? T((*Column)[i]) : T();}
+        std::shared_ptr<T> Value;
+        std::vector<T> FlyingTopEvent::* Member;
+        const std::vector<T>* Column = nullptr;  // of the current event, null if it has not one value per object
+      };
+
+      template <class T> void AddField(ROOT::Experimental::RNTupleModel& model, std::vector<std::unique_ptr<ROOT::Experimental::RNTupleModel> >& itemModels,
+                                       int group, const char* name, std::vector<T> FlyingTopEvent::* member)
+        {
+          int c = CollectionOf(group, name);
+          if ( c < 0 ) Fields.push_back( std::make_unique<TopField<std::vector<T> > >(model, name, member) );
+          else Collections[c].Items.push_back( std::make_unique<CollectionItem<T> >(*itemModels[c], name, member) );
+        }
+      template <class T> void AddField(ROOT::Experimental::RNTupleModel& model, std::vector<std::unique_ptr<ROOT::Experimental::RNTupleModel> >&,
+                                       int, const char* name, T FlyingTopEvent::* member)
+        {
+          Fields.push_back( std::make_unique<TopField<T> >(model, name, member) );
+        }
+#endif
+
+      // ----------member data ---------------------------
+      std::string FileName;
+      std::vector<std::unique_ptr<Field> > Fields;
+      std::vector<Collection> Collections;
+#ifdef FLYINGTOP_RNTUPLE
+      std::unique_ptr<ROOT::Experimental::RNTupleWriter> Writer;
+#endif
+      long   NFill = 0;
+      double FillTime = 0.;     // (s)
+      mutable double Checksum = 0.;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef FlyingTop_FlyingTopSelection_h
+#define FlyingTop_FlyingTopSelection_h
+
+// Z -> mumu + HT decision of FlyingTopFilter, put in the event for FlyingTopProducer (selection).
+// Mmumu is the largest invariant mass of two opposite charge global muons with pt > 10 GeV, one of them
+// above 28 GeV, HT the scalar sum of the pt of the jets with pt > 20 GeV and |eta| < 2.4, as in the
+// tree_Mmumu and tree_passesHTFilter of FlyingTopProducer (the thresholds are parameters of the filter).
+
+class FlyingTopSelection {
+  public:
+
+    float Mmumu = 0.;  // (GeV)
+    float HT = 0.;     // (GeV)
+    bool  hasZ = false;
+    bool  pass = false;
+};
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef FlyingTop_FlyingTopTiming_h
+#define FlyingTop_FlyingTopTiming_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+/*---------------*/
+
+// Per-event time of the stages of FlyingTopProducer and its counters, put in the event when the producer
+// runs with timing = True, and written to the timing TTree by FlyingTopAnalyzer (timingTree = True).
+// The stages follow the order of FlyingTopProducer::produce(); FirstHit, JetAssociation and TruthMatch are the
+// parts of Tracks spent computing the first hit positions, associating the tracks to the jets and matching them
+// to the gen particles, Neighbours the part of Selection spent counting the first hit neighbours of the tracks,
+// VertexFits the part of Vertices spent in the four concurrent vertex fits.
+
+class FlyingTopTiming {
+  public:
+
+    enum Stage { kGen, kObjects, kTracks, kFirstHit, kJetAssociation, kTruthMatch, kAxes, kSelection, kNeighbours, kBDT, kVertexFits, kVertices, kNStages };
+    enum Counter { kTracksProcessed, kPropagationFallbacks, kBDTEvaluations, kFits, kFitTracks, kNCounters };
+
+    static const char* StageName(int stage)
+      {
+        static const char* names[kNStages] = { "Gen", "Objects", "Tracks", "FirstHit", "JetAssociation", "TruthMatch", "Axes", "Selection", "Neighbours", "BDT", "VertexFits", "Vertices" };
+        return names[stage];
+      }
+    //Stage a stage is part of, -1 for the consecutive stages
+    static int Parent(int stage)
+      {
+        switch ( stage ) {
+          case kFirstHit:       return kTracks;
+          case kJetAssociation: return kTracks;
+          case kTruthMatch:     return kTracks;
+          case kNeighbours:     return kSelection;
+          case kVertexFits:     return kVertices;
+          default:              return -1;
+        }
+      }
+    static const char* CounterName(int counter)
+      {
+        static const char* names[kNCounters] = { "TracksProcessed", "PropagationFallbacks", "BDTEvaluations", "Fits", "FitTracks" };
+        return names[counter];
+      }
+
+    std::vector<float> time;   // (ms) per stage
+    std::vector<int>   count;  // per counter
+};
+
+#endif
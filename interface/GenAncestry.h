@@ -0,0 +1,90 @@
+#ifndef FlyingTop_GenAncestry_h
+#define FlyingTop_GenAncestry_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+// user include files
+#if __has_include(<DataFormats/HepMCCandidate/interface/GenParticle.h>)
+#define FLYINGTOP_GENPARTICLE
+#include "DataFormats/Common/interface/View.h"
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#endif
+/*---------------*/
+
+// Ancestry index of the pruned genparticles of one event.
+// Some pruned particles are tagged (final c and b hadrons, LLPs), then a single pass over the collection
+// gives each particle the list of its tagged ancestors, itself included. A packed genparticle then gets
+// its tagged ancestors from its mother(0) in O(1), instead of walking up the decay chain for each
+// tagged particle as FlyingTopProducer::isAncestor did.
+// Only size() and operator[] of the collection and numberOfMothers() and mother() of the particles are used, so the
+// index is a template on them: GenAncestry is the one of the pruned genparticles, ../test/testGenAncestry.cc builds
+// it on its own particles.
+
+template <class Collection, class Candidate>
+class GenAncestryT {
+   public:
+
+      enum { kFinalC = 1, kFinalB = 2, kLLP = 4 };
+
+      //Constructor
+      GenAncestryT(const Collection& pruned) : Pruned (pruned), TagMask (pruned.size(), 0)
+        {
+          Index.reserve(pruned.size());
+          for (unsigned int i=0; i<pruned.size(); i++) Index[&pruned[i]] = i;
+        }
+
+      //Destructor
+      ~GenAncestryT(){}
+
+      //-------Filling--------//
+      void Tag(unsigned int i, int tag) {TagMask[i] |= tag;}
+
+      //One pass over the pruned collection, after all the Tag() calls
+      void Build()
+        {
+          Tagged.clear();
+          for (unsigned int i=0; i<Pruned.size(); i++) Visit(&Pruned[i]);
+        }
+
+      //-------Queries--------//
+      //Tagged ancestors of a particle (indices in the pruned collection, in increasing order),
+      //particles out of the pruned collection are visited on the fly
+      const std::vector<int>& Ancestors(const Candidate* particle) {return Visit(particle);}
+
+      //Tags of the particle at position i in the pruned collection
+      int Tags(unsigned int i) const {return TagMask[i];}
+
+   private:
+      const std::vector<int>& Visit(const Candidate* particle)
+        {
+          auto done = Tagged.find(particle);
+          if ( done != Tagged.end() ) return done->second;
+
+          std::vector<int> ancestors;
+          auto index = Index.find(particle);
+          if ( index != Index.end() && TagMask[index->second] ) ancestors.push_back(index->second);
+          for (size_t m=0; m<particle->numberOfMothers(); m++)
+            {
+              const std::vector<int>& fromMother = Visit(particle->mother(m));
+              ancestors.insert(ancestors.end(), fromMother.begin(), fromMother.end());
+            }
+          std::sort(ancestors.begin(), ancestors.end());
+          ancestors.erase(std::unique(ancestors.begin(), ancestors.end()), ancestors.end());
+          return Tagged[particle] = std::move(ancestors);
+        }
+
+      // ----------member data ---------------------------
+      const Collection& Pruned;
+      std::vector<int> TagMask;                                               // or of the tags of each pruned particle
+      std::unordered_map<const Candidate*, unsigned int> Index;        // position in the pruned collection
+      std::unordered_map<const Candidate*, std::vector<int> > Tagged;    // tagged ancestors of each visited particle
+};
+
+#ifdef FLYINGTOP_GENPARTICLE
+typedef GenAncestryT<edm::View<reco::GenParticle>, reco::Candidate> GenAncestry;
+#endif
+
+#endif
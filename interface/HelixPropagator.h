@@ -0,0 +1,116 @@
+#ifndef FlyingTop_HelixPropagator_h
+#define FlyingTop_HelixPropagator_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <cmath>
+#include <cstdint>
+// user include files
+#include "TrackerSurfaces.h"
+/*---------------*/
+
+// Propagation of a whole set of tracks to the surface of their first hit (see TrackerSurfaces.h) in one pass.
+// The tracks are given as arrays (reference point, momentum, charge, first hit word) and are moved along
+// their helix in a uniform field along z, with the analytic helix-cylinder (barrel) and helix-plane (disks)
+// crossings. Tracks for which there is no crossing get the same geometric fallback as PropaHitPattern.
+// On the disks PropaHitPattern crosses the plane with a straight line (StraightLinePlaneCrossing) while the helix is
+// followed here, so the two differ by about the sagitta of the track, s^2/2R (7 cm at 2 GeV for the last TEC wheel).
+// ../test/testHelixPropagator.cc checks the crossings against a Runge-Kutta stepper.
+// The loop body has no early exit and only selects, so that it can be vectorized by the compiler.
+
+class HelixPropagator {
+   public:
+
+      //Constructor
+      //bz in Tesla
+      HelixPropagator(float bz = 3.8) : Bz (bz) {}
+
+      //Destructor
+      ~HelixPropagator(){}
+
+      //-------Main Method--------//
+      //For each of the n tracks: (x,y,z) is the position at the first hit surface, region is 1 for the disks
+      //and 0 otherwise (as in PropaHitPattern::Main) and valid is 0 when the geometric fallback was used.
+      //Tracks whose first hit is not in the Tracker DataBase get (-1000,-1000,-1000).
+      void Propagate(unsigned int n, const float* x0, const float* y0, const float* z0,
+                     const float* px, const float* py, const float* pz, const int* charge, const uint16_t* firsthit,
+                     float* x, float* y, float* z, int* region, unsigned char* valid) const
+        {
+          const float kappa = 0.299792458e-2 * Bz; // GeV/cm per unit charge
+          for (unsigned int i=0; i<n; i++)
+            {
+              const TrackerSurface& surface = FirstHitSurface(firsthit[i]);
+              const bool  isDisk = ( surface.region == 1 );
+              const float pt  = std::sqrt(px[i]*px[i] + py[i]*py[i]);
+              const float ux  = px[i] / pt, uy = py[i] / pt;
+              const float cot = pz[i] / pt;                  // dz/ds, s being the transverse path length
+              const float rho = -charge[i] * kappa / pt;     // signed curvature, > 0 turns anticlockwise
+              const bool  straight = std::fabs(rho) < 1.e-6;
+              const float irho = straight ? 0. : 1. / rho;
+
+              //----- disks : z = +-|z_disk|, on the side of the momentum
+              const float zDisk = ( pz[i] < 0 ) ? -surface.pos : surface.pos;
+              const float sDisk = ( zDisk - z0[i] ) / cot;
+              const float aDisk = rho * sDisk;
+              const float xDisk = straight ? x0[i] + ux * sDisk : x0[i] + ( ux * std::sin(aDisk) - uy * ( 1. - std::cos(aDisk) ) ) * irho;
+              const float yDisk = straight ? y0[i] + uy * sDisk : y0[i] + ( uy * std::sin(aDisk) + ux * ( 1. - std::cos(aDisk) ) ) * irho;
+              const bool  okDisk = ( pz[i] != 0 ) && ( sDisk > 0 ) && ( std::fabs(aDisk) < 2. * M_PI );
+
+              //----- cylinders : first crossing of the helix circle with the circle of radius R
+              const float R  = surface.pos;
+              // straight line : |p0 + s u| = R
+              const float b  = x0[i] * ux + y0[i] * uy;
+              const float c  = x0[i] * x0[i] + y0[i] * y0[i] - R * R;
+              const float dl = b * b - c;
+              const float sLine = -b + std::sqrt(std::fabs(dl));
+              // helix : centre C and radius r of its circle
+              const float cx = x0[i] - uy * irho, cy = y0[i] + ux * irho;
+              const float r  = std::fabs(irho);
+              const float d2 = cx * cx + cy * cy, d = std::sqrt(d2);
+              const float a  = ( R * R - r * r + d2 ) / ( 2. * d );
+              const float h2 = R * R - a * a;
+              const float h  = std::sqrt(std::fabs(h2));
+              const float sA = ArcLength(x0[i] - cx, y0[i] - cy, a * cx / d - h * cy / d - cx, a * cy / d + h * cx / d - cy, rho);
+              const float sB = ArcLength(x0[i] - cx, y0[i] - cy, a * cx / d + h * cy / d - cx, a * cy / d - h * cx / d - cy, rho);
+              const float sHelix = std::fmin(sA, sB);
+              const float sCyl = straight ? sLine : sHelix;
+              const float aCyl = rho * sCyl;
+              const float xCyl = straight ? x0[i] + ux * sCyl : x0[i] + ( ux * std::sin(aCyl) - uy * ( 1. - std::cos(aCyl) ) ) * irho;
+              const float yCyl = straight ? y0[i] + uy * sCyl : y0[i] + ( uy * std::sin(aCyl) + ux * ( 1. - std::cos(aCyl) ) ) * irho;
+              const bool  okCyl = straight ? ( dl >= 0 && sLine > 0 ) : ( h2 >= 0 && d > 0 );
+
+              //----- geometric fallback, as in PropaHitPattern
+              const float phi  = std::atan2(py[i], px[i]);
+              const float tanTheta = pt / pz[i];
+              const float Rfb  = ( zDisk - z0[i] ) * tanTheta;
+              const float zfb  = R / tanTheta + z0[i];
+
+              const bool ok = isDisk ? okDisk : okCyl;
+              x[i] = isDisk ? ( okDisk ? xDisk : Rfb * std::cos(phi) ) : ( okCyl ? xCyl : R * std::cos(phi) );
+              y[i] = isDisk ? ( okDisk ? yDisk : Rfb * std::sin(phi) ) : ( okCyl ? yCyl : R * std::sin(phi) );
+              z[i] = isDisk ? ( okDisk ? z0[i] + cot * sDisk : zDisk ) : ( okCyl ? z0[i] + cot * sCyl : zfb );
+              region[i] = isDisk ? 1 : 0;
+              valid[i]  = ok;
+              if ( surface.region < 0 ) { x[i] = -1000.; y[i] = -1000.; z[i] = -1000.; valid[i] = 0; }
+            }
+        }
+
+      float BField() const {return Bz;}
+
+   private:
+      //Transverse path length from the point at (vx0,vy0) to the point at (vx1,vy1), both relative to the
+      //centre of the helix circle, turning in the direction given by the sign of the curvature rho
+      static float ArcLength(float vx0, float vy0, float vx1, float vy1, float rho)
+        {
+          float angle = std::atan2(vx0 * vy1 - vy0 * vx1, vx0 * vx1 + vy0 * vy1);
+          angle += ( rho > 0 && angle < 0 ) ?  2. * M_PI : 0.;
+          angle -= ( rho < 0 && angle > 0 ) ?  2. * M_PI : 0.;
+          return angle / rho;
+        }
+
+      // ----------member data ---------------------------
+      float Bz; // (T)
+};
+
+#endif
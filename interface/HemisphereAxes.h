@@ -0,0 +1,172 @@
+#ifndef FlyingTop_HemisphereAxes_h
+#define FlyingTop_HemisphereAxes_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <cmath>
+// user include files
+#include "DeltaFunc.h"
+/*---------------*/
+
+// Axes of the two hemispheres of the event, built from the jets.
+// The jets are given in the order of the jet collection by AddJet(): the ones with pt < PtMin or |eta| > EtaMax
+// are dropped, the prompt muons given before by AddMuon() (the Z candidate) are removed from the jets within
+// DeltaR 0.4 of them, and the momentum of each kept jet is stored in a compact array, with no limit on the number
+// of jets. Build() then goes once over the kept jets: axis 1 starts from the first one that is still above PtMin
+// after the muon removal, axis 2 from the first one not in axis 1, and each jet within DeltaR dRcut of an axis is
+// added to it, axis 1 first. The seed of axis 1 is not excluded from this pass, so it is counted twice when it is
+// within dRcut of axis 1. Without jet for axis 2, axis 2 is opposite to axis 1 in phi.
+// The axes are sums of the jet momenta in double, in the order of the jets, and their eta and phi are computed as
+// in TVector3, so they are the same, to the last bit, as with the TLorentzVector sums this replaces.
+// LastDR1() and LastDR2() are the DeltaR of the last kept jet to the axes in Build(), the values the previous loop
+// left to the comparison with the gen neutralinos.
+
+class HemisphereAxes {
+   public:
+
+      //Constructor
+      HemisphereAxes(float ptMin = 20., float etaMax = 10., float dRcut = 1.5) :
+        PtMin (ptMin), EtaMax (etaMax), DRcut (dRcut) {}
+
+      //Destructor
+      ~HemisphereAxes(){}
+
+      //-------Main Method--------//
+      //Forgets the jets and muons of the previous event
+      void Clear()
+        {
+          MuEta.clear(); MuPhi.clear(); MuPx.clear(); MuPy.clear(); MuPz.clear();
+          Px.clear(); Py.clear(); Pz.clear(); Eta.clear(); Phi.clear();
+          Seed = -1;
+          N1 = N2 = 0;
+        }
+      //Prompt muon to remove from the jets, to be given before the jets
+      void AddMuon(float pt, float eta, float phi)
+        {
+          MuEta.push_back(eta);
+          MuPhi.push_back(phi);
+          MuPx.push_back( std::abs(double(pt)) * std::cos(double(phi)) );
+          MuPy.push_back( std::abs(double(pt)) * std::sin(double(phi)) );
+          MuPz.push_back( std::abs(double(pt)) * std::sinh(double(eta)) );
+        }
+      //Next jet of the collection
+      void AddJet(float pt, float eta, float phi)
+        {
+        if ( pt < PtMin ) return;
+        if ( std::abs(eta) > EtaMax ) return;
+          double px = std::abs(double(pt)) * std::cos(double(phi));
+          double py = std::abs(double(pt)) * std::sin(double(phi));
+          double pz = std::abs(double(pt)) * std::sinh(double(eta));
+          // the muons inside the jet come from the PV, they must not pull the axes
+          bool subtracted = false;
+          for (unsigned int mu=0; mu<MuPx.size(); mu++) {
+          if ( DeltaR2( eta, phi, MuEta[mu], MuPhi[mu] ) >= 0.16 ) continue;
+            px -= MuPx[mu];
+            py -= MuPy[mu];
+            pz -= MuPz[mu];
+            subtracted = true;
+          }
+          if ( subtracted ) {
+            pt  = PtOf(px, py);
+            eta = EtaOf(px, py, pz);
+          }
+          if ( Seed < 0 && pt > PtMin && std::abs(eta) < EtaMax ) Seed = Px.size();
+          Px.push_back(px);
+          Py.push_back(py);
+          Pz.push_back(pz);
+          Eta.push_back( EtaOf(px, py, pz) );
+          Phi.push_back( PhiOf(px, py) );
+        }
+      //Assigns the jets to the two axes
+      void Build()
+        {
+          double x1 = 0., y1 = 0., z1 = 0., x2 = 0., y2 = 0., z2 = 0.;
+          float eta1 = 0., phi1 = 0., eta2 = 0., phi2 = 0.;
+          In1.assign(Px.size(), 0);
+          In2.assign(Px.size(), 0);
+          N1 = N2 = 0;
+          if ( Seed >= 0 ) {
+            N1 = 1;
+            In1[Seed] = 1;
+            x1 = Px[Seed]; y1 = Py[Seed]; z1 = Pz[Seed];
+            eta1 = EtaOf(x1, y1, z1);
+            phi1 = PhiOf(x1, y1);
+          }
+          float dR1 = 10., dR2 = 10.;
+          for (unsigned int i=0; i<Px.size(); i++) {
+            if ( N1 > 0 ) dR1 = std::sqrt( DeltaR2( Eta[i], Phi[i], eta1, phi1 ) );
+            if ( N2 > 0 ) dR2 = std::sqrt( DeltaR2( Eta[i], Phi[i], eta2, phi2 ) );
+            if ( N1 > 0 && !In2[i] && dR1 < DRcut ) {
+              N1++;
+              In1[i] = 1;
+              x1 += Px[i]; y1 += Py[i]; z1 += Pz[i];
+              eta1 = EtaOf(x1, y1, z1);
+              phi1 = PhiOf(x1, y1);
+            }
+            if ( N2 == 0 && !In1[i] ) {
+              N2 = 1;
+              In2[i] = 1;
+              x2 = Px[i]; y2 = Py[i]; z2 = Pz[i];
+              eta2 = EtaOf(x2, y2, z2);
+              phi2 = PhiOf(x2, y2);
+            }
+            else if ( N2 > 0 && !In1[i] && !In2[i] && dR2 < DRcut ) {
+              N2++;
+              In2[i] = 1;
+              x2 += Px[i]; y2 += Py[i]; z2 += Pz[i];
+              eta2 = EtaOf(x2, y2, z2);
+              phi2 = PhiOf(x2, y2);
+            }
+          }
+          DR1_ = dR1;
+          DR2_ = dR2;
+          Eta1_ = eta1;
+          Phi1_ = phi1;
+          Eta2_ = eta2;
+          Phi2_ = phi2;
+          if ( N2 == 0 ) {
+            Eta2_ = Eta1_;
+            Phi2_ = Phi1_ - 3.14159;
+            if ( Phi1_ < 0 ) Phi2_ = Phi1_ + 3.14159;
+          }
+        }
+
+      //-----Access Data Members------//
+      int   NJets() const {return Px.size();}  // kept jets
+      int   NJets1() const {return N1;}        // jets added to axis 1 (its seed can be counted twice)
+      int   NJets2() const {return N2;}
+      float Eta1() const {return Eta1_;}
+      float Phi1() const {return Phi1_;}
+      float Eta2() const {return Eta2_;}
+      float Phi2() const {return Phi2_;}
+      float LastDR1() const {return DR1_;}     // DeltaR of the last kept jet to axis 1 in Build(), 10 if not computed
+      float LastDR2() const {return DR2_;}
+
+      //eta, phi and pt of a momentum, as TVector3::PseudoRapidity(), Phi() and Pt()
+      static double EtaOf(double x, double y, double z)
+        {
+          double p = std::sqrt( x*x + y*y + z*z );
+          double cosTheta = ( p == 0. ) ? 1. : z / p;
+          if ( cosTheta*cosTheta < 1. ) return -0.5 * std::log( (1.-cosTheta) / (1.+cosTheta) );
+          if ( z == 0. ) return 0.;
+          return ( z > 0. ) ? 10e10 : -10e10;
+        }
+      static double PhiOf(double x, double y) {return ( x == 0. && y == 0. ) ? 0. : std::atan2(y, x);}
+      static double PtOf(double x, double y) {return std::sqrt( x*x + y*y );}
+
+   private:
+      // ----------member data ---------------------------
+      float PtMin, EtaMax, DRcut;
+      std::vector<float>  MuEta, MuPhi;
+      std::vector<double> MuPx, MuPy, MuPz;
+      std::vector<double> Px, Py, Pz;   // kept jets, muons removed
+      std::vector<float>  Eta, Phi;
+      std::vector<char>   In1, In2;     // jets added to each axis by Build()
+      int   Seed = -1;                  // first kept jet still above PtMin after the muon removal
+      int   N1 = 0, N2 = 0;
+      float Eta1_ = 0., Phi1_ = 0., Eta2_ = 0., Phi2_ = 0.;
+      float DR1_ = 10., DR2_ = 10.;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef FlyingTop_StageTimer_h
+#define FlyingTop_StageTimer_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <algorithm>
+#include <chrono>
+/*---------------*/
+
+// Wall-clock time and counters of the stages of an event, accumulated over the job.
+// Consecutive stages are timed with Lap(), which gives the time since the previous Lap() (or BeginEvent())
+// to a stage, nested parts of a stage with a Measure() scope. When the timer is disabled, Lap() and
+// Measure() return before reading the clock and Count() does nothing, so the timer can stay in the code.
+
+class StageTimer {
+   public:
+      typedef std::chrono::steady_clock Clock;
+
+      //Adds the time between its construction and its destruction to a stage
+      class Scope {
+         public:
+            Scope(StageTimer& timer, int stage) : Timer (timer), Stage (stage) {if ( Timer.On ) Start = Clock::now();}
+            ~Scope() {if ( Timer.On ) Timer.EventTime[Stage] += std::chrono::duration<double>(Clock::now() - Start).count();}
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+         private:
+            StageTimer& Timer;
+            int Stage;
+            Clock::time_point Start;
+      };
+
+      //Constructor
+      StageTimer(unsigned int nStages, unsigned int nCounters, bool enabled) :
+        On (enabled), EventTime (nStages, 0.), EventCount (nCounters, 0), Time (nStages, 0.), Counts (nCounters, 0) {}
+
+      //Destructor
+      ~StageTimer(){}
+
+      //-------Per event--------//
+      void BeginEvent()
+        {
+          if ( !On ) return;
+          std::fill(EventTime.begin(), EventTime.end(), 0.);
+          std::fill(EventCount.begin(), EventCount.end(), 0);
+          LapStart = Clock::now();
+        }
+      //Time since the previous Lap() or BeginEvent() to the stage
+      void Lap(int stage)
+        {
+          if ( !On ) return;
+          const Clock::time_point now = Clock::now();
+          EventTime[stage] += std::chrono::duration<double>(now - LapStart).count();
+          LapStart = now;
+        }
+      Scope Measure(int stage) {return Scope(*this, stage);}
+      void Count(int counter, long n = 1) {if ( On ) EventCount[counter] += n;}
+      //Adds the event to the job totals
+      void EndEvent()
+        {
+          if ( !On ) return;
+          NEvents++;
+          for (unsigned int i=0; i<Time.size(); i++)   Time[i]   += EventTime[i];
+          for (unsigned int i=0; i<Counts.size(); i++) Counts[i] += EventCount[i];
+        }
+
+      //-------Job totals--------//
+      //Adds the totals of another timer (of another stream)
+      void Merge(const StageTimer& other)
+        {
+          NEvents += other.NEvents;
+          for (unsigned int i=0; i<Time.size(); i++)   Time[i]   += other.Time[i];
+          for (unsigned int i=0; i<Counts.size(); i++) Counts[i] += other.Counts[i];
+        }
+
+      //-----Access Data Members------//
+      bool   Enabled() const {return On;}
+      long   Events() const {return NEvents;}
+      double StageTime(int stage) const {return Time[stage];}          // (s)
+      long   Counter(int counter) const {return Counts[counter];}
+      const std::vector<double>& EventTimes() const {return EventTime;} // (s) of the current event
+      const std::vector<long>&   EventCounts() const {return EventCount;}
+
+   private:
+      // ----------member data ---------------------------
+      bool On;
+      std::vector<double> EventTime;
+      std::vector<long>   EventCount;
+      std::vector<double> Time;
+      std::vector<long>   Counts;
+      long NEvents = 0;
+      Clock::time_point LapStart;
+};
+
+#endif
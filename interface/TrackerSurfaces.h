@@ -0,0 +1,81 @@
+#ifndef FlyingTop_TrackerSurfaces_h
+#define FlyingTop_TrackerSurfaces_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <array>
+#include <cstdint>
+/*---------------*/
+
+// Tracker DataBase of the surfaces a first hit can be on, indexed directly by the hit pattern word.
+// The radius/z and the uncertainties are computed from the first hit of the tracks in RECO dataTier.
+// The radius is the mean value as the distributinos for each layer are not well-defined (2-3-4 peaks, etc...)
+// The standard deviation is also available for new (better?) methods.
+// stereo means second layer of a given hitpattern
+
+struct TrackerSurface {
+  int   region; // 0 : barrel cylinder, 1 : endcap disk, -1 : not in the DataBase
+  float pos;    // radius of the cylinder or |z| of the disk (cm)
+  float sigma;  // standard deviation of pos
+};
+
+struct TrackerSurfaceEntry { uint16_t hitPattern; TrackerSurface surface; };
+
+constexpr TrackerSurfaceEntry kTrackerSurfaces[33] = {
+  {1160, {0,  2.959, 0.2065}},//PIXBL1
+  {1168, {0,  6.778, 0.2   }},//PIXBL2
+  {1176, {0,  10.89, 0.1856}},//PIXBL3
+  {1184, {0,  16.,   0.1819}},//PIXBL4
+  {1416, {0,  23.83, 0.2647}},//TIBL1
+  {1420, {0,  27.02, 0.2597}},//TIBL1stereo
+  {1424, {0,  32.23, 0.2747}},//TIBL2
+  {1428, {0,  35.41, 0.2657}},//TIBL2stereo
+  {1432, {0,  41.75, 1.606 }},//TIBL3
+  {1440, {0,  49.71, 1.599 }},//TIBL4
+  {1672, {0,  60.43, 1.687 }},//TOBL1
+  {1288, {1,  32.35, 1.038 }},//PXFdisk1
+  {1296, {1,  39.41, 1.211 }},//PXFdisk2
+  {1304, {1,  48.96, 1.217 }},//PXFdisk3
+  {1544, {1,  77.9,  1.915 }},//TIDWHeel1
+  {1548, {1,  80.71, 1.613 }},//TIDWHeel1stereo
+  {1552, {1,  90.4,  2.209 }},//TIDWHeel2
+  {1556, {1,  94.02, 1.468 }},//TIDWHeel2stereo
+  {1560, {1,  102.7, 2.131 }},//TIDWHeel3
+  {1564, {1,  107.0, 1.465 }},//TIDWHeel3stereo
+  {1800, {1,  131.6, 3.851 }},//TECWHeel1
+  {1804, {1,  129.4, 3.585 }},//TECWHeel1stereo
+  {1808, {1,  145.5, 3.557 }},//TECWHeel2
+  {1812, {1,  142.8, 3.33  }},//TECWHeel2stereo
+  {1816, {1,  160.1, 3.519 }},//TECWHeel3
+  {1820, {1,  157.1, 3.42  }},//TECWHeel3stereo
+  {1824, {1,  174.2, 3.38  }},//TECWHeel4
+  {1828, {1,  172.7, 3.508 }},//TECWHeel4stereo
+  {1832, {1,  188.4, 3.501 }},//TECWHeel5
+  {1836, {1,  186.3, 3.563 }},//TECWHeel5stereo
+  {1840, {1,  203.2, 0.618 }},//TECWHeel6
+  {1844, {1,  203.8, 3.545 }},//TECWHeel6stereo
+  {1848, {1,  222.2, 0.    }}};//TECWHeel7
+
+// The hit pattern word of a valid tracker hit is 1 | substructure (3 bits) | layer (4 bits) | stereo | 00 (hit type),
+// so the 8 bits in between are enough to index the table
+constexpr unsigned int TrackerSurfaceIndex(uint16_t hitPattern) { return (hitPattern >> 2) & 0xFF; }
+constexpr bool IsValidTrackerHit(uint16_t hitPattern) { return (hitPattern & 0xFC03) == 0x400; }
+
+constexpr std::array<TrackerSurface,256> MakeTrackerSurfaceTable()
+{
+  std::array<TrackerSurface,256> table {};
+  for (unsigned int i=0; i<256; i++) table[i] = TrackerSurface{-1, 0., 0.};
+  for (const auto& entry : kTrackerSurfaces) table[TrackerSurfaceIndex(entry.hitPattern)] = entry.surface;
+  return table;
+}
+
+constexpr std::array<TrackerSurface,256> kTrackerSurfaceTable = MakeTrackerSurfaceTable();
+
+//Surface of a first hit, a single indexed load in kTrackerSurfaceTable
+inline const TrackerSurface& FirstHitSurface(uint16_t firsthit)
+{
+  static constexpr TrackerSurface unknown {-1, 0., 0.};
+  return IsValidTrackerHit(firsthit) ? kTrackerSurfaceTable[TrackerSurfaceIndex(firsthit)] : unknown;
+}
+
+#endif
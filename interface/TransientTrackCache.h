@@ -0,0 +1,55 @@
+#ifndef FlyingTop_TransientTrackCache_h
+#define FlyingTop_TransientTrackCache_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+// user include files
+#include "DataFormats/Common/interface/RefToBaseVector.h"
+#include "DataFormats/TrackReco/interface/Track.h"
+#include "TrackingTools/TransientTrack/interface/TransientTrack.h"
+#include "TrackingTools/TransientTrack/interface/TransientTrackBuilder.h"
+/*---------------*/
+
+// TransientTracks of the tracks of one event, indexed like the RefToBaseVector of the tracks.
+// Each one is built the first time it is asked for and then shared by all the stages of the
+// event (first hit propagation, control samples, hemisphere vertexing).
+// The TransientTracks point to the tracks of the event, so the cache must not outlive it.
+
+class TransientTrackCache {
+   public:
+
+      //Constructor
+      TransientTrackCache(const TransientTrackBuilder& builder, const edm::RefToBaseVector<reco::Track>& tracks) :
+        Builder (builder), Tracks (tracks), TT (tracks.size()), Built (tracks.size(), false) {}
+
+      //Destructor
+      ~TransientTrackCache(){}
+
+      //-------Main Method--------//
+      const reco::TransientTrack& Get(unsigned int i)
+        {
+          NRequests++;
+          if ( !Built[i] )
+            {
+              TT[i] = Builder.build(Tracks[i].get());
+              Built[i] = true;
+              NBuilds++;
+            }
+          return TT[i];
+        }
+
+      //-----Access Data Members------//
+      long Requests() const {return NRequests;}
+      long Builds() const {return NBuilds;}
+
+   private:
+      // ----------member data ---------------------------
+      const TransientTrackBuilder& Builder;
+      const edm::RefToBaseVector<reco::Track>& Tracks;
+      std::vector<reco::TransientTrack> TT;
+      std::vector<bool> Built;
+      long NRequests = 0, NBuilds = 0;
+};
+
+#endif
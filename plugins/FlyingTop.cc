@@ -8,6 +8,11 @@
 #include <utility>
 #include <TNtuple.h>
 #include <bitset>
+#include <chrono>
+#include <mutex>
+#include "tbb/task_group.h"
+#include <iostream>
+#include <fstream>
 
 // user include files
 #include "TTree.h"
@@ -20,7 +25,6 @@
 #include "TMVA/MethodCuts.h"
 #include "boost/functional/hash.hpp"
 
-#include "CommonTools/UtilAlgos/interface/TFileService.h"
 
 #include "CondCore/DBOutputService/interface/PoolDBOutputService.h"
 
@@ -48,8 +52,10 @@
 
 #include "FWCore/Framework/interface/Event.h"
 #include "FWCore/Framework/interface/EDAnalyzer.h"
-#include "FWCore/Framework/interface/one/EDAnalyzer.h"
+#include "FWCore/Framework/interface/stream/EDProducer.h"
 #include "FWCore/Framework/interface/ESHandle.h"
+#include "FWCore/Framework/interface/ESWatcher.h"
+#include "FWCore/Framework/interface/LuminosityBlock.h"
 #include "FWCore/Framework/interface/Frameworkfwd.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
@@ -60,6 +66,7 @@
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
 #include "FWCore/Utilities/interface/VecArray.h"
 #include "FWCore/Utilities/interface/isFinite.h"
+#include "FWCore/Utilities/interface/ESGetToken.h"
 //!!!!
 
 #include "MagneticField/Engine/interface/MagneticField.h"
@@ -99,6 +106,17 @@
 #include "MagneticField/VolumeBasedEngine/interface/VolumeBasedMagneticField.h"
               //----------------New interface----------------------//
 #include "../interface/PropaHitPattern.h"
+#include "../interface/HelixPropagator.h"
+#include "../interface/TransientTrackCache.h"
+#include "../interface/GenAncestry.h"
+#include "../interface/EtaPhiGrid.h"
+#include "../interface/StageTimer.h"
+#include "../interface/FlyingTopTiming.h"
+#include "../interface/BDTForest.h"
+#include "../interface/FirstHitGrid.h"
+#include "../interface/FlyingTopEvent.h"
+#include "../interface/FlyingTopSelection.h"
+#include "../interface/HemisphereAxes.h"
 //------------------------------End of Paul------------------------//
 
 
@@ -106,33 +124,59 @@
 // class declaration
 //
 
-// skeleton from https://twiki.cern.ch/twiki/bin/view/CMSPublic/WorkBookMiniAOD2017#4_7_MiniAOD_Analysis_Documentati
-// If the analyzer does not use TFileService, please remove
-// the template argument to the base class so the class inherits
-// from  edm::one::EDAnalyzer<>
-// This will improve performance in multithreaded jobs.
+// The ntuple content is computed here for each event and put in the event as a FlyingTopEvent,
+// the TTree itself is filled by FlyingTopAnalyzer (see FlyingTopAnalyzer.cc).
+// Being a stream module, the propagation, BDT and vertex fits of different events run in
+// parallel on the threads of the job.
 
 using reco::TrackCollection;
 
-class FlyingTopAnalyzer : public edm::one::EDAnalyzer<edm::one::SharedResources>  {
-// class FlyingTopAnalyzer : public edm::EDAnalyzer {
+// shared by all the streams : the BDT weights, loaded once per job, and the job summary
+struct FlyingTopCache {
+    std::unique_ptr<BDTForest> forest;      // flat copy of the BDTG weights, used for the selection
+    double bookTime = 0.;                   // (s) time spent loading the weights
+    mutable std::once_flag firstEvent;
+    mutable std::chrono::steady_clock::time_point start;  // time of the first event
+    mutable long rssFirstEvent = 0;                       // (kB) resident memory at the first event
+    // per stream counters, summed in endStream
+    mutable std::mutex summaryMutex;
+    mutable long   nEvent = 0;
+    mutable long   nRejected = 0;
+    mutable long   fhTracks = 0, fhCompared = 0, fhDiff = 0;
+    mutable long   ttRequests = 0, ttBuilds = 0;
+    mutable long   esLumis = 0, esRefreshes = 0;
+    mutable long   vfBusyEvents = 0;
+    mutable double vfBusyWallTime = 0., vfBusySerialTime = 0.;
+    mutable double fhMaxDiffBarrel = 0., fhMaxDiffDisk = 0.;
+    mutable StageTimer stages {FlyingTopTiming::kNStages, FlyingTopTiming::kNCounters, false};
+    mutable StageTimer fitTimes {4, 0, false};
+    std::vector<bool> filled;                                          // branch groups computed, see filledGroups()
+    mutable StageTimer groupTimes {FlyingTopBranches::NGroups, 0, false};  // time of the optional computations, per branch group
+};
+
+class FlyingTopProducer : public edm::stream::EDProducer< edm::GlobalCache<FlyingTopCache> >  {
   public:
-    explicit FlyingTopAnalyzer(const edm::ParameterSet&);
-    ~FlyingTopAnalyzer() {}
+    explicit FlyingTopProducer(const edm::ParameterSet&, const FlyingTopCache*);
+    ~FlyingTopProducer() {}
 
+    static std::unique_ptr<FlyingTopCache> initializeGlobalCache(const edm::ParameterSet&);
+    static void globalEndJob(const FlyingTopCache*);
     static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
-    bool isAncestor(const reco::Candidate * ancestor, const reco::Candidate * particle);
 
   private:
-    virtual void beginJob() override;
-    virtual void analyze(const edm::Event&, const edm::EventSetup&) override;
-    virtual void endJob() override;
+    virtual void produce(edm::Event&, const edm::EventSetup&) override;
+    virtual void beginLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup&) override;
+    virtual void endStream() override;
+    void putEvent(edm::Event&, std::unique_ptr<FlyingTopEvent>);
+
+    static std::unique_ptr<AdaptiveVertexFitter> makeVertexFitter();
+    static std::vector<bool> filledGroups(const edm::ParameterSet&);
 
     // ----------member data ---------------------------
-    
-    void clearVariables();
 
-    std::string weightFile_;
+    // counters of this stream, added to the job summary in endStream
+    int    nEvent = 0;
+    long   nRejected = 0;        // events that failed the selection, event record only
 
     //------------------------------------
     // gen information
@@ -168,324 +212,63 @@ class FlyingTopAnalyzer : public edm::one::EDAnalyzer<edm::one::SharedResources>
     edm::EDGetTokenT<edm::View<reco::Track> > trackToken_;  //used to select what tracks to read from configuration file
     edm::EDGetTokenT<edm::View<reco::Track> > trackSrc_;
     std::string parametersDefinerName_;
-    
-  ///////////////
-  // Ntuple info
+    //------------------------------------
+    // Z -> mumu + HT decision of FlyingTopFilter (mode = record), not used if selection is empty
+    //------------------------------------
+    edm::EDGetTokenT<FlyingTopSelection> selectionToken_;
 
-    TTree *smalltree;
-    
-    edm::Service<TFileService> fs;
-    
-//     std::string ttrhbuilder_;
-    
-    edm::ESHandle<MagneticField> bField;
-    
-    edm::ParameterSet kvfPSet;
-       
-    int runNumber, eventNumber, lumiBlock;
-    int  tree_NbrOfZCand;
-    bool tree_passesHTFilter;
-    int  tree_nTracks, tree_nFromC = 0, tree_nFromB = 0; 
-    
-    int nEvent;
-    
-    //-----------------------
-    // trigger variable
-//     std::vector<string > tree_trigger_names;
-//     std::vector<bool >   tree_trigger_bits;
-    
-    //--------------------------------
-    // primary vertex infos -------
-    //--------------------------------
-  
-    int   tree_nPV;
-    std::vector<float> tree_PV_x;
-    std::vector<float> tree_PV_y;
-    std::vector<float> tree_PV_z;
-    std::vector<float> tree_PV_ez;
-    std::vector<float> tree_PV_NChi2;
-    std::vector<float> tree_PV_ndf;
-    
-    std::vector<float> tree_vtx_PosX;
-    std::vector<float> tree_vtx_PosY;
-    std::vector<float> tree_vtx_PosZ;
-    std::vector<float> tree_vtx_NChi2;
-    std::vector<float> tree_vtx_PosXError;
-    std::vector<float> tree_vtx_PosYError;
-    std::vector<float> tree_vtx_PosZError;
-    
-    //--------------------------------
-    // met infos -------
-    //--------------------------------
-    float tree_PFMet_et;
-    float tree_PFMet_phi;
-    float tree_PFMet_sig;
-    
-    //--------------------------------
-    // jet infos -------
-    //--------------------------------
-    
-    int tree_njet;
-    std::vector<float> tree_jet_E;
-    std::vector<float> tree_jet_pt;
-    std::vector<float> tree_jet_eta;
-    std::vector<float> tree_jet_phi;
-    
-    //--------------------------------
-    // electrons infos -------
-    //--------------------------------
-    std::vector<float> tree_electron_pt;
-    std::vector<float> tree_electron_eta;
-    std::vector<float> tree_electron_phi;
-    std::vector<float> tree_electron_x;
-    std::vector<float> tree_electron_y;
-    std::vector<float> tree_electron_z;
-    std::vector<float> tree_electron_energy;
-    std::vector< int > tree_electron_charge;
-    
-    //--------------------------------
-    // muons infos -------
-    //--------------------------------
-    float tree_Mmumu;
-    std::vector<float> tree_muon_pt;
-    std::vector<float> tree_muon_eta;
-    std::vector<float> tree_muon_phi;
-    std::vector<float> tree_muon_x;
-    std::vector<float> tree_muon_y;
-    std::vector<float> tree_muon_z;
-    std::vector<float> tree_muon_energy;
-    std::vector<float> tree_muon_dxy;
-    std::vector<float> tree_muon_dxyError;
-    std::vector<float> tree_muon_dz;
-    std::vector<float> tree_muon_dzError;
-    std::vector< int > tree_muon_charge;
-    std::vector<bool>  tree_muon_isLoose;
-    std::vector<bool>  tree_muon_isTight;
-    std::vector<bool>  tree_muon_isGlobal;
-    
-    //-----------------------
-    // per track
-    //-----------------------
-    std::vector<float>    tree_track_pt;
-    std::vector<float>    tree_track_eta;
-    std::vector<float>    tree_track_phi;
-    std::vector<int>      tree_track_charge;
-    std::vector<float>    tree_track_NChi2;
-    std::vector<bool>     tree_track_isLoose;
-    std::vector<bool>     tree_track_isTight;
-    std::vector<bool>     tree_track_isHighPurity;
-    std::vector<float>    tree_track_dxy; // with respect to PV
-    std::vector<float>    tree_track_dxyError;
-    std::vector<float>    tree_track_drSig;
-    std::vector<float>    tree_track_dz;  // with respect to PV
-    std::vector<float>    tree_track_dzError;
-    std::vector<int>      tree_track_numberOfLostHits;
-    std::vector<unsigned int>    tree_track_originalAlgo;
-//     http://cmsdoxygen.web.cern.ch/cmsdoxygen/CMSSW_10_1_3/doc/html/d8/df2/classreco_1_1TrackBase.html#aca7611bd1a33d535cefc72b6e497ece8
-    std::vector<unsigned int>    tree_track_algo;
-    std::vector<unsigned short>  tree_track_stopReason;
-    std::vector<int>      tree_track_nHit;
-    std::vector<int>      tree_track_nHitPixel;
-    std::vector<int>      tree_track_nHitTIB;
-    std::vector<int>      tree_track_nHitTID;
-    std::vector<int>      tree_track_nHitTOB;
-    std::vector<int>      tree_track_nHitTEC;
-    std::vector<int>      tree_track_nHitPXB;
-    std::vector<int>      tree_track_nHitPXF;
-    std::vector<int>      tree_track_isHitPixel;
-    std::vector<int>      tree_track_nLayers;
-    std::vector<int>      tree_track_nLayersPixel;
-    std::vector<int>      tree_track_stripTECLayersWithMeasurement ;
-    std::vector<int>      tree_track_stripTIBLayersWithMeasurement;
-    std::vector<int>      tree_track_stripTIDLayersWithMeasurement;
-    std::vector<int>      tree_track_stripTOBLayersWithMeasurement;
-//     std::vector<int>     tree_track_nLostHit;
-    
-    std::vector< float >  tree_track_x;
-    std::vector< float >  tree_track_y;
-    std::vector< float >  tree_track_z;
-    std::vector< int >    tree_track_firstHit;
-    std::vector< float >  tree_track_firstHit_x;
-    std::vector< float >  tree_track_firstHit_y;
-    std::vector< float >  tree_track_firstHit_z;
-    std::vector< int >    tree_track_iJet;
-    std::vector<float>    tree_track_region;
-    std::vector<float>    tree_track_ntrk10;
-    std::vector<float>    tree_track_ntrk20;
-    std::vector<float>    tree_track_ntrk30;
-    std::vector< double > tree_track_MVAval;
-    std::vector< int >    tree_track_Hemi;
-    std::vector< double > tree_track_Hemi_dR;
-    std::vector< double > tree_track_Hemi_mva_NChi2;
-    std::vector< int >    tree_track_Hemi_LLP;
-    
-    std::vector< int >    tree_track_sim_LLP;
-    std::vector< bool >   tree_track_sim_isFromB;
-    std::vector< bool >   tree_track_sim_isFromC;
-    std::vector< float >  tree_track_sim_pt;
-    std::vector< float >  tree_track_sim_eta  ;
-    std::vector< float >  tree_track_sim_phi  ;
-    std::vector< int >    tree_track_sim_charge;
-    std::vector< int >    tree_track_sim_pdgId;
-    std::vector< float >  tree_track_sim_mass  ;
-    std::vector< float >  tree_track_sim_x;
-    std::vector< float >  tree_track_sim_y;
-    std::vector< float >  tree_track_sim_z;
-//$$
-    std::vector< float >  tree_track_sim_dFirstGen;
-//$$
-    
-    //--------------------------------
-    // gen infos -------
-    //--------------------------------
-    float tree_GenPVx;
-    float tree_GenPVy;
-    float tree_GenPVz;
-    
-    std::vector< float > tree_genParticle_pt;
-    std::vector< float > tree_genParticle_eta;
-    std::vector< float > tree_genParticle_phi;
-    std::vector< float > tree_genParticle_charge;
-    std::vector< int >   tree_genParticle_pdgId;
-    std::vector< float > tree_genParticle_mass;
-    std::vector< float > tree_genParticle_x;
-    std::vector< float > tree_genParticle_y;
-    std::vector< float > tree_genParticle_z;
-    std::vector< int >   tree_genParticle_statusCode;
-    std::vector< int >   tree_genParticle_mother_pdgId;
-    std::vector< int >   tree_genParticle_LLP;
-
-    std::vector< float > tree_genPackPart_pt;
-    std::vector< float > tree_genPackPart_eta;
-    std::vector< float > tree_genPackPart_phi;
-    std::vector< float > tree_genPackPart_charge;
-    std::vector< int >   tree_genPackPart_pdgId;
-    std::vector< float > tree_genPackPart_mass;
-    std::vector< int >   tree_genPackPart_mother_pdgId;
-
-    int tree_ngenFromLLP;
-    std::vector< int >   tree_genFromLLP_LLP;
-    std::vector< float > tree_genFromLLP_pt;
-    std::vector< float > tree_genFromLLP_eta;
-    std::vector< float > tree_genFromLLP_phi;
-    std::vector< float > tree_genFromLLP_charge;
-    std::vector< int >   tree_genFromLLP_pdgId;
-    std::vector< float > tree_genFromLLP_mass;
-    std::vector< float > tree_genFromLLP_x;
-    std::vector< float > tree_genFromLLP_y;
-    std::vector< float > tree_genFromLLP_z;
-    std::vector< int >   tree_genFromLLP_mother_pdgId;
-    std::vector< bool >  tree_genFromLLP_isFromB;
-    std::vector< bool >  tree_genFromLLP_isFromC;
-    std::vector< float > tree_genAxis_dRneuneu;
-
-    std::vector< float > tree_genFromC_pt;
-    std::vector< float > tree_genFromC_eta;
-    std::vector< float > tree_genFromC_phi;
-    std::vector< float > tree_genFromC_charge;
-    std::vector< int >   tree_genFromC_pdgId;
-    std::vector< float > tree_genFromC_x;
-    std::vector< float > tree_genFromC_y;
-    std::vector< float > tree_genFromC_z;
-    std::vector< int >   tree_genFromC_mother_pdgId;
-    std::vector< int >   tree_genFromC_generation;
-    std::vector< int >   tree_genFromC_LLP;
-    
-    std::vector< float > tree_genFromB_pt;
-    std::vector< float > tree_genFromB_eta;
-    std::vector< float > tree_genFromB_phi;
-    std::vector< float > tree_genFromB_charge;
-    std::vector< int >   tree_genFromB_pdgId;
-    std::vector< float > tree_genFromB_x;
-    std::vector< float > tree_genFromB_y;
-    std::vector< float > tree_genFromB_z;
-    std::vector< int >   tree_genFromB_mother_pdgId;
-    std::vector< int >   tree_genFromB_generation;
-    std::vector< int >   tree_genFromB_LLP;
-   
-    //--------------------------------
-    // gen jet infos -------
-    //--------------------------------
-    std::vector<float> tree_genJet_pt;
-    std::vector<float> tree_genJet_eta;
-    std::vector<float> tree_genJet_phi;
-    std::vector<float> tree_genJet_mass;
-    std::vector<float> tree_genJet_energy;
-    
-    //--------------------------------
-    // gen event info -------
-    //--------------------------------
-    
-    //--------------------------------
-    // lhe event infos -------
-    //--------------------------------
-    
-    //--------------------------------
-    // PF infos -------
-    //--------------------------------
-    
-    //-----------------------
-    // generated LLPs 
-    //-----------------------
-    float LLP1_pt, LLP1_eta, LLP1_phi, LLP2_pt, LLP2_eta, LLP2_phi;
-    float LLP1_x, LLP1_y, LLP1_z, LLP2_x, LLP2_y, LLP2_z;
-    float LLP1_dist, LLP2_dist;
-    int   LLP1_nTrks = 0, LLP2_nTrks = 0;
-
-    int   tree_nLLP = -1;
-    std::vector< int >   tree_LLP;
-    std::vector< float > tree_LLP_pt;
-    std::vector< float > tree_LLP_eta;
-    std::vector< float > tree_LLP_phi;
-    std::vector< float > tree_LLP_x;
-    std::vector< float > tree_LLP_y;
-    std::vector< float > tree_LLP_z;
-    std::vector< float > tree_LLP_dist;
-    std::vector< int >   tree_LLP_nTrks;
-    std::vector< int >   tree_LLP_Vtx_nTrks;
-    std::vector< float > tree_LLP_Vtx_NChi2;
-    std::vector< float > tree_LLP_Vtx_dx;
-    std::vector< float > tree_LLP_Vtx_dy;
-    std::vector< float > tree_LLP_Vtx_dz;
-    std::vector< float > tree_LLP_Vtx_dist;
-    std::vector< float > tree_LLP_Vtx_dd;
-    std::vector< float > tree_LLP_Vtx_trackWeight;
-
-    //-----------------------
-    //Analysis with the two hemispheres
-    //-----------------------
-    std::vector< int >   tree_Hemi;
-    std::vector< int >   tree_Hemi_njet;
-    std::vector< float > tree_Hemi_eta;
-    std::vector< float > tree_Hemi_phi;
-    std::vector< float > tree_Hemi_dR;
-    std::vector< int >   tree_Hemi_nTrks;
-    std::vector< int >   tree_Hemi_nTrks_sig;
-    std::vector< int >   tree_Hemi_nTrks_bad;
-    std::vector< int >   tree_Hemi_nTrks_mva;
-    std::vector< int >   tree_Hemi_nTrks_mva_sig;
-    std::vector< int >   tree_Hemi_nTrks_mva_bad;
-    std::vector< int >   tree_Hemi_LLP;
-    std::vector< float > tree_Hemi_LLP_pt;
-    std::vector< float > tree_Hemi_LLP_eta;
-    std::vector< float > tree_Hemi_LLP_phi;
-    std::vector< float > tree_Hemi_LLP_dist;
-    std::vector< float > tree_Hemi_LLP_x;
-    std::vector< float > tree_Hemi_LLP_y;
-    std::vector< float > tree_Hemi_LLP_z;
-    std::vector< float > tree_Hemi_Vtx_NChi2;
-    std::vector< int >   tree_Hemi_Vtx_nTrks;
-    std::vector< float > tree_Hemi_Vtx_x;
-    std::vector< float > tree_Hemi_Vtx_y;
-    std::vector< float > tree_Hemi_Vtx_z;
-    std::vector< float > tree_Hemi_Vtx_dx;
-    std::vector< float > tree_Hemi_Vtx_dy;
-    std::vector< float > tree_Hemi_Vtx_dz;
-    std::vector< float > tree_Hemi_Vtx_dist;
-    std::vector< float > tree_Hemi_Vtx_dd;
-    std::vector< float > tree_Hemi_Vtx_trackWeight;
-    std::vector< float > tree_Hemi_dR12;
-    std::vector< float > tree_Hemi_LLP_dR12;
+    //------------------------------------
+    // EventSetup of the tracking: TransientTrackBuilder, magnetic field and the propagators built with it,
+    // looked up in beginLuminosityBlock only when TransientTrackRecord (which follows the magnetic field) changes
+    //------------------------------------
+    const edm::ESGetToken<TransientTrackBuilder, TransientTrackRecord> ttBuilderToken_;
+    const edm::ESGetToken<MagneticField, IdealMagneticFieldRecord> bFieldToken_;
+    edm::ESWatcher<TransientTrackRecord> ttRecordWatcher_;
+    const TransientTrackBuilder* ttBuilder_ = nullptr;
+    long   es_nLumis = 0, es_nRefreshes = 0;
+
+    //------------------------------------
+    // first hit propagation
+    //------------------------------------
+    std::unique_ptr<AnalyticalPropagator> propagator_; // rebuilt only when the magnetic field changes
+    PropaHitPattern propaHitPattern_;
+    HelixPropagator helixPropagator_;                  // batch propagation in the field at the centre of the detector
+    bool helixFirstHit_;                               // store the HelixPropagator positions instead of the PropaHitPattern ones
+    bool validateFirstHit_;                            // run both and compare, the PropaHitPattern positions are stored
+
+    // counters of the first hit propagation
+    long   fh_nTracks = 0, fh_nCompared = 0, fh_nDiff = 0;
+    double fh_maxDiffBarrel = 0., fh_maxDiffDisk = 0.; // largest distance between the two (cm)
+
+    // hemisphere axes, one builder per stream
+    HemisphereAxes hemiAxes_;
+
+    // counters of the TransientTrackCache
+    long   tt_nRequests = 0, tt_nBuilds = 0;
+
+    // time of the stages of produce() and counters, see ../interface/FlyingTopTiming.h (timing = True)
+    StageTimer stages_;
+
+    // time of each of the four concurrent vertex fits, llp1, llp2, Hemi1 and Hemi2 (timing = True), and wall-clock
+    // time of the fits and sum of their times in the busy events, with at least 2 fits of more than 20 tracks
+    StageTimer fitTimes_;
+    long   vf_nBusyEvents = 0;
+    double vf_busyWallTime = 0., vf_busySerialTime = 0.;  // (s)
+
+    // branch groups to compute (branchGroups and the groups they need), see ../interface/FlyingTopBranches.h,
+    // and time of their optional computations (timing = True)
+    std::vector<bool> fill_;
+    StageTimer groupTimes_;
+
+    // largest size of each FlyingTopEvent column in the events of the stream: the product is a new object for each
+    // event (the framework owns it once put), so its columns are reserved at these sizes instead of growing from empty
+    std::vector<size_t> columnSizes_;
+
+    //------------------------------------
+    // vertex fitters, one set per stream and one per fit, so that the fits can run concurrently
+    //------------------------------------
+    std::unique_ptr<AdaptiveVertexFitter> theFitter_vertex_llp1_mva, theFitter_vertex_llp2_mva;
+    std::unique_ptr<AdaptiveVertexFitter> theFitter_Vertex_Hemi1_mva, theFitter_Vertex_Hemi2_mva;
 };
 
 //
@@ -496,12 +279,20 @@ class FlyingTopAnalyzer : public edm::one::EDAnalyzer<edm::one::SharedResources>
 // static data member definitions
 //
 
+// memory of the job in kB as given by /proc/self/status for key = "VmRSS" (current) or "VmHWM" (high-water mark)
+static long procStatusKB(const std::string& key)
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while ( std::getline(status, line) )
+    if ( line.compare(0, key.size()+1, key+":") == 0 ) return std::atol(line.c_str() + key.size() + 1);
+  return -1;
+}
+
 //
 // constructors and destructor
 //
-FlyingTopAnalyzer::FlyingTopAnalyzer(const edm::ParameterSet& iConfig):
-
-    weightFile_( iConfig.getUntrackedParameter<std::string>("weightFileMVA") ),   
+FlyingTopProducer::FlyingTopProducer(const edm::ParameterSet& iConfig, const FlyingTopCache*):
 
     prunedGenToken_(consumes<edm::View<reco::GenParticle> >(      iConfig.getParameter<edm::InputTag>("genpruned"))),
     packedGenToken_(consumes<edm::View<pat::PackedGenParticle> >( iConfig.getParameter<edm::InputTag>("genpacked"))),
@@ -514,313 +305,134 @@ FlyingTopAnalyzer::FlyingTopAnalyzer(const edm::ParameterSet& iConfig):
 //$$    muonToken_(     consumes<reco::MuonCollection>(               iConfig.getParameter<edm::InputTag>("muons"))),
     muonToken_(     consumes<pat::MuonCollection>(                iConfig.getParameter<edm::InputTag>("muons"))),
     trackToken_(    consumes<edm::View<reco::Track> >(  	  iConfig.getUntrackedParameter<edm::InputTag>("tracks"))),
-    trackSrc_(      consumes<edm::View<reco::Track> >(  	  iConfig.getParameter<edm::InputTag>("trackLabel") ))
+    trackSrc_(      consumes<edm::View<reco::Track> >(  	  iConfig.getParameter<edm::InputTag>("trackLabel") )),
+    ttBuilderToken_( esConsumes<TransientTrackBuilder, TransientTrackRecord, edm::Transition::BeginLuminosityBlock>(edm::ESInputTag("", "TransientTrackBuilder")) ),
+    bFieldToken_(    esConsumes<MagneticField, IdealMagneticFieldRecord, edm::Transition::BeginLuminosityBlock>() ),
+
+    helixFirstHit_(    iConfig.getUntrackedParameter<std::string>("firstHitPropagation", "cmssw") == "helix" ),
+    validateFirstHit_( iConfig.getUntrackedParameter<std::string>("firstHitPropagation", "cmssw") == "validate" ),
+    stages_( FlyingTopTiming::kNStages, FlyingTopTiming::kNCounters, iConfig.getUntrackedParameter<bool>("timing", false) ),
+    fitTimes_( 4, 0, iConfig.getUntrackedParameter<bool>("timing", false) ),
+    fill_( filledGroups(iConfig) ),
+    groupTimes_( FlyingTopBranches::NGroups, 0, iConfig.getUntrackedParameter<bool>("timing", false) )
 {
    //now do what ever initialization is needed
-    nEvent = 0;
-    usesResource("TFileService");
-    
-    smalltree = fs->make<TTree>("ttree", "ttree");
-    
-    // event info
-    smalltree->Branch("runNumber",  &runNumber,  "runNumber/I");
-    smalltree->Branch("eventNumber",&eventNumber,"eventNumber/I");
-    smalltree->Branch("lumiBlock"  ,&lumiBlock,  "lumiBlock/I");
-    
-    // primary vertex info
-    smalltree->Branch("tree_nPV", &tree_nPV);
-    smalltree->Branch("tree_PV_x",     &tree_PV_x);
-    smalltree->Branch("tree_PV_y",     &tree_PV_y);
-    smalltree->Branch("tree_PV_z",     &tree_PV_z);    
-    smalltree->Branch("tree_PV_ez",    &tree_PV_ez);    
-    smalltree->Branch("tree_PV_NChi2", &tree_PV_NChi2);    
-    smalltree->Branch("tree_PV_ndf",   &tree_PV_ndf);    
-    
-    // trigger info
-//     smalltree->Branch("tree_trigger_names", &tree_trigger_names);
-//     smalltree->Branch("tree_trigger_bits",  &tree_trigger_bits);
-    
-    smalltree->Branch("tree_NbrOfZCand",  &tree_NbrOfZCand,  "tree_NbrOfZCand/I");
-    smalltree->Branch("tree_passesHTFilter", &tree_passesHTFilter);
-    
-    // met info
-    smalltree->Branch("tree_PFMet_et" ,  &tree_PFMet_et);
-    smalltree->Branch("tree_PFMet_phi" , &tree_PFMet_phi);
-    smalltree->Branch("tree_PFMet_sig" , &tree_PFMet_sig);
-    
-    // jet info
-    smalltree->Branch("tree_njet"  ,        &tree_njet);
-    smalltree->Branch("tree_jet_E"  ,       &tree_jet_E);
-    smalltree->Branch("tree_jet_pt"  ,      &tree_jet_pt);
-    smalltree->Branch("tree_jet_eta" ,      &tree_jet_eta);
-    smalltree->Branch("tree_jet_phi" ,      &tree_jet_phi);
-    
-    // electrons info
-    smalltree->Branch("tree_electron_pt"  ,   &tree_electron_pt);
-    smalltree->Branch("tree_electron_eta" ,   &tree_electron_eta);
-    smalltree->Branch("tree_electron_phi" ,   &tree_electron_phi);
-    smalltree->Branch("tree_electron_x"  ,    &tree_electron_x);
-    smalltree->Branch("tree_electron_y" ,     &tree_electron_y);
-    smalltree->Branch("tree_electron_z" ,     &tree_electron_z);
-    smalltree->Branch("tree_electron_energy", &tree_electron_energy);
-    smalltree->Branch("tree_electron_charge", &tree_electron_charge);
-    
-    // muons info
-    smalltree->Branch("tree_Mmumu"  ,         &tree_Mmumu);
-    smalltree->Branch("tree_muon_pt"  ,       &tree_muon_pt);
-    smalltree->Branch("tree_muon_eta" ,       &tree_muon_eta);
-    smalltree->Branch("tree_muon_phi" ,       &tree_muon_phi);
-    smalltree->Branch("tree_muon_x"  ,        &tree_muon_x);
-    smalltree->Branch("tree_muon_y" ,         &tree_muon_y);
-    smalltree->Branch("tree_muon_z" ,         &tree_muon_z);
-    smalltree->Branch("tree_muon_energy",     &tree_muon_energy);
-    smalltree->Branch("tree_muon_dxy",        &tree_muon_dxy);
-    smalltree->Branch("tree_muon_dxyError",   &tree_muon_dxyError);
-    smalltree->Branch("tree_muon_dz",         &tree_muon_dz);
-    smalltree->Branch("tree_muon_dzError",    &tree_muon_dzError);
-    smalltree->Branch("tree_muon_charge",     &tree_muon_charge);
-    smalltree->Branch("tree_muon_isLoose",    &tree_muon_isLoose);
-    smalltree->Branch("tree_muon_isTight",    &tree_muon_isTight);
-    smalltree->Branch("tree_muon_isGlobal",   &tree_muon_isGlobal);
-    
-    // track
-    smalltree->Branch("tree_nTracks",                &tree_nTracks, "tree_nTracks/I"); 
-    smalltree->Branch("tree_track_pt",               &tree_track_pt);
-    smalltree->Branch("tree_track_eta",              &tree_track_eta );
-    smalltree->Branch("tree_track_phi",              &tree_track_phi );
-    smalltree->Branch("tree_track_charge",           &tree_track_charge );
-    smalltree->Branch("tree_track_NChi2",            &tree_track_NChi2);
-    smalltree->Branch("tree_track_isLoose",&tree_track_isLoose);
-    smalltree->Branch("tree_track_isTight",&tree_track_isTight);
-    smalltree->Branch("tree_track_isHighPurity",     &tree_track_isHighPurity);
-    smalltree->Branch("tree_track_dxy",              &tree_track_dxy );
-    smalltree->Branch("tree_track_dxyError",         &tree_track_dxyError);
-    smalltree->Branch("tree_track_drSig",            &tree_track_drSig);
-    smalltree->Branch("tree_track_dz",               &tree_track_dz);
-    smalltree->Branch("tree_track_dzError",          &tree_track_dzError  );
-    smalltree->Branch("tree_track_numberOfLostHits", &tree_track_numberOfLostHits );
-    smalltree->Branch("tree_track_originalAlgo",     &tree_track_originalAlgo );
-    smalltree->Branch("tree_track_algo",             &tree_track_algo);
-    smalltree->Branch("tree_track_stopReason",       &tree_track_stopReason );
-    smalltree->Branch("tree_track_nHit",         &tree_track_nHit);
-    smalltree->Branch("tree_track_nHitPixel",    &tree_track_nHitPixel);
-    smalltree->Branch("tree_track_nHitTIB",      &tree_track_nHitTIB);
-    smalltree->Branch("tree_track_nHitTID",      &tree_track_nHitTID);
-    smalltree->Branch("tree_track_nHitTOB",      &tree_track_nHitTOB);
-    smalltree->Branch("tree_track_nHitTEC",      &tree_track_nHitTEC);
-    smalltree->Branch("tree_track_nHitPXB",      &tree_track_nHitPXB);
-    smalltree->Branch("tree_track_nHitPXF",      &tree_track_nHitPXF);
-    smalltree->Branch("tree_track_isHitPixel",   &tree_track_isHitPixel);
-    smalltree->Branch("tree_track_nLayers",      &tree_track_nLayers);
-    smalltree->Branch("tree_track_nLayersPixel", &tree_track_nLayersPixel);
-    smalltree->Branch("tree_track_stripTECLayersWithMeasurement", &tree_track_stripTECLayersWithMeasurement);
-    smalltree->Branch("tree_track_stripTIBLayersWithMeasurement", &tree_track_stripTIBLayersWithMeasurement);
-    smalltree->Branch("tree_track_stripTIDLayersWithMeasurement", &tree_track_stripTIDLayersWithMeasurement);
-    smalltree->Branch("tree_track_stripTOBLayersWithMeasurement", &tree_track_stripTOBLayersWithMeasurement);
-    smalltree->Branch("tree_track_x",            &tree_track_x );
-    smalltree->Branch("tree_track_y",            &tree_track_y );
-    smalltree->Branch("tree_track_z",            &tree_track_z );
-    smalltree->Branch("tree_track_firstHit",     &tree_track_firstHit);
-    smalltree->Branch("tree_track_region",       &tree_track_region);
-    smalltree->Branch("tree_track_firstHit_x",   &tree_track_firstHit_x);
-    smalltree->Branch("tree_track_firstHit_y",   &tree_track_firstHit_y);
-    smalltree->Branch("tree_track_firstHit_z",   &tree_track_firstHit_z);
-    smalltree->Branch("tree_track_iJet",         &tree_track_iJet);
-    smalltree->Branch("tree_track_ntrk10",       &tree_track_ntrk10);
-    smalltree->Branch("tree_track_ntrk20",       &tree_track_ntrk20);
-    smalltree->Branch("tree_track_ntrk30",       &tree_track_ntrk30);
-    smalltree->Branch("tree_track_MVAval",         &tree_track_MVAval);
-    smalltree->Branch("tree_track_Hemi",           &tree_track_Hemi);
-    smalltree->Branch("tree_track_Hemi_dR",        &tree_track_Hemi_dR);
-    smalltree->Branch("tree_track_Hemi_mva_NChi2", &tree_track_Hemi_mva_NChi2);
-    smalltree->Branch("tree_track_Hemi_LLP",       &tree_track_Hemi_LLP);
-        
-    // info about the simulated track from LLP matched to the reco track
-    smalltree->Branch("tree_track_sim_LLP",        &tree_track_sim_LLP );
-    smalltree->Branch("tree_track_sim_isFromB",    &tree_track_sim_isFromB );
-    smalltree->Branch("tree_track_sim_isFromC",    &tree_track_sim_isFromC );
-    smalltree->Branch("tree_track_sim_pt",         &tree_track_sim_pt );
-    smalltree->Branch("tree_track_sim_eta",        &tree_track_sim_eta );
-    smalltree->Branch("tree_track_sim_phi",        &tree_track_sim_phi );
-    smalltree->Branch("tree_track_sim_charge",     &tree_track_sim_charge );
-    smalltree->Branch("tree_track_sim_pdgId",      &tree_track_sim_pdgId );
-    smalltree->Branch("tree_track_sim_mass",       &tree_track_sim_mass );
-    smalltree->Branch("tree_track_sim_x",          &tree_track_sim_x );
-    smalltree->Branch("tree_track_sim_y",          &tree_track_sim_y );
-    smalltree->Branch("tree_track_sim_z",          &tree_track_sim_z );    
+    produces<FlyingTopEvent>();
+    if ( stages_.Enabled() ) produces<FlyingTopTiming>();
+
+    edm::InputTag selection = iConfig.getUntrackedParameter<edm::InputTag>("selection", edm::InputTag());
+    if ( !selection.label().empty() ) selectionToken_ = consumes<FlyingTopSelection>(selection);
+
+    std::string firstHitPropagation = iConfig.getUntrackedParameter<std::string>("firstHitPropagation", "cmssw");
+    if ( firstHitPropagation != "cmssw" && firstHitPropagation != "helix" && firstHitPropagation != "validate" )
+      throw cms::Exception("Configuration") << "firstHitPropagation must be cmssw, helix or validate, not " << firstHitPropagation;
+
+    theFitter_vertex_llp1_mva  = makeVertexFitter();
+    theFitter_vertex_llp2_mva  = makeVertexFitter();
+    theFitter_Vertex_Hemi1_mva = makeVertexFitter();
+    theFitter_Vertex_Hemi2_mva = makeVertexFitter();
+}
+
+
+std::unique_ptr<FlyingTopCache> FlyingTopProducer::initializeGlobalCache(const edm::ParameterSet& iConfig)
+{
+  auto cache = std::make_unique<FlyingTopCache>();
+
+  //add the variables from my BDT (Paul)
+  // mva_track_firstHit_x/y/z, dxy, dz and algo are not used by TMVAClassification_BDTG50cm_HighPurity.weights.xml
+  const std::vector<std::string> mvaVariables = {
+    "mva_track_pt", "mva_track_eta", "mva_track_nchi2", "mva_track_nhits",
+    "mva_ntrk10", "mva_drSig", "mva_track_isinjet" };
+
+  auto t0 = std::chrono::steady_clock::now();
+  cache->forest = std::make_unique<BDTForest>( iConfig.getUntrackedParameter<std::string>("weightFileMVA"), mvaVariables );
+  cache->bookTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  cache->stages = StageTimer( FlyingTopTiming::kNStages, FlyingTopTiming::kNCounters, iConfig.getUntrackedParameter<bool>("timing", false) );
+  cache->fitTimes = StageTimer( 4, 0, iConfig.getUntrackedParameter<bool>("timing", false) );
+  cache->filled = filledGroups(iConfig);
+  cache->groupTimes = StageTimer( FlyingTopBranches::NGroups, 0, iConfig.getUntrackedParameter<bool>("timing", false) );
+  return cache;
+}
+
+
+// branch groups to compute: the ones in branchGroups (all if empty) and the ones their computation reads back.
+// Event, PV, Jet, Muon, Track, LLP and Hemi are always computed, the selection needs them; the others are
+// skipped when they are not written.
+std::vector<bool> FlyingTopProducer::filledGroups(const edm::ParameterSet& iConfig)
+{
+  std::vector<std::string> names = iConfig.getUntrackedParameter<std::vector<std::string> >("branchGroups", std::vector<std::string>());
+  std::vector<bool> fill(FlyingTopBranches::NGroups, names.empty());
+  for (const auto& name : names) {
+    int group = FlyingTopBranches::GroupIndex(name);
+    if ( group < 0 ) throw cms::Exception("Configuration") << "unknown branch group " << name;
+    fill[group] = true;
+  }
+  // the hemisphere and LLP vertex stages use the truth matching of the tracks, which uses the gen particles from LLP
+  if ( fill[FlyingTopBranches::LLP] || fill[FlyingTopBranches::Hemi] ) fill[FlyingTopBranches::TrackSim] = true;
+  if ( fill[FlyingTopBranches::TrackSim] ) fill[FlyingTopBranches::GenFromLLP] = true;
+  return fill;
+}
+
+
+std::unique_ptr<AdaptiveVertexFitter> FlyingTopProducer::makeVertexFitter()
+{
 //$$
-    smalltree->Branch("tree_track_sim_dFirstGen",  &tree_track_sim_dFirstGen );
+  // parameters for the Adaptive Vertex Fitter (AVF)
+  double maxshift        = 0.0001;
+  unsigned int maxstep   = 30;
+  double maxlpshift      = 0.1;
+  double weightThreshold = 0.001;
+  double sigmacut        = 3.;
+  double Tini            = 256.;
+  double ratio           = 0.25;
 //$$
 
-    // gen info
-    smalltree->Branch("tree_GenPVx" ,  &tree_GenPVx);
-    smalltree->Branch("tree_GenPVy" ,  &tree_GenPVy);
-    smalltree->Branch("tree_GenPVz" ,  &tree_GenPVz);
-    
-    smalltree->Branch("tree_genParticle_pt"  ,          &tree_genParticle_pt);
-    smalltree->Branch("tree_genParticle_eta" ,          &tree_genParticle_eta);
-    smalltree->Branch("tree_genParticle_phi" ,          &tree_genParticle_phi);
-    smalltree->Branch("tree_genParticle_charge" ,       &tree_genParticle_charge);
-    smalltree->Branch("tree_genParticle_pdgId" ,        &tree_genParticle_pdgId);
-    smalltree->Branch("tree_genParticle_mass" ,         &tree_genParticle_mass);
-    smalltree->Branch("tree_genParticle_x"  ,	        &tree_genParticle_x);
-    smalltree->Branch("tree_genParticle_y" ,	        &tree_genParticle_y);
-    smalltree->Branch("tree_genParticle_z" ,	        &tree_genParticle_z);
-    smalltree->Branch("tree_genParticle_statusCode",    &tree_genParticle_statusCode);
-    smalltree->Branch("tree_genParticle_mother_pdgId" , &tree_genParticle_mother_pdgId);
-    smalltree->Branch("tree_genParticle_LLP" ,          &tree_genParticle_LLP);
-
-    smalltree->Branch("tree_genPackPart_pt"  ,          &tree_genPackPart_pt);
-    smalltree->Branch("tree_genPackPart_eta" ,          &tree_genPackPart_eta);
-    smalltree->Branch("tree_genPackPart_phi" ,          &tree_genPackPart_phi);
-    smalltree->Branch("tree_genPackPart_charge" ,       &tree_genPackPart_charge);
-    smalltree->Branch("tree_genPackPart_pdgId" ,        &tree_genPackPart_pdgId);
-    smalltree->Branch("tree_genPackPart_mass" ,         &tree_genPackPart_mass);
-    smalltree->Branch("tree_genPackPart_mother_pdgId" , &tree_genPackPart_mother_pdgId);
-
-    smalltree->Branch("tree_ngenFromLLP"  ,            &tree_ngenFromLLP);
-    smalltree->Branch("tree_genFromLLP_LLP"  ,         &tree_genFromLLP_LLP);
-    smalltree->Branch("tree_genFromLLP_pt"  ,          &tree_genFromLLP_pt);
-    smalltree->Branch("tree_genFromLLP_eta" ,          &tree_genFromLLP_eta);
-    smalltree->Branch("tree_genFromLLP_phi" ,          &tree_genFromLLP_phi);
-    smalltree->Branch("tree_genFromLLP_charge" ,       &tree_genFromLLP_charge);
-    smalltree->Branch("tree_genFromLLP_pdgId" ,        &tree_genFromLLP_pdgId);
-    smalltree->Branch("tree_genFromLLP_mass" ,         &tree_genFromLLP_mass);
-    smalltree->Branch("tree_genFromLLP_x"  ,	       &tree_genFromLLP_x);
-    smalltree->Branch("tree_genFromLLP_y" ,	       &tree_genFromLLP_y);
-    smalltree->Branch("tree_genFromLLP_z" ,	       &tree_genFromLLP_z);
-    smalltree->Branch("tree_genFromLLP_mother_pdgId" , &tree_genFromLLP_mother_pdgId);
-    smalltree->Branch("tree_genFromLLP_isFromB" ,      &tree_genFromLLP_isFromB);
-    smalltree->Branch("tree_genFromLLP_isFromC" ,      &tree_genFromLLP_isFromC);
-
-    smalltree->Branch("tree_genAxis_dRneuneu",       &tree_genAxis_dRneuneu);
-
-    smalltree->Branch("tree_nFromC",                 &tree_nFromC,  "tree_nFromC/I");
-    smalltree->Branch("tree_genFromC_pt"  ,          &tree_genFromC_pt);
-    smalltree->Branch("tree_genFromC_eta" ,          &tree_genFromC_eta);
-    smalltree->Branch("tree_genFromC_phi" ,          &tree_genFromC_phi);
-    smalltree->Branch("tree_genFromC_charge" ,       &tree_genFromC_charge);
-    smalltree->Branch("tree_genFromC_pdgId" ,        &tree_genFromC_pdgId);
-    smalltree->Branch("tree_genFromC_x"  ,	     &tree_genFromC_x);
-    smalltree->Branch("tree_genFromC_y" ,	     &tree_genFromC_y);
-    smalltree->Branch("tree_genFromC_z" ,	     &tree_genFromC_z);
-    smalltree->Branch("tree_genFromC_mother_pdgId" , &tree_genFromC_mother_pdgId);
-    smalltree->Branch("tree_genFromC_generation" ,   &tree_genFromC_generation);
-    smalltree->Branch("tree_genFromC_LLP" ,          &tree_genFromC_LLP);
-
-    smalltree->Branch("tree_nFromB",                 &tree_nFromB,  "tree_nFromB/I");
-    smalltree->Branch("tree_genFromB_pt"  ,	     &tree_genFromB_pt);
-    smalltree->Branch("tree_genFromB_eta" ,	     &tree_genFromB_eta);
-    smalltree->Branch("tree_genFromB_phi" ,	     &tree_genFromB_phi);
-    smalltree->Branch("tree_genFromB_charge" ,	     &tree_genFromB_charge);
-    smalltree->Branch("tree_genFromB_pdgId" ,	     &tree_genFromB_pdgId);
-    smalltree->Branch("tree_genFromB_x"  ,	     &tree_genFromB_x);
-    smalltree->Branch("tree_genFromB_y" ,	     &tree_genFromB_y);
-    smalltree->Branch("tree_genFromB_z" ,	     &tree_genFromB_z);
-    smalltree->Branch("tree_genFromB_mother_pdgId" , &tree_genFromB_mother_pdgId);
-        smalltree->Branch("tree_genFromB_generation" ,   &tree_genFromB_generation);
-    smalltree->Branch("tree_genFromB_LLP" ,          &tree_genFromB_LLP);
-
-    // genJet info
-    smalltree->Branch("tree_genJet_pt"  ,   &tree_genJet_pt);
-    smalltree->Branch("tree_genJet_eta" ,   &tree_genJet_eta);
-    smalltree->Branch("tree_genJet_phi" ,   &tree_genJet_phi);
-    smalltree->Branch("tree_genJet_mass",   &tree_genJet_mass);
-    smalltree->Branch("tree_genJet_energy", &tree_genJet_energy);
-    
-    smalltree->Branch("tree_nLLP",          &tree_nLLP);
-    smalltree->Branch("tree_LLP",           &tree_LLP);
-    smalltree->Branch("tree_LLP_pt" ,       &tree_LLP_pt);
-    smalltree->Branch("tree_LLP_eta",       &tree_LLP_eta);
-    smalltree->Branch("tree_LLP_phi",       &tree_LLP_phi);
-    smalltree->Branch("tree_LLP_x",         &tree_LLP_x);
-    smalltree->Branch("tree_LLP_y",         &tree_LLP_y);
-    smalltree->Branch("tree_LLP_z",         &tree_LLP_z);
-    smalltree->Branch("tree_LLP_dist",      &tree_LLP_dist);
-    smalltree->Branch("tree_LLP_nTrks",     &tree_LLP_nTrks);
-    smalltree->Branch("tree_LLP_Vtx_nTrks", &tree_LLP_Vtx_nTrks);
-    smalltree->Branch("tree_LLP_Vtx_NChi2", &tree_LLP_Vtx_NChi2);
-    smalltree->Branch("tree_LLP_Vtx_dx",    &tree_LLP_Vtx_dx);
-    smalltree->Branch("tree_LLP_Vtx_dy",    &tree_LLP_Vtx_dy);
-    smalltree->Branch("tree_LLP_Vtx_dz",    &tree_LLP_Vtx_dz);
-    smalltree->Branch("tree_LLP_Vtx_dist",  &tree_LLP_Vtx_dist);
-    smalltree->Branch("tree_LLP_Vtx_dd",    &tree_LLP_Vtx_dd);
-    smalltree->Branch("tree_LLP_Vtx_trackWeight", &tree_LLP_Vtx_trackWeight);
-
-    smalltree->Branch("tree_Hemi",           &tree_Hemi);
-    smalltree->Branch("tree_Hemi_njet",      &tree_Hemi_njet);
-    smalltree->Branch("tree_Hemi_eta",       &tree_Hemi_eta);
-    smalltree->Branch("tree_Hemi_phi",       &tree_Hemi_phi);
-    smalltree->Branch("tree_Hemi_dR",        &tree_Hemi_dR);
-    smalltree->Branch("tree_Hemi_nTrks",     &tree_Hemi_nTrks);
-    smalltree->Branch("tree_Hemi_nTrks_sig", &tree_Hemi_nTrks_sig);
-    smalltree->Branch("tree_Hemi_nTrks_bad", &tree_Hemi_nTrks_bad);
-    smalltree->Branch("tree_Hemi_nTrks_mva",     &tree_Hemi_nTrks_mva);
-    smalltree->Branch("tree_Hemi_nTrks_mva_sig", &tree_Hemi_nTrks_mva_sig);
-    smalltree->Branch("tree_Hemi_nTrks_mva_bad", &tree_Hemi_nTrks_mva_bad);
-    smalltree->Branch("tree_Hemi_LLP",       &tree_Hemi_LLP);
-    smalltree->Branch("tree_Hemi_LLP_pt",    &tree_Hemi_LLP_pt);
-    smalltree->Branch("tree_Hemi_LLP_eta",   &tree_Hemi_LLP_eta);
-    smalltree->Branch("tree_Hemi_LLP_phi",   &tree_Hemi_LLP_phi);
-    smalltree->Branch("tree_Hemi_LLP_dist",  &tree_Hemi_LLP_dist);
-    smalltree->Branch("tree_Hemi_LLP_x",     &tree_Hemi_LLP_x);
-    smalltree->Branch("tree_Hemi_LLP_y",     &tree_Hemi_LLP_y);
-    smalltree->Branch("tree_Hemi_LLP_z",     &tree_Hemi_LLP_z);
-    smalltree->Branch("tree_Hemi_Vtx_NChi2", &tree_Hemi_Vtx_NChi2);
-    smalltree->Branch("tree_Hemi_Vtx_nTrks", &tree_Hemi_Vtx_nTrks);
-    smalltree->Branch("tree_Hemi_Vtx_x",     &tree_Hemi_Vtx_x);
-    smalltree->Branch("tree_Hemi_Vtx_y",     &tree_Hemi_Vtx_y);
-    smalltree->Branch("tree_Hemi_Vtx_z",     &tree_Hemi_Vtx_z);
-    smalltree->Branch("tree_Hemi_Vtx_dx",    &tree_Hemi_Vtx_dx);
-    smalltree->Branch("tree_Hemi_Vtx_dy",    &tree_Hemi_Vtx_dy);
-    smalltree->Branch("tree_Hemi_Vtx_dz",    &tree_Hemi_Vtx_dz);
-    smalltree->Branch("tree_Hemi_Vtx_dist",  &tree_Hemi_Vtx_dist);
-    smalltree->Branch("tree_Hemi_Vtx_dd",    &tree_Hemi_Vtx_dd);
-    smalltree->Branch("tree_Hemi_Vtx_trackWeight", &tree_Hemi_Vtx_trackWeight);
-    smalltree->Branch("tree_Hemi_dR12",      &tree_Hemi_dR12);
-    smalltree->Branch("tree_Hemi_LLP_dR12",  &tree_Hemi_LLP_dR12);
+  auto fitter = std::make_unique<AdaptiveVertexFitter>(
+                 GeometricAnnealing ( sigmacut, Tini, ratio ), 
+                 DefaultLinearizationPointFinder(),
+                 KalmanVertexUpdator<5>(), 
+                 KalmanVertexTrackCompatibilityEstimator<5>(), 
+                 KalmanVertexSmoother() );
+  fitter->setParameters ( maxshift, maxlpshift, maxstep, weightThreshold );
+  return fitter;
 }
 
 
-// FlyingTopAnalyzer::~FlyingTopAnalyzer()
+// FlyingTopProducer::~FlyingTopProducer()
 // {
 //    // do anything here that needs to be done at destruction time
 //    // (e.g. close files, deallocate resources etc.)
 // }
 
 
-bool FlyingTopAnalyzer::isAncestor(const reco::Candidate* ancestor, const reco::Candidate * particle)
-{
-//particle is already the ancestor
-  if ( ancestor == particle ) return true;
-
-//otherwise loop on mothers, if any and return true if the ancestor is found
-  for (size_t i=0; i < particle->numberOfMothers(); i++)
-  {
-    if ( isAncestor(ancestor,particle->mother(i)) ) return true;
-  }
-//if we did not return yet, then particle and ancestor are not relatives
-  return false;
-}
-
 
 //
 // member functions
 //
 
 // ------------ method called for each event  ------------
-void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup& iSetup)
+void FlyingTopProducer::produce(edm::Event& iEvent, const edm::EventSetup& iSetup)
 {
-  clearVariables();
+  auto output = std::make_unique<FlyingTopEvent>();
+  FlyingTopEvent& ev = *output;
+  ev.ReserveColumns(columnSizes_);
+  nEvent++;
+  std::call_once( globalCache()->firstEvent, [this]() {
+    globalCache()->start = std::chrono::steady_clock::now();
+    globalCache()->rssFirstEvent = procStatusKB("VmRSS");
+  } );
+  stages_.BeginEvent();
+  fitTimes_.BeginEvent();
+  groupTimes_.BeginEvent();
 //$$
   bool showlog = false;
 //$$
   using namespace edm;
   using namespace reco;
 
-  runNumber   = iEvent.id().run();
-  eventNumber = iEvent.id().event();
-  lumiBlock   = iEvent.luminosityBlock();
+  ev.runNumber   = iEvent.id().run();
+  ev.eventNumber = iEvent.id().event();
+  ev.lumiBlock   = iEvent.luminosityBlock();
 
   bool runOnData_ = false;
 
@@ -834,7 +446,7 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   if ( !runOnData_ ) iEvent.getByToken(packedGenToken_, packed);
 
   edm::Handle<edm::View<reco::GenJet>> genJets;
-  if ( !runOnData_ ) iEvent.getByToken(genJetToken_, genJets);
+  if ( !runOnData_ && fill_[FlyingTopBranches::GenJet] ) iEvent.getByToken(genJetToken_, genJets);
 
   // Pruned particles are the one containing "important" stuff
   // Handle<edm::View<reco::GenParticle> > pruned;
@@ -859,7 +471,7 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 
 //$$  edm::Handle<reco::GsfElectronCollection> electrons;
   edm::Handle<pat::ElectronCollection> electrons;
-  iEvent.getByToken(electronToken_, electrons);
+  if ( fill_[FlyingTopBranches::Electron] ) iEvent.getByToken(electronToken_, electrons);
 
   edm::Handle<edm::View<reco::Track> > tracksHandle;
   iEvent.getByToken(trackToken_, tracksHandle);
@@ -882,14 +494,14 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   //////////////////////////////////
   //////////////////////////////////
   
-  tree_nPV = primaryVertex->size();
+  ev.tree_nPV = primaryVertex->size();
   if ( !primaryVertex->empty() ) {
-    tree_PV_x.push_back(     (*primaryVertex)[0].x()); // l'index 0 donne le PV!
-    tree_PV_y.push_back(     (*primaryVertex)[0].y());
-    tree_PV_z.push_back(     (*primaryVertex)[0].z());
-    tree_PV_ez.push_back(    (*primaryVertex)[0].zError());
-    tree_PV_NChi2.push_back( (*primaryVertex)[0].normalizedChi2());
-    tree_PV_ndf.push_back(   (*primaryVertex)[0].ndof());
+    ev.tree_PV_x.push_back(     (*primaryVertex)[0].x()); // l'index 0 donne le PV!
+    ev.tree_PV_y.push_back(     (*primaryVertex)[0].y());
+    ev.tree_PV_z.push_back(     (*primaryVertex)[0].z());
+    ev.tree_PV_ez.push_back(    (*primaryVertex)[0].zError());
+    ev.tree_PV_NChi2.push_back( (*primaryVertex)[0].normalizedChi2());
+    ev.tree_PV_ndf.push_back(   (*primaryVertex)[0].ndof());
   }
   const reco::Vertex &PV = primaryVertex->front();
 
@@ -900,15 +512,21 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   //////////////////////////////////
   //////////////////////////////////
   
-  tree_nLLP = -1;
-  tree_GenPVx = -1.;
-  tree_GenPVy = -1.;
-  tree_GenPVz = -20.;
+  ev.tree_nLLP = -1;
+  ev.tree_GenPVx = -1.;
+  ev.tree_GenPVy = -1.;
+  ev.tree_GenPVz = -20.;
 
   int nLLP = 0;
   int nllp = 0;
-  tree_nFromC = 0; 
-  tree_nFromB = 0;
+
+  // generated LLPs
+  float LLP1_pt = 0., LLP1_eta = 0., LLP1_phi = 0., LLP2_pt = 0., LLP2_eta = 0., LLP2_phi = 0.;
+  float LLP1_x = 0., LLP1_y = 0., LLP1_z = 0., LLP2_x = 0., LLP2_y = 0., LLP2_z = 0.;
+  float LLP1_dist = 0., LLP2_dist = 0.;
+  int   LLP1_nTrks = 0, LLP2_nTrks = 0;
+  ev.tree_nFromC = 0; 
+  ev.tree_nFromB = 0;
       
   // Gen Information  for event axis //
   float  Gen_neu1_eta=-10, Gen_neu1_phi=-10;
@@ -925,6 +543,64 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 
   if ( !runOnData_ ) {
   
+    // one pass to tag the final c and b hadrons and the 2 LLPs and to give each pruned genparticle its
+    // tagged ancestors, then the packed genparticles get theirs from their mother(0) (see ../interface/GenAncestry.h)
+    GenAncestry ancestry(*pruned);
+    int nTaggedLLP = 0;
+    for (size_t i=0; i<pruned->size(); i++)
+    {
+      const GenParticle & genIt = (*pruned)[i];
+      unsigned int nDaughters = genIt.numberOfDaughters();
+      int ID = abs(genIt.pdgId());
+
+      // Final c Hadron
+      bool isFinalD = false;
+      if ( (ID/100)%10 == 4 || (ID/1000)%10 == 4 ) {
+        isFinalD = true;
+        for (unsigned int d1=0; d1<nDaughters; d1++) {
+          const Candidate* gen1 = genIt.daughter(d1);
+          int ID1 = abs(gen1->pdgId());
+          if ( (ID1/100)%10 == 4 || (ID1/1000)%10 == 4 ) isFinalD = false;
+        }
+      }
+      if ( isFinalD && abs(genIt.eta()) < 4. ) ancestry.Tag(i, GenAncestry::kFinalC);
+
+      // Final b Hadron
+      bool isFinalB = false;
+      if ( (ID/100)%10 == 5 || (ID/1000)%10 == 5 ) {
+        isFinalB = true;
+        for (unsigned int d1=0; d1<nDaughters; d1++) {
+          const Candidate* gen1 = genIt.daughter(d1);
+          int ID1 = abs(gen1->pdgId());
+          if ( (ID1/100)%10 == 5 || (ID1/1000)%10 == 5 ) isFinalB = false;
+        }
+      }
+      if ( isFinalB && abs(genIt.eta()) < 4. ) ancestry.Tag(i, GenAncestry::kFinalB);
+
+      // neutralino from smuon
+      if ( genIt.pdgId() == 1000023 && abs(genIt.mother()->pdgId()) == 1000013 && nTaggedLLP < 2 ) {
+        nTaggedLLP++;
+        ancestry.Tag(i, GenAncestry::kLLP);
+      }
+    }
+    ancestry.Build();
+
+    // final charged packed genparticles from each tagged pruned genparticle, in the order of the packed collection,
+    // and flags of the packed genparticles from a final b or c hadron, used by identity for the LLP daughters
+    std::vector<std::vector<size_t> > packedFrom(pruned->size());
+    std::vector<bool> packedIsFromB(packed->size(), false), packedIsFromC(packed->size(), false);
+    for (size_t j=0; j<packed->size(); j++)
+    {
+    if ( (*packed)[j].pt() < 0.9 || fabs((*packed)[j].eta()) > 3.0 || (*packed)[j].charge() == 0 ) continue;
+      //get the pointer to the first survived ancestor of a given packed GenParticle in the prunedCollection
+      const Candidate * motherInPrunedCollection = (*packed)[j].mother(0);
+    if ( motherInPrunedCollection == nullptr ) continue;
+      for (int h : ancestry.Ancestors(motherInPrunedCollection)) {
+        packedFrom[h].push_back(j);
+        if ( ancestry.Tags(h) & GenAncestry::kFinalB ) packedIsFromB[j] = true;
+        if ( ancestry.Tags(h) & GenAncestry::kFinalC ) packedIsFromC[j] = true;
+      }
+    }
     // cout << endl; cout << endl; cout << endl;
     int genParticle_idx=0;
     for (size_t i=0; i<pruned->size(); i++)
@@ -942,9 +618,9 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 
       // smuon
       if ( genIt.pdgId() == 1000013 ) {
-	tree_GenPVx = genIt.vx();
-	tree_GenPVy = genIt.vy();
-	tree_GenPVz = genIt.vz();
+	ev.tree_GenPVx = genIt.vx();
+	ev.tree_GenPVy = genIt.vy();
+	ev.tree_GenPVz = genIt.vz();
       }
       
       // neutralino from smuon
@@ -977,8 +653,8 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
       }
       
       if ( nneu == 2 ) {
-	dRneuneu = Deltar( Gen_neu1_eta, Gen_neu1_phi, Gen_neu2_eta, Gen_neu2_phi );
-        tree_genAxis_dRneuneu.push_back(dRneuneu);
+	dRneuneu = sqrt( DeltaR2( Gen_neu1_eta, Gen_neu1_phi, Gen_neu2_eta, Gen_neu2_phi ) ); // also in tree_Hemi_LLP_dR12
+        if ( fill_[FlyingTopBranches::Gen] ) ev.tree_genAxis_dRneuneu.push_back(dRneuneu);
       }
       
       // quarks from neutralino
@@ -1001,9 +677,9 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 	    LLP2_x = genIt.vx();
 	    LLP2_y = genIt.vy();
 	    LLP2_z = genIt.vz();
-	    LLP2_dist = TMath::Sqrt( (LLP2_x - tree_GenPVx)*(LLP2_x - tree_GenPVx) 
-				   + (LLP2_y - tree_GenPVy)*(LLP2_y - tree_GenPVy) 
-				   + (LLP2_z - tree_GenPVz)*(LLP2_z - tree_GenPVz) ); 
+	    LLP2_dist = TMath::Sqrt( (LLP2_x - ev.tree_GenPVx)*(LLP2_x - ev.tree_GenPVx) 
+				   + (LLP2_y - ev.tree_GenPVy)*(LLP2_y - ev.tree_GenPVy) 
+				   + (LLP2_z - ev.tree_GenPVz)*(LLP2_z - ev.tree_GenPVz) ); 
 	  }
 	}
 	if ( nllp == 0 ) {
@@ -1011,9 +687,9 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 	  LLP1_x = genIt.vx();
 	  LLP1_y = genIt.vy();
 	  LLP1_z = genIt.vz();
-	  LLP1_dist = TMath::Sqrt( (LLP1_x - tree_GenPVx)*(LLP1_x - tree_GenPVx) 
-				 + (LLP1_y - tree_GenPVy)*(LLP1_y - tree_GenPVy) 
-				 + (LLP1_z - tree_GenPVz)*(LLP1_z - tree_GenPVz) ); 
+	  LLP1_dist = TMath::Sqrt( (LLP1_x - ev.tree_GenPVx)*(LLP1_x - ev.tree_GenPVx) 
+				 + (LLP1_y - ev.tree_GenPVy)*(LLP1_y - ev.tree_GenPVy) 
+				 + (LLP1_z - ev.tree_GenPVz)*(LLP1_z - ev.tree_GenPVz) ); 
 	}
         // cout << " quark " << genIt.pdgId() << " from " << mom->pdgId() 
         //      << " pt eta phi " << Gen_pt << " " << Gen_eta << " " << Gen_phi 
@@ -1022,86 +698,64 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
       }
 
       // Final c Hadron and get all its final charged particles
-      bool isFinalD = false;
-      if ( (ID/100)%10 == 4 || (ID/1000)%10 == 4 ) {
-        isFinalD = true;
-        for (unsigned int d1=0; d1<nDaughters; d1++) {
-          const Candidate* gen1 = genIt.daughter(d1);
-          int ID1 = abs(gen1->pdgId());
-          if ( (ID1/100)%10 == 4 || (ID1/1000)%10 == 4 ) isFinalD = false;
-        }
-      }
-      if ( isFinalD && abs(genIt.eta()) < 4. ) {
-        const Candidate * Ancestor = &genIt;
-        for (size_t j=0; j<packed->size(); j++) 
+      if ( fill_[FlyingTopBranches::GenFromBC] && ( ancestry.Tags(i) & GenAncestry::kFinalC ) ) {
+        auto genFromBCTime = groupTimes_.Measure(FlyingTopBranches::GenFromBC);
+        for (size_t j : packedFrom[i])
         {
-        if ( (*packed)[j].pt() < 0.9 || fabs((*packed)[j].eta()) > 3.0 || (*packed)[j].charge() == 0 ) continue;
-          //get the pointer to the first survived ancestor of a given packed GenParticle in the prunedCollection
-  	  const Candidate * motherInPrunedCollection = (*packed)[j].mother(0) ;
-  	if ( !(motherInPrunedCollection != nullptr && isAncestor( Ancestor , motherInPrunedCollection)) ) continue;
-          tree_nFromC++;
-          tree_genFromC_pt.push_back(	 (*packed)[j].pt());
-          tree_genFromC_eta.push_back(   (*packed)[j].eta());
-          tree_genFromC_phi.push_back(   (*packed)[j].phi());
-          tree_genFromC_charge.push_back((*packed)[j].charge());
-          tree_genFromC_pdgId.push_back( (*packed)[j].pdgId());
-          tree_genFromC_mother_pdgId.push_back( genIt.pdgId());
+          ev.tree_nFromC++;
+          ev.tree_genFromC_pt.push_back(	 (*packed)[j].pt());
+          ev.tree_genFromC_eta.push_back(   (*packed)[j].eta());
+          ev.tree_genFromC_phi.push_back(   (*packed)[j].phi());
+          ev.tree_genFromC_charge.push_back((*packed)[j].charge());
+          ev.tree_genFromC_pdgId.push_back( (*packed)[j].pdgId());
+          ev.tree_genFromC_mother_pdgId.push_back( genIt.pdgId());
 	  if ( nDaughters > 0 ) {
             const Candidate* gen2 = genIt.daughter(0);
-            tree_genFromC_x.push_back(gen2->vx());
-            tree_genFromC_y.push_back(gen2->vy());
-            tree_genFromC_z.push_back(gen2->vz());
+            ev.tree_genFromC_x.push_back(gen2->vx());
+            ev.tree_genFromC_y.push_back(gen2->vy());
+            ev.tree_genFromC_z.push_back(gen2->vz());
 	  }
 	  else { // never happens a priori
-            tree_genFromC_x.push_back(-10);
-            tree_genFromC_y.push_back(-10);
-            tree_genFromC_z.push_back(-10);
+            ev.tree_genFromC_x.push_back(-10);
+            ev.tree_genFromC_y.push_back(-10);
+            ev.tree_genFromC_z.push_back(-10);
 	  }
         }
       } // final c hadron
 
       // Final b Hadron and get all its final charged particles
-      bool isFinalB = false;
-      if ( (ID/100)%10 == 5 || (ID/1000)%10 == 5 ) {
-        isFinalB = true;
-        for (unsigned int d1=0; d1<nDaughters; d1++) {
-          const Candidate* gen1 = genIt.daughter(d1);
-          int ID1 = abs(gen1->pdgId());
-          if ( (ID1/100)%10 == 5 || (ID1/1000)%10 == 5 ) isFinalB = false;
-        }
-      }
-      if ( isFinalB && abs(genIt.eta()) < 4. ) {
-        const Candidate * Ancestor = &genIt;
-        for (size_t j=0; j<packed->size(); j++) 
+      if ( fill_[FlyingTopBranches::GenFromBC] && ( ancestry.Tags(i) & GenAncestry::kFinalB ) ) {
+        auto genFromBCTime = groupTimes_.Measure(FlyingTopBranches::GenFromBC);
+        for (size_t j : packedFrom[i])
         {
-        if ( (*packed)[j].pt() < 0.9 || fabs((*packed)[j].eta()) > 3.0 || (*packed)[j].charge() == 0 ) continue;
-          //get the pointer to the first survied ancestor of a given packed GenParticle in the prunedCollection
-  	  const Candidate * motherInPrunedCollection = (*packed)[j].mother(0) ;
-  	if ( !(motherInPrunedCollection != nullptr && isAncestor( Ancestor , motherInPrunedCollection)) ) continue;
-          tree_nFromB++;
-          tree_genFromB_pt.push_back(	 (*packed)[j].pt());
-          tree_genFromB_eta.push_back(   (*packed)[j].eta());
-          tree_genFromB_phi.push_back(   (*packed)[j].phi());
-          tree_genFromB_charge.push_back((*packed)[j].charge());
-          tree_genFromB_pdgId.push_back( (*packed)[j].pdgId());
-          tree_genFromB_mother_pdgId.push_back( genIt.pdgId());
+          ev.tree_nFromB++;
+          ev.tree_genFromB_pt.push_back(	 (*packed)[j].pt());
+          ev.tree_genFromB_eta.push_back(   (*packed)[j].eta());
+          ev.tree_genFromB_phi.push_back(   (*packed)[j].phi());
+          ev.tree_genFromB_charge.push_back((*packed)[j].charge());
+          ev.tree_genFromB_pdgId.push_back( (*packed)[j].pdgId());
+          ev.tree_genFromB_mother_pdgId.push_back( genIt.pdgId());
 	  if ( nDaughters > 0 ) {
             const Candidate* gen2 = genIt.daughter(0);
-            tree_genFromB_x.push_back(gen2->vx());
-            tree_genFromB_y.push_back(gen2->vy());
-            tree_genFromB_z.push_back(gen2->vz());
+            ev.tree_genFromB_x.push_back(gen2->vx());
+            ev.tree_genFromB_y.push_back(gen2->vy());
+            ev.tree_genFromB_z.push_back(gen2->vz());
 	  }
 	  else { // never happens a priori
-            tree_genFromB_x.push_back(-10);
-            tree_genFromB_y.push_back(-10);
-            tree_genFromB_z.push_back(-10);
+            ev.tree_genFromB_x.push_back(-10);
+            ev.tree_genFromB_y.push_back(-10);
+            ev.tree_genFromB_z.push_back(-10);
 	  }
         }
       } // final b hadron
-    
-      float dV0 = (genIt.vx() - tree_GenPVx)*(genIt.vx() - tree_GenPVx)
-        	+ (genIt.vy() - tree_GenPVy)*(genIt.vy() - tree_GenPVy)
-        	+ (genIt.vz() - tree_GenPVz)*(genIt.vz() - tree_GenPVz);
+
+    // the rest of the loop only fills the pruned genparticle branches
+    if ( !fill_[FlyingTopBranches::Gen] ) continue;
+      auto genTime = groupTimes_.Measure(FlyingTopBranches::Gen);
+
+      float dV0 = (genIt.vx() - ev.tree_GenPVx)*(genIt.vx() - ev.tree_GenPVx)
+        	+ (genIt.vy() - ev.tree_GenPVy)*(genIt.vy() - ev.tree_GenPVy)
+        	+ (genIt.vz() - ev.tree_GenPVz)*(genIt.vz() - ev.tree_GenPVz);
       float dV1 = (genIt.vx() - LLP1_x)*(genIt.vx() - LLP1_x)
         	+ (genIt.vy() - LLP1_y)*(genIt.vy() - LLP1_y)
         	+ (genIt.vz() - LLP1_z)*(genIt.vz() - LLP1_z);
@@ -1115,144 +769,120 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 
     if ( genIt.pt() < 0.9 || fabs(genIt.eta()) > 4.0 ) continue;
       
-      tree_genParticle_pt.push_back(        genIt.pt());
-      tree_genParticle_eta.push_back(       genIt.eta());
-      tree_genParticle_phi.push_back(       genIt.phi());
-      tree_genParticle_charge.push_back(    genIt.charge());
-      tree_genParticle_pdgId.push_back(     genIt.pdgId());
-      tree_genParticle_mass.push_back(      genIt.mass());
-      tree_genParticle_x.push_back(	    genIt.vx());
-      tree_genParticle_y.push_back(	    genIt.vy());
-      tree_genParticle_z.push_back(	    genIt.vz());
-      tree_genParticle_statusCode.push_back(genIt.status());
-      tree_genParticle_mother_pdgId.push_back( mom ? mom->pdgId() :  -10 );
-      tree_genParticle_LLP.push_back(fromLLP);
+      ev.tree_genParticle_pt.push_back(        genIt.pt());
+      ev.tree_genParticle_eta.push_back(       genIt.eta());
+      ev.tree_genParticle_phi.push_back(       genIt.phi());
+      ev.tree_genParticle_charge.push_back(    genIt.charge());
+      ev.tree_genParticle_pdgId.push_back(     genIt.pdgId());
+      ev.tree_genParticle_mass.push_back(      genIt.mass());
+      ev.tree_genParticle_x.push_back(	    genIt.vx());
+      ev.tree_genParticle_y.push_back(	    genIt.vy());
+      ev.tree_genParticle_z.push_back(	    genIt.vz());
+      ev.tree_genParticle_statusCode.push_back(genIt.status());
+      ev.tree_genParticle_mother_pdgId.push_back( mom ? mom->pdgId() :  -10 );
+      ev.tree_genParticle_LLP.push_back(fromLLP);
 
     } // end loop on pruned genparticles
 
-    tree_nLLP = nllp;
+    ev.tree_nLLP = nllp;
     // cout << endl;
 
     // second pass to recover the final particles from LLP decay
     int nLLPbis = 0;
-    tree_ngenFromLLP = 0;
+    ev.tree_ngenFromLLP = 0;
 
-    for (size_t i=0; i<pruned->size(); i++) // loop on pruned genparticles
-    {
-      const GenParticle & genIt = (*pruned)[i];
-      const Candidate * mom = genIt.mother();
-      int pdgid     = genIt.pdgId();
-
-    // neutralino
-    if ( !(pdgid == 1000023 && abs(mom->pdgId()) == 1000013) ) continue;
-      nLLPbis++;
-      // if ( nLLPbis == 2 ) cout << endl;
-      const Candidate * Neutralino = &genIt;
-      for (size_t j=0; j<packed->size(); j++) // loop on packed genparticles
+    if ( fill_[FlyingTopBranches::GenFromLLP] ) {
+      auto genFromLLPTime = groupTimes_.Measure(FlyingTopBranches::GenFromLLP);
+      for (size_t i=0; i<pruned->size(); i++) // loop on pruned genparticles
       {
-      if ( (*packed)[j].pt() < 0.9 || fabs((*packed)[j].eta()) > 3.0 || (*packed)[j].charge() == 0 ) continue;
-        //get the pointer to the first survived ancestor of a given packed GenParticle in the prunedCollection
-        const Candidate * motherInPrunedCollection = (*packed)[j].mother(0);
-      if ( !(motherInPrunedCollection != nullptr && isAncestor( Neutralino , motherInPrunedCollection)) ) continue;
-        tree_ngenFromLLP++;
-        tree_genFromLLP_LLP.push_back(       nLLPbis);
-        float pack_pt  = (*packed)[j].pt();
-        float pack_eta = (*packed)[j].eta();
-        float pack_phi = (*packed)[j].phi();
-        float pack_pdgId = (*packed)[j].pdgId();
-
-        tree_genFromLLP_pt.push_back(	     pack_pt);
-        tree_genFromLLP_eta.push_back(       pack_eta);
-        tree_genFromLLP_phi.push_back(       pack_phi);
-        tree_genFromLLP_charge.push_back(    (*packed)[j].charge());
-        tree_genFromLLP_pdgId.push_back(     pack_pdgId);
-        tree_genFromLLP_mass.push_back(      (*packed)[j].mass());
-        const Candidate * momj =	     (*packed)[j].mother(0);
-
-        int mom_pdgid = -9999;
-	float vx = -10., vy = -10., vz = -10.;
-        if ( momj ) {
-	  mom_pdgid = momj->pdgId();
-	  vx = momj->vx();
-	  vy = momj->vy();
-	  vz = momj->vz();
-          if ( momj->numberOfDaughters() > 0 ) { // always the case a priori
-	    vx = momj->daughter(0)->vx();
-	    vy = momj->daughter(0)->vy();
-	    vz = momj->daughter(0)->vz();
-	  }
-	}
-        tree_genFromLLP_mother_pdgId.push_back(mom_pdgid);
-        tree_genFromLLP_x.push_back( vx );
-        tree_genFromLLP_y.push_back( vy );
-        tree_genFromLLP_z.push_back( vz );
-
-        // match to final b hadron
-	bool matchB = false;
-	for (int k = 0; k < tree_nFromB; k++)
-	{
-        if ( pack_pdgId != tree_genFromB_pdgId[k] ) continue;
-	  float dpt  = abs( pack_pt / tree_genFromB_pt[k] - 1. );
-	  float deta = abs( pack_eta - tree_genFromB_eta[k] );
-  	  float dphi = abs( Deltaphi( pack_phi, tree_genFromB_phi[k] ) );
-          if ( abs(deta) < 0.01 && abs(dphi) < 0.01 && abs(dpt) < 0.01 ) {
-	    matchB = true;
-	    break;
-	  }
-	}
-        tree_genFromLLP_isFromB.push_back(matchB);
+      // neutralino
+      if ( !(ancestry.Tags(i) & GenAncestry::kLLP) ) continue;
+        nLLPbis++;
+        // if ( nLLPbis == 2 ) cout << endl;
+        for (size_t j : packedFrom[i]) // loop on packed genparticles
+        {
+          ev.tree_ngenFromLLP++;
+          ev.tree_genFromLLP_LLP.push_back(       nLLPbis);
+          float pack_pt  = (*packed)[j].pt();
+          float pack_eta = (*packed)[j].eta();
+          float pack_phi = (*packed)[j].phi();
+          float pack_pdgId = (*packed)[j].pdgId();
+
+          ev.tree_genFromLLP_pt.push_back(	     pack_pt);
+          ev.tree_genFromLLP_eta.push_back(       pack_eta);
+          ev.tree_genFromLLP_phi.push_back(       pack_phi);
+          ev.tree_genFromLLP_charge.push_back(    (*packed)[j].charge());
+          ev.tree_genFromLLP_pdgId.push_back(     pack_pdgId);
+          ev.tree_genFromLLP_mass.push_back(      (*packed)[j].mass());
+          const Candidate * momj =	     (*packed)[j].mother(0);
+
+          int mom_pdgid = -9999;
+          float vx = -10., vy = -10., vz = -10.;
+          if ( momj ) {
+            mom_pdgid = momj->pdgId();
+            vx = momj->vx();
+            vy = momj->vy();
+            vz = momj->vz();
+            if ( momj->numberOfDaughters() > 0 ) { // always the case a priori
+              vx = momj->daughter(0)->vx();
+              vy = momj->daughter(0)->vy();
+              vz = momj->daughter(0)->vz();
+            }
+          }
+          ev.tree_genFromLLP_mother_pdgId.push_back(mom_pdgid);
+          ev.tree_genFromLLP_x.push_back( vx );
+          ev.tree_genFromLLP_y.push_back( vy );
+          ev.tree_genFromLLP_z.push_back( vz );
 
-        // match to final c hadron
-	bool matchC = false;
-	for (int k = 0; k < tree_nFromC; k++)
-	{
-        if ( pack_pdgId != tree_genFromC_pdgId[k] ) continue;
-	  float dpt  = abs( pack_pt / tree_genFromC_pt[k] - 1. );
-	  float deta = abs( pack_eta - tree_genFromC_eta[k] );
-  	  float dphi = abs( Deltaphi( pack_phi, tree_genFromC_phi[k] ) );
-          if ( abs(deta) < 0.01 && abs(dphi) < 0.01 && abs(dpt) < 0.01 ) {
-	    matchC = true;
-	    break;
-	  }
-	}
-        tree_genFromLLP_isFromC.push_back(matchC);
-        // cout << " gentk " << pack_pdgId << " from " << mom_pdgid 
-        //      << " LLP " << nLLPbis << " BC " << matchB << matchC
-        //      << " pt eta phi " << pack_pt << " " << pack_eta << " " << pack_phi 
-        //      << " x y z " << vx << " " << vy << " " << vz 
-        //      << endl;
+          // match to final b and c hadrons, by identity
+          ev.tree_genFromLLP_isFromB.push_back(packedIsFromB[j]);
+          ev.tree_genFromLLP_isFromC.push_back(packedIsFromC[j]);
 
-      } // end loop on packed genparticles
-      if ( nLLPbis == 2 ) break;
+          // cout << " gentk " << pack_pdgId << " from " << mom_pdgid 
+          //      << " LLP " << nLLPbis << " BC " << matchB << matchC
+          //      << " pt eta phi " << pack_pt << " " << pack_eta << " " << pack_phi 
+          //      << " x y z " << vx << " " << vy << " " << vz 
+          //      << endl;
 
-    } // end loop on pruned genparticles
+        } // end loop on packed genparticles
+        if ( nLLPbis == 2 ) break;
+
+      } // end loop on pruned genparticles
+    } // GenFromLLP
 
     // packed genparticles (final particles)
-    for (size_t i=0; i<packed->size(); i++) 
-    {
-    if ( (*packed)[i].pt() < 0.9 || fabs((*packed)[i].eta()) > 3.0 || (*packed)[i].charge() == 0 ) continue;
-      const Candidate * mom = (*packed)[i].mother(0);
-      tree_genPackPart_pt.push_back(        (*packed)[i].pt());
-      tree_genPackPart_eta.push_back(       (*packed)[i].eta());
-      tree_genPackPart_phi.push_back(       (*packed)[i].phi());
-      tree_genPackPart_charge.push_back(    (*packed)[i].charge());
-      tree_genPackPart_pdgId.push_back(     (*packed)[i].pdgId());
-      tree_genPackPart_mass.push_back(      (*packed)[i].mass());
-      tree_genPackPart_mother_pdgId.push_back( mom ? mom->pdgId() :  -10 );
-    }
+    if ( fill_[FlyingTopBranches::GenPacked] ) {
+      auto genPackedTime = groupTimes_.Measure(FlyingTopBranches::GenPacked);
+      for (size_t i=0; i<packed->size(); i++)
+      {
+      if ( (*packed)[i].pt() < 0.9 || fabs((*packed)[i].eta()) > 3.0 || (*packed)[i].charge() == 0 ) continue;
+        const Candidate * mom = (*packed)[i].mother(0);
+        ev.tree_genPackPart_pt.push_back(        (*packed)[i].pt());
+        ev.tree_genPackPart_eta.push_back(       (*packed)[i].eta());
+        ev.tree_genPackPart_phi.push_back(       (*packed)[i].phi());
+        ev.tree_genPackPart_charge.push_back(    (*packed)[i].charge());
+        ev.tree_genPackPart_pdgId.push_back(     (*packed)[i].pdgId());
+        ev.tree_genPackPart_mass.push_back(      (*packed)[i].mass());
+        ev.tree_genPackPart_mother_pdgId.push_back( mom ? mom->pdgId() :  -10 );
+      }
+    } // GenPacked
     
     // gen jets
-    for (auto const & genJet : *genJets)
-    {
-    if ( genJet.pt() < 20. ) continue;
-      tree_genJet_pt.push_back(genJet.pt());
-      tree_genJet_eta.push_back(genJet.eta());
-      tree_genJet_phi.push_back(genJet.phi());
-      tree_genJet_mass.push_back(genJet.mass());
-      tree_genJet_energy.push_back(genJet.energy());
-    }
+    if ( fill_[FlyingTopBranches::GenJet] ) {
+      auto genJetTime = groupTimes_.Measure(FlyingTopBranches::GenJet);
+      for (auto const & genJet : *genJets)
+      {
+      if ( genJet.pt() < 20. ) continue;
+        ev.tree_genJet_pt.push_back(genJet.pt());
+        ev.tree_genJet_eta.push_back(genJet.eta());
+        ev.tree_genJet_phi.push_back(genJet.phi());
+        ev.tree_genJet_mass.push_back(genJet.mass());
+        ev.tree_genJet_energy.push_back(genJet.energy());
+      }
+    } // GenJet
     
   } // endif simulation
+  stages_.Lap(FlyingTopTiming::kGen);
     
 
   //////////////////////////////////
@@ -1261,14 +891,14 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   //////////////////////////////////
   //////////////////////////////////
   
-  tree_PFMet_et  = -10.;
-  tree_PFMet_phi = -10.;
-  tree_PFMet_sig = -10.;
-  if ( PFMETs->size() > 0 ) {
+  ev.tree_PFMet_et  = -10.;
+  ev.tree_PFMet_phi = -10.;
+  ev.tree_PFMet_sig = -10.;
+  if ( fill_[FlyingTopBranches::MET] && PFMETs->size() > 0 ) {
     const pat::MET &themet = PFMETs->front();
-    tree_PFMet_et  = themet.et();
-    tree_PFMet_phi = themet.phi();
-    tree_PFMet_sig = themet.significance();
+    ev.tree_PFMet_et  = themet.et();
+    ev.tree_PFMet_phi = themet.phi();
+    ev.tree_PFMet_sig = themet.significance();
   }
 
   //////////////////////////////////
@@ -1277,17 +907,17 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   //////////////////////////////////
   //////////////////////////////////
   
-  tree_njet = 0;
+  ev.tree_njet = 0;
   float HT_val = 0;
   float jet_pt_min = 20.;
   for (int ij=0; ij<int(jets->size()); ij++) {
     const Jet& jet = jets->at(ij);
   if ( jet.pt() < jet_pt_min ) continue;
-    tree_jet_E.push_back(jet.energy());
-    tree_jet_pt.push_back(jet.pt());
-    tree_jet_eta.push_back(jet.eta());
-    tree_jet_phi.push_back(jet.phi());
-    tree_njet++;
+    ev.tree_jet_E.push_back(jet.energy());
+    ev.tree_jet_pt.push_back(jet.pt());
+    ev.tree_jet_eta.push_back(jet.eta());
+    ev.tree_jet_phi.push_back(jet.phi());
+    ev.tree_njet++;
     if ( abs(jet.eta()) < 2.4 ) HT_val += jet.pt(); // used in HT filter !
   }
   
@@ -1297,18 +927,21 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   //////////////////////////////////
   //////////////////////////////////
   
-  for (const pat::Electron &el: *electrons)
-  {
-  if ( el.pt() < 5. ) continue;
-    tree_electron_pt.push_back(     el.pt());
-    tree_electron_eta.push_back(    el.eta());
-    tree_electron_phi.push_back(    el.phi());
-    tree_electron_x.push_back(      el.vx());
-    tree_electron_y.push_back(      el.vy());
-    tree_electron_z.push_back(      el.vz());
-    tree_electron_energy.push_back( el.energy());
-    tree_electron_charge.push_back(el.charge());
-  }
+  if ( fill_[FlyingTopBranches::Electron] ) {
+    auto electronTime = groupTimes_.Measure(FlyingTopBranches::Electron);
+    for (const pat::Electron &el: *electrons)
+    {
+    if ( el.pt() < 5. ) continue;
+      ev.tree_electron_pt.push_back(     el.pt());
+      ev.tree_electron_eta.push_back(    el.eta());
+      ev.tree_electron_phi.push_back(    el.phi());
+      ev.tree_electron_x.push_back(      el.vx());
+      ev.tree_electron_y.push_back(      el.vy());
+      ev.tree_electron_z.push_back(      el.vz());
+      ev.tree_electron_energy.push_back( el.energy());
+      ev.tree_electron_charge.push_back(el.charge());
+    }
+  } // Electron
   
   //////////////////////////////////
   //////////////////////////////////
@@ -1320,21 +953,21 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   for (const pat::Muon &mu : *muons)
   {
   if ( mu.pt() < 3. ) continue;
-    tree_muon_pt.push_back(       mu.pt());
-    tree_muon_eta.push_back(      mu.eta());
-    tree_muon_phi.push_back(      mu.phi());
-    tree_muon_x.push_back(        mu.vx());
-    tree_muon_y.push_back(        mu.vy());
-    tree_muon_z.push_back(        mu.vz());
-    tree_muon_energy.push_back(   mu.energy());
-    tree_muon_dxy.push_back(	  mu.muonBestTrack()->dxy(PV.position()));
-    tree_muon_dxyError.push_back( mu.muonBestTrack()->dxyError());
-    tree_muon_dz.push_back(       mu.muonBestTrack()->dz(PV.position()));
-    tree_muon_dzError.push_back(  mu.muonBestTrack()->dzError());
-    tree_muon_charge.push_back(   mu.charge());
-    tree_muon_isLoose.push_back(  mu.isLooseMuon());
-    tree_muon_isTight.push_back(  mu.isTightMuon(PV));
-    tree_muon_isGlobal.push_back( mu.isGlobalMuon());
+    ev.tree_muon_pt.push_back(       mu.pt());
+    ev.tree_muon_eta.push_back(      mu.eta());
+    ev.tree_muon_phi.push_back(      mu.phi());
+    ev.tree_muon_x.push_back(        mu.vx());
+    ev.tree_muon_y.push_back(        mu.vy());
+    ev.tree_muon_z.push_back(        mu.vz());
+    ev.tree_muon_energy.push_back(   mu.energy());
+    ev.tree_muon_dxy.push_back(	  mu.muonBestTrack()->dxy(PV.position()));
+    ev.tree_muon_dxyError.push_back( mu.muonBestTrack()->dxyError());
+    ev.tree_muon_dz.push_back(       mu.muonBestTrack()->dz(PV.position()));
+    ev.tree_muon_dzError.push_back(  mu.muonBestTrack()->dzError());
+    ev.tree_muon_charge.push_back(   mu.charge());
+    ev.tree_muon_isLoose.push_back(  mu.isLooseMuon());
+    ev.tree_muon_isTight.push_back(  mu.isTightMuon(PV));
+    ev.tree_muon_isGlobal.push_back( mu.isGlobalMuon());
     nmu++;
   }
     
@@ -1342,39 +975,39 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   float mupt1, mueta1, muphi1, mupt2, mueta2, muphi2;
   float mu_mass = 0.1057;
   TLorentzVector v1, v2, v;
-  tree_Mmumu = 0.;
+  ev.tree_Mmumu = 0.;
   
   for ( int mu=0; mu<nmu; mu++)
   { 
-  if ( !tree_muon_isGlobal[mu] ) continue;
-    mupt1  = tree_muon_pt[mu];
+  if ( !ev.tree_muon_isGlobal[mu] ) continue;
+    mupt1  = ev.tree_muon_pt[mu];
   if ( mupt1 < 10. ) continue; // Zmu filter
-//$$  if ( abs(tree_muon_dxy[mu]) > 0.1 || abs(tree_muon_dz[mu]) > 0.2 ) continue; // muons closed to PV
-    mueta1 = tree_muon_eta[mu];
-    muphi1 = tree_muon_phi[mu];
+//$$  if ( abs(ev.tree_muon_dxy[mu]) > 0.1 || abs(ev.tree_muon_dz[mu]) > 0.2 ) continue; // muons closed to PV
+    mueta1 = ev.tree_muon_eta[mu];
+    muphi1 = ev.tree_muon_phi[mu];
     v1.SetPtEtaPhiM(mupt1,mueta1,muphi1,mu_mass);
     for ( int mu2=mu+1; mu2<nmu; mu2++) 
     {	    
-    if ( !tree_muon_isGlobal[mu2] ) continue;
-    if ( tree_muon_charge[mu] == tree_muon_charge[mu2] ) continue;
-//$$    if ( abs(tree_muon_dxy[mu2]) > 0.1 || abs(tree_muon_dz[mu2]) > 0.2 ) continue;
-      mupt2  = tree_muon_pt[mu2];
+    if ( !ev.tree_muon_isGlobal[mu2] ) continue;
+    if ( ev.tree_muon_charge[mu] == ev.tree_muon_charge[mu2] ) continue;
+//$$    if ( abs(ev.tree_muon_dxy[mu2]) > 0.1 || abs(ev.tree_muon_dz[mu2]) > 0.2 ) continue;
+      mupt2  = ev.tree_muon_pt[mu2];
     if ( mupt2 < 10. ) continue;
     if ( mupt1 < 28. && mupt2 < 28. ) continue; // Zmu Filter
-      mueta2 = tree_muon_eta[mu2];
-      muphi2 = tree_muon_phi[mu2];
+      mueta2 = ev.tree_muon_eta[mu2];
+      muphi2 = ev.tree_muon_phi[mu2];
       v2.SetPtEtaPhiM(mupt2,mueta2,muphi2,mu_mass);
       v = v1 + v2;
-      if ( v.Mag() > tree_Mmumu )
+      if ( v.Mag() > ev.tree_Mmumu )
       { // Mag pour masse invariante (magnitude)
-        tree_Mmumu = v.Mag();
+        ev.tree_Mmumu = v.Mag();
         imu1 = mu;
         imu2 = mu2;
       }
     }
   }
 
-  if ( tree_muon_pt[imu2] > tree_muon_pt[imu1] ) {
+  if ( imu1 >= 0 && ev.tree_muon_pt[imu2] > ev.tree_muon_pt[imu1] ) {
     int imu0 = imu2;
     imu2 = imu1; // muons reco with imu1 having the highest pt
     imu1 = imu0;
@@ -1386,21 +1019,103 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   //////////////////////////////////
   //////////////////////////////////
   
-  tree_NbrOfZCand = 0;
-  tree_passesHTFilter = false;
-  tree_nTracks = 0;
-
-  if ( tree_Mmumu > 60. )                  tree_NbrOfZCand = 1;
-  if ( tree_Mmumu > 60. && HT_val > 180. ) tree_passesHTFilter = true;
-  
+  ev.tree_NbrOfZCand = 0;
+  ev.tree_passesHTFilter = false;
+  ev.tree_nTracks = 0;
+
+  if ( ev.tree_Mmumu > 60. )                  ev.tree_NbrOfZCand = 1;
+  if ( ev.tree_Mmumu > 60. && HT_val > 180. ) ev.tree_passesHTFilter = true;
+
+  // with FlyingTopFilter in front (mode = record), the events that fail its selection only get the event record:
+  // no track, BDT nor vertex stage, and empty Track, LLP and Hemi branches
+  if ( !selectionToken_.isUninitialized() ) {
+    edm::Handle<FlyingTopSelection> selection;
+    iEvent.getByToken(selectionToken_, selection);
+    ev.tree_passesHTFilter = selection->pass;
+    if ( !selection->pass ) {
+      nRejected++;
+      stages_.Lap(FlyingTopTiming::kObjects);
+      putEvent(iEvent, std::move(output));
+      return;
+    }
+  }
 
-  edm::ESHandle<TransientTrackBuilder> theTransientTrackBuilder;
-  iSetup.get<TransientTrackRecord>().get("TransientTrackBuilder",theTransientTrackBuilder); // Asking for reco collection of PV..
-  vector<reco::TransientTrack> BestTracks;
+  // each TransientTrack is built once per event and shared by all the stages below,
+  // with the builder of the current IOV (see beginLuminosityBlock)
+  TransientTrackCache transientTracks(*ttBuilder_, trackRefs);
   std::vector<std::pair<uint16_t,float> > Players;
-  int count =0;
 
-//$$ // if ( tree_passesHTFilter ) {
+  stages_.Lap(FlyingTopTiming::kObjects);
+  long propagationFallbacks = propaHitPattern_.Fallbacks();
+
+  // first hit positions of all the tracks in one pass, see ../interface/HelixPropagator.h
+  unsigned int nTrk = trackRefs.size();
+  std::vector<float> helix_x, helix_y, helix_z;
+  std::vector<int> helix_region;
+  std::vector<unsigned char> helix_valid;
+  if ( helixFirstHit_ || validateFirstHit_ ) {
+    auto firstHitTime = stages_.Measure(FlyingTopTiming::kFirstHit);
+    std::vector<float> trk_vx(nTrk), trk_vy(nTrk), trk_vz(nTrk), trk_px(nTrk), trk_py(nTrk), trk_pz(nTrk);
+    std::vector<int> trk_charge(nTrk);
+    std::vector<uint16_t> trk_firsthit(nTrk);
+    for (unsigned int iTrack = 0; iTrack<nTrk; ++iTrack) {
+      const auto& itTrack = trackRefs[iTrack];
+      trk_vx[iTrack] = itTrack->vx();
+      trk_vy[iTrack] = itTrack->vy();
+      trk_vz[iTrack] = itTrack->vz();
+      trk_px[iTrack] = itTrack->px();
+      trk_py[iTrack] = itTrack->py();
+      trk_pz[iTrack] = itTrack->pz();
+      trk_charge[iTrack]   = itTrack->charge();
+      trk_firsthit[iTrack] = itTrack->hitPattern().getHitPattern(HitPattern::HitCategory::TRACK_HITS,0);
+    }
+    helix_x.resize(nTrk);
+    helix_y.resize(nTrk);
+    helix_z.resize(nTrk);
+    helix_region.resize(nTrk);
+    helix_valid.resize(nTrk);
+    helixPropagator_.Propagate( nTrk, trk_vx.data(), trk_vy.data(), trk_vz.data(), trk_px.data(), trk_py.data(), trk_pz.data(),
+                                trk_charge.data(), trk_firsthit.data(),
+                                helix_x.data(), helix_y.data(), helix_z.data(), helix_region.data(), helix_valid.data() );
+  }
+  fh_nTracks += nTrk;
+
+  // gen particles from LLP decays for the truth matching of the tracks: their phi at the PV is computed once
+  // and they are binned in eta-phi, with phi modulo pi (phi0 can be wrong by pi), one grid per charge sign
+  // (the matching itself is tested against the loop over all the gen particles in test/testEtaPhiGrid.cc)
+  int nGenMatch = fill_[FlyingTopBranches::TrackSim] ? ev.tree_ngenFromLLP : 0;
+  std::vector<float> genFromLLP_phi0(nGenMatch);
+  EtaPhiGrid genGridPos(0.1, 0.1, M_PI), genGridNeg(0.1, 0.1, M_PI);
+  {
+    auto matchTime = stages_.Measure(FlyingTopTiming::kTruthMatch);
+    std::vector<char> genFromLLP_pos(nGenMatch), genFromLLP_neg(nGenMatch);
+    for (int k = 0; k < nGenMatch; k++)
+    {
+      float qGen   = ev.tree_genFromLLP_charge[k];
+      float ptGen  = ev.tree_genFromLLP_pt[k];
+      float phiGen = ev.tree_genFromLLP_phi[k]; // given at production point
+      float xGen   = ev.tree_genFromLLP_x[k];
+      float yGen   = ev.tree_genFromLLP_y[k];
+
+      // compute phi at PV for the gen particle (instead of production point)
+      float qR = qGen * ptGen * 100 / 0.3 / 3.8;
+      float sin0 = qR * sin( phiGen ) + (xGen - ev.tree_GenPVx);
+      float cos0 = qR * cos( phiGen ) - (yGen - ev.tree_GenPVy);
+      genFromLLP_phi0[k] = TMath::ATan2( sin0, cos0 ); // but note that it can be wrong by +_pi ! 
+      genFromLLP_pos[k] = ( qGen > 0 );
+      genFromLLP_neg[k] = ( qGen < 0 );
+    }
+    genGridPos.Fill(nGenMatch, ev.tree_genFromLLP_eta.data(), genFromLLP_phi0.data(), genFromLLP_pos.data());
+    genGridNeg.Fill(nGenMatch, ev.tree_genFromLLP_eta.data(), genFromLLP_phi0.data(), genFromLLP_neg.data());
+  }
+
+  // eta-phi grid of the selected jets, indexed like the tree_jet arrays
+  // (First() is tested against the loop over the selected jets in test/testEtaPhiGrid.cc)
+  EtaPhiGrid jetGrid(0.4, 0.4);
+  {
+    auto jetTime = stages_.Measure(FlyingTopTiming::kJetAssociation);
+    jetGrid.Fill(ev.tree_njet, ev.tree_jet_eta.data(), ev.tree_jet_phi.data());
+  }
 
   //////////////////////////////////
   //////////////////////////////////
@@ -1408,60 +1123,64 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
   //////////////////////////////////
   //////////////////////////////////
 
+    // the per track columns of the ntuple are the track table of the event: they are sized once here
+    // and the later stages (neighbour counting, BDT, hemispheres) read them by track index
+    ev.ReserveTracks(trackRefs.size());
+
     for (size_t iTrack = 0; iTrack<trackRefs.size(); ++iTrack) {
-      tree_nTracks++; 
+      ev.tree_nTracks++; 
       const auto& itTrack = trackRefs[iTrack];
       float tk_pt =   itTrack->pt();
       float tk_eta =  itTrack->eta();
       float tk_phi =  itTrack->phi();
       int   tk_nHit = itTrack->hitPattern().numberOfValidHits();
-      tree_track_pt.push_back(           itTrack->pt());
-      tree_track_eta.push_back(          itTrack->eta());
-      tree_track_phi.push_back(          itTrack->phi());
-      tree_track_charge.push_back(       itTrack->charge());
-      tree_track_NChi2.push_back(        itTrack->normalizedChi2());
-      tree_track_x.push_back(            itTrack->vx());
-      tree_track_y.push_back(            itTrack->vy());
-      tree_track_z.push_back(            itTrack->vz());
-      tree_track_dxy.push_back( 	 itTrack->dxy(PV.position()));
-      tree_track_dxyError.push_back(	 itTrack->dxyError());
+      ev.tree_track_pt.push_back(           itTrack->pt());
+      ev.tree_track_eta.push_back(          itTrack->eta());
+      ev.tree_track_phi.push_back(          itTrack->phi());
+      ev.tree_track_charge.push_back(       itTrack->charge());
+      ev.tree_track_NChi2.push_back(        itTrack->normalizedChi2());
+      ev.tree_track_x.push_back(            itTrack->vx());
+      ev.tree_track_y.push_back(            itTrack->vy());
+      ev.tree_track_z.push_back(            itTrack->vz());
+      ev.tree_track_dxy.push_back( 	 itTrack->dxy(PV.position()));
+      ev.tree_track_dxyError.push_back(	 itTrack->dxyError());
       if ( itTrack->dxyError() > 0 ) {
-        tree_track_drSig.push_back( abs(itTrack->dxy(PV.position())) / itTrack->dxyError()); // from Paul
+        ev.tree_track_drSig.push_back( abs(itTrack->dxy(PV.position())) / itTrack->dxyError()); // from Paul
       }
       else {
-        tree_track_drSig.push_back( -1. ); 
+        ev.tree_track_drSig.push_back( -1. ); 
       }
-      tree_track_dz.push_back(           itTrack->dz(PV.position()));
-      tree_track_dzError.push_back(	 itTrack->dzError());
+      ev.tree_track_dz.push_back(           itTrack->dz(PV.position()));
+      ev.tree_track_dzError.push_back(	 itTrack->dzError());
         
-      if( itTrack->quality(reco::TrackBase::highPurity) ){tree_track_isHighPurity.push_back(true);}
-      else {tree_track_isHighPurity.push_back(false);}
-      if( itTrack->quality(reco::TrackBase::loose) )	 {tree_track_isLoose.push_back(true);}
-      else {tree_track_isLoose.push_back(false);}
-      if( itTrack->quality(reco::TrackBase::tight))	 {tree_track_isTight.push_back(true);}
-      else {tree_track_isTight.push_back(false);}
-    
-      tree_track_numberOfLostHits.push_back( itTrack->numberOfLostHits());
-      tree_track_originalAlgo.push_back(itTrack->originalAlgo());
-      tree_track_algo.push_back(itTrack->algo());
-      tree_track_stopReason.push_back(itTrack->stopReason());
+      if( itTrack->quality(reco::TrackBase::highPurity) ){ev.tree_track_isHighPurity.push_back(true);}
+      else {ev.tree_track_isHighPurity.push_back(false);}
+      if( itTrack->quality(reco::TrackBase::loose) )	 {ev.tree_track_isLoose.push_back(true);}
+      else {ev.tree_track_isLoose.push_back(false);}
+      if( itTrack->quality(reco::TrackBase::tight))	 {ev.tree_track_isTight.push_back(true);}
+      else {ev.tree_track_isTight.push_back(false);}
+    
+      ev.tree_track_numberOfLostHits.push_back( itTrack->numberOfLostHits());
+      ev.tree_track_originalAlgo.push_back(itTrack->originalAlgo());
+      ev.tree_track_algo.push_back(itTrack->algo());
+      ev.tree_track_stopReason.push_back(itTrack->stopReason());
        
       const HitPattern hp = itTrack->hitPattern();
-      tree_track_nHit.push_back(         hp.numberOfValidHits());
-      tree_track_nHitPixel.push_back(    hp.numberOfValidPixelHits());
-      tree_track_nHitTIB.push_back(      hp.numberOfValidStripTIBHits());
-      tree_track_nHitTID.push_back(      hp.numberOfValidStripTIDHits());
-      tree_track_nHitTOB.push_back(      hp.numberOfValidStripTOBHits());
-      tree_track_nHitTEC.push_back(      hp.numberOfValidStripTECHits());
-      tree_track_nHitPXB.push_back(      hp.numberOfValidPixelBarrelHits());
-      tree_track_nHitPXF.push_back(      hp.numberOfValidPixelEndcapHits());
-      tree_track_nLayers.push_back(      hp.trackerLayersWithMeasurement());
-      tree_track_nLayersPixel.push_back( hp.pixelLayersWithMeasurement());
-
-      tree_track_stripTECLayersWithMeasurement.push_back(hp.stripTECLayersWithMeasurement() );
-      tree_track_stripTIBLayersWithMeasurement.push_back(hp.stripTIBLayersWithMeasurement());
-      tree_track_stripTIDLayersWithMeasurement.push_back(hp.stripTIDLayersWithMeasurement());
-      tree_track_stripTOBLayersWithMeasurement.push_back(hp.stripTOBLayersWithMeasurement());
+      ev.tree_track_nHit.push_back(         hp.numberOfValidHits());
+      ev.tree_track_nHitPixel.push_back(    hp.numberOfValidPixelHits());
+      ev.tree_track_nHitTIB.push_back(      hp.numberOfValidStripTIBHits());
+      ev.tree_track_nHitTID.push_back(      hp.numberOfValidStripTIDHits());
+      ev.tree_track_nHitTOB.push_back(      hp.numberOfValidStripTOBHits());
+      ev.tree_track_nHitTEC.push_back(      hp.numberOfValidStripTECHits());
+      ev.tree_track_nHitPXB.push_back(      hp.numberOfValidPixelBarrelHits());
+      ev.tree_track_nHitPXF.push_back(      hp.numberOfValidPixelEndcapHits());
+      ev.tree_track_nLayers.push_back(      hp.trackerLayersWithMeasurement());
+      ev.tree_track_nLayersPixel.push_back( hp.pixelLayersWithMeasurement());
+
+      ev.tree_track_stripTECLayersWithMeasurement.push_back(hp.stripTECLayersWithMeasurement() );
+      ev.tree_track_stripTIBLayersWithMeasurement.push_back(hp.stripTIBLayersWithMeasurement());
+      ev.tree_track_stripTIDLayersWithMeasurement.push_back(hp.stripTIDLayersWithMeasurement());
+      ev.tree_track_stripTOBLayersWithMeasurement.push_back(hp.stripTOBLayersWithMeasurement());
 
       int hitPixelLayer = 0;
       if ( hp.hasValidHitInPixelLayer(PixelSubdetector::SubDetector::PixelBarrel, 1) )  hitPixelLayer += 1;
@@ -1471,7 +1190,7 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
       if ( hp.hasValidHitInPixelLayer(PixelSubdetector::SubDetector::PixelEndcap, 1) )  hitPixelLayer += 2;
       if ( hp.hasValidHitInPixelLayer(PixelSubdetector::SubDetector::PixelEndcap, 2) )  hitPixelLayer += 20;
       if ( hp.hasValidHitInPixelLayer(PixelSubdetector::SubDetector::PixelEndcap, 3) )  hitPixelLayer += 200;
-      tree_track_isHitPixel.push_back(hitPixelLayer);
+      ev.tree_track_isHitPixel.push_back(hitPixelLayer);
 
       //---------------- Firsthit -----------//
                   //-----------------IMPORTANT----------------//
@@ -1482,54 +1201,71 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
                   //------------------------------------------//
  //-----hitpattern -> Database ---/
       uint16_t firsthit = hp.getHitPattern(HitPattern::HitCategory::TRACK_HITS,0);
-      tree_track_firstHit.push_back(firsthit);
-
-      //---Creating State to propagate from  TT---//
-      const reco::Track* RtBTracks = trackRefs[iTrack].get();
-      BestTracks.push_back(theTransientTrackBuilder->build(RtBTracks));
-      const MagneticField* B = BestTracks[count].field(); // 3.8T
-      reco::TransientTrack TT (*RtBTracks,BestTracks[count].field());
-      // const FreeTrajectoryState Freetraj = TT.initialFreeState(); // Propagator in the barrel can also use FTS (WARNING: the so-called reference point (where the propagation starts might be different from the first vtx, a check should be done))
-      GlobalPoint vert (itTrack->vx(),itTrack->vy(),itTrack->vz()); // Point where the propagation will start (Reference Point)
-      const TrajectoryStateOnSurface Surtraj = TT.stateOnSurface(vert); // TSOS of this point
-      AnalyticalPropagator* Prop = new AnalyticalPropagator(B); // Propagator that will be used for barrel, crashes in the disks when using Plane
-      Basic3DVector<float> P3D2(itTrack->vx(),itTrack->vy(),itTrack->vz());  // global frame
-      Basic3DVector<float> B3DV (itTrack->px(),itTrack->py(),itTrack->pz()); // global frame 
-      float Eta = itTrack->eta();
-      float Phi = itTrack->phi();
-      float vz  = itTrack->vz();
-      // double pz = itTrack->pz();
-      //------Propagation with new interface --> See ../interface/PropaHitPattern.h-----//
-      PropaHitPattern* PHP = new PropaHitPattern();
-      std::pair<int,GloballyPositioned<float>::PositionType> FHPosition = PHP->Main(firsthit,Prop,Surtraj,Eta,Phi,vz,P3D2,B3DV);
-
-      float xFirst = FHPosition.second.x();
-      float yFirst = FHPosition.second.y();
-      float zFirst = FHPosition.second.z();
-      tree_track_firstHit_x.push_back(xFirst);
-      tree_track_firstHit_y.push_back(yFirst);
-      tree_track_firstHit_z.push_back(zFirst);
-      tree_track_region.push_back(FHPosition.first);
-      count+=1;
-      //-----------------------END OF MINIAOD firsthit-----------------------//
+      ev.tree_track_firstHit.push_back(firsthit);
 
-      // track association to jet
-      int iJet = 0;
-      bool matchTOjet = false;
-      for (int ij=0; ij<int(jets->size()); ij++) {
-        const Jet& jet = jets->at(ij);
-      if ( jet.pt() < jet_pt_min ) continue;
-        float dR = Deltar( jet.eta(), jet.phi(), tk_eta, tk_phi );
-        if ( dR < 0.4 ) {
-          matchTOjet = true;
-          break;
+      float xFirst, yFirst, zFirst;
+      int   regionFirst;
+      if ( !helixFirstHit_ ) {
+        std::pair<int,GloballyPositioned<float>::PositionType> FHPosition;
+        {
+          auto firstHitTime = stages_.Measure(FlyingTopTiming::kFirstHit);
+          //---Creating State to propagate from  TT---//
+          const reco::TransientTrack& TT = transientTracks.Get(iTrack);
+          // const FreeTrajectoryState Freetraj = TT.initialFreeState(); // Propagator in the barrel can also use FTS (WARNING: the so-called reference point (where the propagation starts might be different from the first vtx, a check should be done))
+          GlobalPoint vert (itTrack->vx(),itTrack->vy(),itTrack->vz()); // Point where the propagation will start (Reference Point)
+          const TrajectoryStateOnSurface Surtraj = TT.stateOnSurface(vert); // TSOS of this point
+          Basic3DVector<float> P3D2(itTrack->vx(),itTrack->vy(),itTrack->vz());  // global frame
+          Basic3DVector<float> B3DV (itTrack->px(),itTrack->py(),itTrack->pz()); // global frame 
+          float Eta = itTrack->eta();
+          float Phi = itTrack->phi();
+          float vz  = itTrack->vz();
+          // double pz = itTrack->pz();
+          //------Propagation with new interface --> See ../interface/PropaHitPattern.h-----//
+          FHPosition = propaHitPattern_.Main(firsthit,propagator_.get(),Surtraj,Eta,Phi,vz,P3D2,B3DV);
         }
-        else iJet++;
+
+        xFirst = FHPosition.second.x();
+        yFirst = FHPosition.second.y();
+        zFirst = FHPosition.second.z();
+        regionFirst = FHPosition.first;
+
+        if ( validateFirstHit_ && helix_valid[iTrack] ) {
+          float dist = sqrt( (xFirst-helix_x[iTrack])*(xFirst-helix_x[iTrack]) + (yFirst-helix_y[iTrack])*(yFirst-helix_y[iTrack])
+                           + (zFirst-helix_z[iTrack])*(zFirst-helix_z[iTrack]) );
+          fh_nCompared++;
+          if ( dist > 0.1 ) fh_nDiff++;
+          if ( regionFirst == 1 ) fh_maxDiffDisk   = std::max(fh_maxDiffDisk,   double(dist));
+          else                    fh_maxDiffBarrel = std::max(fh_maxDiffBarrel, double(dist));
+        }
+      }
+      else {
+        xFirst = helix_x[iTrack];
+        yFirst = helix_y[iTrack];
+        zFirst = helix_z[iTrack];
+        regionFirst = helix_region[iTrack];
       }
-      if ( matchTOjet ) tree_track_iJet.push_back (iJet);
-      else              tree_track_iJet.push_back (-1);
 
-      // match to gen particle from LLP decay
+      ev.tree_track_firstHit_x.push_back(xFirst);
+      ev.tree_track_firstHit_y.push_back(yFirst);
+      ev.tree_track_firstHit_z.push_back(zFirst);
+      ev.tree_track_region.push_back(regionFirst);
+      //-----------------------END OF MINIAOD firsthit-----------------------//
+
+      // track association to jet : first selected jet within dR < 0.4
+      int iJet;
+      {
+        auto jetTime = stages_.Measure(FlyingTopTiming::kJetAssociation);
+        iJet = jetGrid.First( tk_eta, tk_phi, 0.4 );
+      }
+      ev.tree_track_iJet.push_back (iJet);
+
+      // match to gen particle from LLP decay, the rest of the loop only fills the track sim branches
+      // but the hemisphere and LLP vertex stages read tree_track_sim_LLP
+      if ( !fill_[FlyingTopBranches::TrackSim] ) {
+        ev.tree_track_sim_LLP.push_back( -1 );
+      continue;
+      }
+      auto trackSimTime = groupTimes_.Measure(FlyingTopBranches::TrackSim);
       int      kmatch = -1;
       float    dFirstGenMin = 1000000.;
       int      track_sim_LLP = -1;
@@ -1545,23 +1281,22 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
       float    track_sim_y = 0;
       float    track_sim_z = 0;
 
-      for (int k = 0; k < tree_ngenFromLLP; k++) // loop on final gen part from LLP
+      // the largest windows of the matching below, with a margin for the folding of dphi
+      float detaWindow = 0.02, dphiWindow = 0.02;
+      if      ( tk_nHit <= 10 ) { detaWindow = 0.30; dphiWindow = 0.08; }
+      else if ( tk_nHit <= 13 ) { detaWindow = 0.12; dphiWindow = 0.05; }
+      else if ( tk_nHit <= 17 ) { detaWindow = 0.04; dphiWindow = 0.03; }
+
+      auto matchGen = [&](int k) // test a final gen part from LLP
       {
-      if ( itTrack->charge() != tree_genFromLLP_charge[k] ) continue;
-
-        float qGen   = tree_genFromLLP_charge[k];
-        float ptGen  = tree_genFromLLP_pt[k];
-        float etaGen = tree_genFromLLP_eta[k];
-        float phiGen = tree_genFromLLP_phi[k]; // given at production point
-        float xGen   = tree_genFromLLP_x[k];
-        float yGen   = tree_genFromLLP_y[k];
-        float zGen   = tree_genFromLLP_z[k];
-	
-	// compute phi at PV for the gen particle (instead of production point)
-        float qR = qGen * ptGen * 100 / 0.3 / 3.8;
-        float sin0 = qR * sin( phiGen ) + (xGen - tree_GenPVx);
-        float cos0 = qR * cos( phiGen ) - (yGen - tree_GenPVy);
-        float phi0 = TMath::ATan2( sin0, cos0 ); // but note that it can be wrong by +_pi ! 
+      if ( itTrack->charge() != ev.tree_genFromLLP_charge[k] ) return;
+
+        float ptGen  = ev.tree_genFromLLP_pt[k];
+        float etaGen = ev.tree_genFromLLP_eta[k];
+        float xGen   = ev.tree_genFromLLP_x[k];
+        float yGen   = ev.tree_genFromLLP_y[k];
+        float zGen   = ev.tree_genFromLLP_z[k];
+        float phi0   = genFromLLP_phi0[k]; // phi at PV
 
         float dpt  = (tk_pt - ptGen) / tk_pt;
         float deta = tk_eta - etaGen;
@@ -1586,50 +1321,62 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 
 	if ( matchTOgen ) {
 	  float dFirstGen = (xFirst-xGen)*(xFirst-xGen) + (yFirst-yGen)*(yFirst-yGen) + (zFirst-zGen)*(zFirst-zGen);
-	  if ( dFirstGen < dFirstGenMin ) {
+	  // the candidates do not come in order: keep the first one in case of equal distances
+	  if ( dFirstGen < dFirstGenMin || ( dFirstGen == dFirstGenMin && k < kmatch ) ) {
 	    kmatch = k;
 	    dFirstGenMin = dFirstGen;
 	  }
 	}
-      } // end loop on final gen part from LLP
+      };
+
+      {
+        auto matchTime = stages_.Measure(FlyingTopTiming::kTruthMatch);
+        const EtaPhiGrid& genGrid = ( itTrack->charge() > 0 ) ? genGridPos : genGridNeg;
+        genGrid.Visit( tk_eta, tk_phi, detaWindow + 0.001, dphiWindow + 0.001, matchGen );
+      }
 
 //$$
       if ( kmatch >= 0 ) {
 //$$
-        track_sim_LLP =     tree_genFromLLP_LLP[kmatch];
-        track_sim_isFromB = tree_genFromLLP_isFromB[kmatch];
-        track_sim_isFromC = tree_genFromLLP_isFromC[kmatch];
-        track_sim_pt  =     tree_genFromLLP_pt[kmatch];
-        track_sim_eta =     tree_genFromLLP_eta[kmatch];
-        track_sim_phi =     tree_genFromLLP_phi[kmatch];
-        track_sim_charge =  tree_genFromLLP_charge[kmatch];
-        track_sim_pdgId =   tree_genFromLLP_pdgId[kmatch];
-        track_sim_mass =    tree_genFromLLP_mass[kmatch];
-        track_sim_x =	    tree_genFromLLP_x[kmatch];
-        track_sim_y =	    tree_genFromLLP_y[kmatch];
-        track_sim_z =	    tree_genFromLLP_z[kmatch];
+        track_sim_LLP =     ev.tree_genFromLLP_LLP[kmatch];
+        track_sim_isFromB = ev.tree_genFromLLP_isFromB[kmatch];
+        track_sim_isFromC = ev.tree_genFromLLP_isFromC[kmatch];
+        track_sim_pt  =     ev.tree_genFromLLP_pt[kmatch];
+        track_sim_eta =     ev.tree_genFromLLP_eta[kmatch];
+        track_sim_phi =     ev.tree_genFromLLP_phi[kmatch];
+        track_sim_charge =  ev.tree_genFromLLP_charge[kmatch];
+        track_sim_pdgId =   ev.tree_genFromLLP_pdgId[kmatch];
+        track_sim_mass =    ev.tree_genFromLLP_mass[kmatch];
+        track_sim_x =	    ev.tree_genFromLLP_x[kmatch];
+        track_sim_y =	    ev.tree_genFromLLP_y[kmatch];
+        track_sim_z =	    ev.tree_genFromLLP_z[kmatch];
       }
-      tree_track_sim_LLP.push_back(	  track_sim_LLP );
-      tree_track_sim_isFromB.push_back(   track_sim_isFromB );
-      tree_track_sim_isFromC.push_back(   track_sim_isFromC );
-      tree_track_sim_pt.push_back(	  track_sim_pt );
-      tree_track_sim_eta.push_back(	  track_sim_eta );
-      tree_track_sim_phi.push_back(	  track_sim_phi );
-      tree_track_sim_charge.push_back(    track_sim_charge );
-      tree_track_sim_pdgId.push_back(	  track_sim_pdgId );
-      tree_track_sim_mass.push_back(	  track_sim_mass );
-      tree_track_sim_x.push_back(	  track_sim_x );
-      tree_track_sim_y.push_back(	  track_sim_y );
-      tree_track_sim_z.push_back(	  track_sim_z );
+      ev.tree_track_sim_LLP.push_back(	  track_sim_LLP );
+      ev.tree_track_sim_isFromB.push_back(   track_sim_isFromB );
+      ev.tree_track_sim_isFromC.push_back(   track_sim_isFromC );
+      ev.tree_track_sim_pt.push_back(	  track_sim_pt );
+      ev.tree_track_sim_eta.push_back(	  track_sim_eta );
+      ev.tree_track_sim_phi.push_back(	  track_sim_phi );
+      ev.tree_track_sim_charge.push_back(    track_sim_charge );
+      ev.tree_track_sim_pdgId.push_back(	  track_sim_pdgId );
+      ev.tree_track_sim_mass.push_back(	  track_sim_mass );
+      ev.tree_track_sim_x.push_back(	  track_sim_x );
+      ev.tree_track_sim_y.push_back(	  track_sim_y );
+      ev.tree_track_sim_z.push_back(	  track_sim_z );
 //$$
       float dSign = 1.;
       if ( kmatch >= 0 &&
-           xFirst*tree_genFromLLP_x[kmatch]+yFirst*tree_genFromLLP_y[kmatch]+zFirst*tree_genFromLLP_z[kmatch] < 0. ) dSign = -1.;
-      tree_track_sim_dFirstGen.push_back( TMath::Sqrt(dFirstGenMin)*dSign );
+           xFirst*ev.tree_genFromLLP_x[kmatch]+yFirst*ev.tree_genFromLLP_y[kmatch]+zFirst*ev.tree_genFromLLP_z[kmatch] < 0. ) dSign = -1.;
+      ev.tree_track_sim_dFirstGen.push_back( TMath::Sqrt(dFirstGenMin)*dSign );
 //$$
 
     } // end loop on all track candidates
 
+    stages_.Count(FlyingTopTiming::kTracksProcessed, trackRefs.size());
+    if ( helixFirstHit_ ) stages_.Count(FlyingTopTiming::kPropagationFallbacks, std::count(helix_valid.begin(), helix_valid.end(), 0));
+    else                  stages_.Count(FlyingTopTiming::kPropagationFallbacks, propaHitPattern_.Fallbacks() - propagationFallbacks);
+    stages_.Lap(FlyingTopTiming::kTracks);
+
 
     /////////////////////////////////////////////////////////
     //-------------------------------------------------------
@@ -1637,63 +1384,11 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     //-------------------------------------------------------
     /////////////////////////////////////////////////////////
 
-    int njet = 0, njet1 = 0, njet2 = 0;
-    bool isjet[99], isjet1[99], isjet2[99];
-    TLorentzVector vaxis1, vaxis2, vjet[99];
-    float PtMin = 20;   // (GeV) minimum jet pt is optimum
-    float EtaMax = 10.; // no cut on eta is optimum
-    int jetidx = 0; //FIXME : May be in the loop/ not sure it changes anything
-    for (int ij=0; ij<int(jets->size()); ij++) {   // Loop on jet
-      const Jet& jet = jets->at(ij);
-      float jet_pt  = jet.pt();
-      float jet_eta = jet.eta();
-      float jet_phi = jet.phi();
-      isjet[jetidx]  = false;
-      isjet1[jetidx] = false; // first neutralino jets
-      isjet2[jetidx] = false; // second neutralino jets
-      v.SetPtEtaPhiM( jet_pt, jet_eta, jet_phi, 0. ); //set the axis
-      
-    if ( jet_pt < PtMin ) continue;
-    if ( abs(jet_eta) > EtaMax ) continue;
-      
-      // look if prompt muon inside
-      float deltaR1 = 1000., deltaR2 = 1000.;
-      if ( imu1 >= 0 ) deltaR1 = Deltar( jet_eta, jet_phi, tree_muon_eta[imu1], tree_muon_phi[imu1] );
-      if ( imu2 >= 0 ) deltaR2 = Deltar( jet_eta, jet_phi, tree_muon_eta[imu2], tree_muon_phi[imu2] );
-      if ( deltaR1 < 0.4 || deltaR2 < 0.4 )
-      {
-        if ( deltaR1 < 0.4 )
-        { //if muon is inside, we remove the muons infomation from the jet
-          v1.SetPtEtaPhiM( tree_muon_pt[imu1],
-          		  tree_muon_eta[imu1],
-          		  tree_muon_phi[imu1],
-          		  0 );
-          v -= v1; //v TLorentzFactor being just above, defined by jet data
-        }
-        if ( deltaR2 < 0.4 )
-        {
-          v2.SetPtEtaPhiM( tree_muon_pt[imu2],
-          		  tree_muon_eta[imu2],
-          		  tree_muon_phi[imu2],
-          		  0 );
-          v -= v2;
-        }
-        jet_pt  = v.Pt(); //Update jet data by removing the muons information (muons that could be in the jet)
-        jet_eta = v.Eta(); //+ we do not want muons data to build the two axis since they come from the PV
-        jet_phi = v.Phi();
-      }
-      
-      njet++;
-      isjet[jetidx] = true;
-      vjet[jetidx] = v; // Only jet data (with  possible muons being removed)
-      if ( njet1 == 0 && jet_pt > PtMin && abs(jet_eta) < EtaMax )
-      {
-        njet1 = 1;
-        isjet1[jetidx] = true;
-        vaxis1 = v;
-      }
-      jetidx++;
-    } // End Loop on jets
+    // muons of the Z candidate removed from the jets, see ../interface/HemisphereAxes.h
+    hemiAxes_.Clear();
+    if ( imu1 >= 0 ) hemiAxes_.AddMuon( ev.tree_muon_pt[imu1], ev.tree_muon_eta[imu1], ev.tree_muon_phi[imu1] );
+    if ( imu2 >= 0 ) hemiAxes_.AddMuon( ev.tree_muon_pt[imu2], ev.tree_muon_eta[imu2], ev.tree_muon_phi[imu2] );
+    for (const auto& jet : *jets) hemiAxes_.AddJet( jet.pt(), jet.eta(), jet.phi() );
 
     /////////////////////////////////////////////////////////
     //-------------------------------------------------------
@@ -1701,36 +1396,12 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     //-------------------------------------------------------
     /////////////////////////////////////////////////////////
 
-    float dR, dR1 = 10., dR2 = 10.;
-    float dRcut_hemis  = 1.5; // subjective choice
     float dRcut_tracks = 10.; // no cut is better (could bias low track pT and high LLP ct) 
-     
-    for (int i=0; i<jetidx; i++) // Loop on jet
-    {
-    if ( !isjet[i] ) continue;
-      // float jet_pt  = vjet[i].Pt();
-      float jet_eta = vjet[i].Eta();
-      float jet_phi = vjet[i].Phi();
-      if ( njet1 > 0 ) dR1 = Deltar( jet_eta, jet_phi, vaxis1.Eta(), vaxis1.Phi() );
-      if ( njet2 > 0 ) dR2 = Deltar( jet_eta, jet_phi, vaxis2.Eta(), vaxis2.Phi() );
-      // axis 1
-      if ( njet1 > 0 && !isjet2[i]  && dR1 < dRcut_hemis) {
-        njet1++;
-        vaxis1 += vjet[i];
-        isjet1[i] = true;
-      }
-      // axis 2
-      if ( njet2 == 0 && !isjet1[i] ) {
-        njet2 = 1;
-        vaxis2 = vjet[i];
-        isjet2[i] = true;
-      }
-      else if ( njet2 > 0 && !isjet1[i] && !isjet2[i] && dR2 < dRcut_hemis ) {//
-        njet2++;
-        vaxis2 += vjet[i];
-        isjet2[i] = true;
-      }
-    }       // end Loop on jet
+
+    hemiAxes_.Build();
+    int njet1 = hemiAxes_.NJets1(), njet2 = hemiAxes_.NJets2();
+    // without gen neutralino, dR1 and dR2 keep their last values of the jet loop
+    float dR, dR1 = hemiAxes_.LastDR1(), dR2 = hemiAxes_.LastDR2();
     
 //$$
 //     // force the axes to the true LLP
@@ -1743,10 +1414,10 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     ///////////////////////////////
     
     int iLLPrec1 = 1, iLLPrec2 = 2;
-    float axis1_eta = vaxis1.Eta();
-    float axis1_phi = vaxis1.Phi();
-    if ( neu[0] >= 0 ) dR1 = Deltar( axis1_eta, axis1_phi, Gen_neu1_eta, Gen_neu1_phi ); //dR between reco axis of jets and gen neutralino
-    if ( neu[1] >= 0 ) dR2 = Deltar( axis1_eta, axis1_phi, Gen_neu2_eta, Gen_neu2_phi );
+    float axis1_eta = hemiAxes_.Eta1();
+    float axis1_phi = hemiAxes_.Phi1();
+    if ( neu[0] >= 0 ) dR1 = sqrt( DeltaR2( axis1_eta, axis1_phi, Gen_neu1_eta, Gen_neu1_phi ) ); //dR between reco axis of jets and gen neutralino
+    if ( neu[1] >= 0 ) dR2 = sqrt( DeltaR2( axis1_eta, axis1_phi, Gen_neu2_eta, Gen_neu2_phi ) );
     dR = dR1;
     if ( dR2 < dR1 )
     { // make sure that the reco axis defined matches well with the axis of the gen neutralino, if not it is swapped
@@ -1755,19 +1426,13 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
       dR = dR2;
     }
     float axis1_dR = dR;
-    float axis2_eta = vaxis2.Eta();
-    float axis2_phi = vaxis2.Phi();
-    if ( njet2 == 0 )
-    {  // compute an axis 2 even without jet, by taking the opposite in phi to axis 1
-      axis2_eta = axis1_eta;
-      axis2_phi = axis1_phi - 3.14159;
-      if ( axis1_phi < 0 ) axis2_phi = axis1_phi + 3.14159;
-    }
-    if ( iLLPrec2 == 1 ) dR = Deltar( axis2_eta, axis2_phi, Gen_neu1_eta, Gen_neu1_phi );
-    else                 dR = Deltar( axis2_eta, axis2_phi, Gen_neu2_eta, Gen_neu2_phi );
+    float axis2_eta = hemiAxes_.Eta2(); // opposite in phi to axis 1 if there is no jet for axis 2
+    float axis2_phi = hemiAxes_.Phi2();
+    if ( iLLPrec2 == 1 ) dR = sqrt( DeltaR2( axis2_eta, axis2_phi, Gen_neu1_eta, Gen_neu1_phi ) );
+    else                 dR = sqrt( DeltaR2( axis2_eta, axis2_phi, Gen_neu2_eta, Gen_neu2_phi ) );
     float axis2_dR = dR;
 
-    float dR_axis12 = Deltar(axis1_eta,axis1_phi,axis2_eta,axis2_phi);
+    float dR_axis12 = sqrt( DeltaR2( axis1_eta, axis1_phi, axis2_eta, axis2_phi ) );
 
         // cout << " njet1 " << njet1 << " and njet2" << njet2 << endl;
         // cout << " axis1_eta " << axis1_eta << " and axis2_eta" << axis2_eta << endl;
@@ -1789,7 +1454,7 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     float drSig, isinjet;
     int jet;
     float ntrk10, ntrk20, ntrk30;
-    float firsthit_X, firsthit_Y, firsthit_Z, pt, eta, phi, NChi, nhits;
+    float pt, eta, phi, NChi, nhits;
 //     float algo;
     double bdtval = -100.;
 
@@ -1801,29 +1466,6 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     LLP1_nTrks = 0;
     LLP2_nTrks = 0;
 
-    //add the variables from my BDT (Paul)
-    TMVA::Reader *reader = new TMVA::Reader( "!Color:Silent" );
-    // reader->AddVariable( "mva_track_firstHit_x", &firsthit_X );//to be exluded if TMVAbgctau50withnhits.xml is chosen
-    // reader->AddVariable( "mva_track_firstHit_y", &firsthit_Y );//to be exluded if TMVAbgctau50withnhits.xml is chosen
-    // reader->AddVariable( "mva_track_firstHit_z", &firsthit_Z );//to be exluded if TMVAbgctau50withnhits.xml is chosen
-    // reader->AddVariable( "mva_track_firstHit_dxy", &dxy );//to be exluded if TMVAbgctau50withnhits.xml is chosen
-    // reader->AddVariable( "mva_track_firstHit_dxyError", &dxyError );//to be exluded if TMVAbgctau50withnhits.xml is chosen
-    // reader->AddVariable( "mva_track_firstHit_dz", &dz );//to be exluded if TMVAbgctau50withnhits.xml is chosen
-    // reader->AddVariable( "mva_track_firstHit_dzError", &dzError );//to be exluded if TMVAbgctau50withnhits.xml is chosen
-    reader->AddVariable( "mva_track_pt", &pt );
-    reader->AddVariable( "mva_track_eta", &eta );
-    reader->AddVariable( "mva_track_nchi2", &NChi );
-    reader->AddVariable( "mva_track_nhits", &nhits );
-//$$$$
-//     reader->AddVariable( "mva_track_algo", &algo);
-    reader->AddVariable( "mva_ntrk10", &ntrk10);
-//$$$$
-    reader->AddVariable( "mva_drSig", &drSig); /*!*/
-    reader->AddVariable( "mva_track_isinjet", &isinjet); /*!*/
-    //reader->AddVariable("mva_track_dR",&track_dR);
-    // reader->AddVariable("mva_track_dRmax",&track_dRmax);
-    reader->BookMVA( "BDTG", weightFile_ ); // root 6.14/09, care compatiblity of versions for tmva
-
 //$$
     float pt_Cut = 1.;
     float NChi2_Cut = 5.;
@@ -1835,24 +1477,48 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 //     double bdtcut = -0.0067; // for TMVAClassification_BDTG50cm_sansntrk10_avecHP.weights.xml BDTrecohpsansalgosansntrk10
 //$$
 
+    stages_.Lap(FlyingTopTiming::kAxes);
+
+    std::vector<int>   mvaTracks;     // index of the tracks to score
+    std::vector<float> mvaInputs[7];  // BDT inputs of these tracks, same order as mvaVariables
+    for (int i=0; i<7; i++) mvaInputs[i].reserve(trackRefs.size());
+
+    // preselection of the tracks (one pass over the pt, NChi2 and drSig columns) and grid over
+    // the first hits of the preselected tracks, for the ntrk10/20/30 counting
+    std::vector<char> preselected(trackRefs.size());
+    std::vector<int> gridIndex(trackRefs.size(), -1);
+    std::vector<float> gridX, gridY, gridZ;
+    for (size_t iTrack = 0; iTrack<trackRefs.size(); ++iTrack)
+//$$$$
+      preselected[iTrack] = ( ev.tree_track_pt[iTrack] > pt_Cut && ev.tree_track_NChi2[iTrack] < NChi2_Cut && ev.tree_track_drSig[iTrack] > drSig_Cut );
+//$$$$
+    for (size_t iTrack = 0; iTrack<trackRefs.size(); ++iTrack) {
+    if ( !preselected[iTrack] ) continue;
+      gridIndex[iTrack] = gridX.size();
+      gridX.push_back(ev.tree_track_firstHit_x[iTrack]);
+      gridY.push_back(ev.tree_track_firstHit_y[iTrack]);
+      gridZ.push_back(ev.tree_track_firstHit_z[iTrack]);
+    }
+    const float ntrkRadius2[3] = { 10.*10., 20.*20., 30.*30. };
+    FirstHitGrid hitGrid( 30. );
+    {
+      auto neighboursTime = stages_.Measure(FlyingTopTiming::kNeighbours);
+      hitGrid.Fill( gridX.size(), gridX.data(), gridY.data(), gridZ.data() );
+    }
+
     int counter_track = -1;
     //---------------------------//
-    // if (tree_passesHTFilter){
 
     for (size_t iTrack = 0; iTrack<trackRefs.size(); ++iTrack) {
 
       counter_track++;
-      const auto& itTrack = trackRefs[iTrack];
-      firsthit_X = tree_track_firstHit_x[counter_track];
-      firsthit_Y = tree_track_firstHit_y[counter_track];
-      firsthit_Z = tree_track_firstHit_z[counter_track];
-      pt	 = tree_track_pt[counter_track];
-      eta	 = tree_track_eta[counter_track];
-      phi	 = tree_track_phi[counter_track];
-      NChi	 = tree_track_NChi2[counter_track];
-      nhits	 = tree_track_nHit[counter_track];
-//       algo	 = tree_track_algo[counter_track];
-      drSig      = tree_track_drSig[counter_track];
+      pt	 = ev.tree_track_pt[counter_track];
+      eta	 = ev.tree_track_eta[counter_track];
+      phi	 = ev.tree_track_phi[counter_track];
+      NChi	 = ev.tree_track_NChi2[counter_track];
+      nhits	 = ev.tree_track_nHit[counter_track];
+//       algo	 = ev.tree_track_algo[counter_track];
+      drSig      = ev.tree_track_drSig[counter_track];
 
       ntrk10 = 0;
       ntrk20 = 0;
@@ -1862,110 +1528,121 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
       int tracks_axis = 0; // flag to check which axis is the closest from the track
 
 //$$$$
-      if ( pt > pt_Cut && NChi < NChi2_Cut && drSig > drSig_Cut ) // preselection : pt > 1. && NChi2 < 5. && drSig > 5.
+      if ( preselected[counter_track] ) // preselection : pt > 1. && NChi2 < 5. && drSig > 5.
 //       if ( pt > pt_Cut && NChi < NChi2_Cut && drSig > drSig_Cut 
-//                        && tree_track_isHighPurity[counter_track] )
+//                        && ev.tree_track_isHighPurity[counter_track] )
 //$$$$
       { 
-        jet = tree_track_iJet[counter_track];
+        jet = ev.tree_track_iJet[counter_track];
         isinjet = 0.;
         if ( jet >= 0 ) isinjet = 1.;
-        int isFromLLP = tree_track_sim_LLP[counter_track];
+        int isFromLLP = ev.tree_track_sim_LLP[counter_track];
 
         //check the dR between the tracks and the second axis (without any selection on the tracks)
-        float dR1  = Deltar( eta, phi, axis1_eta, axis1_phi ); // axis1_phi and axis1_eta for the first axis
-        float dR2  = Deltar( eta, phi, axis2_eta, axis2_phi );
+        float dR1  = DeltaR2( eta, phi, axis1_eta, axis1_phi ); // axis1_phi and axis1_eta for the first axis (squared)
+        float dR2  = DeltaR2( eta, phi, axis2_eta, axis2_phi );
         tracks_axis = 1;
-        dR = dR1;
+        dR = sqrt( dR1 );
         if ( dR2 < dR1 ) { // a restriction could be added on the value of dR to assign the value Tracks_axis  (avoid some background???)
           tracks_axis = 2;
-          dR = dR2;
+          dR = sqrt( dR2 );
         }
 
-        //Computation of the distances needed for the BDT
-        int counter_othertrack = -1;
-        for (size_t iTrack2=0; iTrack2<trackRefs.size(); ++iTrack2)    // Loop on all the other Tracks/*!*/
+        //Computation of the distances needed for the BDT : other preselected tracks with their first hit within 10, 20 and 30 cm
+        int nNeighbours[3];
         {
-          counter_othertrack++;
-        if ( counter_othertrack == counter_track ) continue;
-          float pt2  = tree_track_pt[counter_othertrack];
-          float drSig2 = tree_track_drSig[counter_othertrack];
-          float NChi2 = tree_track_NChi2[counter_othertrack];
-//$$$$
-        if ( !(pt2 > pt_Cut && NChi2 < NChi2_Cut && drSig2 > drSig_Cut ) ) continue; // On regarde les autres track_selec[i] qui sont True donc de potentielles tracks secondaires
-//         if ( !(pt2 > pt_Cut && NChi2 < NChi2_Cut && drSig2 > drSig_Cut 
-//              && tree_track_isHighPurity[counter_othertrack] ) ) continue;
-//$$$$
-          float x2 = tree_track_firstHit_x[counter_othertrack];
-          float y2 = tree_track_firstHit_y[counter_othertrack];
-          float z2 = tree_track_firstHit_z[counter_othertrack];
-          float dist = TMath::Sqrt( (firsthit_X-x2)*(firsthit_X-x2) + (firsthit_Y-y2)*(firsthit_Y-y2) + (firsthit_Z-z2)*(firsthit_Z-z2) );//pour chaque reconstruite, on regarde les autres tracks,
-          if ( dist < 10. )	     {ntrk10++;} // les sctocker les 3 , on teste sur une seule couche quand on regarde vers l'avant
-          if ( dist < 20. )	     {ntrk20++;}
-          if ( dist < 30. )	     {ntrk30++;}
-        }  // end Loop on other Tracks
+          auto neighboursTime = stages_.Measure(FlyingTopTiming::kNeighbours);
+          hitGrid.Count( gridIndex[counter_track], 3, ntrkRadius2, nNeighbours );
+        }
+        ntrk10 = nNeighbours[0];
+        ntrk20 = nNeighbours[1];
+        ntrk30 = nNeighbours[2];
 
         if ( dR < dRcut_tracks ) 
 	{
 	  if ( isFromLLP == 1 ) LLP1_nTrks++;
 	  if ( isFromLLP == 2 ) LLP2_nTrks++;
 	
-          bdtval = reader->EvaluateMVA( "BDTG" ); //default value = -10 (no -10 observed and -999 comes from EvaluateMVA)
-
-          if ( tracks_axis == 1 ) {
-	    nTrks_axis1++;
-            if ( isFromLLP == iLLPrec1 ) nTrks_axis1_sig++;
-            else if ( isFromLLP >= 1 )   nTrks_axis1_bad++;
-          }
-        
-          if ( tracks_axis == 2 ) {
-	    nTrks_axis2++;
-            if ( isFromLLP == iLLPrec2 ) nTrks_axis2_sig++;
-            else if ( isFromLLP >= 1 )   nTrks_axis2_bad++;
-          }
-        
-          if ( bdtval > bdtcut ) {
-            ////--------------Control tracks-----------------////
-            if ( isFromLLP == 1 )
-            {
-              displacedTracks_llp1_mva.push_back(theTransientTrackBuilder->build(*itTrack));
-            }
-            if ( isFromLLP == 2 )
-            {
-              displacedTracks_llp2_mva.push_back(theTransientTrackBuilder->build(*itTrack));
-            }
-
-            if ( tracks_axis == 1 )
-            {
-              displacedTracks_Hemi1_mva.push_back(theTransientTrackBuilder->build(*itTrack));
-              nTrks_axis1_mva++;
-              if ( isFromLLP == iLLPrec1 ) nTrks_axis1_mva_sig++;
-              else if ( isFromLLP >= 1 )   nTrks_axis1_mva_bad++;
-            }
- 
-            if ( tracks_axis == 2 )
-            {
-              displacedTracks_Hemi2_mva.push_back(theTransientTrackBuilder->build(*itTrack));
-              nTrks_axis2_mva++;
-              if ( isFromLLP == iLLPrec2 ) nTrks_axis2_mva_sig++;
-              else if ( isFromLLP >= 1 )   nTrks_axis2_mva_bad++;
-            }
-          }
+          // BDT inputs, all the tracks are scored at once after this loop
+          mvaTracks.push_back(counter_track);
+          mvaInputs[0].push_back(pt);
+          mvaInputs[1].push_back(eta);
+          mvaInputs[2].push_back(NChi);
+          mvaInputs[3].push_back(nhits);
+          mvaInputs[4].push_back(ntrk10);
+          mvaInputs[5].push_back(drSig);
+          mvaInputs[6].push_back(isinjet);
         }
       }
       
-      tree_track_ntrk10.push_back(ntrk10);
-      tree_track_ntrk20.push_back(ntrk20);
-      tree_track_ntrk30.push_back(ntrk30);
-      tree_track_MVAval.push_back(bdtval);
-      tree_track_Hemi.push_back(tracks_axis);
-      tree_track_Hemi_dR.push_back(dR);
-      if      ( tracks_axis == 1 ) tree_track_Hemi_LLP.push_back(iLLPrec1);
-      else if ( tracks_axis == 2 ) tree_track_Hemi_LLP.push_back(iLLPrec2);
-      else		           tree_track_Hemi_LLP.push_back(0);
+      ev.tree_track_ntrk10.push_back(ntrk10);
+      ev.tree_track_ntrk20.push_back(ntrk20);
+      ev.tree_track_ntrk30.push_back(ntrk30);
+      ev.tree_track_MVAval.push_back(bdtval);
+      ev.tree_track_Hemi.push_back(tracks_axis);
+      ev.tree_track_Hemi_dR.push_back(dR);
+      if      ( tracks_axis == 1 ) ev.tree_track_Hemi_LLP.push_back(iLLPrec1);
+      else if ( tracks_axis == 2 ) ev.tree_track_Hemi_LLP.push_back(iLLPrec2);
+      else		           ev.tree_track_Hemi_LLP.push_back(0);
       
     } //End loop on all the tracks
-    // }//ENd of Passes HTfilter
+    stages_.Lap(FlyingTopTiming::kSelection);
+
+    //BDT scoring of the selected tracks
+    unsigned int nMVA = mvaTracks.size();
+    std::vector<double> mvaValues(nMVA);
+    const float* mvaColumns[7];
+    for (int i=0; i<7; i++) mvaColumns[i] = mvaInputs[i].data();
+    globalCache()->forest->Evaluate( mvaColumns, nMVA, mvaValues.data() );
+    stages_.Count(FlyingTopTiming::kBDTEvaluations, nMVA);
+
+    for (unsigned int k=0; k<nMVA; k++) {
+      counter_track = mvaTracks[k];
+      bdtval = mvaValues[k];
+      ev.tree_track_MVAval[counter_track] = bdtval;
+      int isFromLLP   = ev.tree_track_sim_LLP[counter_track];
+      int tracks_axis = ev.tree_track_Hemi[counter_track];
+
+      if ( tracks_axis == 1 ) {
+        nTrks_axis1++;
+        if ( isFromLLP == iLLPrec1 ) nTrks_axis1_sig++;
+        else if ( isFromLLP >= 1 )   nTrks_axis1_bad++;
+      }
+    
+      if ( tracks_axis == 2 ) {
+        nTrks_axis2++;
+        if ( isFromLLP == iLLPrec2 ) nTrks_axis2_sig++;
+        else if ( isFromLLP >= 1 )   nTrks_axis2_bad++;
+      }
+    
+      if ( bdtval > bdtcut ) {
+        ////--------------Control tracks-----------------////
+        if ( isFromLLP == 1 )
+        {
+          displacedTracks_llp1_mva.push_back(transientTracks.Get(counter_track));
+        }
+        if ( isFromLLP == 2 )
+        {
+          displacedTracks_llp2_mva.push_back(transientTracks.Get(counter_track));
+        }
+
+        if ( tracks_axis == 1 )
+        {
+          displacedTracks_Hemi1_mva.push_back(transientTracks.Get(counter_track));
+          nTrks_axis1_mva++;
+          if ( isFromLLP == iLLPrec1 ) nTrks_axis1_mva_sig++;
+          else if ( isFromLLP >= 1 )   nTrks_axis1_mva_bad++;
+        }
+
+        if ( tracks_axis == 2 )
+        {
+          displacedTracks_Hemi2_mva.push_back(transientTracks.Get(counter_track));
+          nTrks_axis2_mva++;
+          if ( isFromLLP == iLLPrec2 ) nTrks_axis2_mva_sig++;
+          else if ( isFromLLP >= 1 )   nTrks_axis2_mva_bad++;
+        }
+      }
+    } // end loop on BDT scored tracks
         // cout << " displaced tracks LLP1 " << LLP1_nTrks << " and with mva" << displacedTracks_llp1_mva.size() << endl;
         // cout << " displaced tracks LLP2 " << LLP2_nTrks << " and with mva" << displacedTracks_llp2_mva.size() << endl;
         // cout << " displaced tracks Hemi1 " << nTrks_axis1 << " and with mva" << displacedTracks_Hemi1_mva.size() << endl;
@@ -2041,28 +1718,41 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     float Vtx_x = 0., Vtx_y = 0., Vtx_z= 0., Vtx_chi = -10.;
     float recX, recY, recZ, dSV, recD;
     
-//$$
-    // parameters for the Adaptive Vertex Fitter (AVF)
-    double maxshift        = 0.0001;
-    unsigned int maxstep   = 30;
-    double maxlpshift      = 0.1;
-    double weightThreshold = 0.001;
-    double sigmacut        = 3.;
-    double Tini            = 256.;
-    double ratio           = 0.25;
-//$$
+    // the four fits are independent and run concurrently, each with its own fitter;
+    // the results are then stored below in the fixed order llp1, llp2, Hemi1, Hemi2
+    TransientVertex displacedVertex_llp1_mva, displacedVertex_llp2_mva, displacedVertex_Hemi1_mva, displacedVertex_Hemi2_mva;
+    auto fitVertex = [](const AdaptiveVertexFitter& fitter, const vector<reco::TransientTrack>& tracks, TransientVertex& vertex, StageTimer& times, int fit) {
+      if ( tracks.size() < 2 ) return;
+      auto fitTime = times.Measure(fit);  // each fit its own stage, no clock read when timing is off
+      vertex = fitter.vertex(tracks); // fitted vertex
+    };
+    stages_.Lap(FlyingTopTiming::kBDT);
+    {
+      auto fitsTime = stages_.Measure(FlyingTopTiming::kVertexFits);
+      tbb::task_group fits;
+      fits.run([&]() { fitVertex(*theFitter_vertex_llp1_mva,  displacedTracks_llp1_mva,  displacedVertex_llp1_mva,  fitTimes_, 0); });
+      fits.run([&]() { fitVertex(*theFitter_vertex_llp2_mva,  displacedTracks_llp2_mva,  displacedVertex_llp2_mva,  fitTimes_, 1); });
+      fits.run([&]() { fitVertex(*theFitter_Vertex_Hemi1_mva, displacedTracks_Hemi1_mva, displacedVertex_Hemi1_mva, fitTimes_, 2); });
+      fits.run([&]() { fitVertex(*theFitter_Vertex_Hemi2_mva, displacedTracks_Hemi2_mva, displacedVertex_Hemi2_mva, fitTimes_, 3); });
+      fits.wait();
+    }
+    for (const auto* fitTracks : { &displacedTracks_llp1_mva, &displacedTracks_llp2_mva, &displacedTracks_Hemi1_mva, &displacedTracks_Hemi2_mva })
+      if ( fitTracks->size() >= 2 ) {
+        stages_.Count(FlyingTopTiming::kFits);
+        stages_.Count(FlyingTopTiming::kFitTracks, fitTracks->size());
+      }
+    if ( fitTimes_.Enabled() ) {
+      int nLargeFits = ( displacedTracks_llp1_mva.size()  > 20 ) + ( displacedTracks_llp2_mva.size()  > 20 )
+                     + ( displacedTracks_Hemi1_mva.size() > 20 ) + ( displacedTracks_Hemi2_mva.size() > 20 );
+      if ( nLargeFits >= 2 ) {
+        vf_nBusyEvents++;
+        vf_busyWallTime += stages_.EventTimes()[FlyingTopTiming::kVertexFits];
+        for (double fitTime : fitTimes_.EventTimes()) vf_busySerialTime += fitTime;
+      }
+    }
 
 //------------------------------- FIRST LLP WITH MVA ----------------------------------//
     
-    static AdaptiveVertexFitter 
-    theFitter_vertex_llp1_mva(
-                 GeometricAnnealing ( sigmacut, Tini, ratio ), 
-                 DefaultLinearizationPointFinder(),
-                 KalmanVertexUpdator<5>(), 
-                 KalmanVertexTrackCompatibilityEstimator<5>(), 
-                 KalmanVertexSmoother() );
-    theFitter_vertex_llp1_mva.setParameters ( maxshift, maxlpshift, maxstep, weightThreshold );
-    
     Vtx_ntk = displacedTracks_llp1_mva.size();
     Vtx_x = -100.;
     Vtx_y = -100.;
@@ -2072,7 +1762,6 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     
     if ( Vtx_ntk > 1 )
     {
-      TransientVertex displacedVertex_llp1_mva = theFitter_vertex_llp1_mva.vertex(displacedTracks_llp1_mva); // fitted vertex
       
       // std::cout<< "displacedVertex_llp1_mva is built" << std::endl;
       
@@ -2084,7 +1773,7 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
         Vtx_chi = displacedVertex_llp1_mva.normalisedChiSquared();
         // tree_LLP_Vtx_posError.push_back(displacedVertex_llp1_mva.positionError());
         for (int p=0; p<Vtx_ntk; p++) {
-          tree_LLP_Vtx_trackWeight.push_back(displacedVertex_llp1_mva.trackWeight(displacedTracks_llp1_mva[p]));
+          ev.tree_LLP_Vtx_trackWeight.push_back(displacedVertex_llp1_mva.trackWeight(displacedTracks_llp1_mva[p]));
 	  if ( displacedVertex_llp1_mva.trackWeight(displacedTracks_llp1_mva[p]) > 0.5 ) Vtx_ntk_cut++;
 	  if ( showlog )
           std::cout << " vtx_chi / weight / chi2 / ndof / NCHi2: "<<Vtx_chi<<" / " <<displacedVertex_llp1_mva.trackWeight(displacedTracks_llp1_mva[p])<<" / "<<displacedTracks_llp1_mva[p].chi2()<<" / "<<displacedTracks_llp1_mva[p].ndof()<<" / "<<displacedTracks_llp1_mva[p].normalizedChi2()<<std::endl;
@@ -2092,28 +1781,28 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
       }
     }
 
-    tree_LLP.push_back(1);
-    tree_LLP_pt.push_back(   LLP1_pt);
-    tree_LLP_eta.push_back(  LLP1_eta);
-    tree_LLP_phi.push_back(  LLP1_phi);
-    tree_LLP_x.push_back(    LLP1_x);
-    tree_LLP_y.push_back(    LLP1_y);
-    tree_LLP_z.push_back(    LLP1_z);
-    tree_LLP_dist.push_back( LLP1_dist);
-    tree_LLP_nTrks.push_back(LLP1_nTrks);
-    tree_LLP_Vtx_nTrks.push_back(Vtx_ntk_cut);
-    tree_LLP_Vtx_NChi2.push_back(Vtx_chi);
-    tree_LLP_Vtx_dx.push_back(Vtx_x - LLP1_x);
-    tree_LLP_Vtx_dy.push_back(Vtx_y - LLP1_y);
-    tree_LLP_Vtx_dz.push_back(Vtx_z - LLP1_z);
+    ev.tree_LLP.push_back(1);
+    ev.tree_LLP_pt.push_back(   LLP1_pt);
+    ev.tree_LLP_eta.push_back(  LLP1_eta);
+    ev.tree_LLP_phi.push_back(  LLP1_phi);
+    ev.tree_LLP_x.push_back(    LLP1_x);
+    ev.tree_LLP_y.push_back(    LLP1_y);
+    ev.tree_LLP_z.push_back(    LLP1_z);
+    ev.tree_LLP_dist.push_back( LLP1_dist);
+    ev.tree_LLP_nTrks.push_back(LLP1_nTrks);
+    ev.tree_LLP_Vtx_nTrks.push_back(Vtx_ntk_cut);
+    ev.tree_LLP_Vtx_NChi2.push_back(Vtx_chi);
+    ev.tree_LLP_Vtx_dx.push_back(Vtx_x - LLP1_x);
+    ev.tree_LLP_Vtx_dy.push_back(Vtx_y - LLP1_y);
+    ev.tree_LLP_Vtx_dz.push_back(Vtx_z - LLP1_z);
     
     dSV = (Vtx_x - LLP1_x)*(Vtx_x - LLP1_x) + (Vtx_y - LLP1_y)*(Vtx_y - LLP1_y) + (Vtx_z - LLP1_z)*(Vtx_z - LLP1_z);
-    recX = Vtx_x - tree_PV_x[0];
-    recY = Vtx_y - tree_PV_y[0];
-    recZ = Vtx_z - tree_PV_z[0];
+    recX = Vtx_x - ev.tree_PV_x[0];
+    recY = Vtx_y - ev.tree_PV_y[0];
+    recZ = Vtx_z - ev.tree_PV_z[0];
     recD = TMath::Sqrt(recX*recX + recY*recY + recZ*recZ);
-    tree_LLP_Vtx_dist.push_back( recD );
-    tree_LLP_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP1_dist );
+    ev.tree_LLP_Vtx_dist.push_back( recD );
+    ev.tree_LLP_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP1_dist );
 
 //&&&&&
 // //     bool dump = false;
@@ -2121,7 +1810,7 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 //     cout << endl;
 //     cout << endl;
 //     cout << " &&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&&& " << endl;
-//     cout << " run event " << runNumber << " " << eventNumber << endl;
+//     cout << " run event " << ev.runNumber << " " << ev.eventNumber << endl;
 //     cout << " LLP " << 1 << " pt eta phi " << LLP1_pt << " " << LLP1_eta << " " << LLP1_phi << " x y z " << LLP1_x << " " << LLP1_y << " " << LLP1_z << " nTrks " << LLP1_nTrks << endl;
 //     cout << "	  Vtx Chi2 " << Vtx_chi << " dx dy dz " << Vtx_x - LLP1_x << " " << Vtx_y - LLP1_y  << " " << Vtx_z - LLP1_z << " nTrks " << Vtx_ntk << endl;
 //&&&&&
@@ -2129,15 +1818,6 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 
     //-------------------------- SECOND LLP WITH MVA -------------------------------------//
     
-    static AdaptiveVertexFitter 
-    theFitter_vertex_llp2_mva(
-                 GeometricAnnealing ( sigmacut, Tini, ratio ), 
-                 DefaultLinearizationPointFinder(),
-                 KalmanVertexUpdator<5>(), 
-                 KalmanVertexTrackCompatibilityEstimator<5>(), 
-                 KalmanVertexSmoother() );
-    theFitter_vertex_llp2_mva.setParameters ( maxshift, maxlpshift, maxstep, weightThreshold );
-    
     Vtx_ntk = displacedTracks_llp2_mva.size();
     Vtx_x = -100.;
     Vtx_y = -100.;
@@ -2147,7 +1827,6 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     
     if ( Vtx_ntk > 1 )
     {
-      TransientVertex displacedVertex_llp2_mva = theFitter_vertex_llp2_mva.vertex(displacedTracks_llp2_mva); // fitted vertex
       
       if ( displacedVertex_llp2_mva.isValid() ) // NotValid if the max number of steps has been exceded or the fitted position is out of tracker bounds.
       {
@@ -2157,7 +1836,7 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
         Vtx_chi = displacedVertex_llp2_mva.normalisedChiSquared();
         // tree_LLP_Vtx_posError.push_back(displacedVertex_llp2_mva.positionError();)
         for (int p=0; p<Vtx_ntk; p++) {
-          tree_LLP_Vtx_trackWeight.push_back(displacedVertex_llp2_mva.trackWeight(displacedTracks_llp2_mva[p]));
+          ev.tree_LLP_Vtx_trackWeight.push_back(displacedVertex_llp2_mva.trackWeight(displacedTracks_llp2_mva[p]));
 	  if ( displacedVertex_llp2_mva.trackWeight(displacedTracks_llp2_mva[p]) > 0.5 ) Vtx_ntk_cut++;
 	  if ( showlog )
           std::cout << " vtx_chi  / weight / chi2 / ndof / NChi2 : "<<Vtx_chi<<" / " <<displacedVertex_llp2_mva.trackWeight(displacedTracks_llp2_mva[p])<<" / "<<displacedTracks_llp2_mva[p].chi2()<<" / "<<displacedTracks_llp2_mva[p].ndof()<<" / "<<displacedTracks_llp2_mva[p].normalizedChi2()<<std::endl;
@@ -2165,28 +1844,28 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
       }
     }
 
-    tree_LLP.push_back(2);
-    tree_LLP_pt.push_back(   LLP2_pt);
-    tree_LLP_eta.push_back(  LLP2_eta);
-    tree_LLP_phi.push_back(  LLP2_phi);
-    tree_LLP_x.push_back(    LLP2_x);
-    tree_LLP_y.push_back(    LLP2_y);
-    tree_LLP_z.push_back(    LLP2_z);
-    tree_LLP_dist.push_back( LLP2_dist);
-    tree_LLP_nTrks.push_back(LLP2_nTrks);
-    tree_LLP_Vtx_nTrks.push_back(Vtx_ntk_cut);
-    tree_LLP_Vtx_NChi2.push_back(Vtx_chi);
-    tree_LLP_Vtx_dx.push_back(Vtx_x - LLP2_x);
-    tree_LLP_Vtx_dy.push_back(Vtx_y - LLP2_y);
-    tree_LLP_Vtx_dz.push_back(Vtx_z - LLP2_z);
+    ev.tree_LLP.push_back(2);
+    ev.tree_LLP_pt.push_back(   LLP2_pt);
+    ev.tree_LLP_eta.push_back(  LLP2_eta);
+    ev.tree_LLP_phi.push_back(  LLP2_phi);
+    ev.tree_LLP_x.push_back(    LLP2_x);
+    ev.tree_LLP_y.push_back(    LLP2_y);
+    ev.tree_LLP_z.push_back(    LLP2_z);
+    ev.tree_LLP_dist.push_back( LLP2_dist);
+    ev.tree_LLP_nTrks.push_back(LLP2_nTrks);
+    ev.tree_LLP_Vtx_nTrks.push_back(Vtx_ntk_cut);
+    ev.tree_LLP_Vtx_NChi2.push_back(Vtx_chi);
+    ev.tree_LLP_Vtx_dx.push_back(Vtx_x - LLP2_x);
+    ev.tree_LLP_Vtx_dy.push_back(Vtx_y - LLP2_y);
+    ev.tree_LLP_Vtx_dz.push_back(Vtx_z - LLP2_z);
 
     dSV = (Vtx_x - LLP2_x)*(Vtx_x - LLP2_x) + (Vtx_y - LLP2_y)*(Vtx_y - LLP2_y) + (Vtx_z - LLP2_z)*(Vtx_z - LLP2_z);
-    recX = Vtx_x - tree_PV_x[0];
-    recY = Vtx_y - tree_PV_y[0];
-    recZ = Vtx_z - tree_PV_z[0];
+    recX = Vtx_x - ev.tree_PV_x[0];
+    recY = Vtx_y - ev.tree_PV_y[0];
+    recZ = Vtx_z - ev.tree_PV_z[0];
     recD = TMath::Sqrt(recX*recX + recY*recY + recZ*recZ);
-    tree_LLP_Vtx_dist.push_back( recD );
-    tree_LLP_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP2_dist );
+    ev.tree_LLP_Vtx_dist.push_back( recD );
+    ev.tree_LLP_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP2_dist );
     
 //&&&&&
 // //     if ( Vtx_chi < 0 && LLP2_nTrks > 1 ) dump = true;
@@ -2200,15 +1879,6 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
      
     //--------------------------- FIRST HEMISPHERE WITH MVA -------------------------------------//
     
-    static AdaptiveVertexFitter 
-    theFitter_Vertex_Hemi1_mva(
-                 GeometricAnnealing ( sigmacut, Tini, ratio ), 
-                 DefaultLinearizationPointFinder(),
-                 KalmanVertexUpdator<5>(), 
-                 KalmanVertexTrackCompatibilityEstimator<5>(), 
-                 KalmanVertexSmoother() );
-    theFitter_Vertex_Hemi1_mva.setParameters ( maxshift, maxlpshift, maxstep, weightThreshold );
-    
     Vtx_ntk = displacedTracks_Hemi1_mva.size();
     Vtx_x = -100.;
     Vtx_y = -100.;
@@ -2218,7 +1888,6 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 	
     if ( Vtx_ntk > 1 )
     {
-      TransientVertex displacedVertex_Hemi1_mva = theFitter_Vertex_Hemi1_mva.vertex(displacedTracks_Hemi1_mva); // fitted vertex
       if ( displacedVertex_Hemi1_mva.isValid() ) // NotValid if the max number of steps has been exceded or the fitted position is out of tracker bounds.
       { 
         Vtx_x = displacedVertex_Hemi1_mva.position().x();
@@ -2226,76 +1895,67 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
         Vtx_z = displacedVertex_Hemi1_mva.position().z();
         Vtx_chi = displacedVertex_Hemi1_mva.normalisedChiSquared();
         for (int p=0; p<Vtx_ntk; p++) {
-          tree_Hemi_Vtx_trackWeight.push_back(displacedVertex_Hemi1_mva.trackWeight(displacedTracks_Hemi1_mva[p]));
+          ev.tree_Hemi_Vtx_trackWeight.push_back(displacedVertex_Hemi1_mva.trackWeight(displacedTracks_Hemi1_mva[p]));
 	  if ( displacedVertex_Hemi1_mva.trackWeight(displacedTracks_Hemi1_mva[p]) > 0.5 ) Vtx_ntk_cut++;
         }
       }
     }
    
     float Vtx_chi1 = Vtx_chi;
-    tree_Hemi.push_back(1);
-    tree_Hemi_njet.push_back(njet1);
-    tree_Hemi_eta.push_back(axis1_eta);
-    tree_Hemi_phi.push_back(axis1_phi);
-    tree_Hemi_dR.push_back(axis1_dR);
-    tree_Hemi_nTrks.push_back(nTrks_axis1);
-    tree_Hemi_nTrks_sig.push_back(nTrks_axis1_sig);
-    tree_Hemi_nTrks_bad.push_back(nTrks_axis1_bad);
-    tree_Hemi_nTrks_mva.push_back(nTrks_axis1_mva);
-    tree_Hemi_nTrks_mva_sig.push_back(nTrks_axis1_mva_sig);
-    tree_Hemi_nTrks_mva_bad.push_back(nTrks_axis1_mva_bad);
-    tree_Hemi_Vtx_NChi2.push_back(Vtx_chi);
-    tree_Hemi_Vtx_nTrks.push_back(Vtx_ntk_cut);
-    tree_Hemi_Vtx_x.push_back(Vtx_x);
-    tree_Hemi_Vtx_y.push_back(Vtx_y);
-    tree_Hemi_Vtx_z.push_back(Vtx_z);
-    recX = Vtx_x - tree_PV_x[0];
-    recY = Vtx_y - tree_PV_y[0];
-    recZ = Vtx_z - tree_PV_z[0];
+    ev.tree_Hemi.push_back(1);
+    ev.tree_Hemi_njet.push_back(njet1);
+    ev.tree_Hemi_eta.push_back(axis1_eta);
+    ev.tree_Hemi_phi.push_back(axis1_phi);
+    ev.tree_Hemi_dR.push_back(axis1_dR);
+    ev.tree_Hemi_nTrks.push_back(nTrks_axis1);
+    ev.tree_Hemi_nTrks_sig.push_back(nTrks_axis1_sig);
+    ev.tree_Hemi_nTrks_bad.push_back(nTrks_axis1_bad);
+    ev.tree_Hemi_nTrks_mva.push_back(nTrks_axis1_mva);
+    ev.tree_Hemi_nTrks_mva_sig.push_back(nTrks_axis1_mva_sig);
+    ev.tree_Hemi_nTrks_mva_bad.push_back(nTrks_axis1_mva_bad);
+    ev.tree_Hemi_Vtx_NChi2.push_back(Vtx_chi);
+    ev.tree_Hemi_Vtx_nTrks.push_back(Vtx_ntk_cut);
+    ev.tree_Hemi_Vtx_x.push_back(Vtx_x);
+    ev.tree_Hemi_Vtx_y.push_back(Vtx_y);
+    ev.tree_Hemi_Vtx_z.push_back(Vtx_z);
+    recX = Vtx_x - ev.tree_PV_x[0];
+    recY = Vtx_y - ev.tree_PV_y[0];
+    recZ = Vtx_z - ev.tree_PV_z[0];
     recD = TMath::Sqrt(recX*recX + recY*recY + recZ*recZ);
-    tree_Hemi_Vtx_dist.push_back( recD );
+    ev.tree_Hemi_Vtx_dist.push_back( recD );
     if ( iLLPrec1 == 1 ) {
-      tree_Hemi_LLP_pt.push_back( LLP1_pt);
-      tree_Hemi_LLP_eta.push_back(LLP1_eta);
-      tree_Hemi_LLP_phi.push_back(LLP1_phi);
-      tree_Hemi_LLP_x.push_back(LLP1_x);
-      tree_Hemi_LLP_y.push_back(LLP1_y);
-      tree_Hemi_LLP_z.push_back(LLP1_z);
-      tree_Hemi_LLP_dist.push_back(LLP1_dist);
+      ev.tree_Hemi_LLP_pt.push_back( LLP1_pt);
+      ev.tree_Hemi_LLP_eta.push_back(LLP1_eta);
+      ev.tree_Hemi_LLP_phi.push_back(LLP1_phi);
+      ev.tree_Hemi_LLP_x.push_back(LLP1_x);
+      ev.tree_Hemi_LLP_y.push_back(LLP1_y);
+      ev.tree_Hemi_LLP_z.push_back(LLP1_z);
+      ev.tree_Hemi_LLP_dist.push_back(LLP1_dist);
       dSV = (Vtx_x - LLP1_x)*(Vtx_x - LLP1_x) + (Vtx_y - LLP1_y)*(Vtx_y - LLP1_y) + (Vtx_z - LLP1_z)*(Vtx_z - LLP1_z);
-      tree_Hemi_Vtx_dx.push_back(Vtx_x - LLP1_x);
-      tree_Hemi_Vtx_dy.push_back(Vtx_y - LLP1_y);
-      tree_Hemi_Vtx_dz.push_back(Vtx_z - LLP1_z);
-      tree_Hemi_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP1_dist );
+      ev.tree_Hemi_Vtx_dx.push_back(Vtx_x - LLP1_x);
+      ev.tree_Hemi_Vtx_dy.push_back(Vtx_y - LLP1_y);
+      ev.tree_Hemi_Vtx_dz.push_back(Vtx_z - LLP1_z);
+      ev.tree_Hemi_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP1_dist );
     }
     else {
-      tree_Hemi_LLP_pt.push_back( LLP2_pt);
-      tree_Hemi_LLP_eta.push_back(LLP2_eta);
-      tree_Hemi_LLP_phi.push_back(LLP2_phi);
-      tree_Hemi_LLP_x.push_back(LLP2_x);
-      tree_Hemi_LLP_y.push_back(LLP2_y);
-      tree_Hemi_LLP_z.push_back(LLP2_z);
-      tree_Hemi_LLP_dist.push_back(LLP2_dist);
+      ev.tree_Hemi_LLP_pt.push_back( LLP2_pt);
+      ev.tree_Hemi_LLP_eta.push_back(LLP2_eta);
+      ev.tree_Hemi_LLP_phi.push_back(LLP2_phi);
+      ev.tree_Hemi_LLP_x.push_back(LLP2_x);
+      ev.tree_Hemi_LLP_y.push_back(LLP2_y);
+      ev.tree_Hemi_LLP_z.push_back(LLP2_z);
+      ev.tree_Hemi_LLP_dist.push_back(LLP2_dist);
       dSV = (Vtx_x - LLP2_x)*(Vtx_x - LLP2_x) + (Vtx_y - LLP2_y)*(Vtx_y - LLP2_y) + (Vtx_z - LLP2_z)*(Vtx_z - LLP2_z);
-      tree_Hemi_Vtx_dx.push_back(Vtx_x - LLP2_x);
-      tree_Hemi_Vtx_dy.push_back(Vtx_y - LLP2_y);
-      tree_Hemi_Vtx_dz.push_back(Vtx_z - LLP2_z);
-      tree_Hemi_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP2_dist );
+      ev.tree_Hemi_Vtx_dx.push_back(Vtx_x - LLP2_x);
+      ev.tree_Hemi_Vtx_dy.push_back(Vtx_y - LLP2_y);
+      ev.tree_Hemi_Vtx_dz.push_back(Vtx_z - LLP2_z);
+      ev.tree_Hemi_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP2_dist );
     }
-    tree_Hemi_LLP.push_back(iLLPrec1);
+    ev.tree_Hemi_LLP.push_back(iLLPrec1);
      
 
     //--------------------------- SECOND HEMISPHERE WITH MVA -------------------------------------//
     
-    static AdaptiveVertexFitter 
-    theFitter_Vertex_Hemi2_mva(
-                 GeometricAnnealing ( sigmacut, Tini, ratio ), 
-                 DefaultLinearizationPointFinder(),
-                 KalmanVertexUpdator<5>(), 
-                 KalmanVertexTrackCompatibilityEstimator<5>(), 
-                 KalmanVertexSmoother() );
-    theFitter_Vertex_Hemi2_mva.setParameters ( maxshift, maxlpshift, maxstep, weightThreshold );
-    
     Vtx_ntk = displacedTracks_Hemi2_mva.size();
     Vtx_x = -100.;
     Vtx_y = -100.;
@@ -2305,7 +1965,6 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     
     if ( Vtx_ntk > 1 )
     {
-      TransientVertex displacedVertex_Hemi2_mva = theFitter_Vertex_Hemi2_mva.vertex(displacedTracks_Hemi2_mva); // fitted vertex
       
       if ( displacedVertex_Hemi2_mva.isValid() ) // NotValid if the max number of steps has been exceded or the fitted position is out of tracker bounds.
       {
@@ -2314,84 +1973,84 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
         Vtx_z = displacedVertex_Hemi2_mva.position().z();
         Vtx_chi = displacedVertex_Hemi2_mva.normalisedChiSquared();
         for (int p=0; p<Vtx_ntk; p++) {
-          tree_Hemi_Vtx_trackWeight.push_back(displacedVertex_Hemi2_mva.trackWeight(displacedTracks_Hemi2_mva[p]));
+          ev.tree_Hemi_Vtx_trackWeight.push_back(displacedVertex_Hemi2_mva.trackWeight(displacedTracks_Hemi2_mva[p]));
 	  if ( displacedVertex_Hemi2_mva.trackWeight(displacedTracks_Hemi2_mva[p]) > 0.5 ) Vtx_ntk_cut++;
         }
       }
     }
     
     float Vtx_chi2 = Vtx_chi;
-    tree_Hemi.push_back(2);
-    tree_Hemi_njet.push_back(njet2);
-    tree_Hemi_eta.push_back(axis2_eta);
-    tree_Hemi_phi.push_back(axis2_phi);
-    tree_Hemi_dR.push_back(axis2_dR);
-    tree_Hemi_nTrks.push_back(nTrks_axis2);
-    tree_Hemi_nTrks_sig.push_back(nTrks_axis2_sig);
-    tree_Hemi_nTrks_bad.push_back(nTrks_axis2_bad);
-    tree_Hemi_nTrks_mva.push_back(nTrks_axis2_mva);
-    tree_Hemi_nTrks_mva_sig.push_back(nTrks_axis2_mva_sig);
-    tree_Hemi_nTrks_mva_bad.push_back(nTrks_axis2_mva_bad);
-    tree_Hemi_Vtx_NChi2.push_back(Vtx_chi);
-    tree_Hemi_Vtx_nTrks.push_back(Vtx_ntk_cut);
-    tree_Hemi_Vtx_x.push_back(Vtx_x);
-    tree_Hemi_Vtx_y.push_back(Vtx_y);
-    tree_Hemi_Vtx_z.push_back(Vtx_z);
-    recX = Vtx_x - tree_PV_x[0];
-    recY = Vtx_y - tree_PV_y[0];
-    recZ = Vtx_z - tree_PV_z[0];
+    ev.tree_Hemi.push_back(2);
+    ev.tree_Hemi_njet.push_back(njet2);
+    ev.tree_Hemi_eta.push_back(axis2_eta);
+    ev.tree_Hemi_phi.push_back(axis2_phi);
+    ev.tree_Hemi_dR.push_back(axis2_dR);
+    ev.tree_Hemi_nTrks.push_back(nTrks_axis2);
+    ev.tree_Hemi_nTrks_sig.push_back(nTrks_axis2_sig);
+    ev.tree_Hemi_nTrks_bad.push_back(nTrks_axis2_bad);
+    ev.tree_Hemi_nTrks_mva.push_back(nTrks_axis2_mva);
+    ev.tree_Hemi_nTrks_mva_sig.push_back(nTrks_axis2_mva_sig);
+    ev.tree_Hemi_nTrks_mva_bad.push_back(nTrks_axis2_mva_bad);
+    ev.tree_Hemi_Vtx_NChi2.push_back(Vtx_chi);
+    ev.tree_Hemi_Vtx_nTrks.push_back(Vtx_ntk_cut);
+    ev.tree_Hemi_Vtx_x.push_back(Vtx_x);
+    ev.tree_Hemi_Vtx_y.push_back(Vtx_y);
+    ev.tree_Hemi_Vtx_z.push_back(Vtx_z);
+    recX = Vtx_x - ev.tree_PV_x[0];
+    recY = Vtx_y - ev.tree_PV_y[0];
+    recZ = Vtx_z - ev.tree_PV_z[0];
     recD = TMath::Sqrt(recX*recX + recY*recY + recZ*recZ);
-    tree_Hemi_Vtx_dist.push_back( recD );
+    ev.tree_Hemi_Vtx_dist.push_back( recD );
     if ( iLLPrec2 == 1 ) {
-      tree_Hemi_LLP_pt.push_back( LLP1_pt);
-      tree_Hemi_LLP_eta.push_back(LLP1_eta);
-      tree_Hemi_LLP_phi.push_back(LLP1_phi);
-      tree_Hemi_LLP_x.push_back(LLP1_x);
-      tree_Hemi_LLP_y.push_back(LLP1_y);
-      tree_Hemi_LLP_z.push_back(LLP1_z);
-      tree_Hemi_LLP_dist.push_back(LLP1_dist);
+      ev.tree_Hemi_LLP_pt.push_back( LLP1_pt);
+      ev.tree_Hemi_LLP_eta.push_back(LLP1_eta);
+      ev.tree_Hemi_LLP_phi.push_back(LLP1_phi);
+      ev.tree_Hemi_LLP_x.push_back(LLP1_x);
+      ev.tree_Hemi_LLP_y.push_back(LLP1_y);
+      ev.tree_Hemi_LLP_z.push_back(LLP1_z);
+      ev.tree_Hemi_LLP_dist.push_back(LLP1_dist);
       dSV = (Vtx_x - LLP1_x)*(Vtx_x - LLP1_x) + (Vtx_y - LLP1_y)*(Vtx_y - LLP1_y) + (Vtx_z - LLP1_z)*(Vtx_z - LLP1_z);
-      tree_Hemi_Vtx_dx.push_back(Vtx_x - LLP1_x);
-      tree_Hemi_Vtx_dy.push_back(Vtx_y - LLP1_y);
-      tree_Hemi_Vtx_dz.push_back(Vtx_z - LLP1_z);
-      tree_Hemi_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP1_dist );
+      ev.tree_Hemi_Vtx_dx.push_back(Vtx_x - LLP1_x);
+      ev.tree_Hemi_Vtx_dy.push_back(Vtx_y - LLP1_y);
+      ev.tree_Hemi_Vtx_dz.push_back(Vtx_z - LLP1_z);
+      ev.tree_Hemi_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP1_dist );
     }
     else {
-      tree_Hemi_LLP_pt.push_back( LLP2_pt);
-      tree_Hemi_LLP_eta.push_back(LLP2_eta);
-      tree_Hemi_LLP_phi.push_back(LLP2_phi);
-      tree_Hemi_LLP_x.push_back(LLP2_x);
-      tree_Hemi_LLP_y.push_back(LLP2_y);
-      tree_Hemi_LLP_z.push_back(LLP2_z);
-      tree_Hemi_LLP_dist.push_back(LLP2_dist);
+      ev.tree_Hemi_LLP_pt.push_back( LLP2_pt);
+      ev.tree_Hemi_LLP_eta.push_back(LLP2_eta);
+      ev.tree_Hemi_LLP_phi.push_back(LLP2_phi);
+      ev.tree_Hemi_LLP_x.push_back(LLP2_x);
+      ev.tree_Hemi_LLP_y.push_back(LLP2_y);
+      ev.tree_Hemi_LLP_z.push_back(LLP2_z);
+      ev.tree_Hemi_LLP_dist.push_back(LLP2_dist);
       dSV = (Vtx_x - LLP2_x)*(Vtx_x - LLP2_x) + (Vtx_y - LLP2_y)*(Vtx_y - LLP2_y) + (Vtx_z - LLP2_z)*(Vtx_z - LLP2_z);
-      tree_Hemi_Vtx_dx.push_back(Vtx_x - LLP2_x);
-      tree_Hemi_Vtx_dy.push_back(Vtx_y - LLP2_y);
-      tree_Hemi_Vtx_dz.push_back(Vtx_z - LLP2_z);
-      tree_Hemi_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP2_dist );
+      ev.tree_Hemi_Vtx_dx.push_back(Vtx_x - LLP2_x);
+      ev.tree_Hemi_Vtx_dy.push_back(Vtx_y - LLP2_y);
+      ev.tree_Hemi_Vtx_dz.push_back(Vtx_z - LLP2_z);
+      ev.tree_Hemi_Vtx_dd.push_back( TMath::Sqrt(dSV)/LLP2_dist );
     }
-    tree_Hemi_LLP.push_back(iLLPrec2);
+    ev.tree_Hemi_LLP.push_back(iLLPrec2);
 
 //&&&&&
 //     // some informations from gen particles from LLP 
 // //   if ( dump ) {
 //     cout << endl;
-//     for (int k = 0; k < tree_ngenFromLLP; k++) // loop on final gen part from LLP
+//     for (int k = 0; k < ev.tree_ngenFromLLP; k++) // loop on final gen part from LLP
 //     {
-//       float qGen   = tree_genFromLLP_charge[k];
-//       float ptGen  = tree_genFromLLP_pt[k];
-//       float etaGen = tree_genFromLLP_eta[k];
-//       float phiGen = tree_genFromLLP_phi[k]; // given at production point
-//       float xGen   = tree_genFromLLP_x[k];
-//       float yGen   = tree_genFromLLP_y[k];
-//       float zGen   = tree_genFromLLP_z[k];
+//       float qGen   = ev.tree_genFromLLP_charge[k];
+//       float ptGen  = ev.tree_genFromLLP_pt[k];
+//       float etaGen = ev.tree_genFromLLP_eta[k];
+//       float phiGen = ev.tree_genFromLLP_phi[k]; // given at production point
+//       float xGen   = ev.tree_genFromLLP_x[k];
+//       float yGen   = ev.tree_genFromLLP_y[k];
+//       float zGen   = ev.tree_genFromLLP_z[k];
 // 	// compute phi at PV for the gen particle (instead of production point)
 //         float qR = qGen * ptGen * 100 / 0.3 / 3.8;
-//         float sin0 = qR * sin( phiGen ) + (xGen - tree_GenPVx);
-//         float cos0 = qR * cos( phiGen ) - (yGen - tree_GenPVy);
+//         float sin0 = qR * sin( phiGen ) + (xGen - ev.tree_GenPVx);
+//         float cos0 = qR * cos( phiGen ) - (yGen - ev.tree_GenPVy);
 //         float phi0 = TMath::ATan2( sin0, cos0 ); // but note that it can be wrong by +_pi ! 
 // //       if ( dump ) {
-//         cout << " Gen " << k << " from LLP " << tree_genFromLLP_LLP[k]
+//         cout << " Gen " << k << " from LLP " << ev.tree_genFromLLP_LLP[k]
 // 	     << " pt eta phi phi0 q " << ptGen << " " << etaGen << " " << phiGen << " " << phi0 << " " << qGen 
 // 	     << " x y z " << xGen << " " << yGen << " " << zGen 
 // 	     << endl; 
@@ -2413,14 +2072,14 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
 //     if ( tk_nHit == 0 ) continue;
 //     if ( tk_charge == 0 ) continue;
 //       counter_track++;
-//       if ( tree_track_sim_LLP[counter_track] > 0 
-//            && tree_track_pt[counter_track] > pt_Cut 
-// 	   && tree_track_NChi2[counter_track] < NChi2_Cut 
-// 	   && tree_track_drSig[counter_track] > drSig_Cut ) {
-//         cout << " Track " << counter_track << " LLP " << tree_track_sim_LLP[counter_track] 
-// 	     << " pt eta phi q " << tree_track_pt[counter_track] << " " << tree_track_eta[counter_track] << " " << tree_track_phi[counter_track] << " " << tree_track_charge[counter_track] 
-// 	     << " chi2 drSig " << tree_track_NChi2[counter_track] << " " << tree_track_drSig[counter_track] 
-// 	     << " 1rst x y z " << tree_track_firstHit_x[counter_track] << " " << tree_track_firstHit_y[counter_track] << " " << tree_track_firstHit_z[counter_track] 
+//       if ( ev.tree_track_sim_LLP[counter_track] > 0 
+//            && ev.tree_track_pt[counter_track] > pt_Cut 
+// 	   && ev.tree_track_NChi2[counter_track] < NChi2_Cut 
+// 	   && ev.tree_track_drSig[counter_track] > drSig_Cut ) {
+//         cout << " Track " << counter_track << " LLP " << ev.tree_track_sim_LLP[counter_track] 
+// 	     << " pt eta phi q " << ev.tree_track_pt[counter_track] << " " << ev.tree_track_eta[counter_track] << " " << ev.tree_track_phi[counter_track] << " " << ev.tree_track_charge[counter_track] 
+// 	     << " chi2 drSig " << ev.tree_track_NChi2[counter_track] << " " << ev.tree_track_drSig[counter_track] 
+// 	     << " 1rst x y z " << ev.tree_track_firstHit_x[counter_track] << " " << ev.tree_track_firstHit_y[counter_track] << " " << ev.tree_track_firstHit_z[counter_track] 
 // 	     << " LOST " << tree_track_lost[counter_track] 
 // 	     << endl; 
 //       }
@@ -2433,40 +2092,176 @@ void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup&
     for (size_t iTrack = 0; iTrack<trackRefs.size(); ++iTrack) { // Loop on all the tracks
       counter_track++;
       const auto& itTrack = trackRefs[iTrack];
-      int hemi      = tree_track_Hemi[counter_track];
-      double MVAval = tree_track_MVAval[counter_track];
+      int hemi      = ev.tree_track_Hemi[counter_track];
+      double MVAval = ev.tree_track_MVAval[counter_track];
       Vtx_chi = -10.;
       if      ( hemi == 1 && MVAval > bdtcut ) Vtx_chi = Vtx_chi1;
       else if ( hemi == 2 && MVAval > bdtcut ) Vtx_chi = Vtx_chi2;
-      tree_track_Hemi_mva_NChi2.push_back(Vtx_chi);
+      ev.tree_track_Hemi_mva_NChi2.push_back(Vtx_chi);
     } //End loop on all the tracks
       
-    tree_Hemi_dR12.push_back(dR_axis12);
-    tree_Hemi_dR12.push_back(dR_axis12);
-    tree_Hemi_LLP_dR12.push_back(dRneuneu);
-    tree_Hemi_LLP_dR12.push_back(dRneuneu);
+    ev.tree_Hemi_dR12.push_back(dR_axis12);
+    ev.tree_Hemi_dR12.push_back(dR_axis12);
+    ev.tree_Hemi_LLP_dR12.push_back(dRneuneu);
+    ev.tree_Hemi_LLP_dR12.push_back(dRneuneu);
 
   //////////////////////////////////
   // }//end passes htfilter
-  smalltree->Fill();
+  tt_nRequests += transientTracks.Requests();
+  tt_nBuilds   += transientTracks.Builds();
+
+  stages_.Lap(FlyingTopTiming::kVertices);
+  putEvent(iEvent, std::move(output));
 }
 
 
-// ------------ method called once each job just before starting event loop  ------------
+// ------------ ends the timing of the event and puts the ntuple content (and the stage times) in the event  ------------
+void FlyingTopProducer::putEvent(edm::Event& iEvent, std::unique_ptr<FlyingTopEvent> output)
+{
+  stages_.EndEvent();
+  fitTimes_.EndEvent();
+  groupTimes_.EndEvent();
+  if ( stages_.Enabled() ) {
+    auto timing = std::make_unique<FlyingTopTiming>();
+    for (double t : stages_.EventTimes())  timing->time.push_back(1.e3 * t);
+    for (long n : stages_.EventCounts())   timing->count.push_back(n);
+    iEvent.put(std::move(timing));
+  }
+  output->MaxColumnSizes(columnSizes_);
+  iEvent.put(std::move(output));
+}
+
+
+// ------------ method called when starting a luminosity block  ------------
+// the TransientTrackBuilder, the magnetic field and the propagators are kept as long as TransientTrackRecord does not change
+void
+FlyingTopProducer::beginLuminosityBlock(const edm::LuminosityBlock&, const edm::EventSetup& iSetup)
+{
+  es_nLumis++;
+  if ( !ttRecordWatcher_.check(iSetup) && ttBuilder_ ) return;
+  es_nRefreshes++;
+  ttBuilder_ = &iSetup.getData(ttBuilderToken_);
+  const MagneticField& bField = iSetup.getData(bFieldToken_);
+  // Propagator that will be used for barrel, crashes in the disks when using Plane, shared by all the tracks
+  propagator_ = std::make_unique<AnalyticalPropagator>( &bField ); // 3.8T
+  helixPropagator_ = HelixPropagator( bField.inTesla(GlobalPoint(0.,0.,0.)).z() );
+}
+
+
+// ------------ method called once each stream just after ending the event loop  ------------
 void
-FlyingTopAnalyzer::beginJob()
+FlyingTopProducer::endStream()
 {
+  std::lock_guard<std::mutex> guard(globalCache()->summaryMutex);
+  globalCache()->stages.Merge(stages_);
+  globalCache()->fitTimes.Merge(fitTimes_);
+  globalCache()->groupTimes.Merge(groupTimes_);
+  globalCache()->nEvent     += nEvent;
+  globalCache()->nRejected  += nRejected;
+  globalCache()->fhTracks    += fh_nTracks;
+  globalCache()->ttRequests  += tt_nRequests;
+  globalCache()->vfBusyEvents     += vf_nBusyEvents;
+  globalCache()->vfBusyWallTime   += vf_busyWallTime;
+  globalCache()->vfBusySerialTime += vf_busySerialTime;
+  globalCache()->ttBuilds    += tt_nBuilds;
+  globalCache()->esLumis     += es_nLumis;
+  globalCache()->esRefreshes += es_nRefreshes;
+  globalCache()->fhCompared  += fh_nCompared;
+  globalCache()->fhDiff      += fh_nDiff;
+  if ( fh_maxDiffBarrel > globalCache()->fhMaxDiffBarrel ) globalCache()->fhMaxDiffBarrel = fh_maxDiffBarrel;
+  if ( fh_maxDiffDisk   > globalCache()->fhMaxDiffDisk )   globalCache()->fhMaxDiffDisk   = fh_maxDiffDisk;
 }
 
 // ------------ method called once each job just after ending the event loop  ------------
 void
-FlyingTopAnalyzer::endJob()
+FlyingTopProducer::globalEndJob(const FlyingTopCache* cache)
 {
+  double wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - cache->start).count();
+  std::cout << " FlyingTop summary: " << cache->nEvent << " events";
+  if ( cache->nEvent > 0 && wallTime > 0 ) std::cout << ", " << cache->nEvent / wallTime << " events/s";
+  if ( cache->nRejected > 0 ) std::cout << ", " << cache->nRejected << " failing the selection (event record only)";
+  std::cout << std::endl;
+  // resident memory, TransientTracks, EventSetup refreshes and vertex fits (timing = True)
+  const StageTimer& stages = cache->stages;
+  if ( stages.Enabled() ) {
+    // the resident memory should stay flat during the job
+    std::cout << "   memory: RSS at first event " << cache->rssFirstEvent / 1024 << " MB, at end of job " << procStatusKB("VmRSS") / 1024
+              << " MB, high-water mark " << procStatusKB("VmHWM") / 1024 << " MB" << std::endl;
+
+    // the TransientTracks used to be built for each use
+    std::cout << " FlyingTop TransientTrack summary: " << cache->ttBuilds << " built for " << cache->ttRequests << " uses, "
+              << cache->ttRequests - cache->ttBuilds << " builds avoided" << std::endl;
+    // the builder, the magnetic field and the propagators used to be looked up or checked for each event
+    std::cout << "   EventSetup: builder, magnetic field and propagators refreshed " << cache->esRefreshes << " times in "
+              << cache->esLumis << " luminosity blocks (summed over the streams)" << std::endl;
+
+    // vertex fits, wall-clock time of the concurrent fits (VertexFits stage) vs the time they would take one after the other
+    const StageTimer& fitTimes = cache->fitTimes;
+    if ( fitTimes.Events() > 0 ) {
+      double serialTime = 0.;
+      for (int f=0; f<4; f++) serialTime += fitTimes.StageTime(f);
+      std::cout << " FlyingTop vertex fit summary: " << fitTimes.Events() << " events, " << 1.e3 * stages.StageTime(FlyingTopTiming::kVertexFits) / fitTimes.Events()
+                << " ms per event (" << 1.e3 * serialTime / fitTimes.Events() << " ms if run one after the other)" << std::endl;
+      if ( cache->vfBusyEvents > 0 )
+        std::cout << "   " << cache->vfBusyEvents << " events with at least 2 fits of more than 20 tracks: "
+                  << 1.e3 * ( cache->vfBusySerialTime - cache->vfBusyWallTime ) / cache->vfBusyEvents << " ms saved per event" << std::endl;
+    }
+  }
+
+  // first hit propagation: its time is the FirstHit stage (timing = True), HelixPropagator against PropaHitPattern
+  // for firstHitPropagation = validate
+  if ( cache->fhTracks > 0 ) {
+    std::cout << " FlyingTop first hit summary: " << cache->fhTracks << " tracks" << std::endl;
+    if ( cache->fhCompared > 0 ) {
+      std::cout << "   max distance HelixPropagator - PropaHitPattern: barrel " << cache->fhMaxDiffBarrel << " cm, disks " << cache->fhMaxDiffDisk
+                << " cm, " << cache->fhDiff << " / " << cache->fhCompared << " tracks above 1 mm" << std::endl;
+    }
+  }
+
+  // the BDT used to be booked for each event: report what loading it once saves
+  // (BDTForest against TMVA and its evaluation time: test/testBDTForest.cc and test/benchBDTForest.cc)
+  std::cout << " FlyingTop BDT summary: " << cache->forest->NTrees() << " trees / " << cache->forest->NNodes() << " nodes" << std::endl;
+  std::cout << "   weights loaded once: " << cache->bookTime << " s, loadings avoided: " << std::max(cache->nEvent-1, 0L)
+            << ", load time saved: " << cache->bookTime * std::max(cache->nEvent-1, 0L) << " s" << std::endl;
+
+  // time of the stages of produce(), in the order they run (timing = True)
+  if ( stages.Enabled() && stages.Events() > 0 ) {
+    double total = 0.;
+    for (int i=0; i<FlyingTopTiming::kNStages; i++) if ( FlyingTopTiming::Parent(i) < 0 ) total += stages.StageTime(i);
+    std::cout << " FlyingTop stage timing: " << stages.Events() << " events, " << 1.e3 * total / stages.Events() << " ms per event" << std::endl;
+    for (int i=0; i<FlyingTopTiming::kNStages; i++) {
+      std::cout << "   " << FlyingTopTiming::StageName(i) << ": " << 1.e3 * stages.StageTime(i) / stages.Events() << " ms per event ("
+                << 100. * stages.StageTime(i) / total << " %)";
+      if ( FlyingTopTiming::Parent(i) >= 0 ) std::cout << ", included in " << FlyingTopTiming::StageName( FlyingTopTiming::Parent(i) );
+      std::cout << std::endl;
+    }
+    std::cout << "   counters per event:";
+    for (int i=0; i<FlyingTopTiming::kNCounters; i++)
+      std::cout << " " << FlyingTopTiming::CounterName(i) << " " << double(stages.Counter(i)) / stages.Events();
+    std::cout << std::endl;
+  }
+
+  // branch groups: the optional computations of each group are skipped when it is not in branchGroups,
+  // their time is what leaving the group out saves (timing = True)
+  const StageTimer& groupTimes = cache->groupTimes;
+  std::cout << " FlyingTop branch groups:";
+  for (int i=0; i<FlyingTopBranches::NGroups; i++) std::cout << " " << FlyingTopBranches::GroupName(i) << ( cache->filled[i] ? "" : " (skipped)" );
+  std::cout << std::endl;
+  if ( groupTimes.Enabled() && groupTimes.Events() > 0 ) {
+    std::cout << "   time of the skippable computations:";
+    for (int i : { FlyingTopBranches::Electron, FlyingTopBranches::TrackSim, FlyingTopBranches::Gen, FlyingTopBranches::GenPacked,
+                   FlyingTopBranches::GenFromLLP, FlyingTopBranches::GenFromBC, FlyingTopBranches::GenJet }) {
+      std::cout << " " << FlyingTopBranches::GroupName(i) << " ";
+      if ( cache->filled[i] ) std::cout << 1.e3 * groupTimes.StageTime(i) / groupTimes.Events() << " ms";
+      else                    std::cout << "skipped";
+    }
+    std::cout << " per event" << std::endl;
+  }
 }
 
 // ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
 void
-FlyingTopAnalyzer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+FlyingTopProducer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
   //The following says we do not know what parameters are allowed so do no validation
   // Please change this to state exactly what you do use, even if it is no parameters
   edm::ParameterSetDescription desc;
@@ -2481,232 +2276,4 @@ FlyingTopAnalyzer::fillDescriptions(edm::ConfigurationDescriptions& descriptions
 }
 
 //define this as a plug-in
-DEFINE_FWK_MODULE(FlyingTopAnalyzer);
-
-void FlyingTopAnalyzer::clearVariables() {
-    
-//     tree_trigger_names.clear();
-//     tree_trigger_bits.clear();
-    tree_PV_x.clear(); // l'index 0 donne le PV!
-    tree_PV_y.clear();
-    tree_PV_z.clear();
-    tree_PV_ez.clear();
-    tree_PV_NChi2.clear();
-    tree_PV_ndf.clear();
-
-    tree_jet_E.clear();
-    tree_jet_pt.clear();
-    tree_jet_eta.clear();
-    tree_jet_phi.clear();
-    
-    tree_electron_pt.clear();
-    tree_electron_eta.clear();
-    tree_electron_phi.clear();
-    tree_electron_x.clear();
-    tree_electron_y.clear();
-    tree_electron_z.clear();
-    tree_electron_energy.clear();
-    tree_electron_charge.clear();
-    
-    tree_muon_pt.clear();
-    tree_muon_eta.clear();
-    tree_muon_phi.clear();
-    tree_muon_x.clear();
-    tree_muon_y.clear();
-    tree_muon_z.clear();
-    tree_muon_energy.clear();
-    tree_muon_dxy.clear();
-    tree_muon_dxyError.clear();
-    tree_muon_dz.clear();
-    tree_muon_dzError.clear();
-    tree_muon_charge.clear();
-    tree_muon_isLoose.clear();
-    tree_muon_isTight.clear();
-    tree_muon_isGlobal.clear();
-    
-    tree_track_pt.clear();
-    tree_track_eta.clear();
-    tree_track_phi.clear();
-    tree_track_charge.clear();
-    tree_track_NChi2.clear();
-    tree_track_isLoose.clear();
-    tree_track_isTight.clear();
-    tree_track_isHighPurity.clear();
-    tree_track_dxy.clear();
-    tree_track_dxyError.clear();
-    tree_track_drSig.clear();
-    tree_track_dz.clear();
-    tree_track_dzError.clear();
-    tree_track_numberOfLostHits.clear();
-    tree_track_originalAlgo.clear();
-    tree_track_algo.clear();
-    tree_track_stopReason.clear();
-    tree_track_nHit.clear();
-    tree_track_nHitPixel.clear();
-    tree_track_nHitTIB.clear();
-    tree_track_nHitTID.clear();
-    tree_track_nHitTOB.clear();
-    tree_track_nHitTEC.clear();
-    tree_track_nHitPXB.clear();
-    tree_track_nHitPXF.clear();
-    tree_track_isHitPixel.clear();
-    tree_track_nLayers.clear();
-    tree_track_nLayersPixel.clear();
-    tree_track_stripTECLayersWithMeasurement .clear();
-    tree_track_stripTIBLayersWithMeasurement.clear();
-    tree_track_stripTIDLayersWithMeasurement.clear();
-    tree_track_stripTOBLayersWithMeasurement.clear();
-    tree_track_x.clear();
-    tree_track_y.clear();
-    tree_track_z.clear();
-    tree_track_firstHit.clear();
-    tree_track_firstHit_x.clear();
-    tree_track_firstHit_y.clear();
-    tree_track_firstHit_z.clear();
-    tree_track_region.clear();
-    tree_track_iJet.clear();
-    tree_track_ntrk10.clear();
-    tree_track_ntrk20.clear();
-    tree_track_ntrk30.clear();
-    tree_track_MVAval.clear();
-    
-    tree_track_Hemi.clear();
-    tree_track_Hemi_dR.clear();
-    tree_track_Hemi_mva_NChi2.clear();
-    tree_track_Hemi_LLP.clear();
-    
-    tree_track_sim_LLP.clear();
-    tree_track_sim_isFromB.clear();
-    tree_track_sim_isFromC.clear();
-    tree_track_sim_pt.clear();
-    tree_track_sim_eta.clear();
-    tree_track_sim_phi.clear();
-    tree_track_sim_charge.clear();
-    tree_track_sim_pdgId.clear();
-    tree_track_sim_mass.clear();
-    tree_track_sim_x.clear();
-    tree_track_sim_y.clear();
-    tree_track_sim_z.clear();
-//$$
-    tree_track_sim_dFirstGen.clear();
-//$$
-
-    tree_genParticle_pt.clear();
-    tree_genParticle_eta.clear();
-    tree_genParticle_phi.clear();
-    tree_genParticle_charge.clear();
-    tree_genParticle_pdgId.clear();
-    tree_genParticle_mass.clear();
-    tree_genParticle_x.clear();
-    tree_genParticle_y.clear();
-    tree_genParticle_z.clear();
-    tree_genParticle_statusCode.clear();
-    tree_genParticle_mother_pdgId.clear();
-    tree_genParticle_LLP.clear();
-
-    tree_genPackPart_pt.clear();
-    tree_genPackPart_eta.clear();
-    tree_genPackPart_phi.clear();
-    tree_genPackPart_charge.clear();
-    tree_genPackPart_pdgId.clear();
-    tree_genPackPart_mass.clear();
-    tree_genPackPart_mother_pdgId.clear();
-
-    tree_genFromLLP_LLP.clear();
-    tree_genFromLLP_pt.clear();
-    tree_genFromLLP_eta.clear();
-    tree_genFromLLP_phi.clear();
-    tree_genFromLLP_charge.clear();
-    tree_genFromLLP_pdgId.clear();
-    tree_genFromLLP_mass.clear();
-    tree_genFromLLP_x.clear();
-    tree_genFromLLP_y.clear();
-    tree_genFromLLP_z.clear();
-    tree_genFromLLP_mother_pdgId.clear();
-    tree_genFromLLP_isFromB.clear();
-    tree_genFromLLP_isFromC.clear();
-
-    tree_genAxis_dRneuneu.clear();
-
-    tree_genFromC_pt.clear();
-    tree_genFromC_eta.clear();
-    tree_genFromC_phi.clear();
-    tree_genFromC_charge.clear();
-    tree_genFromC_pdgId.clear();
-    tree_genFromC_x.clear();
-    tree_genFromC_y.clear();
-    tree_genFromC_z.clear();
-    tree_genFromC_mother_pdgId.clear();
-    tree_genFromC_generation.clear();
-    tree_genFromC_LLP.clear();
-
-    tree_genFromB_pt.clear();
-    tree_genFromB_eta.clear();
-    tree_genFromB_phi.clear();
-    tree_genFromB_charge.clear();
-    tree_genFromB_pdgId.clear();
-    tree_genFromB_x.clear();
-    tree_genFromB_y.clear();
-    tree_genFromB_z.clear();
-    tree_genFromB_mother_pdgId.clear();
-    tree_genFromB_generation.clear();
-    tree_genFromB_LLP.clear();
-
-    tree_genJet_pt.clear();
-    tree_genJet_eta.clear();
-    tree_genJet_phi.clear();
-    tree_genJet_mass.clear();
-    tree_genJet_energy.clear();
-    
-    tree_LLP.clear();
-    tree_LLP_pt.clear();
-    tree_LLP_eta.clear();
-    tree_LLP_phi.clear();
-    tree_LLP_x.clear();
-    tree_LLP_y.clear();
-    tree_LLP_z.clear();
-    tree_LLP_dist.clear();
-    tree_LLP_nTrks.clear();
-    tree_LLP_Vtx_NChi2.clear();
-    tree_LLP_Vtx_nTrks.clear();
-    tree_LLP_Vtx_dx.clear();
-    tree_LLP_Vtx_dy.clear();
-    tree_LLP_Vtx_dz.clear();
-    tree_LLP_Vtx_dist.clear();
-    tree_LLP_Vtx_dd.clear();
-    tree_LLP_Vtx_trackWeight.clear();
-
-    tree_Hemi.clear();
-    tree_Hemi_njet.clear();
-    tree_Hemi_eta.clear();
-    tree_Hemi_phi.clear();
-    tree_Hemi_dR.clear();
-    tree_Hemi_nTrks.clear();
-    tree_Hemi_nTrks_sig.clear();
-    tree_Hemi_nTrks_bad.clear();
-    tree_Hemi_nTrks_mva.clear();
-    tree_Hemi_nTrks_mva_sig.clear();
-    tree_Hemi_nTrks_mva_bad.clear();
-    tree_Hemi_LLP.clear();
-    tree_Hemi_LLP_pt.clear();
-    tree_Hemi_LLP_eta.clear();
-    tree_Hemi_LLP_phi.clear();
-    tree_Hemi_LLP_dist.clear();
-    tree_Hemi_LLP_x.clear();
-    tree_Hemi_LLP_y.clear();
-    tree_Hemi_LLP_z.clear();
-    tree_Hemi_Vtx_NChi2.clear();
-    tree_Hemi_Vtx_nTrks.clear();
-    tree_Hemi_Vtx_x.clear();
-    tree_Hemi_Vtx_y.clear();
-    tree_Hemi_Vtx_z.clear();
-    tree_Hemi_Vtx_dist.clear();
-    tree_Hemi_Vtx_dx.clear();
-    tree_Hemi_Vtx_dy.clear();
-    tree_Hemi_Vtx_dz.clear();
-    tree_Hemi_Vtx_dd.clear();
-    tree_Hemi_Vtx_trackWeight.clear();
-    tree_Hemi_dR12.clear();
-    tree_Hemi_LLP_dR12.clear();
-}
-
+DEFINE_FWK_MODULE(FlyingTopProducer);
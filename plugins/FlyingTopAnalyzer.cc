@@ -0,0 +1,350 @@
+// system include files
+#include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <fstream>
+
+// user include files
+#include "TTree.h"
+#include "TBranch.h"
+
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/one/EDAnalyzer.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "CommonTools/UtilAlgos/interface/TFileService.h"
+
+#include "../interface/FlyingTopEvent.h"
+#include "../interface/FlyingTopTiming.h"
+#include "../interface/FlyingTopParquet.h"
+#include "../interface/FlyingTopRNTuple.h"
+
+
+//
+// class declaration
+//
+
+// Writes the FlyingTopEvent put in the event by FlyingTopProducer to the ttree.
+// This is the only part of the ntupling that touches TFileService, so it is the only one that
+// has to run one event at a time.
+// With timing = True the time of smalltree->Fill() is summarized at the end of the job, with timingTree = True
+// the stage times and counters of FlyingTopProducer (run with timing = True) go to a second TTree, timing.
+// Only the branch groups in branchGroups (all if empty, see ../interface/FlyingTopBranches.h) are written,
+// the size of each of them in the ttree is printed at the end of the job.
+// With parquetFile set, the Track (with TrackSim when it is booked) and Hemi groups are also written as flat tables
+// (one row per track or hemisphere) to <parquetFile>_tracks.parquet and <parquetFile>_hemis.parquet,
+// see ../interface/FlyingTopParquet.h.
+// With backend = rntuple or both, the same branches are also (or only) written to an RNTuple in its own file, with
+// collections for the tracks, jets, muons, Hemi and LLP, see ../interface/FlyingTopRNTuple.h; with both, the end of
+// the job compares the write time, the size and the time to read back the readBack columns of the two.
+
+class FlyingTopAnalyzer : public edm::one::EDAnalyzer<edm::one::SharedResources>  {
+  public:
+    explicit FlyingTopAnalyzer(const edm::ParameterSet&);
+    ~FlyingTopAnalyzer() {}
+
+    static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+  private:
+    virtual void analyze(const edm::Event&, const edm::EventSetup&) override;
+    virtual void endJob() override;
+
+    // the std::vector branches read the object their address points to, the others the value at their address
+    template <class T> static TBranch* BookBranch(TTree* tree, const char* name, std::vector<T>** address) {return tree->Branch(name, address);}
+    static TBranch* BookBranch(TTree* tree, const char* name, int** address)   {return tree->Branch(name, *address, (std::string(name)+"/I").c_str());}
+    static TBranch* BookBranch(TTree* tree, const char* name, float** address) {return tree->Branch(name, *address, (std::string(name)+"/F").c_str());}
+    static TBranch* BookBranch(TTree* tree, const char* name, bool** address)  {return tree->Branch(name, *address, (std::string(name)+"/O").c_str());}
+
+    // for each event the std::vector branches are pointed to the columns of the product and the other values are copied
+    template <class T> static void PointBranch(std::vector<T>*& address, std::vector<T>&, const std::vector<T>& column)
+      {address = const_cast<std::vector<T>*>(&column);}
+    template <class T> static void PointBranch(T*&, T& value, const T& column) {value = column;}
+
+    // points a std::vector<float> branch back to its member of event_, to read it
+    static std::vector<float>* ReadAddress(TBranch* branch, std::vector<float>*& address, std::vector<float>& member)
+      {
+        address = &member;
+        if ( branch ) branch->SetAddress(&address);
+        return &member;
+      }
+    template <class T> static std::vector<float>* ReadAddress(TBranch*, T*&, T&) {return nullptr;}
+
+    static void parquetSummary(FlyingTopParquetTable& table);
+    void compareBackends();
+
+    // ----------member data ---------------------------
+
+    edm::EDGetTokenT<FlyingTopEvent> eventToken_;
+
+    TTree *smalltree = nullptr;
+    edm::Service<TFileService> fs;
+
+    FlyingTopEvent event_; // the branches point to its members, but for the std::vector ones from analyze()
+#define FLYINGTOP_DECLARE_ADDRESS(group, type, name) type* name = nullptr;
+    struct Addresses { FLYINGTOP_BRANCHES(FLYINGTOP_DECLARE_ADDRESS) };
+#undef FLYINGTOP_DECLARE_ADDRESS
+    Addresses address_;    // address of each branch: a member of event_, or in analyze() a column of the product
+    std::vector<std::vector<TBranch*> > groupBranches_; // branches of each group, empty if the group is not written
+
+    // Parquet tables of the tracks and of the hemispheres
+    std::unique_ptr<FlyingTopParquetTable> trackTable_, hemiTable_;
+
+    // RNTuple backend
+    std::unique_ptr<FlyingTopRNTupleWriter> rntuple_;
+    std::vector<std::string> readBack_;  // std::vector<float> branches read back at the end of the job
+
+    // timing of the ntupling
+    bool timing_, timingTree_;
+    edm::EDGetTokenT<FlyingTopTiming> timingToken_;
+    TTree *timingtree = nullptr;
+    std::vector<float> stageTime_;  // (ms) stages of FlyingTopProducer, then smalltree->Fill()
+    std::vector<int>   stageCount_;
+    long   nFill_ = 0;
+    double fillTime_ = 0.;          // (s)
+};
+
+
+//
+// constructors and destructor
+//
+FlyingTopAnalyzer::FlyingTopAnalyzer(const edm::ParameterSet& iConfig):
+    eventToken_( consumes<FlyingTopEvent>( iConfig.getParameter<edm::InputTag>("src") ) ),
+    timing_(     iConfig.getUntrackedParameter<bool>("timing", false) ),
+    timingTree_( iConfig.getUntrackedParameter<bool>("timingTree", false) )
+{
+   //now do what ever initialization is needed
+    usesResource("TFileService");
+
+    if ( timingTree_ ) {
+      timingToken_ = consumes<FlyingTopTiming>( iConfig.getParameter<edm::InputTag>("src") );
+      stageTime_.assign(FlyingTopTiming::kNStages+1, 0.);
+      stageCount_.assign(FlyingTopTiming::kNCounters, 0);
+      timingtree = fs->make<TTree>("timing", "timing");
+      for (int i=0; i<FlyingTopTiming::kNStages; i++) {
+        std::string name = std::string("time_") + FlyingTopTiming::StageName(i);
+        timingtree->Branch(name.c_str(), &stageTime_[i], (name+"/F").c_str());
+      }
+      timingtree->Branch("time_Fill", &stageTime_[FlyingTopTiming::kNStages], "time_Fill/F");
+      for (int i=0; i<FlyingTopTiming::kNCounters; i++) {
+        std::string name = std::string("count_") + FlyingTopTiming::CounterName(i);
+        timingtree->Branch(name.c_str(), &stageCount_[i], (name+"/I").c_str());
+      }
+    }
+    
+    std::string backend = iConfig.getUntrackedParameter<std::string>("backend", "ttree");
+    if ( backend != "ttree" && backend != "rntuple" && backend != "both" )
+      throw cms::Exception("Configuration") << "backend must be ttree, rntuple or both, not " << backend;
+
+    std::vector<std::string> groups = iConfig.getUntrackedParameter<std::vector<std::string> >("branchGroups", std::vector<std::string>());
+    std::vector<bool> book(FlyingTopBranches::NGroups, groups.empty());
+    for (const auto& name : groups) {
+      int group = FlyingTopBranches::GroupIndex(name);
+      if ( group < 0 ) throw cms::Exception("Configuration") << "unknown branch group " << name;
+      book[group] = true;
+    }
+
+    // one branch per member of FlyingTopEvent in the booked groups, in the order of the registry
+    groupBranches_.resize(FlyingTopBranches::NGroups);
+    if ( backend != "rntuple" ) {
+      smalltree = fs->make<TTree>("ttree", "ttree");
+#define FLYINGTOP_BOOK_BRANCH(group, type, name) \
+      address_.name = &event_.name; \
+      if ( book[FlyingTopBranches::group] ) groupBranches_[FlyingTopBranches::group].push_back( BookBranch(smalltree, #name, &address_.name) );
+      FLYINGTOP_BRANCHES(FLYINGTOP_BOOK_BRANCH)
+#undef FLYINGTOP_BOOK_BRANCH
+    }
+
+    if ( backend != "ttree" ) {
+      rntuple_ = std::make_unique<FlyingTopRNTupleWriter>( iConfig.getUntrackedParameter<std::string>("rntupleFile", "FlyingTop_rntuple.root"), book,
+                                                           1024 * iConfig.getUntrackedParameter<unsigned int>("rntuplePageSize", 1024),           // kB
+                                                           1024 * 1024 * iConfig.getUntrackedParameter<unsigned int>("rntupleClusterSize", 200) ); // MB
+      readBack_ = iConfig.getUntrackedParameter<std::vector<std::string> >("readBack", std::vector<std::string>());
+    }
+
+    std::string parquetFile = iConfig.getUntrackedParameter<std::string>("parquetFile", "");
+    if ( !parquetFile.empty() ) {
+      long batchRows = iConfig.getUntrackedParameter<unsigned int>("parquetBatchRows", 100000);
+      unsigned int maxPending = iConfig.getUntrackedParameter<unsigned int>("parquetMaxPending", 4);
+      // the per track truth (and BDT label tree_track_sim_LLP) on the rows of the tracks
+      std::vector<int> trackGroups = {FlyingTopBranches::Track};
+      if ( book[FlyingTopBranches::TrackSim] ) trackGroups.push_back(FlyingTopBranches::TrackSim);
+      if ( book[FlyingTopBranches::Track] )
+        trackTable_ = std::make_unique<FlyingTopParquetTable>(parquetFile + "_tracks.parquet", trackGroups, batchRows, maxPending);
+      if ( book[FlyingTopBranches::Hemi] )
+        hemiTable_  = std::make_unique<FlyingTopParquetTable>(parquetFile + "_hemis.parquet", std::vector<int>{FlyingTopBranches::Hemi}, batchRows, maxPending);
+    }
+}
+
+
+//
+// member functions
+//
+
+// ------------ method called for each event  ------------
+void FlyingTopAnalyzer::analyze(const edm::Event& iEvent, const edm::EventSetup& iSetup)
+{
+  edm::Handle<FlyingTopEvent> ntuple;
+  iEvent.getByToken(eventToken_, ntuple);
+
+  if ( trackTable_ ) trackTable_->Fill(*ntuple);
+  if ( hemiTable_ )  hemiTable_->Fill(*ntuple);
+  if ( rntuple_ )    rntuple_->Fill(*ntuple);
+  if ( !smalltree ) return;
+
+  // the ttree reads the columns of the product, not a copy of them (TBranchElement follows the new addresses in Fill())
+#define FLYINGTOP_POINT_BRANCH(group, type, name) PointBranch(address_.name, event_.name, ntuple->name);
+  FLYINGTOP_BRANCHES(FLYINGTOP_POINT_BRANCH)
+#undef FLYINGTOP_POINT_BRANCH
+  if ( !timing_ && !timingTree_ && !rntuple_ ) {
+    smalltree->Fill();
+    return;
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  smalltree->Fill();
+  double fillTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  nFill_++;
+  fillTime_ += fillTime;
+
+  if ( timingTree_ ) {
+    edm::Handle<FlyingTopTiming> timing;
+    iEvent.getByToken(timingToken_, timing);
+    if ( timing.isValid() ) {
+      for (int i=0; i<FlyingTopTiming::kNStages; i++)   stageTime_[i]  = timing->time[i];
+      for (int i=0; i<FlyingTopTiming::kNCounters; i++) stageCount_[i] = timing->count[i];
+      stageTime_[FlyingTopTiming::kNStages] = 1.e3 * fillTime;
+      timingtree->Fill();
+    }
+  }
+}
+
+
+// ------------ method called once each job just after ending the event loop  ------------
+void FlyingTopAnalyzer::endJob()
+{
+  if ( nFill_ > 0 )
+    std::cout << " FlyingTopAnalyzer: " << nFill_ << " events, smalltree->Fill() " << 1.e3 * fillTime_ / nFill_ << " ms per event" << std::endl;
+  if ( trackTable_ ) parquetSummary(*trackTable_);
+  if ( hemiTable_ )  parquetSummary(*hemiTable_);
+  if ( rntuple_ )    compareBackends();
+
+  // size of each branch group, what leaving it out of branchGroups saves
+  if ( !smalltree || smalltree->GetEntries() == 0 ) return;
+  Long64_t nEntries = smalltree->GetEntries();
+  smalltree->FlushBaskets();
+  double totBytes = 0., zipBytes = 0.;
+  for (const auto& branches : groupBranches_)
+    for (TBranch* branch : branches) {
+      totBytes += branch->GetTotBytes();
+      zipBytes += branch->GetZipBytes();
+    }
+  std::cout << " FlyingTopAnalyzer ttree size: " << nEntries << " events, " << zipBytes / 1024. / nEntries << " kB per event compressed ("
+            << totBytes / 1024. / nEntries << " kB uncompressed)" << std::endl;
+  for (int i=0; i<FlyingTopBranches::NGroups; i++) {
+    std::cout << "   " << FlyingTopBranches::GroupName(i) << ": ";
+    if ( groupBranches_[i].empty() ) {
+      std::cout << "not written" << std::endl;
+      continue;
+    }
+    double groupTot = 0., groupZip = 0.;
+    for (TBranch* branch : groupBranches_[i]) {
+      groupTot += branch->GetTotBytes();
+      groupZip += branch->GetZipBytes();
+    }
+    std::cout << groupBranches_[i].size() << " branches, " << groupZip / 1024. / nEntries << " kB per event compressed ("
+              << 100. * groupZip / zipBytes << " %), " << groupTot / 1024. / nEntries << " kB uncompressed" << std::endl;
+  }
+}
+
+
+// ------------ closes a Parquet table and prints its size and write time  ------------
+void FlyingTopAnalyzer::parquetSummary(FlyingTopParquetTable& table)
+{
+  table.Close();
+  long nEvents = table.Events();
+  if ( nEvents == 0 ) return;
+  std::ifstream file(table.File(), std::ios::binary | std::ios::ate);
+  double bytes = file.tellg();
+  std::cout << " FlyingTopAnalyzer Parquet " << table.File() << ": " << nEvents << " events, " << table.RowCount() << " rows in "
+            << table.RowGroups() << " row groups, " << bytes / 1024. / nEvents << " kB per event" << std::endl;
+  std::cout << "   Fill() " << 1.e3 * table.FillSeconds() / nEvents << " ms per event on the event thread, writing "
+            << 1.e3 * table.WriteSeconds() / nEvents << " ms per event in the background" << std::endl;
+  if ( table.Stalls() > 0 )
+    std::cout << "   the writing queue was full " << table.Stalls() << " times, Fill() waited " << 1.e3 * table.StallSeconds() / nEvents
+              << " ms per event for it (raise parquetMaxPending or parquetBatchRows)" << std::endl;
+  for (const auto& column : table.Mismatches())
+    std::cout << "   " << column.first << ": null in " << column.second << " events (not one value per row)" << std::endl;
+}
+
+
+// ------------ RNTuple vs ttree: write time, size and time to read back the readBack columns  ------------
+void FlyingTopAnalyzer::compareBackends()
+{
+  rntuple_->Close();
+  long nEntries = rntuple_->Entries();
+  if ( nEntries == 0 ) return;
+  std::ifstream file(rntuple_->File(), std::ios::binary | std::ios::ate);
+  double rntupleBytes = file.tellg();
+  std::cout << " FlyingTopAnalyzer RNTuple " << rntuple_->File() << ": " << nEntries << " events, Fill() " << 1.e3 * rntuple_->FillSeconds() / nEntries
+            << " ms per event, " << rntupleBytes / 1024. / nEntries << " kB per event" << std::endl;
+  for (const auto& column : rntuple_->Mismatches())
+    std::cout << "   " << column.first << ": 0 in " << column.second << " events (not one value per object of its collection)" << std::endl;
+
+  if ( smalltree ) {
+    smalltree->FlushBaskets();
+    double ttreeBytes = 0.;
+    for (const auto& branches : groupBranches_)
+      for (TBranch* branch : branches) ttreeBytes += branch->GetZipBytes();
+    std::cout << "   ttree: Fill() " << 1.e3 * fillTime_ / nFill_ << " ms per event, " << ttreeBytes / 1024. / nEntries << " kB per event" << std::endl;
+  }
+
+  // read throughput in millions of values per second, and the sum of the values read from each backend
+  for (const auto& name : readBack_) {
+    long nValues = 0;
+    double rntupleTime = rntuple_->ReadColumn(name, nValues);
+    if ( nValues < 0 ) {
+      std::cout << "   " << name << ": not written, not read back" << std::endl;
+      continue;
+    }
+    std::cout << "   " << name << ": RNTuple " << 1.e-6 * nValues / rntupleTime << " M values/s";
+    TBranch* branch = smalltree ? smalltree->GetBranch(name.c_str()) : nullptr;
+    std::vector<float>* column = nullptr;
+#define FLYINGTOP_READ_ADDRESS(group, type, branchName) if ( name == #branchName ) column = ReadAddress(branch, address_.branchName, event_.branchName);
+    FLYINGTOP_BRANCHES(FLYINGTOP_READ_ADDRESS)
+#undef FLYINGTOP_READ_ADDRESS
+    if ( branch && column ) {
+      // the branch reads into its FlyingTopEvent member, the product it pointed to is gone
+      long nTreeValues = 0;
+      double sum = 0.;
+      auto t0 = std::chrono::steady_clock::now();
+      for (Long64_t i=0; i<smalltree->GetEntries(); i++) {
+        branch->GetEntry(i);
+        for (float value : *column) sum += value;
+        nTreeValues += column->size();
+      }
+      double ttreeTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+      std::cout << ", ttree " << 1.e-6 * nTreeValues / ttreeTime << " M values/s";
+      if ( nTreeValues != nValues || sum != rntuple_->LastChecksum() ) std::cout << ", DIFFERENT values (" << nTreeValues << " in the ttree)";
+    }
+    std::cout << " (" << nValues << " values)" << std::endl;
+  }
+}
+
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+FlyingTopAnalyzer::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(FlyingTopAnalyzer);
@@ -0,0 +1,156 @@
+// system include files
+#include <memory>
+#include <cmath>
+#include <string>
+#include <atomic>
+#include <iostream>
+
+// user include files
+#include "TLorentzVector.h"
+
+#include "DataFormats/JetReco/interface/Jet.h"
+#include "DataFormats/PatCandidates/interface/Muon.h"
+
+#include "FWCore/Framework/interface/Frameworkfwd.h"
+#include "FWCore/Framework/interface/global/EDFilter.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/MakerMacros.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ParameterSet/interface/ConfigurationDescriptions.h"
+#include "FWCore/ParameterSet/interface/ParameterSetDescription.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "../interface/FlyingTopSelection.h"
+
+
+//
+// class declaration
+//
+
+// Z -> mumu + HT selection of the FlyingTop ntuple, from the muons and jets only, so that it can run
+// in front of FlyingTopProducer in the FlyingTopNtuple path (see ../interface/FlyingTopSelection.h).
+// With mode = reject the events that fail stop the path: FlyingTopProducer and FlyingTopAnalyzer do not
+// run for them. With mode = record all the events go on, and FlyingTopProducer (selection = this module)
+// only fills the event record (event, PV, gen, MET, jets, leptons) of the events that fail, without the
+// track, BDT and vertex stages, so the ttree still has every event for the efficiencies.
+
+class FlyingTopFilter : public edm::global::EDFilter<>  {
+  public:
+    explicit FlyingTopFilter(const edm::ParameterSet&);
+    ~FlyingTopFilter() {}
+
+    static void fillDescriptions(edm::ConfigurationDescriptions& descriptions);
+
+  private:
+    virtual bool filter(edm::StreamID, edm::Event&, const edm::EventSetup&) const override;
+    virtual void endJob() override;
+
+    // ----------member data ---------------------------
+
+    const edm::EDGetTokenT<edm::View<reco::Jet> > jetToken_;
+    const edm::EDGetTokenT<pat::MuonCollection> muonToken_;
+    bool reject_;  // mode = reject, else record
+
+    // thresholds (GeV)
+    const float minMmumu_, minHT_;
+    const float jetPtMin_, jetEtaMax_;
+    const float muonPtMin_, leadingMuonPtMin_;
+
+    // counters of the job
+    mutable std::atomic<long> nEvents_{0}, nZ_{0}, nPass_{0};
+};
+
+
+//
+// constructors and destructor
+//
+FlyingTopFilter::FlyingTopFilter(const edm::ParameterSet& iConfig):
+    jetToken_(  consumes<edm::View<reco::Jet> >( iConfig.getParameter<edm::InputTag>("jets") ) ),
+    muonToken_( consumes<pat::MuonCollection>(   iConfig.getParameter<edm::InputTag>("muons") ) ),
+    minMmumu_(         iConfig.getUntrackedParameter<double>("minMmumu", 60.) ),
+    minHT_(            iConfig.getUntrackedParameter<double>("minHT", 180.) ),
+    jetPtMin_(         iConfig.getUntrackedParameter<double>("jetPtMin", 20.) ),
+    jetEtaMax_(        iConfig.getUntrackedParameter<double>("jetEtaMax", 2.4) ),
+    muonPtMin_(        iConfig.getUntrackedParameter<double>("muonPtMin", 10.) ),
+    leadingMuonPtMin_( iConfig.getUntrackedParameter<double>("leadingMuonPtMin", 28.) )
+{
+    std::string mode = iConfig.getUntrackedParameter<std::string>("mode", "reject");
+    if ( mode != "reject" && mode != "record" )
+      throw cms::Exception("Configuration") << "mode must be reject or record, not " << mode;
+    reject_ = ( mode == "reject" );
+    produces<FlyingTopSelection>();
+}
+
+
+//
+// member functions
+//
+
+// ------------ method called for each event  ------------
+bool FlyingTopFilter::filter(edm::StreamID, edm::Event& iEvent, const edm::EventSetup& iSetup) const
+{
+  auto selection = std::make_unique<FlyingTopSelection>();
+
+  edm::Handle<edm::View<reco::Jet> > jets;
+  iEvent.getByToken(jetToken_, jets);
+  for (const auto& jet : *jets) {
+  if ( jet.pt() < jetPtMin_ ) continue;
+    if ( fabs(jet.eta()) < jetEtaMax_ ) selection->HT += jet.pt();
+  }
+
+  // same muon pairing as FlyingTopProducer, with the values it stores as floats
+  edm::Handle<pat::MuonCollection> muons;
+  iEvent.getByToken(muonToken_, muons);
+  float mu_mass = 0.1057;
+  TLorentzVector v1, v2;
+  for (size_t mu=0; mu<muons->size(); mu++) {
+    const pat::Muon& mu1 = (*muons)[mu];
+    float mupt1 = mu1.pt();
+  if ( !mu1.isGlobalMuon() || mupt1 < muonPtMin_ ) continue;
+    v1.SetPtEtaPhiM(mupt1, float(mu1.eta()), float(mu1.phi()), mu_mass);
+    for (size_t mu2=mu+1; mu2<muons->size(); mu2++) {
+      const pat::Muon& mu2nd = (*muons)[mu2];
+      float mupt2 = mu2nd.pt();
+    if ( !mu2nd.isGlobalMuon() || mu1.charge() == mu2nd.charge() ) continue;
+    if ( mupt2 < muonPtMin_ ) continue;
+    if ( mupt1 < leadingMuonPtMin_ && mupt2 < leadingMuonPtMin_ ) continue;
+      v2.SetPtEtaPhiM(mupt2, float(mu2nd.eta()), float(mu2nd.phi()), mu_mass);
+      float mass = (v1 + v2).Mag();
+      if ( mass > selection->Mmumu ) selection->Mmumu = mass;
+    }
+  }
+
+  selection->hasZ = ( selection->Mmumu > minMmumu_ );
+  selection->pass = ( selection->hasZ && selection->HT > minHT_ );
+  nEvents_++;
+  if ( selection->hasZ ) nZ_++;
+  if ( selection->pass ) nPass_++;
+
+  bool pass = selection->pass;
+  iEvent.put(std::move(selection));
+  return pass || !reject_;
+}
+
+
+// ------------ method called once each job just after ending the event loop  ------------
+void FlyingTopFilter::endJob()
+{
+  long nEvents = nEvents_, nZ = nZ_, nPass = nPass_;
+  if ( nEvents == 0 ) return;
+  std::cout << " FlyingTopFilter (" << ( reject_ ? "reject" : "record" ) << "): " << nEvents << " events, " << nZ << " with Mmumu > " << minMmumu_
+            << " (" << 100. * nZ / nEvents << " %), " << nPass << " also with HT > " << minHT_ << " (" << 100. * nPass / nEvents << " %)" << std::endl;
+}
+
+
+// ------------ method fills 'descriptions' with the allowed parameters for the module  ------------
+void
+FlyingTopFilter::fillDescriptions(edm::ConfigurationDescriptions& descriptions) {
+  //The following says we do not know what parameters are allowed so do no validation
+  // Please change this to state exactly what you do use, even if it is no parameters
+  edm::ParameterSetDescription desc;
+  desc.setUnknown();
+  descriptions.addDefault(desc);
+}
+
+//define this as a plug-in
+DEFINE_FWK_MODULE(FlyingTopFilter);
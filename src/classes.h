@@ -0,0 +1,4 @@
+#include "DataFormats/Common/interface/Wrapper.h"
+#include "FlyingTop/FlyingTop/interface/FlyingTopEvent.h"
+#include "FlyingTop/FlyingTop/interface/FlyingTopTiming.h"
+#include "FlyingTop/FlyingTop/interface/FlyingTopSelection.h"
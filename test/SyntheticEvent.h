@@ -0,0 +1,184 @@
+#ifndef FlyingTop_SyntheticEvent_h
+#define FlyingTop_SyntheticEvent_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdint>
+// user include files
+#include "../interface/TrackerSurfaces.h"
+/*---------------*/
+
+// Random event for the benchmarks of the FlyingTop headers, without CMSSW: two LLPs decaying inside the tracker,
+// their charged daughters (the gen particles from LLP decays), tracks from these daughters and prompt tracks from
+// the PV, jets along the LLPs and elsewhere, and two muons. The columns are the ones FlyingTopProducer reads from
+// the AOD collections, with the same units; the first hit of a track is the first surface of the Tracker DataBase
+// (TrackerSurfaces.h) outside its production point.
+// MatchWindow() and MatchCuts() are the nHit dependent windows and cuts of the truth matching of FlyingTopProducer.
+
+class SyntheticEvent {
+   public:
+
+      //Constructor
+      SyntheticEvent(unsigned int seed) : Rng (seed) {}
+
+      //Destructor
+      ~SyntheticEvent(){}
+
+      //-------Main Method--------//
+      //New event with nTracks tracks (at most half of them from the gen particles), nJets jets and nGen gen particles from LLPs
+      void Generate(unsigned int nTracks, unsigned int nJets, unsigned int nGen)
+        {
+          std::uniform_real_distribution<float> u(0., 1.);
+          std::exponential_distribution<float> expo(1.);
+          std::normal_distribution<float> gauss(0., 1.);
+          Clear();
+          GenPVx = 0.001 * gauss(Rng);
+          GenPVy = 0.001 * gauss(Rng);
+          GenPVz = 5. * gauss(Rng);
+
+          // LLP decay vertices, at 1 to 50 cm in the transverse plane
+          float llpEta[2], llpPhi[2], llpX[2], llpY[2], llpZ[2];
+          for (int l=0; l<2; l++)
+            {
+              llpEta[l] = 4. * u(Rng) - 2.;
+              llpPhi[l] = 2. * M_PI * u(Rng) - M_PI;
+              float r = 1. + 49. * u(Rng);
+              llpX[l] = GenPVx + r * std::cos(llpPhi[l]);
+              llpY[l] = GenPVy + r * std::sin(llpPhi[l]);
+              llpZ[l] = GenPVz + r * std::sinh(llpEta[l]);
+            }
+
+          // charged daughters, phi0 being their phi at the PV
+          for (unsigned int k=0; k<nGen; k++)
+            {
+              int l = k % 2;
+              gen_LLP.push_back(l);
+              gen_charge.push_back( u(Rng) < 0.5 ? 1 : -1 );
+              gen_pt.push_back( 0.5 + 5. * expo(Rng) );
+              gen_eta.push_back( llpEta[l] + 0.5 * gauss(Rng) );
+              gen_phi.push_back( Wrap( llpPhi[l] + 0.5 * gauss(Rng) ) );
+              gen_x.push_back(llpX[l]);
+              gen_y.push_back(llpY[l]);
+              gen_z.push_back(llpZ[l]);
+              float qR = gen_charge[k] * gen_pt[k] * 100 / 0.3 / 3.8;
+              gen_phi0.push_back( std::atan2( qR * std::sin(gen_phi[k]) + (gen_x[k] - GenPVx), qR * std::cos(gen_phi[k]) - (gen_y[k] - GenPVy) ) );
+            }
+
+          // tracks: the daughters, measured, then prompt tracks
+          for (unsigned int i=0; i<nTracks; i++)
+            {
+              const bool fromGen = ( i < nGen && i < nTracks / 2 );
+              int   charge = ( u(Rng) < 0.5 ) ? 1 : -1;
+              float pt = 0.5 + 2. * expo(Rng), eta = 5. * u(Rng) - 2.5, phi = 2. * M_PI * u(Rng) - M_PI;
+              float x = GenPVx, y = GenPVy, z = GenPVz;
+              if ( fromGen )
+                {
+                  charge = gen_charge[i];
+                  pt  = gen_pt[i] * ( 1. + 0.02 * gauss(Rng) );
+                  eta = gen_eta[i] + 0.005 * gauss(Rng);
+                  phi = Wrap( gen_phi0[i] + 0.005 * gauss(Rng) );
+                  x = gen_x[i];
+                  y = gen_y[i];
+                  z = gen_z[i];
+                }
+              track_charge.push_back(charge);
+              track_pt.push_back(pt);
+              track_eta.push_back(eta);
+              track_phi.push_back(phi);
+              track_vx.push_back( GenPVx + 0.01 * gauss(Rng) );
+              track_vy.push_back( GenPVy + 0.01 * gauss(Rng) );
+              track_vz.push_back( GenPVz + 0.05 * gauss(Rng) );
+              track_px.push_back( pt * std::cos(phi) );
+              track_py.push_back( pt * std::sin(phi) );
+              track_pz.push_back( pt * std::sinh(eta) );
+              track_firstHit.push_back( FirstSurface(x, y, z, eta) );
+              track_nHit.push_back( 8 + int(17 * u(Rng)) );
+              track_NChi2.push_back( 3. * expo(Rng) );
+              track_drSig.push_back( fromGen ? 5. + 100. * u(Rng) : 2. * expo(Rng) );
+            }
+
+          // jets: along the LLPs, then elsewhere
+          for (unsigned int j=0; j<nJets; j++)
+            {
+              const bool fromLLP = ( j < 2 );
+              jet_pt.push_back( fromLLP ? 50. + 150. * u(Rng) : 20. + 30. * expo(Rng) );
+              jet_eta.push_back( fromLLP ? llpEta[j] + 0.1 * gauss(Rng) : 5. * u(Rng) - 2.5 );
+              jet_phi.push_back( fromLLP ? Wrap( llpPhi[j] + 0.1 * gauss(Rng) ) : 2. * M_PI * u(Rng) - M_PI );
+            }
+
+          // Z -> mumu
+          for (int m=0; m<2; m++)
+            {
+              muon_pt.push_back( 30. + 30. * u(Rng) );
+              muon_eta.push_back( 4. * u(Rng) - 2. );
+              muon_phi.push_back( 2. * M_PI * u(Rng) - M_PI );
+            }
+        }
+
+      //Windows in eta and phi of the truth matching of a track with nHit hits
+      static void MatchWindow(int nHit, float& deta, float& dphi)
+        {
+          deta = 0.02; dphi = 0.02;
+          if      ( nHit <= 10 ) { deta = 0.30; dphi = 0.08; }
+          else if ( nHit <= 13 ) { deta = 0.12; dphi = 0.05; }
+          else if ( nHit <= 17 ) { deta = 0.04; dphi = 0.03; }
+        }
+      //Cuts of the truth matching on the relative pt difference and the eta and phi differences
+      static bool MatchCuts(int nHit, float dpt, float deta, float dphi)
+        {
+          if ( nHit <= 10 ) return std::abs(dpt) < 0.70 && std::abs(deta) < 0.30 && std::abs(dphi) < 0.08;
+          if ( nHit <= 13 ) return std::abs(dpt) < 0.20 && std::abs(deta) < 0.12 && std::abs(dphi) < 0.05;
+          if ( nHit <= 17 ) return std::abs(dpt) < 0.08 && std::abs(deta) < 0.04 && std::abs(dphi) < 0.03;
+          return std::abs(dpt) < 0.07 && std::abs(deta) < 0.02 && std::abs(dphi) < 0.02;
+        }
+
+      // ----------member data ---------------------------
+      float GenPVx = 0., GenPVy = 0., GenPVz = 0.;
+      // tracks, (vx,vy,vz) being their reference point
+      std::vector<float> track_pt, track_eta, track_phi, track_vx, track_vy, track_vz, track_px, track_py, track_pz;
+      std::vector<float> track_NChi2, track_drSig;
+      std::vector<int>   track_charge, track_nHit;
+      std::vector<uint16_t> track_firstHit;
+      // gen particles from LLP decays, (x,y,z) being their production point
+      std::vector<float> gen_pt, gen_eta, gen_phi, gen_phi0, gen_x, gen_y, gen_z;
+      std::vector<int>   gen_charge, gen_LLP;
+      std::vector<float> jet_pt, jet_eta, jet_phi;
+      std::vector<float> muon_pt, muon_eta, muon_phi;
+
+   private:
+      void Clear()
+        {
+          for (auto* column : {&track_pt, &track_eta, &track_phi, &track_vx, &track_vy, &track_vz, &track_px, &track_py, &track_pz,
+                               &track_NChi2, &track_drSig, &gen_pt, &gen_eta, &gen_phi, &gen_phi0, &gen_x, &gen_y, &gen_z,
+                               &jet_pt, &jet_eta, &jet_phi, &muon_pt, &muon_eta, &muon_phi}) column->clear();
+          track_charge.clear();
+          track_nHit.clear();
+          track_firstHit.clear();
+          gen_charge.clear();
+          gen_LLP.clear();
+        }
+
+      //First barrel layer outside the radius of (x,y), or for |eta| > 1.5 first disk beyond |z|, TOB L1 / TEC wheel 7 if none
+      static uint16_t FirstSurface(float x, float y, float z, float eta)
+        {
+          const bool  endcap = ( std::abs(eta) > 1.5 );
+          const float pos = endcap ? std::abs(z) : std::sqrt(x*x + y*y);
+          for (const auto& entry : kTrackerSurfaces)
+            if ( entry.surface.region == ( endcap ? 1 : 0 ) && entry.surface.pos > pos ) return entry.hitPattern;
+          return endcap ? 1848 : 1672;
+        }
+
+      static float Wrap(float phi)
+        {
+          if ( phi >  M_PI ) phi -= 2. * M_PI;
+          if ( phi < -M_PI ) phi += 2. * M_PI;
+          return phi;
+        }
+
+      std::mt19937 Rng;
+};
+
+#endif
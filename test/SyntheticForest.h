@@ -0,0 +1,170 @@
+#ifndef FlyingTop_SyntheticForest_h
+#define FlyingTop_SyntheticForest_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <vector>
+#include <string>
+#include <random>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+/*---------------*/
+
+// Random gradient boosted forest for the tests and benchmarks of ../interface/BDTForest.h.
+// Write() saves it as a TMVA BDTG weights file, with the elements and attributes of MethodBDT::AddWeightsXMLTo
+// that BDTForest and TMVA::Reader read (the trees of a gradient boosted forest are regression trees, AnalysisType 1),
+// and Evaluate() walks its nodes the way TMVA does (DecisionTreeNode::GoesRight, then MethodBDT::GetGradBoostMVA),
+// so both must agree to the last bit.
+// The inputs are the 7 variables of the track BDT of FlyingTopProducer, in its order, with their usual ranges.
+
+class SyntheticForest {
+   public:
+      struct Node {
+        int   ivar = -1;      // input tested, -1 for a leaf
+        float cut = 0.;
+        int   cType = 1;      // 1 : goes right if x >= cut, 0 : goes right if x < cut
+        float res = 0.;       // response, used for the leaves
+        int   left = -1, right = -1;
+      };
+
+      //Constructor
+      //nTrees trees of depth at most maxDepth, a node below the root is split with probability pSplit
+      SyntheticForest(unsigned int nTrees, int maxDepth, unsigned int seed, double pSplit = 0.8) :
+        Rng (seed)
+        {
+          for (unsigned int t=0; t<nTrees; t++) Roots.push_back( AddNode(0, maxDepth, pSplit) );
+        }
+
+      //Destructor
+      ~SyntheticForest(){}
+
+      //-------Main Method--------//
+      //Score of a track, x in the order of Variables()
+      double Evaluate(const float* x) const
+        {
+          double sum = 0.;
+          for (int root : Roots)
+            {
+              int n = root;
+              while ( Nodes[n].left >= 0 ) n = ( (x[Nodes[n].ivar] >= Nodes[n].cut) == (Nodes[n].cType == 1) ) ? Nodes[n].right : Nodes[n].left;
+              sum += Nodes[n].res;
+            }
+          return 2./(1.+exp(-2.*sum)) - 1.;
+        }
+
+      //Random track; each input is set to a cut value of the forest one time in ten, to test the x == cut case
+      void RandomTrack(std::mt19937& rng, float* x) const
+        {
+          std::uniform_real_distribution<float> u(0., 1.);
+          for (unsigned int i=0; i<NInputs; i++)
+            {
+              x[i] = kMin[i] + u(rng) * (kMax[i] - kMin[i]);
+              if ( i == 3 || i == 4 || i == 6 ) x[i] = std::floor(x[i]);  // nhits, ntrk10 and isinjet are integers
+            }
+          if ( u(rng) < 0.1 )
+            {
+              const Node& node = Nodes[ std::uniform_int_distribution<unsigned int>(0, Nodes.size()-1)(rng) ];
+              if ( node.ivar >= 0 ) x[node.ivar] = node.cut;
+            }
+        }
+
+      //Weights file of the forest, false if it cannot be written
+      bool Write(const std::string& fileName) const
+        {
+          std::ofstream out(fileName);
+          out << "<?xml version=\"1.0\"?>\n<MethodSetup Method=\"BDT::BDTG\">\n";
+          out << "  <GeneralInfo>\n    <Info name=\"TMVA Release\" value=\"4.2.1 [262657]\"/>\n"
+              << "    <Info name=\"ROOT Release\" value=\"6.30/07 [400903]\"/>\n"
+              << "    <Info name=\"Creator\" value=\"FlyingTop SyntheticForest\"/>\n"
+              << "    <Info name=\"AnalysisType\" value=\"Classification\"/>\n  </GeneralInfo>\n";
+          out << "  <Options>\n    <Option name=\"NTrees\" modified=\"Yes\">" << Roots.size() << "</Option>\n"
+              << "    <Option name=\"BoostType\" modified=\"Yes\">Grad</Option>\n  </Options>\n";
+          out << "  <Variables NVar=\"" << NInputs << "\">\n";
+          for (unsigned int i=0; i<NInputs; i++)
+            out << "    <Variable VarIndex=\"" << i << "\" Expression=\"" << Variables()[i] << "\" Label=\"" << Variables()[i]
+                << "\" Title=\"" << Variables()[i] << "\" Unit=\"\" Internal=\"" << Variables()[i] << "\" Type=\"F\" Min=\""
+                << Number(kMin[i]) << "\" Max=\"" << Number(kMax[i]) << "\"/>\n";
+          out << "  </Variables>\n  <Spectators NSpec=\"0\"/>\n";
+          out << "  <Classes NClass=\"2\">\n    <Class Name=\"Signal\" Index=\"0\"/>\n    <Class Name=\"Background\" Index=\"1\"/>\n  </Classes>\n";
+          out << "  <Transformations NTransformations=\"0\"/>\n  <MVAPdfs/>\n";
+          out << "  <Weights NTrees=\"" << Roots.size() << "\" AnalysisType=\"1\">\n";
+          for (unsigned int t=0; t<Roots.size(); t++)
+            {
+              out << "    <BinaryTree type=\"DecisionTree\" boostWeight=\"1.0000000000000000e+00\" itree=\"" << t << "\">\n";
+              WriteNode(out, Roots[t], "s", 0);
+              out << "    </BinaryTree>\n";
+            }
+          out << "  </Weights>\n</MethodSetup>\n";
+          return bool(out);
+        }
+
+      //-----Access Data Members------//
+      static const std::vector<std::string>& Variables()
+        {
+          static const std::vector<std::string> names = {
+            "mva_track_pt", "mva_track_eta", "mva_track_nchi2", "mva_track_nhits",
+            "mva_ntrk10", "mva_drSig", "mva_track_isinjet" };
+          return names;
+        }
+      unsigned int NTrees() const {return Roots.size();}
+      unsigned int NNodes() const {return Nodes.size();}
+      const std::vector<Node>& Tree() const {return Nodes;}
+      const std::vector<int>&  TreeRoots() const {return Roots;}
+
+      static constexpr unsigned int NInputs = 7;
+
+   private:
+      int AddNode(int depth, int maxDepth, double pSplit)
+        {
+          std::uniform_real_distribution<float> u(0., 1.);
+          int n = Nodes.size();
+          Nodes.emplace_back();
+          Nodes[n].res = 0.4 * u(Rng) - 0.2;
+          if ( depth == maxDepth || ( depth > 0 && u(Rng) > pSplit ) ) return n;
+          int ivar = std::uniform_int_distribution<int>(0, NInputs-1)(Rng);
+          Nodes[n].ivar  = ivar;
+          Nodes[n].cut   = kMin[ivar] + u(Rng) * (kMax[ivar] - kMin[ivar]);
+          Nodes[n].cType = ( u(Rng) < 0.8 ) ? 1 : 0;
+          int left  = AddNode(depth+1, maxDepth, pSplit);
+          int right = AddNode(depth+1, maxDepth, pSplit);
+          Nodes[n].left  = left;
+          Nodes[n].right = right;
+          return n;
+        }
+
+      void WriteNode(std::ostream& out, int n, const char* pos, int depth) const
+        {
+          const Node& node = Nodes[n];
+          out << std::string(6+2*depth, ' ') << "<Node pos=\"" << pos << "\" depth=\"" << depth << "\" NCoef=\"0\" IVar=\"" << node.ivar
+              << "\" Cut=\"" << Number(node.cut) << "\" cType=\"" << node.cType << "\" res=\"" << Number(node.res)
+              << "\" rms=\"0.0000000000000000e+00\" purity=\"5.0000000000000000e-01\" nType=\"" << ( node.left < 0 ? -99 : 0 ) << "\"";
+          if ( node.left < 0 )
+            {
+              out << "/>\n";
+              return;
+            }
+          out << ">\n";
+          WriteNode(out, node.left,  "l", depth+1);
+          WriteNode(out, node.right, "r", depth+1);
+          out << std::string(6+2*depth, ' ') << "</Node>\n";
+        }
+
+      //9 significant digits, read back as the same float
+      static std::string Number(float value)
+        {
+          char text[32];
+          std::snprintf(text, sizeof(text), "%.9e", value);
+          return text;
+        }
+
+      static constexpr float kMin[NInputs] = { 1.,   -2.5,  0.,  0.,  0.,  0.,   0. };
+      static constexpr float kMax[NInputs] = { 100.,  2.5, 10., 40., 30., 200.,  2. };
+
+      // ----------member data ---------------------------
+      std::mt19937 Rng;
+      std::vector<Node> Nodes;  // all the trees
+      std::vector<int>  Roots;  // first node of each tree
+};
+
+#endif
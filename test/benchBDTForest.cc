@@ -0,0 +1,127 @@
+// Microbenchmark of ../interface/BDTForest.h: time per track of BDTForest::Evaluate, one track at a time and in a
+// batch of columns, against the walk of the same forest through heap allocated nodes with a virtual GoesRight(),
+// the layout of TMVA::DecisionTreeNode. The forest is random, of the size of the TMVA BDTG defaults (800 trees of
+// depth 3, SyntheticForest.h).
+// With a weights file as argument, that forest is used instead and TMVA::Reader::EvaluateMVA is timed too:
+//   benchFlyingTopBDTForest TMVAClassification_BDTG50cm_HighPurity.weights.xml
+
+// system include files
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+
+// user include files
+#include "TMVA/Reader.h"
+
+#include "../interface/BDTForest.h"
+#include "SyntheticForest.h"
+
+// node of a pointer based tree
+class BenchNode {
+   public:
+      virtual ~BenchNode() {}
+      virtual bool GoesRight(const float* x) const {return ( x[Var] >= Cut ) == CutType;}
+      std::unique_ptr<BenchNode> Left, Right;
+      int   Var = 0;
+      float Cut = 0.;
+      bool  CutType = true;
+      float Response = 0.;
+};
+
+static std::unique_ptr<BenchNode> copyNode(const SyntheticForest& forest, int n)
+{
+  const SyntheticForest::Node& node = forest.Tree()[n];
+  auto copy = std::make_unique<BenchNode>();
+  copy->Response = node.res;
+  if ( node.left < 0 ) return copy;
+  copy->Var = node.ivar;
+  copy->Cut = node.cut;
+  copy->CutType = ( node.cType == 1 );
+  copy->Left  = copyNode(forest, node.left);
+  copy->Right = copyNode(forest, node.right);
+  return copy;
+}
+
+static double evaluateNodes(const std::vector<std::unique_ptr<BenchNode> >& trees, const float* x)
+{
+  double sum = 0.;
+  for (const auto& tree : trees) {
+    const BenchNode* node = tree.get();
+    while ( node->Left ) node = node->GoesRight(x) ? node->Right.get() : node->Left.get();
+    sum += node->Response;
+  }
+  return 2./(1.+exp(-2.*sum)) - 1.;
+}
+
+// ns per call of score(x) over the tracks, best of 5 passes
+template <class F> static double timePerTrack(const std::vector<float>& tracks, F score, double& checksum)
+{
+  const unsigned int n = tracks.size() / SyntheticForest::NInputs;
+  double best = 1.e30;
+  for (int pass=0; pass<5; pass++) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned int k=0; k<n; k++) checksum += score(&tracks[k*SyntheticForest::NInputs]);
+    best = std::min( best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n );
+  }
+  return best;
+}
+
+int main(int argc, char** argv)
+{
+  const std::string fileName = ( argc > 1 ) ? argv[1] : "benchBDTForest.weights.xml";
+  SyntheticForest synthetic(800, 3, 2024);
+  if ( argc == 1 ) synthetic.Write(fileName);
+  BDTForest forest(fileName, SyntheticForest::Variables());
+
+  std::mt19937 rng(7);
+  const unsigned int nTracks = 20000;
+  std::vector<float> tracks(nTracks * SyntheticForest::NInputs);
+  for (unsigned int k=0; k<nTracks; k++) synthetic.RandomTrack(rng, &tracks[k*SyntheticForest::NInputs]);
+
+  double checksum = 0.;
+  std::cout << " BDTForest benchmark: " << forest.NTrees() << " trees, " << forest.NNodes() << " nodes, " << nTracks << " tracks" << std::endl;
+  double flat = timePerTrack(tracks, [&](const float* x) {return forest.Evaluate(x);}, checksum);
+  std::cout << "   BDTForest::Evaluate       " << flat << " ns per track" << std::endl;
+
+  // the same tracks as columns, scored in one batch
+  std::vector<std::vector<float> > columns(SyntheticForest::NInputs, std::vector<float>(nTracks));
+  for (unsigned int k=0; k<nTracks; k++)
+    for (unsigned int i=0; i<SyntheticForest::NInputs; i++) columns[i][k] = tracks[k*SyntheticForest::NInputs+i];
+  const float* x[SyntheticForest::NInputs];
+  for (unsigned int i=0; i<SyntheticForest::NInputs; i++) x[i] = columns[i].data();
+  std::vector<double> scores(nTracks);
+  double batch = 1.e30;
+  for (int pass=0; pass<5; pass++) {
+    auto t0 = std::chrono::steady_clock::now();
+    forest.Evaluate(x, nTracks, scores.data());
+    batch = std::min( batch, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / nTracks );
+    checksum += scores[pass];
+  }
+  std::cout << "   batch of " << nTracks << " (" << BDTForest::kLanes << " lanes) " << batch << " ns per track (x " << flat / batch << " faster)" << std::endl;
+
+  if ( argc == 1 ) {
+    std::vector<std::unique_ptr<BenchNode> > trees;
+    for (int root : synthetic.TreeRoots()) trees.push_back( copyNode(synthetic, root) );
+    double nodes = timePerTrack(tracks, [&](const float* x) {return evaluateNodes(trees, x);}, checksum);
+    std::cout << "   linked nodes              " << nodes << " ns per track (x " << nodes / flat << ")" << std::endl;
+    std::remove(fileName.c_str());
+  }
+  else {
+    float in[SyntheticForest::NInputs];
+    TMVA::Reader reader("!Color:Silent");
+    for (unsigned int i=0; i<SyntheticForest::NInputs; i++) reader.AddVariable(SyntheticForest::Variables()[i], &in[i]);
+    reader.BookMVA("BDTG", fileName);
+    double tmva = timePerTrack(tracks, [&](const float* x) {
+        for (unsigned int i=0; i<SyntheticForest::NInputs; i++) in[i] = x[i];
+        return reader.EvaluateMVA("BDTG");
+      }, checksum);
+    std::cout << "   TMVA::Reader::EvaluateMVA " << tmva << " ns per track (x " << tmva / flat << ")" << std::endl;
+  }
+  std::cout << "   (checksum " << checksum << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,81 @@
+// Microbenchmark of ../interface/DeltaFunc.h against the previous Deltar and Deltaphi (double, with branches and
+// TMath, here with std::abs and std::sqrt): ns per pair for one object against 1000 (the track-jet and
+// muon-jet loops) and for a 100 x 1000 matrix, with the scalar functions and with the array forms.
+
+// system include files
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+// user include files
+#include "../interface/DeltaFunc.h"
+
+// the DeltaFunc.h functions before the float kernels
+static double Deltar(double eta1, double phi1, double eta2, double phi2) {
+  double DeltaPhi = std::abs(phi2 - phi1);
+  if (DeltaPhi > 3.141593 ) DeltaPhi = 2.*3.141593 - DeltaPhi;
+  return std::sqrt( (eta2-eta1)*(eta2-eta1) + DeltaPhi*DeltaPhi );
+}
+static double Deltaphi(double phi1, double phi2) {
+  double DeltaPhi = phi1 - phi2;
+  if (std::abs(DeltaPhi) > 3.141593 ) {
+    DeltaPhi = 2.*3.141593 - std::abs(DeltaPhi);
+    DeltaPhi = -DeltaPhi * (phi1 - phi2) / std::abs(phi1 - phi2);
+  }
+  return DeltaPhi;
+}
+
+// ns per pair of pass(r), which computes nPairs values, best of 20 passes
+template <class F> static double timePerPair(long nPairs, F pass)
+{
+  double best = 1.e30;
+  for (int r=0; r<20; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    pass(r);
+    best = std::min( best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / nPairs );
+  }
+  return best;
+}
+
+static void print(const char* what, double ns, double reference)
+{
+  std::cout << "   " << std::left << std::setw(34) << what << std::right << std::setw(8) << std::setprecision(3) << ns << " ns per pair";
+  if ( reference > 0 ) std::cout << ", speedup x " << reference / ns;
+  std::cout << std::endl;
+}
+
+int main()
+{
+  std::mt19937 rng(15);
+  std::uniform_real_distribution<float> u(0., 1.);
+  const unsigned int n = 100, m = 1000;
+  std::vector<float> eta1(n), phi1(n), eta2(m), phi2(m), out(n*m);
+  for (unsigned int i=0; i<n; i++) { eta1[i] = 5. * u(rng) - 2.5; phi1[i] = 2. * M_PI * u(rng) - M_PI; }
+  for (unsigned int j=0; j<m; j++) { eta2[j] = 5. * u(rng) - 2.5; phi2[j] = 2. * M_PI * u(rng) - M_PI; }
+  double checksum = 0.;
+
+  std::cout << " DeltaFunc benchmark: one against " << m << std::endl;
+  double oldDr = timePerPair(m, [&](int r) { for (unsigned int j=0; j<m; j++) out[j] = Deltar(eta1[r], phi1[r], eta2[j], phi2[j]); checksum += out[m/2]; });
+  print("Deltar (previous)", oldDr, 0.);
+  print("DeltaR2 scalar", timePerPair(m, [&](int r) { for (unsigned int j=0; j<m; j++) out[j] = DeltaR2(eta1[r], phi1[r], eta2[j], phi2[j]); checksum += out[m/2]; }), oldDr);
+  print("DeltaR2 one against n", timePerPair(m, [&](int r) { DeltaR2(eta1[r], phi1[r], m, eta2.data(), phi2.data(), out.data()); checksum += out[m/2]; }), oldDr);
+  double oldDphi = timePerPair(m, [&](int r) { for (unsigned int j=0; j<m; j++) out[j] = Deltaphi(phi1[r], phi2[j]); checksum += out[m/2]; });
+  print("Deltaphi (previous)", oldDphi, 0.);
+  print("DeltaPhi scalar", timePerPair(m, [&](int r) { for (unsigned int j=0; j<m; j++) out[j] = DeltaPhi(phi1[r], phi2[j]); checksum += out[m/2]; }), oldDphi);
+  print("DeltaPhi one against n", timePerPair(m, [&](int r) { DeltaPhi(phi1[r], m, phi2.data(), out.data()); checksum += out[m/2]; }), oldDphi);
+  print("FirstWithin, DeltaR < 0.01", timePerPair(m, [&](int r) { checksum += FirstWithin(eta1[r], phi1[r], m, eta2.data(), phi2.data(), 1.e-4f); }), oldDr);
+
+  std::cout << " DeltaFunc benchmark: " << n << " x " << m << " matrix" << std::endl;
+  double oldMatrix = timePerPair(n*m, [&](int r) {
+      for (unsigned int i=0; i<n; i++) for (unsigned int j=0; j<m; j++) out[i*m+j] = Deltar(eta1[i], phi1[i], eta2[j], phi2[j]);
+      checksum += out[n*m/2+r];
+    });
+  print("Deltar (previous)", oldMatrix, 0.);
+  print("DeltaR2 n x m", timePerPair(n*m, [&](int r) { DeltaR2(n, eta1.data(), phi1.data(), m, eta2.data(), phi2.data(), out.data()); checksum += out[n*m/2+r]; }), oldMatrix);
+
+  std::cout << "   (checksum " << checksum << ")" << std::endl;
+  return 0;
+}
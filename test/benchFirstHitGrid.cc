@@ -0,0 +1,66 @@
+// Benchmark of ../interface/FirstHitGrid.h: time per event of the ntrk10/20/30 counting of all the preselected
+// tracks with the grid (filling included) and with the loop over all the pairs it replaced, for 100 to 5000 tracks
+// spread over the tracker, to find where the grid starts to pay off.
+
+// system include files
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+// user include files
+#include "../interface/FirstHitGrid.h"
+
+// ms per call of count(), best of the repeats
+template <class F> static double timeEvent(int repeat, F count)
+{
+  double best = 1.e30;
+  for (int r=0; r<repeat; r++) {
+    auto t0 = std::chrono::steady_clock::now();
+    count();
+    best = std::min( best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() );
+  }
+  return best;
+}
+
+int main()
+{
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> u(0., 1.);
+  const float r2[3] = { 10.*10., 20.*20., 30.*30. };
+  FirstHitGrid grid(30.);
+  long checksum = 0;
+
+  std::cout << " FirstHitGrid benchmark: ms per event to count the neighbours of all the tracks" << std::endl;
+  std::cout << std::setw(8) << "tracks" << std::setw(12) << "pair loop" << std::setw(12) << "grid" << std::setw(10) << "ratio" << std::endl;
+  for (unsigned int n : {100u, 200u, 500u, 1000u, 2000u, 5000u}) {
+    std::vector<float> x(n), y(n), z(n);
+    for (unsigned int i=0; i<n; i++) {
+      x[i] = 120. * u(rng) - 60.;
+      y[i] = 120. * u(rng) - 60.;
+      z[i] = 400. * u(rng) - 200.;
+    }
+    const int repeat = n > 1000 ? 3 : 20;
+    double loop = timeEvent(repeat, [&]() {
+        for (unsigned int i=0; i<n; i++)
+          for (unsigned int j=0; j<n; j++) {
+          if ( j == i ) continue;
+            float dist = std::sqrt( double( (x[i]-x[j])*(x[i]-x[j]) + (y[i]-y[j])*(y[i]-y[j]) + (z[i]-z[j])*(z[i]-z[j]) ) );
+            checksum += ( dist < 10. ) + ( dist < 20. ) + ( dist < 30. );
+          }
+      });
+    double cells = timeEvent(repeat, [&]() {
+        grid.Fill( n, x.data(), y.data(), z.data() );
+        for (unsigned int i=0; i<n; i++) {
+          int count[3];
+          grid.Count(i, 3, r2, count);
+          checksum += count[0] + count[1] + count[2];
+        }
+      });
+    std::cout << std::setw(8) << n << std::setw(12) << loop << std::setw(12) << cells << std::setw(10) << loop / cells << std::endl;
+  }
+  std::cout << "   (checksum " << checksum << ")" << std::endl;
+  return 0;
+}
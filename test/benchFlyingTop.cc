@@ -0,0 +1,216 @@
+// Benchmark of the per event kernels of FlyingTopProducer on synthetic events (SyntheticEvent.h), without CMSSW:
+// the first hit propagation (HelixPropagator, the PropaHitPattern propagation needs the CMSSW field and propagator),
+// the track-jet association and the truth matching (EtaPhiGrid), the hemisphere axes (HemisphereAxes), the
+// ntrk10/20/30 counting (FirstHitGrid) and the BDT scoring of the preselected tracks (BDTForest, when ROOT is there
+// to read the weights; a random forest of the size of the BDTG is used without a weights file).
+// Gives the time of each kernel per track (per event for the axes) and the events/s of all of them:
+//   benchFlyingTop [--tracks 1000] [--jets 10] [--gen 100] [--events 2000] [--weights TMVAClassification_BDTG.weights.xml]
+
+// system include files
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+// user include files
+#if __has_include(<TXMLEngine.h>)
+#define FLYINGTOP_BDT
+#endif
+
+#include "../interface/StageTimer.h"
+#include "../interface/HelixPropagator.h"
+#include "../interface/EtaPhiGrid.h"
+#include "../interface/HemisphereAxes.h"
+#include "../interface/FirstHitGrid.h"
+#ifdef FLYINGTOP_BDT
+#include "../interface/BDTForest.h"
+#endif
+#include "SyntheticEvent.h"
+#include "SyntheticForest.h"
+
+enum Stage { kFirstHit, kJetAssociation, kTruthMatch, kAxes, kNeighbours, kBDT, kNStages };
+enum Counter { kTracks, kPreselected, kMatched, kNCounters };
+
+int main(int argc, char** argv)
+{
+  unsigned int nTracks = 1000, nJets = 10, nGen = 100, nEvents = 2000;
+  std::string weights;
+  for (int i=1; i+1<argc; i+=2) {
+    const std::string option = argv[i];
+    if      ( option == "--tracks" )  nTracks = std::atoi(argv[i+1]);
+    else if ( option == "--jets" )    nJets   = std::atoi(argv[i+1]);
+    else if ( option == "--gen" )     nGen    = std::atoi(argv[i+1]);
+    else if ( option == "--events" )  nEvents = std::atoi(argv[i+1]);
+    else if ( option == "--weights" ) weights = argv[i+1];
+    else {
+      std::cerr << "unknown option " << option << std::endl;
+      return 1;
+    }
+  }
+
+  // a pool of events, generated before the timing and processed in turn
+  const unsigned int nPool = std::min(nEvents, 50u);
+  std::vector<SyntheticEvent> pool;
+  for (unsigned int e=0; e<nPool; e++) {
+    pool.emplace_back(17 + e);
+    pool.back().Generate(nTracks, nJets, nGen);
+  }
+
+#ifdef FLYINGTOP_BDT
+  const bool ownWeights = weights.empty();
+  if ( ownWeights ) {
+    weights = "benchFlyingTop.weights.xml";
+    SyntheticForest(800, 3, 2024).Write(weights);
+  }
+  BDTForest forest(weights, SyntheticForest::Variables());
+  if ( ownWeights ) std::remove(weights.c_str());
+#endif
+
+  HelixPropagator helixPropagator;
+  HemisphereAxes hemiAxes;
+  EtaPhiGrid jetGrid(0.4, 0.4);
+  EtaPhiGrid genGridPos(0.1, 0.1, M_PI), genGridNeg(0.1, 0.1, M_PI);
+  FirstHitGrid hitGrid(30.);
+  const float ntrkRadius2[3] = { 10.*10., 20.*20., 30.*30. };
+  StageTimer timer(kNStages, kNCounters, true);
+
+  // per event buffers, reused
+  std::vector<float> x, y, z, gridX, gridY, gridZ, phi0;
+  std::vector<int> region, iJet, gridIndex;
+  std::vector<unsigned char> valid;
+  std::vector<char> genPos, genNeg;
+  std::vector<std::vector<float> > columns(SyntheticForest::NInputs);
+  std::vector<double> scores;
+  double checksum = 0.;
+
+  for (unsigned int e=0; e<nEvents; e++) {
+    const SyntheticEvent& ev = pool[e % nPool];
+    const unsigned int n = ev.track_pt.size(), nGenEv = ev.gen_pt.size();
+    timer.BeginEvent();
+
+    // first hit positions
+    x.resize(n); y.resize(n); z.resize(n); region.resize(n); valid.resize(n);
+    helixPropagator.Propagate( n, ev.track_vx.data(), ev.track_vy.data(), ev.track_vz.data(), ev.track_px.data(), ev.track_py.data(),
+                               ev.track_pz.data(), ev.track_charge.data(), ev.track_firstHit.data(),
+                               x.data(), y.data(), z.data(), region.data(), valid.data() );
+    timer.Lap(kFirstHit);
+
+    // first selected jet within DeltaR < 0.4
+    jetGrid.Fill(ev.jet_pt.size(), ev.jet_eta.data(), ev.jet_phi.data());
+    iJet.resize(n);
+    for (unsigned int i=0; i<n; i++) iJet[i] = jetGrid.First(ev.track_eta[i], ev.track_phi[i], 0.4);
+    timer.Lap(kJetAssociation);
+
+    // truth matching: phi at the PV of the gen particles, one pi periodic grid per charge, closest first hit
+    phi0.resize(nGenEv); genPos.resize(nGenEv); genNeg.resize(nGenEv);
+    for (unsigned int k=0; k<nGenEv; k++) {
+      float qR = ev.gen_charge[k] * ev.gen_pt[k] * 100 / 0.3 / 3.8;
+      phi0[k] = std::atan2( qR * std::sin(ev.gen_phi[k]) + (ev.gen_x[k] - ev.GenPVx), qR * std::cos(ev.gen_phi[k]) - (ev.gen_y[k] - ev.GenPVy) );
+      genPos[k] = ( ev.gen_charge[k] > 0 );
+      genNeg[k] = ( ev.gen_charge[k] < 0 );
+    }
+    genGridPos.Fill(nGenEv, ev.gen_eta.data(), phi0.data(), genPos.data());
+    genGridNeg.Fill(nGenEv, ev.gen_eta.data(), phi0.data(), genNeg.data());
+    long nMatched = 0;
+    for (unsigned int i=0; i<n; i++) {
+      int kmatch = -1;
+      float dFirstGenMin = 1000000.;
+      auto matchGen = [&](int k) {
+        if ( ev.track_charge[i] != ev.gen_charge[k] ) return;
+        float dphi = ev.track_phi[i] - phi0[k];
+        if      ( dphi < -3.14159 / 2. ) dphi += 3.14159;
+        else if ( dphi >  3.14159 / 2. ) dphi -= 3.14159;
+        if ( !SyntheticEvent::MatchCuts( ev.track_nHit[i], (ev.track_pt[i] - ev.gen_pt[k]) / ev.track_pt[i], ev.track_eta[i] - ev.gen_eta[k], dphi ) ) return;
+        float dFirstGen = (x[i]-ev.gen_x[k])*(x[i]-ev.gen_x[k]) + (y[i]-ev.gen_y[k])*(y[i]-ev.gen_y[k]) + (z[i]-ev.gen_z[k])*(z[i]-ev.gen_z[k]);
+        if ( dFirstGen < dFirstGenMin || ( dFirstGen == dFirstGenMin && k < kmatch ) ) {
+          kmatch = k;
+          dFirstGenMin = dFirstGen;
+        }
+      };
+      float detaWindow, dphiWindow;
+      SyntheticEvent::MatchWindow(ev.track_nHit[i], detaWindow, dphiWindow);
+      const EtaPhiGrid& genGrid = ( ev.track_charge[i] > 0 ) ? genGridPos : genGridNeg;
+      genGrid.Visit( ev.track_eta[i], ev.track_phi[i], detaWindow + 0.001, dphiWindow + 0.001, matchGen );
+      if ( kmatch >= 0 ) nMatched++;
+    }
+    timer.Lap(kTruthMatch);
+
+    // hemisphere axes, the muons being removed from the jets
+    hemiAxes.Clear();
+    for (unsigned int m=0; m<ev.muon_pt.size(); m++) hemiAxes.AddMuon(ev.muon_pt[m], ev.muon_eta[m], ev.muon_phi[m]);
+    for (unsigned int j=0; j<ev.jet_pt.size(); j++) hemiAxes.AddJet(ev.jet_pt[j], ev.jet_eta[j], ev.jet_phi[j]);
+    hemiAxes.Build();
+    checksum += hemiAxes.Eta1() + hemiAxes.Phi2();
+    timer.Lap(kAxes);
+
+    // preselected tracks: pt > 1, NChi2 < 5, drSig > 5, and the other preselected tracks within 10, 20 and 30 cm
+    gridX.clear(); gridY.clear(); gridZ.clear(); gridIndex.clear();
+    for (unsigned int i=0; i<n; i++) {
+      if ( !( ev.track_pt[i] > 1. && ev.track_NChi2[i] < 5. && ev.track_drSig[i] > 5. ) ) continue;
+      gridIndex.push_back(i);
+      gridX.push_back(x[i]);
+      gridY.push_back(y[i]);
+      gridZ.push_back(z[i]);
+    }
+    const unsigned int nPresel = gridIndex.size();
+    hitGrid.Fill(nPresel, gridX.data(), gridY.data(), gridZ.data());
+    for (auto& column : columns) column.resize(nPresel);
+    for (unsigned int p=0; p<nPresel; p++) {
+      int nNeighbours[3];
+      hitGrid.Count(p, 3, ntrkRadius2, nNeighbours);
+      const int i = gridIndex[p];
+      columns[0][p] = ev.track_pt[i];
+      columns[1][p] = ev.track_eta[i];
+      columns[2][p] = ev.track_NChi2[i];
+      columns[3][p] = ev.track_nHit[i];
+      columns[4][p] = nNeighbours[0];
+      columns[5][p] = ev.track_drSig[i];
+      columns[6][p] = ( iJet[i] >= 0 ) ? 1. : 0.;
+    }
+    timer.Lap(kNeighbours);
+
+    // BDT of the preselected tracks, in one batch
+    scores.resize(nPresel);
+#ifdef FLYINGTOP_BDT
+    const float* in[SyntheticForest::NInputs];
+    for (unsigned int v=0; v<SyntheticForest::NInputs; v++) in[v] = columns[v].data();
+    forest.Evaluate(in, nPresel, scores.data());
+    if ( nPresel > 0 ) checksum += scores[0];
+#endif
+    timer.Lap(kBDT);
+
+    timer.Count(kTracks, n);
+    timer.Count(kPreselected, nPresel);
+    timer.Count(kMatched, nMatched);
+    timer.EndEvent();
+  }
+
+  const double events = timer.Events();
+  const double tracks = timer.Counter(kTracks), preselected = timer.Counter(kPreselected);
+  double total = 0.;
+  for (int s=0; s<kNStages; s++) total += timer.StageTime(s);
+  std::cout << " FlyingTop synthetic benchmark: " << nEvents << " events (" << nPool << " different) of " << nTracks << " tracks, " << nJets
+            << " jets, " << nGen << " gen particles from LLPs; " << preselected / events << " preselected and "
+            << timer.Counter(kMatched) / events << " matched tracks per event" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  auto print = [&](const char* what, int stage, double per, const char* unit) {
+    std::cout << "   " << std::left << std::setw(44) << what << std::right << std::setw(10) << 1.e9 * timer.StageTime(stage) / per << unit
+              << std::setw(8) << 100. * timer.StageTime(stage) / total << " %" << std::endl;
+  };
+  print("first hit propagation (HelixPropagator)", kFirstHit, tracks, " ns per track");
+  print("track-jet association (EtaPhiGrid::First)", kJetAssociation, tracks, " ns per track");
+  print("truth matching (EtaPhiGrid::Visit)", kTruthMatch, tracks, " ns per track");
+  print("hemisphere axes (HemisphereAxes)", kAxes, events, " ns per event");
+  print("ntrk10/20/30 (FirstHitGrid)", kNeighbours, preselected, " ns per preselected track");
+#ifdef FLYINGTOP_BDT
+  print("BDT (BDTForest, batch)", kBDT, preselected, " ns per preselected track");
+#else
+  std::cout << "   BDT: not built, ROOT is needed to read the weights" << std::endl;
+#endif
+  std::cout << "   all: " << 1.e3 * total / events << " ms per event, " << std::setprecision(0) << events / total << " events/s on one thread" << std::endl;
+  std::cout << std::defaultfloat << "   (checksum " << checksum << ")" << std::endl;
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Benchmark of the columns of ../interface/FlyingTopEvent.h: allocations and cache misses per event of the filling
+// of FlyingTopProducer, which pushes one value per track into each per track column (Track and TrackSim groups of
+// FlyingTopBranches.h) and one value per object into the other columns (a tenth of the number of tracks here),
+// followed by the preselection pass that reads pt, NChi2 and drSig back,
+//   - with the columns growing from empty, as before ReserveTracks()
+//   - with the per track columns reserved by ReserveTracks() before the track loop
+//   - with also all the columns reserved by ReserveColumns() at their largest size in the previous events, as the
+//     producer does
+// on a new FlyingTopEvent for each event, as the producer does, with 80 to 120 % of the given number of tracks.
+// The copy of the event that FlyingTopAnalyzer used to make before filling the ttree is timed too.
+// The allocations are counted by replacing the global operator new, the cache misses are read from perf_event_open
+// (n/a if the kernel does not allow it):
+//   benchFlyingTopEvent [tracks per event, 1500] [events, 500]
+
+// system include files
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define FLYINGTOP_PERF
+#endif
+
+// user include files
+#include "../interface/FlyingTopEvent.h"
+
+// every allocation of the program goes through here
+static long nAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+  nAllocations++;
+  if ( void* p = std::malloc(size ? size : 1) ) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+
+// cache misses of this thread (last level), -1 if they cannot be counted
+class CacheMisses {
+  public:
+    CacheMisses()
+      {
+#ifdef FLYINGTOP_PERF
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        Fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if ( Fd >= 0 ) ioctl(Fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+      }
+    ~CacheMisses()
+      {
+#ifdef FLYINGTOP_PERF
+        if ( Fd >= 0 ) close(Fd);
+#endif
+      }
+    long long Read() const
+      {
+        long long count = -1;
+#ifdef FLYINGTOP_PERF
+        if ( Fd < 0 || read(Fd, &count, sizeof(count)) != sizeof(count) ) return -1;
+#endif
+        return count;
+      }
+
+  private:
+    int Fd = -1;
+};
+
+enum Mode { kGrow, kReserveTracks, kReserveColumns };
+
+// one value per object in each column: per track in the Track and TrackSim groups, as the track loop of the producer
+template <class T> static void push(std::vector<T>& column, size_t i) {column.push_back( T(i % 7) );}
+template <class T> static void push(T&, size_t) {}
+
+static void fill(FlyingTopEvent& ev, size_t nTracks, Mode mode)
+{
+  for (size_t i=0; i<nTracks/10; i++) {
+#define FLYINGTOP_PUSH_OBJECT(group, type, name) \
+    if ( FlyingTopBranches::group != FlyingTopBranches::Track && FlyingTopBranches::group != FlyingTopBranches::TrackSim ) push(ev.name, i);
+    FLYINGTOP_BRANCHES(FLYINGTOP_PUSH_OBJECT)
+#undef FLYINGTOP_PUSH_OBJECT
+  }
+  if ( mode != kGrow ) ev.ReserveTracks(nTracks);
+  for (size_t i=0; i<nTracks; i++) {
+    ev.tree_nTracks++;
+#define FLYINGTOP_PUSH_TRACK(group, type, name) \
+    if ( FlyingTopBranches::group == FlyingTopBranches::Track || FlyingTopBranches::group == FlyingTopBranches::TrackSim ) push(ev.name, i);
+    FLYINGTOP_BRANCHES(FLYINGTOP_PUSH_TRACK)
+#undef FLYINGTOP_PUSH_TRACK
+  }
+}
+
+// number of tracks of event e, 80 to 120 % of nTracks
+static size_t eventTracks(size_t nTracks, int e) {return nTracks * (80 + (e * 7919) % 41) / 100;}
+
+static void run(const char* what, Mode mode, size_t nTracks, int nEvents, const CacheMisses& misses)
+{
+  long long checksum = 0;
+  std::vector<size_t> columnSizes;
+  const long allocations0 = nAllocations;
+  const long long misses0 = misses.Read();
+  auto t0 = std::chrono::steady_clock::now();
+  for (int e=0; e<nEvents; e++) {
+    const size_t n = eventTracks(nTracks, e);
+    auto ev = std::make_unique<FlyingTopEvent>();
+    if ( mode == kReserveColumns ) ev->ReserveColumns(columnSizes);
+    fill(*ev, n, mode);
+    for (size_t i=0; i<n; i++)
+      if ( ev->tree_track_pt[i] > 1. && ev->tree_track_NChi2[i] < 5. && ev->tree_track_drSig[i] > 0.5 ) checksum++;
+    if ( mode == kReserveColumns ) ev->MaxColumnSizes(columnSizes);
+  }
+  const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  const long long misses1 = misses.Read();
+  std::cout << "   " << std::left << std::setw(24) << what << std::right << std::setw(8) << double(nAllocations - allocations0) / nEvents
+            << " allocations  " << std::setw(10);
+  if ( misses0 >= 0 && misses1 >= 0 ) std::cout << double(misses1 - misses0) / nEvents;
+  else std::cout << "n/a";
+  std::cout << " cache misses  " << std::setw(8) << 1.e6 * time / nEvents << " us per event   (checksum " << checksum << ")" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  const size_t nTracks = ( argc > 1 ) ? std::atoi(argv[1]) : 1500;
+  const int nEvents = ( argc > 2 ) ? std::atoi(argv[2]) : 500;
+  CacheMisses misses;
+  std::cout << " FlyingTopEvent columns benchmark: " << nTracks << " tracks, " << nEvents << " events, per event:" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+  for (int pass=0; pass<2; pass++) {
+    run("growing from empty", kGrow, nTracks, nEvents, misses);
+    run("ReserveTracks", kReserveTracks, nTracks, nEvents, misses);
+    run("and ReserveColumns", kReserveColumns, nTracks, nEvents, misses);
+  }
+
+  // copy of the whole event into one kept from event to event, as FlyingTopAnalyzer did before pointing its branches
+  // to the columns of the product
+  std::vector<std::unique_ptr<FlyingTopEvent> > events;
+  for (int e=0; e<10; e++) {
+    events.push_back( std::make_unique<FlyingTopEvent>() );
+    fill(*events.back(), eventTracks(nTracks, e), kReserveTracks);
+  }
+  FlyingTopEvent copy;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int e=0; e<nEvents; e++) copy = *events[e % 10];
+  const double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  std::cout << "   copy of the event" << std::setw(89) << 1.e6 * time / nEvents << " us per event" << std::endl;
+  return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef FWCore_Utilities_Exception_h
+#define FWCore_Utilities_Exception_h
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <string>
+#include <sstream>
+#include <exception>
+/*---------------*/
+
+// Stand-in for cms::Exception in the standalone build of the tests (../../../../CMakeLists.txt): same
+// category and streamed message, so that the FlyingTop headers compile without CMSSW. Not used inside CMSSW.
+
+namespace cms {
+
+  class Exception : public std::exception {
+     public:
+
+        //Constructor
+        explicit Exception(const std::string& category) : Category (category) {}
+
+        //Destructor
+        ~Exception() override {}
+
+        template <class T> Exception& operator<<(const T& value)
+          {
+            std::ostringstream text;
+            text << value;
+            Message += text.str();
+            return *this;
+          }
+
+        //-----Access Data Members------//
+        const std::string& category() const {return Category;}
+        const char* what() const noexcept override {return Message.c_str();}
+
+     private:
+        // ----------member data ---------------------------
+        std::string Category, Message;
+  };
+
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef ROOT_TLorentzVector
+#define ROOT_TLorentzVector
+
+/*----------INCLUDES-----------*/
+// system include files
+#include <cmath>
+/*---------------*/
+
+// Stand-in for the part of ROOT's TLorentzVector used by the reference loops of the tests, in the standalone build
+// when ROOT is not found (../../CMakeLists.txt): the same double components and the same formulas as
+// TLorentzVector::SetPtEtaPhiM() and TVector3::PseudoRapidity(), Phi() and Perp(). Not used when ROOT is there.
+
+class TLorentzVector {
+   public:
+
+      //Constructor
+      TLorentzVector() {}
+
+      //Destructor
+      ~TLorentzVector() {}
+
+      void SetPtEtaPhiM(double pt, double eta, double phi, double m)
+        {
+          pt = std::abs(pt);
+          X = pt * std::cos(phi);
+          Y = pt * std::sin(phi);
+          Z = pt * std::sinh(eta);
+          E = std::sqrt( X*X + Y*Y + Z*Z + m*m );
+        }
+      TLorentzVector& operator+=(const TLorentzVector& q) {X += q.X; Y += q.Y; Z += q.Z; E += q.E; return *this;}
+      TLorentzVector& operator-=(const TLorentzVector& q) {X -= q.X; Y -= q.Y; Z -= q.Z; E -= q.E; return *this;}
+
+      //-----Access Data Members------//
+      double Pt() const {return std::sqrt( X*X + Y*Y );}
+      double Phi() const {return ( X == 0. && Y == 0. ) ? 0. : std::atan2(Y, X);}
+      double Eta() const
+        {
+          double p = std::sqrt( X*X + Y*Y + Z*Z );
+          double cosTheta = ( p == 0. ) ? 1. : Z / p;
+          if ( cosTheta*cosTheta < 1. ) return -0.5 * std::log( (1.-cosTheta) / (1.+cosTheta) );
+          if ( Z == 0. ) return 0.;
+          return ( Z > 0. ) ? 10e10 : -10e10;
+        }
+
+   private:
+      // ----------member data ---------------------------
+      double X = 0., Y = 0., Z = 0., E = 0.;
+};
+
+#endif
@@ -0,0 +1,152 @@
+// Unit test of ../interface/BDTForest.h.
+// A random forest (SyntheticForest.h) written as a TMVA BDTG weights file must give, for random tracks, the same
+// score to the last bit as the walk of its nodes, one track at a time and in batches, and the weights BDTForest
+// does not support must throw.
+// The scores of random tracks are also compared with TMVA::Reader (within 1e-5) for data/TMVAClassification_BDTG_synthetic.weights.xml
+// (SyntheticForest(20, 3, 2024), found from LOCAL_TEST_DIR, set by scram b runtests and by ctest), or for the weights
+// file given as argument:
+//   testFlyingTopBDTForest TMVAClassification_BDTG50cm_HighPurity.weights.xml
+
+// system include files
+#include <vector>
+#include <string>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+// user include files
+#include "TMVA/Reader.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "../interface/BDTForest.h"
+#include "SyntheticForest.h"
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+  std::cout << ( ok ? " ok     " : " FAILED " ) << what << std::endl;
+  if ( !ok ) nFailed++;
+}
+
+// BDTForest must not accept these weights
+static bool rejects(const std::string& text)
+{
+  const std::string fileName = "testBDTForest_bad.weights.xml";
+  std::ofstream(fileName) << text;
+  bool thrown = false;
+  try {
+    BDTForest forest(fileName, SyntheticForest::Variables());
+  }
+  catch (cms::Exception& e) {
+    thrown = ( e.category() == "BDTForest" );
+  }
+  std::remove(fileName.c_str());
+  return thrown;
+}
+
+// the weights with the first from replaced by to
+static std::string replaced(std::string text, const std::string& from, const std::string& to)
+{
+  size_t pos = text.find(from);
+  if ( pos != std::string::npos ) text.replace(pos, from.size(), to);
+  return text;
+}
+
+// the weights with the attribute attr removed from the first node of the given type (nType="0" or nType="-99")
+static std::string withoutAttr(std::string text, const std::string& nodeType, const std::string& attr)
+{
+  size_t end = text.find(nodeType);
+  size_t begin = text.rfind("<Node ", end);
+  size_t pos = text.find(" " + attr + "=\"", begin);
+  if ( end == std::string::npos || pos > end ) return text;
+  text.erase(pos, text.find('"', pos + attr.size() + 3) + 1 - pos);
+  return text;
+}
+
+int main(int argc, char** argv)
+{
+  std::mt19937 rng(12345);
+
+  // random forests, balanced and not, against the walk of their nodes
+  const std::string fileName = "testBDTForest.weights.xml";
+  for (int maxDepth : {1, 3, 6}) {
+    SyntheticForest synthetic(200, maxDepth, 100+maxDepth);
+    check( synthetic.Write(fileName), "write the weights file" );
+    BDTForest forest(fileName, SyntheticForest::Variables());
+    check( forest.NTrees() == synthetic.NTrees() && forest.NNodes() == synthetic.NNodes() && forest.NVariables() == SyntheticForest::NInputs,
+           "depth " + std::to_string(maxDepth) + ": same number of trees, nodes and inputs" );
+    int nDiff = 0;
+    for (int k=0; k<100000; k++) {
+      float x[SyntheticForest::NInputs];
+      synthetic.RandomTrack(rng, x);
+      if ( forest.Evaluate(x) != synthetic.Evaluate(x) ) nDiff++;
+    }
+    check( nDiff == 0, "depth " + std::to_string(maxDepth) + ": same scores as the node walk on 100000 tracks (" + std::to_string(nDiff) + " differ)" );
+
+    // batches of all sizes around the lane count: the same scores as one track at a time, to the last bit
+    for (unsigned int n : {0u, 1u, BDTForest::kLanes-1, BDTForest::kLanes, BDTForest::kLanes+1, 3*BDTForest::kLanes+5, 1000u}) {
+      std::vector<std::vector<float> > columns(SyntheticForest::NInputs, std::vector<float>(n));
+      for (unsigned int k=0; k<n; k++) {
+        float x[SyntheticForest::NInputs];
+        synthetic.RandomTrack(rng, x);
+        for (unsigned int i=0; i<SyntheticForest::NInputs; i++) columns[i][k] = x[i];
+      }
+      const float* x[SyntheticForest::NInputs];
+      for (unsigned int i=0; i<SyntheticForest::NInputs; i++) x[i] = columns[i].data();
+      std::vector<double> batch(n+1, -10.);
+      forest.Evaluate(x, n, batch.data());
+      int nBatchDiff = 0;
+      for (unsigned int k=0; k<n; k++) {
+        float in[SyntheticForest::NInputs];
+        for (unsigned int i=0; i<SyntheticForest::NInputs; i++) in[i] = columns[i][k];
+        if ( batch[k] != forest.Evaluate(in) ) nBatchDiff++;
+      }
+      check( nBatchDiff == 0 && batch[n] == -10., "depth " + std::to_string(maxDepth) + ": batch of " + std::to_string(n)
+             + " tracks, same scores as one at a time (" + std::to_string(nBatchDiff) + " differ)" );
+    }
+  }
+
+  // weights that BDTForest cannot evaluate
+  std::stringstream text;
+  text << std::ifstream(fileName).rdbuf();
+  const std::string weights = text.str();
+  check( rejects( replaced(weights, ">Grad<", ">AdaBoost<") ), "a forest that is not gradient boosted throws" );
+  check( rejects( replaced(weights, "NTransformations=\"0\"", "NTransformations=\"1\"") ), "input transformations throw" );
+  check( rejects( replaced(weights, "Expression=\"mva_drSig\"", "Expression=\"mva_dxy\"") ), "a variable that is not an input throws" );
+  check( rejects( replaced(weights, "Expression=\"mva_drSig\"", "") ), "a variable without Expression throws" );
+  check( rejects( replaced(weights, "NCoef=\"0\" IVar=\"", "NCoef=\"2\" IVar=\"") ), "a Fisher cut throws" );
+  check( rejects( weights.substr(0, weights.find("  <Weights")) + "</MethodSetup>\n" ), "a file without tree throws" );
+  for (const char* attr : {"IVar", "Cut", "cType"})
+    check( rejects( withoutAttr(weights, "nType=\"0\"", attr) ), std::string("a node without ") + attr + " throws" );
+  check( rejects( withoutAttr(weights, "nType=\"-99\"", "res") ), "a leaf without res throws" );
+  std::remove(fileName.c_str());
+
+  // a weights file against TMVA
+  std::string weightsFile;
+  if ( argc > 1 ) weightsFile = argv[1];
+  else if ( std::getenv("LOCAL_TEST_DIR") ) weightsFile = std::string(std::getenv("LOCAL_TEST_DIR")) + "/data/TMVAClassification_BDTG_synthetic.weights.xml";
+  if ( !weightsFile.empty() ) {
+    float in[SyntheticForest::NInputs];
+    TMVA::Reader reader("!Color:Silent");
+    for (unsigned int i=0; i<SyntheticForest::NInputs; i++) reader.AddVariable(SyntheticForest::Variables()[i], &in[i]);
+    check( reader.BookMVA("BDTG", weightsFile) != nullptr, "TMVA::Reader books " + weightsFile );
+    BDTForest forest(weightsFile, SyntheticForest::Variables());
+    SyntheticForest tracks(1, 3, 1);
+    double maxDiff = 0.;
+    for (int k=0; k<100000; k++) {
+      tracks.RandomTrack(rng, in);
+      maxDiff = std::max( maxDiff, std::abs( reader.EvaluateMVA("BDTG") - forest.Evaluate(in) ) );
+    }
+    check( maxDiff < 1.e-5, "same scores as TMVA::Reader on 100000 tracks for " + weightsFile + " (max difference " + std::to_string(maxDiff) + ")" );
+  }
+  else std::cout << " no weights file given and no LOCAL_TEST_DIR, the comparison with TMVA::Reader is skipped" << std::endl;
+
+  std::cout << " testBDTForest: " << nFailed << " failed" << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}
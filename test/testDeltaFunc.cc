@@ -0,0 +1,135 @@
+// Unit test of ../interface/DeltaFunc.h.
+// DeltaPhi must be the phi difference wrapped into [-pi, pi], within a float rounding of the exact value computed in
+// double, around the +-pi boundaries, around multiples of 2 pi, for a zero difference and over the usual range;
+// it must agree with the previous Deltaphi away from the boundaries. The array forms must give the scalar values
+// to the last bit, and FirstWithin the first object of a loop with the DeltaR2 cut.
+
+// system include files
+#include <vector>
+#include <string>
+#include <random>
+#include <sstream>
+#include <iostream>
+#include <cmath>
+#include <cfloat>
+
+// user include files
+#include "../interface/DeltaFunc.h"
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+  std::cout << ( ok ? " ok     " : " FAILED " ) << what << std::endl;
+  if ( !ok ) nFailed++;
+}
+
+static std::string sci(double x)
+{
+  std::ostringstream out;
+  out << x;
+  return out.str();
+}
+
+// the DeltaFunc.h functions before the float kernels (TMath::Abs is std::abs)
+static double Deltaphi(double phi1, double phi2) {
+  double DeltaPhi = phi1 - phi2;
+  if (std::abs(DeltaPhi) > 3.141593 ) {
+    DeltaPhi = 2.*3.141593 - std::abs(DeltaPhi);
+    DeltaPhi = -DeltaPhi * (phi1 - phi2) / std::abs(phi1 - phi2);
+  }
+  return DeltaPhi;
+}
+
+// difference between DeltaPhi and the wrapped float difference computed in double, 0 if they are the same angle
+// (+pi and -pi for a difference of pi exactly); -1 if DeltaPhi is not in [-pi, pi]
+static double wrapError(float phi1, float phi2)
+{
+  const double pi = M_PI;
+  const float  dphi = DeltaPhi(phi1, phi2);
+  if ( !( std::abs(dphi) <= float(M_PI) ) ) return -1.;
+  const double exact = std::remainder( double(phi1 - phi2), 2.*pi );
+  double error = std::abs( dphi - exact );
+  return std::min( error, std::abs( error - 2.*pi ) );
+}
+
+int main()
+{
+  std::mt19937 rng(15);
+  std::uniform_real_distribution<float> u(0., 1.);
+  const float pi = M_PI;
+
+  // zero and +-pi: no NaN, in [-pi, pi]
+  check( DeltaPhi(1.f, 1.f) == 0.f && DeltaPhi(0.f, 0.f) == 0.f && DeltaPhi(-2.f, -2.f) == 0.f, "DeltaPhi of equal angles is 0" );
+  check( std::abs(DeltaPhi(pi, 0.f)) <= pi && std::abs(DeltaPhi(0.f, pi)) <= pi && std::abs(DeltaPhi(pi, -pi)) < 1.e-6
+         && std::abs(DeltaPhi(pi/2, -pi/2)) <= pi, "DeltaPhi of +-pi and of pi against -pi" );
+
+  // the floats next to +-pi and to the multiples of 2 pi up to 8 pi, from both sides
+  double maxError = 0.;
+  int nOut = 0, nPoints = 0;
+  for (int k=-4; k<=4; k++)
+    for (float centre : {float(2*k*M_PI), float((2*k+1)*M_PI)}) {
+      float x = centre;
+      for (int step=0; step<64; step++) x = std::nextafter(x, -FLT_MAX);
+      for (int step=0; step<128; step++, x = std::nextafter(x, FLT_MAX)) {
+        for (float phi2 : {0.f, 1.f, -2.5f}) {
+          double error = wrapError(x + phi2, phi2);
+          if ( error < 0. ) nOut++;
+          else maxError = std::max(maxError, error);
+          nPoints++;
+        }
+      }
+    }
+  check( nOut == 0 && maxError < 1.e-6, std::to_string(nPoints) + " differences next to the multiples of pi: wrapped in [-pi, pi], within "
+         + sci(maxError) + " of the exact value" );
+
+  // usual range: phi in [-pi, pi], and phi up to +-4 pi
+  maxError = 0.;
+  nOut = 0;
+  double maxOld = 0.;
+  for (int k=0; k<1000000; k++) {
+    float phi1 = 2. * pi * u(rng) - pi;
+    float phi2 = 2. * pi * u(rng) - pi;
+    double error = wrapError(phi1, phi2);
+    if ( error < 0. ) nOut++;
+    else maxError = std::max(maxError, error);
+    if ( std::abs( std::abs(phi1 - phi2) - M_PI ) > 1.e-5 ) maxOld = std::max( maxOld, std::abs( DeltaPhi(phi1, phi2) - Deltaphi(phi1, phi2) ) );
+    error = wrapError(4.f * phi1, 4.f * phi2);
+    if ( error < 0. ) nOut++;
+    else maxError = std::max(maxError, error);
+  }
+  check( nOut == 0 && maxError < 1.e-6, "2000000 random differences: wrapped in [-pi, pi], within " + sci(maxError) + " of the exact value" );
+  check( maxOld < 1.e-5, "same as the previous Deltaphi away from +-pi (max difference " + sci(maxOld) + ")" );
+
+  // array forms against the scalar ones, to the last bit, for sizes around the vector width
+  int nDiff = 0;
+  for (unsigned int n : {0u, 1u, 3u, 4u, 7u, 8u, 9u, 16u, 17u, 100u}) {
+    std::vector<float> eta(n), phi(n), dphi(n+1, -10.f), dr2(n+1, -10.f);
+    for (unsigned int i=0; i<n; i++) {
+      eta[i] = 5. * u(rng) - 2.5;
+      phi[i] = 2. * pi * u(rng) - pi;
+    }
+    if ( n > 0 ) phi[0] = -pi;
+    const float eta0 = 0.3, phi0 = pi;
+    DeltaPhi(phi0, n, phi.data(), dphi.data());
+    DeltaR2(eta0, phi0, n, eta.data(), phi.data(), dr2.data());
+    for (unsigned int i=0; i<n; i++)
+      if ( dphi[i] != DeltaPhi(phi0, phi[i]) || dr2[i] != DeltaR2(eta0, phi0, eta[i], phi[i]) ) nDiff++;
+    if ( dphi[n] != -10.f || dr2[n] != -10.f ) nDiff++;
+
+    std::vector<float> matrix(n*5);
+    DeltaR2(n, eta.data(), phi.data(), 5, eta.data(), phi.data(), matrix.data());
+    for (unsigned int i=0; i<n; i++)
+      for (unsigned int j=0; j<5 && j<n; j++) if ( matrix[i*5+j] != DeltaR2(eta[i], phi[i], eta[j], phi[j]) ) nDiff++;
+
+    for (float cut : {0.f, 0.01f, 0.16f, 100.f}) {
+      int first = -1;
+      for (unsigned int i=0; i<n && first<0; i++) if ( DeltaR2(eta0, phi0, eta[i], phi[i]) < cut ) first = i;
+      if ( FirstWithin(eta0, phi0, n, eta.data(), phi.data(), cut) != first ) nDiff++;
+    }
+  }
+  check( nDiff == 0, "array forms, n x m matrix and FirstWithin: same values as the scalar forms (" + std::to_string(nDiff) + " differ)" );
+
+  std::cout << " testDeltaFunc: " << nFailed << " failed" << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}
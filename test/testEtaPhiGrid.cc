@@ -0,0 +1,227 @@
+// Unit test of ../interface/EtaPhiGrid.h.
+// Visit() must give every object of the window, once, for grids with a 2 pi and a pi period, with objects beyond
+// the eta range and phi given outside [-pi, pi]. First() must give the jet that the track-jet association of
+// FlyingTopProducer found with its loop over the selected jets, for events of up to 3000 tracks and 40 jets.
+// The track truth matching of FlyingTopProducer, on the gen particles visited in the grids of each charge, must
+// pick the same gen particle as its loop over all of them.
+
+// system include files
+#include <vector>
+#include <string>
+#include <random>
+#include <iostream>
+#include <cmath>
+
+// user include files
+#include "../interface/EtaPhiGrid.h"
+#include "../interface/DeltaFunc.h"
+#include "SyntheticEvent.h"
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+  std::cout << ( ok ? " ok     " : " FAILED " ) << what << std::endl;
+  if ( !ok ) nFailed++;
+}
+
+// distance in phi modulo period
+static float phiDistance(float phi1, float phi2, float period)
+{
+  float d = std::fmod( std::abs(phi1 - phi2), period );
+  return std::min( d, period - d );
+}
+
+// queries of the window around random directions: objects missed and objects visited twice
+static void visitWindows(const EtaPhiGrid& grid, const std::vector<float>& eta, const std::vector<float>& phi, float period,
+                         float dEta, float dPhi, std::mt19937& rng, int& nMissed, int& nTwice)
+{
+  std::uniform_real_distribution<float> u(0., 1.);
+  std::vector<int> visits(eta.size());
+  for (int q=0; q<2000; q++) {
+    float qEta = 12. * u(rng) - 6.;
+    float qPhi = 4. * M_PI * u(rng) - 2. * M_PI;
+    std::fill(visits.begin(), visits.end(), 0);
+    grid.Visit( qEta, qPhi, dEta, dPhi, [&](int i) { visits[i]++; } );
+    for (unsigned int i=0; i<eta.size(); i++) {
+      if ( visits[i] > 1 ) nTwice++;
+      bool inWindow = ( std::abs(eta[i] - qEta) < dEta && phiDistance(phi[i], qPhi, period) < dPhi );
+      if ( inWindow && visits[i] == 0 ) nMissed++;
+    }
+  }
+}
+
+// gen particles and tracks for the truth matching, as in FlyingTopProducer (phi0: phi at the PV)
+struct GenParticle { int charge; float pt, eta, phi0, x, y, z; };
+struct Track       { int charge, nHit; float pt, eta, phi, xFirst, yFirst, zFirst; };
+
+// matching of FlyingTopProducer: gen particle k tested for track tk, the closest to the first hit is kept
+static void matchGen(const Track& tk, const std::vector<GenParticle>& gen, int k, int& kmatch, float& dFirstGenMin)
+{
+  const GenParticle& g = gen[k];
+  if ( tk.charge != g.charge ) return;
+  float dpt  = (tk.pt - g.pt) / tk.pt;
+  float deta = tk.eta - g.eta;
+  float dphi = tk.phi - g.phi0;
+  if      ( dphi < -3.14159 / 2. ) dphi += 3.14159;
+  else if ( dphi >  3.14159 / 2. ) dphi -= 3.14159;
+  if ( SyntheticEvent::MatchCuts(tk.nHit, dpt, deta, dphi) ) {
+    float dFirstGen = (tk.xFirst-g.x)*(tk.xFirst-g.x) + (tk.yFirst-g.y)*(tk.yFirst-g.y) + (tk.zFirst-g.z)*(tk.zFirst-g.z);
+    if ( dFirstGen < dFirstGenMin || ( dFirstGen == dFirstGenMin && k < kmatch ) ) {
+      kmatch = k;
+      dFirstGenMin = dFirstGen;
+    }
+  }
+}
+
+int main()
+{
+  std::mt19937 rng(13);
+  std::uniform_real_distribution<float> u(0., 1.);
+
+  // objects beyond |eta| = 5 and with phi in [-2 pi, 2 pi]
+  std::vector<float> eta(3000), phi(3000);
+  for (unsigned int i=0; i<eta.size(); i++) {
+    eta[i] = 14. * u(rng) - 7.;
+    phi[i] = 4. * M_PI * u(rng) - 2. * M_PI;
+  }
+  int nMissed = 0, nTwice = 0, nDiff = 0, nTracks = 0;
+  EtaPhiGrid grid(0.4, 0.4);
+  grid.Fill(eta.size(), eta.data(), phi.data());
+  check( grid.Size() == eta.size(), "2 pi period: all the objects are in the grid" );
+  for (float window : {0.05f, 0.4f, 1.f, 4.f}) visitWindows(grid, eta, phi, 2.*M_PI, window, window, rng, nMissed, nTwice);
+  check( nMissed == 0 && nTwice == 0, "2 pi period: Visit() gives all the objects of the windows once ("
+         + std::to_string(nMissed) + " missed, " + std::to_string(nTwice) + " twice)" );
+
+  nMissed = nTwice = 0;
+  EtaPhiGrid piGrid(0.1, 0.1, M_PI);
+  std::vector<char> use(eta.size());
+  for (unsigned int i=0; i<eta.size(); i++) use[i] = ( i % 3 != 0 );
+  piGrid.Fill(eta.size(), eta.data(), phi.data(), use.data());
+  std::vector<float> usedEta, usedPhi;
+  for (unsigned int i=0; i<eta.size(); i++) if ( use[i] ) {
+    usedEta.push_back(eta[i]);
+    usedPhi.push_back(phi[i]);
+  }
+  check( piGrid.Size() == usedEta.size(), "pi period: only the objects selected by use are in the grid" );
+  int nUnused = 0;
+  piGrid.Visit( 0., 0., 10., 10., [&](int i) { if ( !use[i] ) nUnused++; } );
+  check( nUnused == 0, "pi period: the objects not selected are never visited" );
+  EtaPhiGrid usedGrid(0.1, 0.1, M_PI);
+  usedGrid.Fill(usedEta.size(), usedEta.data(), usedPhi.data());
+  for (float window : {0.021f, 0.081f, 0.301f, 2.f}) visitWindows(usedGrid, usedEta, usedPhi, M_PI, window, window, rng, nMissed, nTwice);
+  check( nMissed == 0 && nTwice == 0, "pi period: Visit() gives all the objects of the windows once ("
+         + std::to_string(nMissed) + " missed, " + std::to_string(nTwice) + " twice)" );
+
+  // track-jet association: first selected jet within DeltaR < 0.4, jets and tracks around a few common directions
+  nDiff = 0;
+  int nAssociated = 0;
+  nTracks = 0;
+  for (int nJet : {0, 1, 5, 20, 40}) {
+    std::vector<float> jetEta, jetPhi;
+    for (int j=0; j<nJet; j++) {
+      jetEta.push_back( 2. * (j % 4) - 3. + 0.6 * u(rng) );
+      jetPhi.push_back( 1.5 * (j % 5) - 3. + 0.6 * u(rng) );
+    }
+    EtaPhiGrid jetGrid(0.4, 0.4);
+    jetGrid.Fill(nJet, jetEta.data(), jetPhi.data());
+    for (int t=0; t<3000; t++) {
+      float tkEta = 6. * u(rng) - 3.;
+      float tkPhi = 2. * M_PI * u(rng) - M_PI;
+      if ( nJet > 0 && t % 2 == 0 ) {
+        int j = t % nJet;
+        tkEta = jetEta[j] + 0.8 * (u(rng) - 0.5);
+        tkPhi = jetPhi[j] + 0.8 * (u(rng) - 0.5);
+        if ( tkPhi < -M_PI ) tkPhi += 2. * M_PI;
+      }
+      int iJet = 0;
+      bool matchTOjet = false;
+      for (int j=0; j<nJet; j++) {
+        if ( DeltaR2( jetEta[j], jetPhi[j], tkEta, tkPhi ) < 0.16 ) {
+          matchTOjet = true;
+          break;
+        }
+        else iJet++;
+      }
+      int iJetGrid = jetGrid.First( tkEta, tkPhi, 0.4 );
+      if ( iJetGrid != ( matchTOjet ? iJet : -1 ) ) nDiff++;
+      if ( matchTOjet ) nAssociated++;
+      nTracks++;
+    }
+  }
+  check( nDiff == 0 && nAssociated > 0, "track-jet association of " + std::to_string(nTracks) + " tracks (" + std::to_string(nAssociated)
+         + " in a jet): same jet as the loop over the jets (" + std::to_string(nDiff) + " differ)" );
+
+  // truth matching: LLP daughters, tracks smeared around them with phi0 wrong by pi for some, and fakes
+  nDiff = 0;
+  nTracks = 0;
+  int nMatched = 0;
+  for (int event=0; event<20; event++) {
+    std::vector<GenParticle> gen(400);
+    for (auto& g : gen) {
+      g.charge = ( u(rng) < 0.5 ) ? 1 : -1;
+      g.pt  = 0.5 + 20. * u(rng);
+      g.eta = 5. * u(rng) - 2.5;
+      g.phi0 = 2. * M_PI * u(rng) - M_PI;
+      g.x = 40. * u(rng) - 20.;
+      g.y = 40. * u(rng) - 20.;
+      g.z = 100. * u(rng) - 50.;
+    }
+    std::vector<Track> tracks;
+    for (int t=0; t<1500; t++) {
+      Track tk;
+      tk.nHit = 8 + int(15 * u(rng));
+      if ( t < 600 ) {
+        const GenParticle& g = gen[ std::uniform_int_distribution<int>(0, gen.size()-1)(rng) ];
+        tk.charge = g.charge;
+        tk.pt  = g.pt * ( 1. + 0.1 * (u(rng) - 0.5) );
+        tk.eta = g.eta + 0.1 * (u(rng) - 0.5);
+        tk.phi = g.phi0 + 0.06 * (u(rng) - 0.5) + ( u(rng) < 0.2 ? M_PI : 0. );
+        if ( tk.phi >  M_PI ) tk.phi -= 2. * M_PI;
+        tk.xFirst = g.x + u(rng);
+        tk.yFirst = g.y + u(rng);
+        tk.zFirst = g.z + u(rng);
+      }
+      else {
+        tk.charge = ( u(rng) < 0.5 ) ? 1 : -1;
+        tk.pt  = 0.5 + 20. * u(rng);
+        tk.eta = 5. * u(rng) - 2.5;
+        tk.phi = 2. * M_PI * u(rng) - M_PI;
+        tk.xFirst = tk.yFirst = tk.zFirst = 0.;
+      }
+      tracks.push_back(tk);
+    }
+
+    std::vector<float> genEta, genPhi0;
+    std::vector<char> genPos, genNeg;
+    for (const auto& g : gen) {
+      genEta.push_back(g.eta);
+      genPhi0.push_back(g.phi0);
+      genPos.push_back(g.charge > 0);
+      genNeg.push_back(g.charge < 0);
+    }
+    EtaPhiGrid genGridPos(0.1, 0.1, M_PI), genGridNeg(0.1, 0.1, M_PI);
+    genGridPos.Fill(gen.size(), genEta.data(), genPhi0.data(), genPos.data());
+    genGridNeg.Fill(gen.size(), genEta.data(), genPhi0.data(), genNeg.data());
+
+    for (const auto& tk : tracks) {
+      float detaWindow, dphiWindow;
+      SyntheticEvent::MatchWindow(tk.nHit, detaWindow, dphiWindow);
+      int kmatchGrid = -1;
+      float dGrid = 1000000.;
+      const EtaPhiGrid& genGrid = ( tk.charge > 0 ) ? genGridPos : genGridNeg;
+      genGrid.Visit( tk.eta, tk.phi, detaWindow + 0.001, dphiWindow + 0.001, [&](int k) { matchGen(tk, gen, k, kmatchGrid, dGrid); } );
+      int kmatch = -1;
+      float dLoop = 1000000.;
+      for (unsigned int k=0; k<gen.size(); k++) matchGen(tk, gen, k, kmatch, dLoop);
+      if ( kmatch != kmatchGrid ) nDiff++;
+      if ( kmatch >= 0 ) nMatched++;
+      nTracks++;
+    }
+  }
+  check( nDiff == 0 && nMatched > 0, "truth matching of " + std::to_string(nTracks) + " tracks (" + std::to_string(nMatched)
+         + " matched): same gen particle as the loop over all (" + std::to_string(nDiff) + " differ)" );
+
+  std::cout << " testEtaPhiGrid: " << nFailed << " failed" << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+// Unit test of ../interface/FirstHitGrid.h: the ntrk10/20/30 counts of the grid must be the ones of the loop over
+// all the pairs it replaced in FlyingTopProducer, for points spread over the tracker, for dense clusters, for points
+// on the cell boundaries and at exactly the radii, and when the grid is filled again for another event.
+
+// system include files
+#include <vector>
+#include <string>
+#include <random>
+#include <iostream>
+#include <cmath>
+
+// user include files
+#include "../interface/FirstHitGrid.h"
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+  std::cout << ( ok ? " ok     " : " FAILED " ) << what << std::endl;
+  if ( !ok ) nFailed++;
+}
+
+// counts of the previous loop over all the other tracks
+static void pairLoop(const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z, unsigned int i, int count[3])
+{
+  count[0] = count[1] = count[2] = 0;
+  for (unsigned int j=0; j<x.size(); j++) {
+  if ( j == i ) continue;
+    float dist = std::sqrt( double( (x[i]-x[j])*(x[i]-x[j]) + (y[i]-y[j])*(y[i]-y[j]) + (z[i]-z[j])*(z[i]-z[j]) ) );
+    if ( dist < 10. ) count[0]++;
+    if ( dist < 20. ) count[1]++;
+    if ( dist < 30. ) count[2]++;
+  }
+}
+
+// grid against the pair loop for all the points, returns the number of points with different counts
+static int compare(FirstHitGrid& grid, const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z)
+{
+  const float r2[3] = { 10.*10., 20.*20., 30.*30. };
+  grid.Fill( x.size(), x.data(), y.data(), z.data() );
+  int nDiff = 0;
+  for (unsigned int i=0; i<x.size(); i++) {
+    int count[3], ref[3];
+    grid.Count(i, 3, r2, count);
+    pairLoop(x, y, z, i, ref);
+    if ( count[0] != ref[0] || count[1] != ref[1] || count[2] != ref[2] ) nDiff++;
+  }
+  return nDiff;
+}
+
+int main()
+{
+  std::mt19937 rng(4);
+  std::uniform_real_distribution<float> u(0., 1.);
+  FirstHitGrid grid(30.);
+
+  // empty event and single point
+  std::vector<float> x, y, z;
+  check( compare(grid, x, y, z) == 0 && grid.Size() == 0, "no point" );
+  x = {1.}; y = {-2.}; z = {3.};
+  check( compare(grid, x, y, z) == 0 && grid.Size() == 1, "one point" );
+
+  // spread over the tracker volume, then dense clusters around a few displaced vertices
+  for (unsigned int n : {100u, 1000u, 3000u}) {
+    x.resize(n); y.resize(n); z.resize(n);
+    for (unsigned int i=0; i<n; i++) {
+      x[i] = 220. * u(rng) - 110.;
+      y[i] = 220. * u(rng) - 110.;
+      z[i] = 560. * u(rng) - 280.;
+    }
+    int nDiff = compare(grid, x, y, z);
+    check( nDiff == 0 && grid.Size() == n, std::to_string(n) + " points in the tracker: same counts as the pair loop (" + std::to_string(nDiff) + " differ)" );
+  }
+  for (unsigned int i=0; i<x.size(); i++) {
+    float cx = 40. * (i % 5) - 80., cy = 25. * (i % 3), cz = -20. * (i % 7);
+    x[i] = cx + 25. * u(rng);
+    y[i] = cy + 25. * u(rng);
+    z[i] = cz + 25. * u(rng);
+  }
+  int nDiff = compare(grid, x, y, z);
+  check( nDiff == 0, "3000 points in 105 clusters: same counts as the pair loop (" + std::to_string(nDiff) + " differ)" );
+
+  // on the cell boundaries (multiples of 30 cm, both signs) and at exactly 10, 20 and 30 cm of each other
+  x.clear(); y.clear(); z.clear();
+  for (int ix=-3; ix<=3; ix++)
+  for (int iz=-3; iz<=3; iz++)
+  for (float d : {0.f, 10.f, 20.f, 30.f}) {
+    x.push_back(30.*ix + d);
+    y.push_back(-30.);
+    z.push_back(30.*iz);
+  }
+  nDiff = compare(grid, x, y, z);
+  check( nDiff == 0, std::to_string(x.size()) + " points on the cell boundaries and at the radii: same counts as the pair loop (" + std::to_string(nDiff) + " differ)" );
+
+  std::cout << " testFirstHitGrid: " << nFailed << " failed" << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}
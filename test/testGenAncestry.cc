@@ -0,0 +1,393 @@
+// Unit test of ../interface/GenAncestry.h.
+// The packed genparticles given to each tagged pruned genparticle (final c and b hadrons, LLPs) by the index must
+// be the same, in the same order, as with the recursive isAncestor scan of the packed collection for each tagged
+// particle that FlyingTopProducer used before (scanFrom below), and the isFromB/C flags the same as with this scan.
+// The isFromB/C flags of the LLP daughters, given by identity, are also compared with the previous matching on pdgId,
+// pt, eta and phi to the b and c daughters (fuzzyFlags below): each flag set by identity must be set by this matching,
+// which can only add flags, to particles close to a b or c daughter by chance.
+// The events are synthetic decay chains: smuon -> neutralino -> quarks -> (excited) b and c hadrons -> final
+// particles, with strings of two quarks (particles with two mothers), prompt b and c hadrons, hadrons beyond the
+// eta cut, intermediate particles that are not in the pruned collection and packed particles without mother.
+
+// system include files
+#include <vector>
+#include <deque>
+#include <string>
+#include <random>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+
+// user include files
+#include "../interface/GenAncestry.h"
+#include "../interface/DeltaFunc.h"
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+  std::cout << ( ok ? " ok     " : " FAILED " ) << what << std::endl;
+  if ( !ok ) nFailed++;
+}
+
+// the part of reco::Candidate used by the producer for the association
+struct Particle {
+  int   pdgId_ = 0, charge_ = 0;
+  float pt_ = 0., eta_ = 0., phi_ = 0.;
+  std::vector<const Particle*> mothers, daughters;
+  int   pdgId() const {return pdgId_;}
+  int   charge() const {return charge_;}
+  float pt() const {return pt_;}
+  float eta() const {return eta_;}
+  float phi() const {return phi_;}
+  size_t numberOfMothers() const {return mothers.size();}
+  size_t numberOfDaughters() const {return daughters.size();}
+  const Particle* mother(size_t m = 0) const {return m < mothers.size() ? mothers[m] : nullptr;}
+  const Particle* daughter(size_t d) const {return daughters[d];}
+};
+
+// a deque keeps the addresses of its particles when it grows
+typedef std::deque<Particle> Particles;
+typedef GenAncestryT<Particles, Particle> Ancestry;
+
+struct Event {
+  Particles pruned;
+  Particles hidden;   // intermediate particles dropped from the pruned collection
+  Particles packed;
+};
+
+class Generator {
+  public:
+    Generator(unsigned int seed) : rng (seed) {}
+
+    Event Next()
+      {
+        Event event;
+        Particle* proton = Add(event.pruned, 2212, {});
+        int nSmuons = ( u(rng) < 0.1 ) ? 3 : 2;   // a third neutralino is not tagged
+        std::vector<Particle*> quarks;
+        for (int s=0; s<nSmuons; s++) {
+          Particle* smuon = Add(event.pruned, ( u(rng) < 0.5 ) ? 1000013 : -1000013, {proton});
+          Particle* neutralino = Add(event.pruned, 1000023, {smuon});
+          Final(event, Add(event.pruned, 13, {smuon}), 13);
+          for (int q=0; q<3; q++) quarks.push_back( Add(event.pruned, 1 + int(u(rng) * 5), {neutralino}) );
+        }
+        // hadronization: each quark alone or in a string with another quark, of the same or of the other neutralino
+        for (unsigned int q=0; q<quarks.size(); q++) {
+          if ( q+1 < quarks.size() && u(rng) < 0.3 ) {
+            Particle* string = Add(event.pruned, 92, {quarks[q], quarks[q+1]});
+            Hadrons(event, string, quarks[q]->pdgId());
+            Hadrons(event, string, quarks[q+1]->pdgId());
+            q++;
+          }
+          else Hadrons(event, quarks[q], quarks[q]->pdgId());
+        }
+        // prompt b and c quarks
+        int nPrompt = int(u(rng) * 3);
+        for (int p=0; p<nPrompt; p++) Hadrons(event, Add(event.pruned, ( u(rng) < 0.5 ) ? 5 : 4, {proton}), 0);
+        // pileup like final particles, some without mother
+        int nOther = int(u(rng) * 20);
+        for (int p=0; p<nOther; p++) Final(event, ( u(rng) < 0.5 ) ? proton : nullptr, 211);
+        return event;
+      }
+
+    std::uniform_real_distribution<float> u {0., 1.};
+
+  private:
+    Particle* Add(Particles& particles, int pdgId, const std::vector<Particle*>& mothers)
+      {
+        particles.emplace_back();
+        Particle& particle = particles.back();
+        particle.pdgId_ = pdgId;
+        particle.pt_  = 0.2f + 10.f * expo(rng);
+        particle.eta_ = 10.f * u(rng) - 5.f;
+        particle.phi_ = float(2. * M_PI * u(rng) - M_PI);
+        for (Particle* mother : mothers) {
+          particle.mothers.push_back(mother);
+          mother->daughters.push_back(&particle);
+        }
+        return &particle;
+      }
+
+    // final particles of a hadron or quark, in the packed collection, their mother(0) a pruned particle
+    void Final(Event& event, Particle* mother, int pdgId = 0)
+      {
+        int n = ( pdgId != 0 ) ? 1 : 1 + int(u(rng) * 4);
+        for (int f=0; f<n; f++) {
+          static const int finals[] = {211, -211, 321, -321, 111, 22, 11, -13, 2212};
+          event.packed.emplace_back();
+          Particle& particle = event.packed.back();
+          particle.pdgId_  = ( pdgId != 0 ) ? pdgId : finals[ int(u(rng) * 9) % 9 ];
+          particle.charge_ = ( particle.pdgId_ == 111 || particle.pdgId_ == 22 ) ? 0 : ( particle.pdgId_ > 0 ? 1 : -1 );
+          particle.pt_  = 0.2f + 5.f * expo(rng);
+          particle.eta_ = 8.f * u(rng) - 4.f;
+          particle.phi_ = float(2. * M_PI * u(rng) - M_PI);
+          if ( mother ) particle.mothers.push_back(mother);
+        }
+      }
+
+    // a chain of decays down to the final particles, from a b quark: (B*) -> B -> (D*) -> D, from a c quark (D*) -> D
+    void Hadrons(Event& event, Particle* from, int quark)
+      {
+        static const int bHadrons[] = {511, 521, 531, 5122, 5232};
+        static const int cHadrons[] = {411, 421, 431, 4122, 4232};
+        static const int light[]    = {113, 213, 221, 313, 323};
+        Particle* last = from;
+        int flavour = std::abs(quark);
+        if ( flavour == 5 || ( quark == 0 && from->pdgId() == 5 ) ) {
+          if ( u(rng) < 0.4 ) last = Add(event.pruned, 513, {last});
+          last = Add(event.pruned, bHadrons[ int(u(rng) * 5) % 5 ], {last});
+          if ( u(rng) < 0.3 ) Final(event, last);   // B -> D + final particles
+          flavour = 4;
+        }
+        if ( flavour == 4 || ( quark == 0 && from->pdgId() == 4 ) ) {
+          if ( u(rng) < 0.4 ) last = Add(event.pruned, 413, {last});
+          last = Add(event.pruned, cHadrons[ int(u(rng) * 5) % 5 ], {last});
+        }
+        // a light resonance, sometimes not kept in the pruned collection
+        if ( u(rng) < 0.5 ) {
+          Particles& where = ( u(rng) < 0.5 ) ? event.hidden : event.pruned;
+          last = Add(where, light[ int(u(rng) * 5) % 5 ], {last});
+          if ( &where == &event.hidden && u(rng) < 0.5 ) last = Add(event.hidden, 111, {last});
+        }
+        Final(event, last);
+      }
+
+    std::mt19937 rng;
+    std::exponential_distribution<float> expo {1.};
+};
+
+// tagging of the pruned genparticles, as in FlyingTopProducer
+static void tag(const Particles& pruned, Ancestry& ancestry)
+{
+  int nTaggedLLP = 0;
+  for (size_t i=0; i<pruned.size(); i++)
+  {
+    const Particle& genIt = pruned[i];
+    unsigned int nDaughters = genIt.numberOfDaughters();
+    int ID = abs(genIt.pdgId());
+
+    bool isFinalD = false;
+    if ( (ID/100)%10 == 4 || (ID/1000)%10 == 4 ) {
+      isFinalD = true;
+      for (unsigned int d1=0; d1<nDaughters; d1++) {
+        int ID1 = abs(genIt.daughter(d1)->pdgId());
+        if ( (ID1/100)%10 == 4 || (ID1/1000)%10 == 4 ) isFinalD = false;
+      }
+    }
+    if ( isFinalD && std::abs(genIt.eta()) < 4. ) ancestry.Tag(i, Ancestry::kFinalC);
+
+    bool isFinalB = false;
+    if ( (ID/100)%10 == 5 || (ID/1000)%10 == 5 ) {
+      isFinalB = true;
+      for (unsigned int d1=0; d1<nDaughters; d1++) {
+        int ID1 = abs(genIt.daughter(d1)->pdgId());
+        if ( (ID1/100)%10 == 5 || (ID1/1000)%10 == 5 ) isFinalB = false;
+      }
+    }
+    if ( isFinalB && std::abs(genIt.eta()) < 4. ) ancestry.Tag(i, Ancestry::kFinalB);
+
+    if ( genIt.pdgId() == 1000023 && abs(genIt.mother()->pdgId()) == 1000013 && nTaggedLLP < 2 ) {
+      nTaggedLLP++;
+      ancestry.Tag(i, Ancestry::kLLP);
+    }
+  }
+  ancestry.Build();
+}
+
+static bool selected(const Particle& particle)
+{
+  return !( particle.pt() < 0.9 || std::abs(particle.eta()) > 3.0 || particle.charge() == 0 );
+}
+
+// the association of the packed genparticles to the tagged pruned ones with the index, as in FlyingTopProducer
+struct Association {
+  std::vector<std::vector<size_t> > packedFrom;
+  std::vector<bool> packedIsFromB, packedIsFromC;
+};
+
+static Association indexFrom(const Event& event, Ancestry& ancestry)
+{
+  Association association;
+  association.packedFrom.resize(event.pruned.size());
+  association.packedIsFromB.assign(event.packed.size(), false);
+  association.packedIsFromC.assign(event.packed.size(), false);
+  for (size_t j=0; j<event.packed.size(); j++)
+  {
+  if ( !selected(event.packed[j]) ) continue;
+    const Particle* motherInPrunedCollection = event.packed[j].mother(0);
+  if ( motherInPrunedCollection == nullptr ) continue;
+    for (int h : ancestry.Ancestors(motherInPrunedCollection)) {
+      association.packedFrom[h].push_back(j);
+      if ( ancestry.Tags(h) & Ancestry::kFinalB ) association.packedIsFromB[j] = true;
+      if ( ancestry.Tags(h) & Ancestry::kFinalC ) association.packedIsFromC[j] = true;
+    }
+  }
+  return association;
+}
+
+// the same with the recursive isAncestor, one scan of the packed collection per tagged particle
+static bool isAncestor(const Particle* ancestor, const Particle* particle)
+{
+  if ( ancestor == particle ) return true;
+  for (size_t i=0; i < particle->numberOfMothers(); i++)
+  {
+    if ( isAncestor(ancestor, particle->mother(i)) ) return true;
+  }
+  return false;
+}
+
+static Association scanFrom(const Event& event, const Ancestry& ancestry)
+{
+  Association association;
+  association.packedFrom.resize(event.pruned.size());
+  association.packedIsFromB.assign(event.packed.size(), false);
+  association.packedIsFromC.assign(event.packed.size(), false);
+  for (size_t i=0; i<event.pruned.size(); i++)
+  {
+  if ( !ancestry.Tags(i) ) continue;
+    const Particle* Ancestor = &event.pruned[i];
+    for (size_t j=0; j<event.packed.size(); j++)
+    {
+    if ( !selected(event.packed[j]) ) continue;
+      const Particle* motherInPrunedCollection = event.packed[j].mother(0);
+    if ( !(motherInPrunedCollection != nullptr && isAncestor( Ancestor , motherInPrunedCollection)) ) continue;
+      association.packedFrom[i].push_back(j);
+      if ( ancestry.Tags(i) & Ancestry::kFinalB ) association.packedIsFromB[j] = true;
+      if ( ancestry.Tags(i) & Ancestry::kFinalC ) association.packedIsFromC[j] = true;
+    }
+  }
+  return association;
+}
+
+static bool sameAssociation(const Association& a, const Association& b)
+{
+  return a.packedFrom == b.packedFrom && a.packedIsFromB == b.packedIsFromB && a.packedIsFromC == b.packedIsFromC;
+}
+
+// LLP daughters and their isFromB/C flags with the previous matching on pt/eta/phi to the b and c daughters,
+// as FlyingTopProducer did: counts the flags set by identity and not by the matching (missed) and the other way (extra)
+struct FlagDiff {
+  int nDaughters = 0, nMissed = 0, nExtra = 0;
+};
+
+static FlagDiff fuzzyFlags(const Event& event, const Ancestry& ancestry, const Association& association)
+{
+  std::vector<int>   genFromB_pdgId, genFromC_pdgId;
+  std::vector<float> genFromB_pt, genFromB_eta, genFromB_phi, genFromC_pt, genFromC_eta, genFromC_phi;
+  for (size_t i=0; i<event.pruned.size(); i++) {
+    for (size_t j : association.packedFrom[i]) {
+      const Particle& particle = event.packed[j];
+      if ( ancestry.Tags(i) & Ancestry::kFinalC ) {
+        genFromC_pdgId.push_back(particle.pdgId());
+        genFromC_pt.push_back(particle.pt()); genFromC_eta.push_back(particle.eta()); genFromC_phi.push_back(particle.phi());
+      }
+      if ( ancestry.Tags(i) & Ancestry::kFinalB ) {
+        genFromB_pdgId.push_back(particle.pdgId());
+        genFromB_pt.push_back(particle.pt()); genFromB_eta.push_back(particle.eta()); genFromB_phi.push_back(particle.phi());
+      }
+    }
+  }
+  auto match = [](const Particle& particle, const std::vector<int>& pdgId, const std::vector<float>& pt,
+                  const std::vector<float>& eta, const std::vector<float>& phi) {
+    float pack_pdgId = particle.pdgId();
+    for (size_t k = 0; k < pdgId.size(); k++)
+    {
+    if ( pack_pdgId != pdgId[k] ) continue;
+      float dpt  = std::abs( particle.pt() / pt[k] - 1.f );
+      float deta = std::abs( particle.eta() - eta[k] );
+      float dphi = std::abs( DeltaPhi( particle.phi(), phi[k] ) );
+      if ( deta < 0.01 && dphi < 0.01 && dpt < 0.01 ) return true;
+    }
+    return false;
+  };
+  FlagDiff diff;
+  for (size_t i=0; i<event.pruned.size(); i++) {
+  if ( !(ancestry.Tags(i) & Ancestry::kLLP) ) continue;
+    for (size_t j : association.packedFrom[i]) {
+      bool matchB = match(event.packed[j], genFromB_pdgId, genFromB_pt, genFromB_eta, genFromB_phi);
+      bool matchC = match(event.packed[j], genFromC_pdgId, genFromC_pt, genFromC_eta, genFromC_phi);
+      diff.nDaughters++;
+      if ( ( association.packedIsFromB[j] && !matchB ) || ( association.packedIsFromC[j] && !matchC ) ) diff.nMissed++;
+      if ( ( !association.packedIsFromB[j] && matchB ) || ( !association.packedIsFromC[j] && matchC ) ) diff.nExtra++;
+    }
+  }
+  return diff;
+}
+
+int main()
+{
+  // a chain written by hand: smuon -> neutralino -> b -> B* -> B -> D -> (hidden rho) -> pi
+  {
+    Event event;
+    auto add = [&event](Particles& particles, int pdgId, const Particle* mother, float pt = 5., float eta = 0.5, int charge = 0) {
+      particles.emplace_back();
+      Particle& particle = particles.back();
+      particle.pdgId_ = pdgId; particle.pt_ = pt; particle.eta_ = eta; particle.charge_ = charge;
+      if ( mother ) {
+        particle.mothers.push_back(mother);
+        if ( &particles != &event.packed ) const_cast<Particle*>(mother)->daughters.push_back(&particle);
+      }
+      return &particle;
+    };
+    const Particle* smuon      = add(event.pruned, 1000013, nullptr);
+    const Particle* neutralino = add(event.pruned, 1000023, smuon);
+    const Particle* bQuark     = add(event.pruned, 5, neutralino);
+    const Particle* bStar      = add(event.pruned, 513, bQuark);
+    const Particle* b          = add(event.pruned, 511, bStar);
+    const Particle* d          = add(event.pruned, 421, b);
+    const Particle* rho        = add(event.hidden, 113, d);
+    const Particle* uQuark     = add(event.pruned, 2, neutralino);
+    add(event.packed, 211, rho, 2., 0.5, 1);
+    add(event.packed, -211, d, 2., 0.5, -1);
+    add(event.packed, 211, b, 0.5, 0.5, 1);     // below the pt cut
+    add(event.packed, 13, smuon, 20., 1., -1);
+    add(event.packed, 211, nullptr, 3., 0., 1);
+    add(event.packed, 211, uQuark, 2.01, 0.505, 1);  // close to the first pion, but not from the b
+    Ancestry ancestry(event.pruned);
+    tag(event.pruned, ancestry);
+    check( ancestry.Tags(1) == Ancestry::kLLP && ancestry.Tags(3) == 0 && ancestry.Tags(4) == Ancestry::kFinalB
+           && ancestry.Tags(5) == Ancestry::kFinalC, "tags of the hand written chain" );
+    Association association = indexFrom(event, ancestry);
+    check( association.packedFrom[1] == std::vector<size_t>({0, 1, 5}) && association.packedFrom[4] == std::vector<size_t>({0, 1})
+           && association.packedFrom[5] == std::vector<size_t>({0, 1}) && association.packedFrom[0].empty(),
+           "final particles of the hand written chain" );
+    check( association.packedIsFromB == std::vector<bool>({true, true, false, false, false, false})
+           && association.packedIsFromC == std::vector<bool>({true, true, false, false, false, false}), "isFromB/C of the hand written chain" );
+    check( sameAssociation(association, scanFrom(event, ancestry)), "hand written chain, same as the isAncestor scan" );
+    FlagDiff diff = fuzzyFlags(event, ancestry, association);
+    check( diff.nDaughters == 3 && diff.nMissed == 0 && diff.nExtra == 1, "hand written chain, the pt/eta/phi matching flags the pion close to a b daughter" );
+  }
+
+  // random events
+  Generator generator(2025);
+  int nDiff = 0, nTagged = 0, nFromLLP = 0, nMultiMother = 0;
+  FlagDiff flagDiff;
+  const int nEvents = 5000;
+  for (int e=0; e<nEvents; e++) {
+    Event event = generator.Next();
+    Ancestry ancestry(event.pruned);
+    tag(event.pruned, ancestry);
+    Association association = indexFrom(event, ancestry);
+    if ( !sameAssociation(association, scanFrom(event, ancestry)) ) nDiff++;
+    FlagDiff diff = fuzzyFlags(event, ancestry, association);
+    flagDiff.nDaughters += diff.nDaughters;
+    flagDiff.nMissed    += diff.nMissed;
+    flagDiff.nExtra     += diff.nExtra;
+    for (size_t i=0; i<event.pruned.size(); i++) {
+      if ( ancestry.Tags(i) ) nTagged++;
+      if ( ancestry.Tags(i) & Ancestry::kLLP ) nFromLLP += association.packedFrom[i].size();
+      if ( event.pruned[i].numberOfMothers() > 1 ) nMultiMother++;
+    }
+  }
+  check( nTagged > nEvents && nFromLLP > nEvents && nMultiMother > 0,
+         "random events: " + std::to_string(nTagged) + " tagged particles, " + std::to_string(nFromLLP) + " LLP daughters, "
+         + std::to_string(nMultiMother) + " strings" );
+  check( nDiff == 0, std::to_string(nEvents) + " random events, same as the isAncestor scan (" + std::to_string(nDiff) + " differ)" );
+  check( flagDiff.nDaughters == nFromLLP && flagDiff.nMissed == 0,
+         std::to_string(flagDiff.nDaughters) + " LLP daughters, isFromB/C flags also set by the pt/eta/phi matching ("
+         + std::to_string(flagDiff.nMissed) + " missed, " + std::to_string(flagDiff.nExtra) + " only set by the matching)" );
+
+  std::cout << " testGenAncestry: " << nFailed << " failed" << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}
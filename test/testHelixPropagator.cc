@@ -0,0 +1,275 @@
+// Unit test of ../interface/HelixPropagator.h.
+// The crossings with the barrel cylinders and the endcap disks must be the ones of a reference Runge-Kutta stepper
+// of the motion in the uniform field (refCrossing below), within 50 um for tracks of 0.5 to 100 GeV: for the
+// barrel when the helix circle reaches the cylinder, for the disks when the disk is reached within one turn.
+// At very high pt they must be the straight line crossings, and near it they must stay within the sagitta of the
+// straight line: this is also the difference on the disks with PropaHitPattern, which crosses the disk planes with a
+// straight line (StraightLinePlaneCrossing) while HelixPropagator follows the helix to them.
+// The fallbacks must be the geometric ones of PropaHitPattern: pz = 0 or a disk behind the track, looping tracks
+// that never reach their cylinder or only reach their disk after more than one turn, and first hits that are not
+// in the Tracker DataBase.
+
+// system include files
+#include <vector>
+#include <string>
+#include <random>
+#include <iostream>
+#include <cmath>
+#include <cstdint>
+
+// user include files
+#include "../interface/HelixPropagator.h"
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+  std::cout << ( ok ? " ok     " : " FAILED " ) << what << std::endl;
+  if ( !ok ) nFailed++;
+}
+
+static const float Bz = 3.8;
+static const double kappa = 0.299792458e-2 * Bz;  // GeV/cm per unit charge
+
+struct Track {
+  float x0, y0, z0, px, py, pz;
+  int   charge;
+  uint16_t firsthit;
+};
+
+struct Position {
+  float x, y, z;
+  int   region;
+  bool  valid;
+};
+
+static Position propagate(const HelixPropagator& propagator, const Track& track)
+{
+  Position position;
+  unsigned char valid;
+  propagator.Propagate(1, &track.x0, &track.y0, &track.z0, &track.px, &track.py, &track.pz, &track.charge, &track.firsthit,
+                       &position.x, &position.y, &position.z, &position.region, &valid);
+  position.valid = valid;
+  return position;
+}
+
+// reference: Runge-Kutta (4th order) integration of dr/dl = p/|p|, dp/dl = q kappa (p x z)/|p| along the path
+// length l, in double, until the track crosses the cylinder (x^2+y^2 = R^2) or the disk plane (z = zDisk);
+// gives the crossing and the transverse path length to it, false if there is none within maxPath
+struct State {
+  double r[3], p[3];
+};
+
+static State rk4Step(const State& s, double h, int charge)
+{
+  auto deriv = [charge](const State& s) {
+    double p = std::sqrt(s.p[0]*s.p[0] + s.p[1]*s.p[1] + s.p[2]*s.p[2]);
+    State d;
+    for (int i=0; i<3; i++) d.r[i] = s.p[i] / p;
+    d.p[0] =  charge * kappa * s.p[1] / p;
+    d.p[1] = -charge * kappa * s.p[0] / p;
+    d.p[2] = 0.;
+    return d;
+  };
+  auto add = [](const State& s, const State& d, double h) {
+    State t;
+    for (int i=0; i<3; i++) { t.r[i] = s.r[i] + h * d.r[i]; t.p[i] = s.p[i] + h * d.p[i]; }
+    return t;
+  };
+  State k1 = deriv(s);
+  State k2 = deriv(add(s, k1, h/2));
+  State k3 = deriv(add(s, k2, h/2));
+  State k4 = deriv(add(s, k3, h));
+  State next;
+  for (int i=0; i<3; i++) {
+    next.r[i] = s.r[i] + h / 6. * ( k1.r[i] + 2.*k2.r[i] + 2.*k3.r[i] + k4.r[i] );
+    next.p[i] = s.p[i] + h / 6. * ( k1.p[i] + 2.*k2.p[i] + 2.*k3.p[i] + k4.p[i] );
+  }
+  return next;
+}
+
+static bool refCrossing(const Track& track, bool disk, double pos, double maxPath, double& x, double& y, double& z, double& sTransverse)
+{
+  State s = {{track.x0, track.y0, track.z0}, {track.px, track.py, track.pz}};
+  double zDisk = ( track.pz < 0 ) ? -pos : pos;
+  auto f = [&](const State& s) { return disk ? ( s.r[2] - zDisk ) * ( zDisk > 0 ? 1. : -1. ) : s.r[0]*s.r[0] + s.r[1]*s.r[1] - pos*pos; };
+  if ( f(s) >= 0 ) return false;
+  const double h = 1.;  // cm, the error of a step is ~ r (h/r)^5
+  double p  = std::sqrt(double(track.px)*track.px + double(track.py)*track.py + double(track.pz)*track.pz);
+  double pt = std::sqrt(double(track.px)*track.px + double(track.py)*track.py);
+  for (double l=0.; l<maxPath; l+=h) {
+    State next = rk4Step(s, h, track.charge);
+    if ( f(next) >= 0 ) {
+      // bisection on the length of the last step
+      double lo = 0., hi = h;
+      for (int it=0; it<60; it++) {
+        double mid = 0.5 * ( lo + hi );
+        if ( f(rk4Step(s, mid, track.charge)) >= 0 ) hi = mid;
+        else lo = mid;
+      }
+      State crossing = rk4Step(s, hi, track.charge);
+      x = crossing.r[0]; y = crossing.r[1]; z = crossing.r[2];
+      sTransverse = ( l + hi ) * pt / p;
+      return true;
+    }
+    s = next;
+  }
+  return false;
+}
+
+static float distance(const Position& position, double x, double y, double z)
+{
+  return std::sqrt( (position.x-x)*(position.x-x) + (position.y-y)*(position.y-y) + (position.z-z)*(position.z-z) );
+}
+
+static Track makeTrack(float pt, float eta, float phi, int charge, uint16_t firsthit, float x0 = 0., float y0 = 0., float z0 = 0.)
+{
+  return Track{x0, y0, z0, float(pt * std::cos(phi)), float(pt * std::sin(phi)), float(pt * std::sinh(eta)), charge, firsthit};
+}
+
+static const uint16_t barrel[] = {1160, 1168, 1176, 1184, 1416, 1420, 1424, 1428, 1432, 1440, 1672};
+static const uint16_t disks[]  = {1288, 1296, 1304, 1544, 1548, 1552, 1556, 1560, 1564, 1800, 1804, 1808, 1812, 1816, 1820,
+                                  1824, 1828, 1832, 1836, 1840, 1844, 1848};
+
+int main()
+{
+  HelixPropagator propagator(Bz);
+  const float tolerance = 50.e-4;  // cm, the float precision of the propagator for the large radii of the high pt tracks
+
+  // single tracks against the reference
+  {
+    Track track = makeTrack(2., 0.3, 0.7, 1, 1672, 0.1, -0.05, 2.);
+    Position position = propagate(propagator, track);
+    double x, y, z, s;
+    bool found = refCrossing(track, false, 60.43, 1000., x, y, z, s);
+    check( found && position.valid && position.region == 0 && distance(position, x, y, z) < tolerance
+           && std::fabs(std::sqrt(position.x*position.x + position.y*position.y) - 60.43) < tolerance, "2 GeV track to TOBL1" );
+    track = makeTrack(1.5, -1.8, -2.5, -1, 1560, -0.2, 0.3, -5.);
+    position = propagate(propagator, track);
+    found = refCrossing(track, true, 102.7, 2000., x, y, z, s);
+    check( found && position.valid && position.region == 1 && distance(position, x, y, z) < tolerance && std::fabs(position.z + 102.7) < tolerance,
+           "1.5 GeV track to TIDWHeel3, backward" );
+  }
+
+  // random tracks from 0.5 to 100 GeV, displaced by up to 1 cm in x and y and 10 cm in z
+  std::mt19937 rng(2025);
+  std::uniform_real_distribution<float> u(0., 1.);
+  int nBarrel = 0, nDisk = 0, nBarrelDiff = 0, nDiskDiff = 0, nValidDiff = 0, nFallbacks = 0;
+  float maxBarrel = 0., maxDisk = 0.;
+  for (int t=0; t<20000; t++) {
+    float pt  = 0.5f * std::pow(200.f, u(rng));
+    float eta = 5.f * u(rng) - 2.5f;
+    bool  isDisk = ( t % 2 == 1 );
+  if ( isDisk && std::fabs(eta) < 0.1 ) continue;  // thousands of turns before the disk
+    float phi = float(2. * M_PI * u(rng) - M_PI);
+    uint16_t firsthit = isDisk ? disks[ int(u(rng) * 22) % 22 ] : barrel[ int(u(rng) * 11) % 11 ];
+    Track track = makeTrack(pt, eta, phi, ( u(rng) < 0.5 ) ? 1 : -1, firsthit, 2.f * u(rng) - 1.f, 2.f * u(rng) - 1.f, 20.f * u(rng) - 10.f);
+    const TrackerSurface& surface = FirstHitSurface(firsthit);
+    // the helix circle, to leave out the tracks that just touch their cylinder or reach their disk after one turn
+    double r  = pt / kappa;
+    double cx = track.x0 + track.charge * track.py / pt * r, cy = track.y0 - track.charge * track.px / pt * r;
+    double rMax = std::sqrt(cx*cx + cy*cy) + r;
+    double x, y, z, s;
+    // the path length to the disk plane, or at most one turn to the cylinder
+    double maxPath = isDisk ? ( surface.pos + 10. ) / std::fabs(std::tanh(eta)) + 1. : std::fmin(2. * M_PI * r, 2. * M_PI * ( surface.pos + 2. )) * std::cosh(eta);
+    bool found = refCrossing(track, isDisk, surface.pos, maxPath, x, y, z, s);
+    bool expected = found && ( !isDisk || s / r < 2. * M_PI );
+    if ( !isDisk && std::fabs(rMax - surface.pos) < 0.01 ) continue;
+    if ( isDisk && found && std::fabs(s / r - 2. * M_PI) < 1.e-3 ) continue;
+    Position position = propagate(propagator, track);
+    if ( position.valid != expected || position.region != surface.region ) {
+      nValidDiff++;
+      continue;
+    }
+    if ( !expected ) {
+      nFallbacks++;
+      continue;
+    }
+    float d = distance(position, x, y, z);
+    if ( isDisk ) {
+      nDisk++;
+      if ( d > tolerance ) nDiskDiff++;
+      if ( d > maxDisk ) maxDisk = d;
+    }
+    else {
+      nBarrel++;
+      if ( d > tolerance ) nBarrelDiff++;
+      if ( d > maxBarrel ) maxBarrel = d;
+    }
+  }
+  check( nValidDiff == 0, "random tracks, crossing found as by the reference (" + std::to_string(nValidDiff) + " differ, "
+         + std::to_string(nFallbacks) + " fallbacks)" );
+  check( nBarrel > 1000 && nBarrelDiff == 0, std::to_string(nBarrel) + " barrel crossings within 50 um of the reference (max "
+         + std::to_string(1.e4 * maxBarrel) + " um)" );
+  check( nDisk > 1000 && nDiskDiff == 0, std::to_string(nDisk) + " disk crossings within 50 um of the reference (max "
+         + std::to_string(1.e4 * maxDisk) + " um)" );
+
+  // straight line limit: below |rho| = 1e-6 /cm the propagator uses the straight line
+  {
+    Track track = makeTrack(1.e5, 1.2, 0.4, 1, 1816, 0.3, -0.2, 4.);
+    Position position = propagate(propagator, track);
+    double s = ( 160.1 - track.z0 ) / track.pz;
+    check( position.valid && std::fabs(position.x - ( track.x0 + track.px * s )) < 1.e-3 && std::fabs(position.y - ( track.y0 + track.py * s )) < 1.e-3
+           && position.z == 160.1f, "100 TeV track, straight line to the disk" );
+    track = makeTrack(1.e5, 0.2, -1.1, -1, 1440, 0.3, -0.2, 4.);
+    position = propagate(propagator, track);
+    double pt = std::sqrt(double(track.px)*track.px + double(track.py)*track.py);
+    double ux = track.px / pt, uy = track.py / pt, b = track.x0 * ux + track.y0 * uy;
+    double sLine = -b + std::sqrt(b*b - ( track.x0*track.x0 + track.y0*track.y0 - 49.71*49.71 ));
+    check( position.valid && std::fabs(position.x - ( track.x0 + ux * sLine )) < 1.e-3 && std::fabs(position.y - ( track.y0 + uy * sLine )) < 1.e-3
+           && std::fabs(position.z - ( track.z0 + track.pz / pt * sLine )) < 1.e-3, "100 TeV track, straight line to the cylinder" );
+  }
+  // near the straight line, and the difference with the straight line plane crossing of PropaHitPattern on the disks
+  for (float pt : {500.f, 20.f, 2.f}) {
+    Track track = makeTrack(pt, 2.2, 1.3, 1, 1848, 0., 0., 0.);
+    Position position = propagate(propagator, track);
+    double s = 222.2 / track.pz;
+    double xLine = track.px * s, yLine = track.py * s;
+    double sT = 222.2 / std::sinh(2.2), sagitta = 0.5 * sT * sT * kappa / pt;
+    double dLine = std::sqrt( (position.x-xLine)*(position.x-xLine) + (position.y-yLine)*(position.y-yLine) );
+    double x, y, z, sRef;
+    bool found = refCrossing(track, true, 222.2, 1000., x, y, z, sRef);
+    check( position.valid && found && distance(position, x, y, z) < tolerance && std::fabs(dLine - sagitta) < 0.01 * sagitta + 1.e-3,
+           std::to_string(int(pt)) + " GeV track to TECWHeel7, " + std::to_string(dLine) + " cm from the straight line (sagitta "
+           + std::to_string(sagitta) + " cm)" );
+  }
+
+  // fallbacks
+  {
+    // pz = 0 on a disk: no crossing, the disk z along the track phi
+    Track track = makeTrack(3., 0., 0.6, 1, 1296);
+    Position position = propagate(propagator, track);
+    check( !position.valid && position.region == 1 && position.z == 39.41f && position.x > 0 && position.y > 0, "pz = 0 on a disk" );
+    // disk behind the track: the geometric crossing, behind too
+    track = makeTrack(3., 0.5, 0.6, 1, 1288, 0., 0., 40.);
+    position = propagate(propagator, track);
+    float tanTheta = 1. / std::sinh(0.5);
+    float Rfb = ( 32.35 - 40. ) * tanTheta;
+    check( !position.valid && position.z == 32.35f && std::fabs(position.x - Rfb * std::cos(0.6)) < 1.e-4 && std::fabs(position.y - Rfb * std::sin(0.6)) < 1.e-4,
+           "disk behind the track" );
+    // looping in the barrel: a 0.3 GeV track from the origin turns within 2 r = 53 cm, it never reaches TOBL1
+    track = makeTrack(0.3, 0.4, -2., -1, 1672);
+    position = propagate(propagator, track);
+    double x, y, z, s;
+    bool found = refCrossing(track, false, 60.43, 2000., x, y, z, s);
+    check( !found && !position.valid && position.region == 0 && std::fabs(position.x - 60.43 * std::cos(-2.)) < 1.e-4
+           && std::fabs(position.y - 60.43 * std::sin(-2.)) < 1.e-4 && std::fabs(position.z - 60.43 * std::sinh(0.4)) < 1.e-3,
+           "0.3 GeV track looping before TOBL1" );
+    // looping to a disk: a 0.6 GeV track at eta 0.05 reaches TECWHeel1 after several turns
+    track = makeTrack(0.6, 0.05, 1., 1, 1800);
+    position = propagate(propagator, track);
+    found = refCrossing(track, true, 131.6, 50000., x, y, z, s);
+    tanTheta = 1. / std::sinh(0.05);
+    Rfb = 131.6 * tanTheta;
+    check( found && s * kappa / 0.6 > 2. * M_PI && !position.valid && position.region == 1 && position.z == 131.6f
+           && std::fabs(position.x - Rfb * std::cos(1.)) < 1.e-2 && std::fabs(position.y - Rfb * std::sin(1.)) < 1.e-2,
+           "0.6 GeV track reaching TECWHeel1 after more than one turn" );
+    // first hit not in the Tracker DataBase
+    track = makeTrack(5., 0.5, 0.6, 1, 1192);
+    position = propagate(propagator, track);
+    check( !position.valid && position.x == -1000. && position.y == -1000. && position.z == -1000., "first hit not in the Tracker DataBase" );
+  }
+
+  std::cout << " testHelixPropagator: " << nFailed << " failed" << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}
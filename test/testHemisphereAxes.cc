@@ -0,0 +1,199 @@
+// Unit test of ../interface/HemisphereAxes.h.
+// The axes must be the same, to the last bit, as the ones of the TLorentzVector loops of FlyingTopProducer that
+// HemisphereAxes replaced (previousAxes below): for 0, 1, 2 and 150 jets, with jets below the pt cut and beyond
+// the eta cut, with the muons of the Z candidate inside the jets (also taking a jet below the pt cut), and for
+// random events of up to 150 jets. The DeltaR of the last jet to the axes in the loop (LastDR1/LastDR2), that the
+// producer keeps for the comparison with the gen neutralinos, must be the same too.
+// Without ROOT, the standalone build uses the TLorentzVector of standalone/noroot.
+
+// system include files
+#include <vector>
+#include <string>
+#include <random>
+#include <iostream>
+#include <cmath>
+
+// user include files
+#include "TLorentzVector.h"
+
+#include "../interface/HemisphereAxes.h"
+#include "../interface/DeltaFunc.h"
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+  std::cout << ( ok ? " ok     " : " FAILED " ) << what << std::endl;
+  if ( !ok ) nFailed++;
+}
+
+struct Object {
+  float pt, eta, phi;
+};
+
+struct Axes {
+  int   nJets[2];
+  float axes[4];  // eta, phi of axis 1, eta, phi of axis 2
+  float dR[2];    // dR1, dR2 at the end of the jet loop
+};
+
+// hemisphere axes as FlyingTopProducer built them before HemisphereAxes, with TLorentzVector sums;
+// muons are the (up to two) muons of the Z candidate
+static Axes previousAxes(const std::vector<Object>& jets, const std::vector<Object>& muons, float PtMin = 20., float EtaMax = 10.)
+{
+  int njet1 = 0, njet2 = 0;
+  std::vector<char> isjet1, isjet2;
+  std::vector<TLorentzVector> vjet;
+  TLorentzVector v, v1, vaxis1, vaxis2;
+  for (const auto& jet : jets) {
+    float jet_pt  = jet.pt;
+    float jet_eta = jet.eta;
+    float jet_phi = jet.phi;
+    v.SetPtEtaPhiM( jet_pt, jet_eta, jet_phi, 0. );
+  if ( jet_pt < PtMin ) continue;
+  if ( std::abs(jet_eta) > EtaMax ) continue;
+    bool subtracted = false;
+    for (const auto& mu : muons) {
+      if ( DeltaR2( jet_eta, jet_phi, mu.eta, mu.phi ) >= 0.16 ) continue;
+      v1.SetPtEtaPhiM( mu.pt, mu.eta, mu.phi, 0 );
+      v -= v1;
+      subtracted = true;
+    }
+    if ( subtracted ) {
+      jet_pt  = v.Pt();
+      jet_eta = v.Eta();
+    }
+    vjet.push_back(v);
+    isjet1.push_back(false);
+    isjet2.push_back(false);
+    if ( njet1 == 0 && jet_pt > PtMin && std::abs(jet_eta) < EtaMax ) {
+      njet1 = 1;
+      isjet1.back() = true;
+      vaxis1 = v;
+    }
+  }
+  float dR1 = 10., dR2 = 10.;
+  float dRcut_hemis = 1.5;
+  for (unsigned int i=0; i<vjet.size(); i++) {
+    float jet_eta = vjet[i].Eta();
+    float jet_phi = vjet[i].Phi();
+    if ( njet1 > 0 ) dR1 = sqrt( DeltaR2( jet_eta, jet_phi, vaxis1.Eta(), vaxis1.Phi() ) );
+    if ( njet2 > 0 ) dR2 = sqrt( DeltaR2( jet_eta, jet_phi, vaxis2.Eta(), vaxis2.Phi() ) );
+    if ( njet1 > 0 && !isjet2[i] && dR1 < dRcut_hemis ) {
+      njet1++;
+      vaxis1 += vjet[i];
+      isjet1[i] = true;
+    }
+    if ( njet2 == 0 && !isjet1[i] ) {
+      njet2 = 1;
+      vaxis2 = vjet[i];
+      isjet2[i] = true;
+    }
+    else if ( njet2 > 0 && !isjet1[i] && !isjet2[i] && dR2 < dRcut_hemis ) {
+      njet2++;
+      vaxis2 += vjet[i];
+      isjet2[i] = true;
+    }
+  }
+  Axes result;
+  result.nJets[0] = njet1;
+  result.nJets[1] = njet2;
+  result.dR[0] = dR1;
+  result.dR[1] = dR2;
+  result.axes[0] = vaxis1.Eta();
+  result.axes[1] = vaxis1.Phi();
+  result.axes[2] = vaxis2.Eta();
+  result.axes[3] = vaxis2.Phi();
+  if ( njet2 == 0 ) {
+    result.axes[2] = result.axes[0];
+    result.axes[3] = result.axes[1] - 3.14159;
+    if ( result.axes[1] < 0 ) result.axes[3] = result.axes[1] + 3.14159;
+  }
+  return result;
+}
+
+// HemisphereAxes on the same jets and muons, true if it gives the same axes as previousAxes
+static bool sameAxes(HemisphereAxes& hemiAxes, const std::vector<Object>& jets, const std::vector<Object>& muons, float ptMin = 20., float etaMax = 10.)
+{
+  hemiAxes.Clear();
+  for (const auto& mu : muons) hemiAxes.AddMuon(mu.pt, mu.eta, mu.phi);
+  for (const auto& jet : jets) hemiAxes.AddJet(jet.pt, jet.eta, jet.phi);
+  hemiAxes.Build();
+  Axes ref = previousAxes(jets, muons, ptMin, etaMax);
+  return hemiAxes.NJets1() == ref.nJets[0] && hemiAxes.NJets2() == ref.nJets[1]
+      && hemiAxes.Eta1() == ref.axes[0] && hemiAxes.Phi1() == ref.axes[1] && hemiAxes.Eta2() == ref.axes[2] && hemiAxes.Phi2() == ref.axes[3]
+      && hemiAxes.LastDR1() == ref.dR[0] && hemiAxes.LastDR2() == ref.dR[1];
+}
+
+static std::vector<Object> randomJets(int n, std::mt19937& rng)
+{
+  std::uniform_real_distribution<float> u(0., 1.);
+  std::exponential_distribution<float> expo(1.);
+  std::vector<Object> jets;
+  for (int j=0; j<n; j++) jets.push_back( {10.f + 40.f * expo(rng), 10.f * u(rng) - 5.f, float(2. * M_PI * u(rng) - M_PI)} );
+  return jets;
+}
+
+int main()
+{
+  HemisphereAxes hemiAxes;
+  const std::vector<Object> noMuon;
+  std::mt19937 rng(2025);
+
+  // no jet: both axes at 0, axis 2 opposite in phi
+  check( sameAxes(hemiAxes, {}, noMuon) && hemiAxes.NJets() == 0 && hemiAxes.NJets1() == 0 && hemiAxes.NJets2() == 0
+         && hemiAxes.LastDR1() == 10. && hemiAxes.LastDR2() == 10., "0 jets" );
+  check( sameAxes(hemiAxes, {{15., 0.5, 1.}, {19.9, -1., -2.}}, noMuon) && hemiAxes.NJets() == 0, "0 jets above the pt cut" );
+
+  // one jet: its seed is counted twice in axis 1
+  check( sameAxes(hemiAxes, {{50., 0.5, 1.}}, noMuon) && hemiAxes.NJets1() == 2 && hemiAxes.NJets2() == 0
+         && hemiAxes.LastDR1() == 0. && hemiAxes.LastDR2() == 10., "1 jet" );
+  check( sameAxes(hemiAxes, {{50., 0.5, -1.}}, noMuon) && hemiAxes.Phi2() == float(-1. + 3.14159), "1 jet at negative phi, axis 2 opposite" );
+
+  // two jets, back to back and close
+  check( sameAxes(hemiAxes, {{80., 0.3, 0.2}, {60., -0.4, 0.2 - 3.1}}, noMuon) && hemiAxes.NJets1() == 2 && hemiAxes.NJets2() == 1
+         && hemiAxes.LastDR1() > 3. && hemiAxes.LastDR2() == 10., "2 jets back to back, last dR1 of the second jet to axis 1" );
+  check( sameAxes(hemiAxes, {{80., 0.3, 0.2}, {60., 0.5, 0.6}}, noMuon) && hemiAxes.NJets1() == 3 && hemiAxes.NJets2() == 0, "2 jets in one hemisphere" );
+
+  // 150 jets
+  bool ok150 = true;
+  for (int e=0; e<100; e++) ok150 = sameAxes(hemiAxes, randomJets(150, rng), noMuon) && ok150;
+  check( ok150, "150 jets, 100 events" );
+
+  // eta cut
+  std::vector<Object> forward = {{70., 3.5, 0.1}, {50., 1., 2.}, {40., -2.8, -1.}};
+  HemisphereAxes central(20., 2.4);
+  check( sameAxes(central, forward, noMuon, 20., 2.4) && central.NJets() == 1, "jets beyond the eta cut dropped" );
+
+  // muons of the Z candidate inside the jets
+  std::vector<Object> jets = {{60., 0.2, 1.}, {45., -1., -2.}, {30., 1.5, 2.5}};
+  check( sameAxes(hemiAxes, jets, {{30., 0.25, 1.05}}), "1 muon inside the first jet" );
+  check( sameAxes(hemiAxes, jets, {{30., 0.25, 1.05}, {25., -1.1, -1.95}}), "2 muons inside two jets" );
+  check( sameAxes(hemiAxes, jets, {{20., 0.25, 1.05}, {15., 0.1, 0.9}}), "2 muons inside the same jet" );
+  check( sameAxes(hemiAxes, jets, {{50., 0.2, 1.02}}) && hemiAxes.NJets() == 3, "muon taking the first jet below the pt cut, the seed moves" );
+  check( sameAxes(hemiAxes, jets, {{60., 0.2, 1.}}), "muon as the whole first jet" );
+
+  // random events, with the muons on jets half of the time
+  std::uniform_real_distribution<float> u(0., 1.);
+  int nDiff = 0;
+  const int nEvents = 20000;
+  for (int e=0; e<nEvents; e++) {
+    std::vector<Object> eventJets = randomJets( int(u(rng) * 151), rng );
+    std::vector<Object> muons;
+    int nMuons = int(u(rng) * 3);
+    for (int m=0; m<nMuons; m++) {
+      Object mu = {20.f + 40.f * u(rng), 5.f * u(rng) - 2.5f, float(2. * M_PI * u(rng) - M_PI)};
+      if ( !eventJets.empty() && u(rng) < 0.5 ) {
+        const Object& jet = eventJets[ int(u(rng) * eventJets.size()) % eventJets.size() ];
+        mu.eta = jet.eta + 0.3f * (u(rng) - 0.5f);
+        mu.phi = jet.phi + 0.3f * (u(rng) - 0.5f);
+      }
+      muons.push_back(mu);
+    }
+    if ( !sameAxes(hemiAxes, eventJets, muons) ) nDiff++;
+  }
+  check( nDiff == 0, std::to_string(nEvents) + " random events of 0 to 150 jets and 0 to 2 muons (" + std::to_string(nDiff) + " differ)" );
+
+  std::cout << " testHemisphereAxes: " << nFailed << " failed" << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}
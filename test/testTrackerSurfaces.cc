@@ -0,0 +1,89 @@
+// Unit test of ../interface/TrackerSurfaces.h: for all the 65536 hit pattern words, FirstHitSurface must give the
+// surface that the previous PropaHitPattern found with its disk/cylinder chain of comparisons and its scans of the
+// Layer and Disk vectors, with the uncertainty of its Cyl/stdCyl and disk/stddisk arrays, and none for any other word.
+// The substructure of each layer code must also be the one of its region (barrel or endcap).
+
+// system include files
+#include <vector>
+#include <string>
+#include <utility>
+#include <iostream>
+#include <cstdint>
+
+// user include files
+#include "../interface/TrackerSurfaces.h"
+
+static int nFailed = 0;
+
+static void check(bool ok, const std::string& what)
+{
+  std::cout << ( ok ? " ok     " : " FAILED " ) << what << std::endl;
+  if ( !ok ) nFailed++;
+}
+
+// the DataBase of PropaHitPattern before TrackerSurfaces.h
+static const std::vector<std::pair<uint16_t,float> > Layer = {
+  {1160,2.959}, {1168,6.778}, {1176,10.89}, {1184,16.}, {1416,23.83}, {1420,27.02}, {1424,32.23}, {1428,35.41},
+  {1432,41.75}, {1440,49.71}, {1672,60.43} };
+static const std::vector<std::pair<uint16_t,float> > Disk = {
+  {1288,32.35}, {1296,39.41}, {1304,48.96}, {1544,77.9}, {1548,80.71}, {1552,90.4}, {1556,94.02}, {1560,102.7},
+  {1564,107.0}, {1800,131.6}, {1804,129.4}, {1808,145.5}, {1812,142.8}, {1816,160.1}, {1820,157.1}, {1824,174.2},
+  {1828,172.7}, {1832,188.4}, {1836,186.3}, {1840,203.2}, {1844,203.8}, {1848,222.2} };
+static const float stdCyl[11]  = {0.2065,0.2,0.1856,0.1819,0.2647,0.2597,0.2747,0.2657,1.606,1.599,1.687};
+static const float stddisk[22] = {1.038,1.211,1.217,1.915,1.613,2.209,1.468,2.131,1.465,3.851,3.585,3.557,3.33,3.519,3.42,3.38,3.508,3.501,3.563,0.618,3.545,0};
+
+// surface of a first hit as PropaHitPattern::Main, PropagateToDisk and PropagateToCylinder found it
+static TrackerSurface previousSurface(uint16_t firsthit)
+{
+  if (firsthit==1288 || firsthit==1296 || firsthit==1304 || firsthit==1544 || firsthit==1548 || firsthit==1552 || firsthit==1556 || firsthit==1560 || firsthit==1564 || firsthit==1800 || firsthit==1804 || firsthit==1808 || firsthit==1812 || firsthit==1816 || firsthit==1820 || firsthit==1824 || firsthit==1828 || firsthit==1832 || firsthit==1836 || firsthit==1840 ||firsthit== 1844 || firsthit==1848)
+    {
+      for (int i=0; i<22; i++) if ( Disk[i].first == firsthit ) return TrackerSurface{1, Disk[i].second, stddisk[i]};
+    }
+  else
+    {
+      for (int i=0; i<11; i++) if ( Layer[i].first == firsthit ) return TrackerSurface{0, Layer[i].second, stdCyl[i]};
+    }
+  return TrackerSurface{-1, 0., 0.};
+}
+
+int main()
+{
+  // every word of 16 bits
+  int nDiff = 0, nFound = 0;
+  for (unsigned int word=0; word<65536; word++) {
+    const TrackerSurface& surface = FirstHitSurface(word);
+    TrackerSurface previous = previousSurface(word);
+    if ( surface.region != previous.region || surface.pos != previous.pos || surface.sigma != previous.sigma ) {
+      if ( nDiff < 10 ) std::cout << "   word " << word << ": region " << surface.region << " pos " << surface.pos << " sigma " << surface.sigma
+                                  << " instead of " << previous.region << " " << previous.pos << " " << previous.sigma << std::endl;
+      nDiff++;
+    }
+    if ( surface.region >= 0 ) nFound++;
+  }
+  check( nDiff == 0, "65536 hit pattern words: same surface as the previous PropaHitPattern (" + std::to_string(nDiff) + " differ)" );
+  check( nFound == 33, "33 words are in the DataBase (" + std::to_string(nFound) + " found)" );
+
+  // layer codes: valid tracker hits, one entry of the table each, in the region of their substructure
+  // (1 PXB, 3 TIB, 5 TOB are barrel cylinders, 2 PXF, 4 TID, 6 TEC are endcap disks)
+  int nBad = 0;
+  for (const auto& entry : kTrackerSurfaces) {
+    unsigned int substructure = (entry.hitPattern >> 7) & 0x7;
+    bool ok = IsValidTrackerHit(entry.hitPattern)
+      && &FirstHitSurface(entry.hitPattern) == &kTrackerSurfaceTable[TrackerSurfaceIndex(entry.hitPattern)]
+      && entry.surface.region == ( substructure % 2 == 0 ? 1 : 0 );
+    for (const auto& other : kTrackerSurfaces)
+      if ( &other != &entry && TrackerSurfaceIndex(other.hitPattern) == TrackerSurfaceIndex(entry.hitPattern) ) ok = false;
+    if ( !ok ) {
+      std::cout << "   layer code " << entry.hitPattern << " is wrong" << std::endl;
+      nBad++;
+    }
+  }
+  check( nBad == 0, "the 33 layer codes are valid tracker hits, with their own index, in the region of their substructure" );
+
+  // invalid and missing hits (hit type != 0) and muon hits are never on a surface
+  check( FirstHitSurface(1160 | 1).region == -1 && FirstHitSurface(1160 | 2).region == -1 && FirstHitSurface(1160 | 0x800).region == -1,
+         "a PIXBL1 word with another hit type or detector is not on a surface" );
+
+  std::cout << " testTrackerSurfaces: " << nFailed << " failed" << std::endl;
+  return nFailed == 0 ? 0 : 1;
+}